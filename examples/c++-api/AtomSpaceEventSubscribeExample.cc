@@ -1,6 +1,6 @@
 #include <iostream>
 
-#include <boost/signals2.hpp>
+#include <boost/bind.hpp>
 
 #include <opencog/atomspace/AtomSpace.h>
 #include <opencog/attentionbank/AttentionBank.h>
@@ -32,12 +32,12 @@ int main(int argc, char ** args)
     AtomSpace as;
     AttentionBank& bank(attentionbank(&as));
 
-    boost::signals2::connection AtomAddedSignalConn,
-                                AVChangedSignalConn,
-                                TVChangedSignalConn,
-                                AtomsRemovedSignalConn,
-                                AtomAddedToAttentionalFocusSignalConn,
-                                AtomRemovedFromAttentionalFocusSignalConn;
+    ObserverConnection AtomAddedSignalConn,
+                       AVChangedSignalConn,
+                       TVChangedSignalConn,
+                       AtomsRemovedSignalConn,
+                       AtomAddedToAttentionalFocusSignalConn,
+                       AtomRemovedFromAttentionalFocusSignalConn;
 
     // Register Atomspace and AttentionBank event callback handlers.
     AtomAddedSignalConn = as.addAtomSignal(
@@ -24,8 +24,11 @@
  * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
  */
 
+#include <cmath>
+#include <cstring>
 #include <set>
 #include <sstream>
+#include <utility>
 
 #ifndef WIN32
 #include <unistd.h>
@@ -40,6 +43,8 @@
 
 #include <opencog/atomspace/AtomSpace.h>
 #include <opencog/atomspace/AtomTable.h>
+#include <opencog/atomspace/EpochGuard.h>
+#include <opencog/truthvalue/SimpleTruthValue.h>
 
 //! Atom flag
 #define FETCHED_RECENTLY        1  //BIT0
@@ -50,6 +55,13 @@
 // #define REMOVED_BY_DECAY        32 //BIT5
 #define CHECKED                 64  //BIT6
 
+// Set in a truth-value word that holds a packed simple TV.
+#define TV_PACKED  (((uint64_t) 1) << 63)
+
+// How far a packed mean or confidence may be from the double it came
+// from; ten times tighter than SimpleTruthValue::operator== looks.
+#define TV_FLOAT_ERROR 1.0e-7
+
 //#define DPRINTF printf
 #define DPRINTF(...)
 
@@ -70,54 +82,159 @@ Atom::~Atom()
              classserver().getTypeName(_type).c_str(), get_hash());
     }
     drop_incoming_set();
+
+    // No one can be reading the truth value of an atom that is going
+    // away, so the box, if any, can go at once.
+    free_tv_word(_tv_word.load());
 }
 
 // ==============================================================
 // Whole lotta truthiness going on here.  Does it really need to be
 // this complicated!?
 
+static inline const TruthValuePtr* tv_box(uint64_t w)
+{
+    return (const TruthValuePtr*) (uintptr_t) w;
+}
+
+static inline uint32_t float_bits(float f)
+{
+    uint32_t u;
+    memcpy(&u, &f, sizeof(u));
+    return u;
+}
+
+static inline float bits_float(uint32_t u)
+{
+    float f;
+    memcpy(&f, &u, sizeof(f));
+    return f;
+}
+
+/// All atoms start out sharing the same box, holding the default TV.
+/// It is never freed.
+uint64_t Atom::default_tv_word()
+{
+    static const TruthValuePtr* box =
+        new TruthValuePtr(TruthValue::DEFAULT_TV());
+    return (uint64_t) (uintptr_t) box;
+}
+
+/// Make the word for a truth value: packed, if it is a simple TV that
+/// fits in two floats, else a pointer to a new box.  The two can't be
+/// mistaken for one another, because a packed TV has the top bit set,
+/// and no user-space pointer does.
+static uint64_t make_tv_word(const TruthValuePtr& tv, uint64_t dflt)
+{
+    if (tv.get() == tv_box(dflt)->get()) return dflt;
+
+    if (SIMPLE_TRUTH_VALUE == tv->getType()) {
+        double mean = tv->getMean();
+        double conf = tv->getConfidence();
+        float fmean = mean;
+        float fconf = conf;
+
+        // The confidence goes in the top half, and so can't use the
+        // sign bit.  Anything that a float can't hold to well within
+        // the tolerance of SimpleTruthValue::operator== stays boxed.
+        // NaN and infinity fail these tests, too.
+        if (0.0 <= conf and
+            fabs(fmean - mean) <= TV_FLOAT_ERROR and
+            fabs(fconf - conf) <= TV_FLOAT_ERROR)
+            return TV_PACKED
+                | (((uint64_t) (float_bits(fconf) & 0x7fffffff)) << 32)
+                | float_bits(fmean);
+    }
+    return (uint64_t) (uintptr_t) new TruthValuePtr(tv);
+}
+
+/// The truth value held in the word.  If it is boxed, the caller must
+/// make sure that the box can't be freed meanwhile.
+///
+/// The TruthValues made for packed words are kept, a few dozen per
+/// thread, so that reading the same truth value over and over, as the
+/// hot loops do, gets the same TruthValuePtr, and allocates nothing.
+static TruthValuePtr load_tv_word(uint64_t w)
+{
+    if (not (w & TV_PACKED)) return *tv_box(w);
+
+    static thread_local std::pair<uint64_t, TruthValuePtr> made[64];
+    auto& slot = made[(w * 0x9e3779b97f4a7c15ULL) >> 58];
+    if (slot.first != w) {
+        slot.second = SimpleTruthValue::createTV(
+            bits_float((uint32_t) w), bits_float((w >> 32) & 0x7fffffff));
+        slot.first = w;
+    }
+    return slot.second;
+}
+
+/// Free the box of a word that was never published, or that no
+/// reader can see any more.
+void Atom::free_tv_word(uint64_t w)
+{
+    if (w & TV_PACKED or default_tv_word() == w) return;
+    delete tv_box(w);
+}
+
+/// Free the box of a word that has been swapped out, once every
+/// reader that might have loaded it is done with it.
+void Atom::retire_tv_word(uint64_t w)
+{
+    if (w & TV_PACKED or default_tv_word() == w) return;
+    epoch_delete(tv_box(w));
+}
+
 void Atom::setTruthValue(TruthValuePtr newTV)
 {
     if (nullptr == newTV) return;
 
-    // If both old and new are e.g. DEFAULT_TV, then do nothing.
-    if (_truthValue.get() == newTV.get()) return;
+    // Setting a boxed truth value to an equal one changes nothing,
+    // and so signals nothing, just as for a packed one, below.  The
+    // box can't be freed while we look, because only a writer that
+    // has swapped it out can free it.
+    {
+        EpochGuard guard;
+        uint64_t w = _tv_word.load();
+        if (not (w & TV_PACKED))
+        {
+            const TruthValuePtr& old = *tv_box(w);
+            if (old == newTV or *old == *newTV) return;
+        }
+    }
 
-    // We need to guarantee that the signal goes out with the
-    // correct truth value.  That is, another setter could be changing
-    // this, even as we are.  So make a copy, first.
-    TruthValuePtr oldTV(getTruthValue());
+    // A packed truth value is the same if the word is; setting it
+    // again changes nothing, and so signals nothing.
+    uint64_t newword = make_tv_word(newTV, default_tv_word());
+    if ((newword & TV_PACKED) and _tv_word.load() == newword)
+        return;
 
-    // ... and we still need to make sure that only one thread is
-    // writing this at a time. std:shared_ptr is NOT thread-safe against
-    // multiple writers: see "Example 5" in
-    // http://www.boost.org/doc/libs/1_53_0/libs/smart_ptr/shared_ptr.htm#ThreadSafety
-    std::unique_lock<std::mutex> lck(_mtx);
-    _truthValue = newTV;
-    lck.unlock();
+    // Swap in the new word. Whoever swaps out a box owns it, so the
+    // old truth value can be read out of it, for the signal, without
+    // any race against other setters.
+    uint64_t oldword = _tv_word.exchange(newword);
 
     if (_atom_space != nullptr) {
         TVCHSigl& tvch = _atom_space->_atom_table.TVChangedSignal();
-        tvch(getHandle(), oldTV, newTV);
+        if (not tvch.empty())
+            tvch(getHandle(), load_tv_word(oldword), newTV);
     }
+    retire_tv_word(oldword);
 }
 
 TruthValuePtr Atom::getTruthValue() const
 {
-    // OK. The atomic thread-safety of shared-pointers is subtle. See
-    // http://www.boost.org/doc/libs/1_53_0/libs/smart_ptr/shared_ptr.htm#ThreadSafety
-    // and http://cppwisdom.quora.com/shared_ptr-is-almost-thread-safe
-    // What it boils down to here is that we must *always* make a copy
-    // of _truthValue before we use it, since it can go out of scope
-    // because it can get set in another thread.  Viz, using it to
-    // dereference can return a raw pointer to an object that has been
-    // deconstructed.  The AtomSpaceAsyncUTest will hit this, as will
-    // the multi-threaded async atom store in the SQL peristance backend.
-    // Furthermore, we must make a copy while holding the lock! Got that?
-
-    std::lock_guard<std::mutex> lck(_mtx);
-    TruthValuePtr local(_truthValue);
-    return local;
+    // The box pointed at can be swapped out, by a setter in another
+    // thread, at any time; the epoch guard keeps it from being freed
+    // until we have made our copy of the truth value in it.  Making
+    // the copy is a single atomic increment; no locks are taken, and
+    // setters are never waited for.  A packed truth value needs no
+    // guard, but does need a TruthValue made for it, unless this
+    // thread made one for it recently.
+    uint64_t w = _tv_word.load();
+    if (w & TV_PACKED) return load_tv_word(w);
+
+    EpochGuard guard;
+    return load_tv_word(_tv_word.load());
 
 #if THIS_WONT_WORK_AS_NICELY_AS_YOU_MIGHT_GUESS
 
@@ -160,26 +277,56 @@ TruthValuePtr Atom::getTruthValue() const
 #endif
 }
 
+void Atom::getTruthValuePair(strength_t& mean, confidence_t& conf) const
+{
+    uint64_t w = _tv_word.load();
+    if (w & TV_PACKED) {
+        mean = bits_float((uint32_t) w);
+        conf = bits_float((w >> 32) & 0x7fffffff);
+        return;
+    }
+
+    EpochGuard guard;
+    const TruthValuePtr& tv = *tv_box(_tv_word.load());
+    mean = tv->getMean();
+    conf = tv->getConfidence();
+}
+
 void Atom::merge(const TruthValuePtr& tvn, const MergeCtrl& mc)
 {
     if (nullptr == tvn or tvn->isDefaultTV()) return;
 
-    // No locking to be done here. It is possible that between the time
-    // that we read the TV here (i.e. set currentTV) and the time that
-    // we look to see if currentTV is default, that some other thread
-    // will have changed _truthValue. This is a race, but we don't care,
-    // because if two threads are trying to simultaneously set the TV on
-    // one atom, without co-operating with one-another, they get what
-    // they deserve -- a race. (We still use getTruthValue() to avoid a
-    // read-write race on the shared_pointer itself!)
-    TruthValuePtr currentTV(getTruthValue());
-    if (currentTV->isDefaultTV()) {
-        setTruthValue(tvn);
-        return;
+    // Merge into the current truth value, and swap the result in, but
+    // only if no other thread changed the truth value in the meantime;
+    // if one did, merge into what it set, and try again.  This way,
+    // simultaneous merges from many threads all count.
+    TruthValuePtr currentTV, mergedTV;
+    uint64_t dflt = default_tv_word();
+    uint64_t oldword, newword;
+    {
+        EpochGuard guard;
+        oldword = _tv_word.load();
+        while (true) {
+            currentTV = load_tv_word(oldword);
+            mergedTV = currentTV->isDefaultTV() ?
+                tvn : currentTV->merge(tvn, mc);
+
+            newword = make_tv_word(mergedTV, dflt);
+            if (_tv_word.compare_exchange_weak(oldword, newword)) break;
+            free_tv_word(newword);
+        }
     }
 
-    TruthValuePtr mergedTV(currentTV->merge(tvn, mc));
-    setTruthValue(mergedTV);
+    // A merge that leaves a packed truth value as it was changes
+    // nothing.
+    if (oldword == newword) return;
+    retire_tv_word(oldword);
+
+    if (_atom_space != nullptr) {
+        TVCHSigl& tvch = _atom_space->_atom_table.TVChangedSignal();
+        if (not tvch.empty())
+            tvch(getHandle(), currentTV, mergedTV);
+    }
 }
 
 // ==============================================================
@@ -291,7 +438,7 @@ AtomTable* Atom::getAtomTable() const
 /// is made, those links won't show up in the incoming set.
 ///
 /// We don't automatically track incoming sets for two reasons:
-/// 1) std::set takes up 48 bytes
+/// 1) the incoming set takes up memory, even when empty
 /// 2) adding and remoiving uses up cpu cycles.
 /// Thus, if the incoming set isn't needed, then don't bother
 /// tracking it.
@@ -324,6 +471,19 @@ void Atom::insert_atom(const LinkPtr& a)
 #endif /* INCOMING_SET_SIGNALS */
 }
 
+/// Add several links to the incoming set, under one lock.
+void Atom::insert_atoms(const std::vector<LinkPtr>& links)
+{
+    if (NULL == _incoming_set) return;
+    std::lock_guard<std::mutex> lck (_mtx);
+    for (const LinkPtr& a : links) {
+        _incoming_set->_iset.insert(a);
+#ifdef INCOMING_SET_SIGNALS
+        _incoming_set->_addAtomSignal(shared_from_this(), a);
+#endif /* INCOMING_SET_SIGNALS */
+    }
+}
+
 /// Remove an atom from the incoming set.
 void Atom::remove_atom(const LinkPtr& a)
 {
@@ -373,33 +533,48 @@ IncomingSet Atom::getIncomingSet(AtomSpace* as) const
         // Prevent update of set while a copy is being made.
         std::lock_guard<std::mutex> lck (_mtx);
         IncomingSet iset;
-        for (const WinkPtr& w : _incoming_set->_iset)
+        iset.reserve(_incoming_set->_iset.size());
+        _incoming_set->_iset.foreach([&](const WinkPtr& w)
         {
             LinkPtr l(w.lock());
             if (l and atab->in_environ(l))
                 iset.emplace_back(l);
-        }
+        });
         return iset;
     }
 
     // Prevent update of set while a copy is being made.
     std::lock_guard<std::mutex> lck (_mtx);
     IncomingSet iset;
-    for (WinkPtr w : _incoming_set->_iset)
+    iset.reserve(_incoming_set->_iset.size());
+    _incoming_set->_iset.foreach([&](const WinkPtr& w)
     {
         LinkPtr l(w.lock());
         if (l) iset.emplace_back(l);
-    }
+    });
     return iset;
 }
 
 IncomingSet Atom::getIncomingSetByType(Type type, bool subclass) const
 {
-    HandleSeq inhs;
-    getIncomingSetByType(std::back_inserter(inhs), type, subclass);
     IncomingSet inlinks;
-    for (const Handle& h : inhs)
-        inlinks.emplace_back(LinkCast(h));
+    if (NULL == _incoming_set) return inlinks;
+
+    auto out = [&](const WinkPtr& w)
+    {
+        LinkPtr l(w.lock());
+        if (l) inlinks.emplace_back(l);
+    };
+
+    std::lock_guard<std::mutex> lck (_mtx);
+    if (not subclass) {
+        inlinks.reserve(_incoming_set->_iset.size(type));
+        _incoming_set->_iset.foreach_of_type(type, out);
+        return inlinks;
+    }
+    ClassServer& cs(classserver());
+    _incoming_set->_iset.foreach_if(
+        [&](Type at) { return cs.isA(at, type); }, out);
     return inlinks;
 }
 
@@ -27,6 +27,7 @@
 #ifndef _OPENCOG_ATOM_H
 #define _OPENCOG_ATOM_H
 
+#include <atomic>
 #include <memory>
 #include <mutex>
 #include <set>
@@ -35,6 +36,7 @@
 #include <boost/signals2.hpp>
 
 #include <opencog/atoms/base/Handle.h>
+#include <opencog/atoms/base/IncomingBuckets.h>
 #include <opencog/atoms/base/ProtoAtom.h>
 #include <opencog/truthvalue/TruthValue.h>
 
@@ -57,14 +59,16 @@ class Link;
 typedef std::shared_ptr<Link> LinkPtr;
 typedef std::vector<LinkPtr> IncomingSet; // use vector; see below.
 typedef std::weak_ptr<Link> WinkPtr;
-typedef std::set<WinkPtr, std::owner_less<WinkPtr> > WincomingSet;
+typedef IncomingBuckets WincomingSet;
 typedef boost::signals2::signal<void (AtomPtr, LinkPtr)> AtomPairSignal;
 
 // We use a std:vector instead of std::set for IncomingSet, because
 // virtually all access will be either insert, or iterate, so we get
-// O(1) performance. We use std::set for WincomingSet, because we want
-// both good insert and good remove performance.  Note that sometimes
-// incoming sets can be huge (millions of atoms).
+// O(1) performance. WincomingSet keeps the links in one vector per
+// link type, indexed by address once a vector gets big, because we
+// want good insert and remove performance, compact storage, and fast
+// lookup by type.  Note that sometimes incoming sets can be huge
+// (millions of atoms).
 
 /**
  * Atoms are the basic implementational unit in the system that
@@ -99,7 +103,19 @@ protected:
 
     AtomSpace *_atom_space;
 
-    mutable TruthValuePtr _truthValue;
+    // The truth value, in a single word, so that it can be swapped
+    // atomically.  Most atoms carry a plain (strength, confidence)
+    // pair; these are packed into the word itself, as two floats, and
+    // cost no heap memory at all.  Any other truth value is boxed, and
+    // the word holds a pointer to the box. A box is never changed after
+    // it is published; it is replaced by a new one, and the old one is
+    // freed once no reader can be looking at it any more.  This way,
+    // reading the truth value takes no lock, and does not wait for
+    // writers.
+    std::atomic<uint64_t> _tv_word;
+    static uint64_t default_tv_word();
+    static void free_tv_word(uint64_t);
+    static void retire_tv_word(uint64_t);
 
     // Lock, used to serialize changes.
     // This costs 40 bytes per atom.  Tried using a single, global lock,
@@ -122,7 +138,7 @@ protected:
         _flags(0),
         _content_hash(Handle::INVALID_HASH),
         _atom_space(nullptr),
-        _truthValue(TruthValue::DEFAULT_TV())
+        _tv_word(default_tv_word())
     {}
 
     struct InSet
@@ -130,7 +146,8 @@ protected:
         // The incoming set is not tracked by the garbage collector;
         // this is required, in order to avoid cyclic references.
         // That is, we use weak pointers here, not strong ones.
-        // std::set<ptr> uses 48 bytes (per atom).  See the README file
+        // An empty WincomingSet uses 32 bytes, and each link in it
+        // another 24 or so (per atom).  See the README file
         // in this directory for a slightly longer explanation for why
         // weak pointers are needed, and why bdgc cannot be used.
         WincomingSet _iset;
@@ -150,6 +167,7 @@ protected:
 
     // Insert and remove links from the incoming set.
     void insert_atom(const LinkPtr&);
+    void insert_atoms(const std::vector<LinkPtr>&);
     void remove_atom(const LinkPtr&);
     void swap_atom(const LinkPtr&, const LinkPtr&);
 
@@ -218,6 +236,10 @@ public:
     /** Returns the TruthValue object of the atom. */
     TruthValuePtr getTruthValue() const;
 
+    /** Returns the strength and confidence of the truth value. Unlike
+     *  getTruthValue(), this makes no TruthValue for a packed value. */
+    void getTruthValuePair(strength_t&, confidence_t&) const;
+
     //! Sets the TruthValue object of the atom.
     void setTruthValue(TruthValuePtr);
 
@@ -274,14 +296,11 @@ public:
     {
         if (NULL == _incoming_set) return result;
         std::lock_guard<std::mutex> lck(_mtx);
-        // Sigh. I need to compose copy_if with transform. I could
-        // do this wih boost range adaptors, but I don't feel like it.
-        auto end = _incoming_set->_iset.end();
-        for (auto w = _incoming_set->_iset.begin(); w != end; w++)
+        _incoming_set->_iset.foreach([&](const WinkPtr& w)
         {
-            Handle h(w->lock());
+            Handle h(w.lock());
             if (h) { *result = h; result ++; }
-        }
+        });
         return result;
     }
 
@@ -316,20 +335,19 @@ public:
     {
         if (NULL == _incoming_set) return result;
         std::lock_guard<std::mutex> lck(_mtx);
-        ClassServer& cs(classserver());
-        // Sigh. I need to compose copy_if with transform. I could
-        // do this wih boost range adaptors, but I don't feel like it.
-        auto end = _incoming_set->_iset.end();
-        for (auto w = _incoming_set->_iset.begin(); w != end; w++)
+        auto out = [&](const WinkPtr& w)
         {
-            Handle h(w->lock());
-            if (nullptr == h) continue;
-            Type at(h->getType());
-            if (type == at or (subclass and cs.isA(at, type))) {
-                *result = h;
-                result ++;
-            }
+            Handle h(w.lock());
+            if (h) { *result = h; result ++; }
+        };
+        // Only the buckets of the wanted types are looked at.
+        if (not subclass) {
+            _incoming_set->_iset.foreach_of_type(type, out);
+            return result;
         }
+        ClassServer& cs(classserver());
+        _incoming_set->_iset.foreach_if(
+            [&](Type at) { return cs.isA(at, type); }, out);
         return result;
     }
 
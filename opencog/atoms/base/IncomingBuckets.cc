@@ -0,0 +1,235 @@
+/*
+ * opencog/atoms/base/IncomingBuckets.cc
+ *
+ * Copyright (C) 2017 OpenCog Foundation
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License v3 as
+ * published by the Free Software Foundation and including the exceptions
+ * at http://opencog.org/wiki/Licenses
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, write to:
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <opencog/atoms/base/IncomingBuckets.h>
+#include <opencog/atoms/base/Link.h>
+
+using namespace opencog;
+
+// Buckets with more entries than this get an index.  Below that,
+// a linear search through the entries is about as fast, and uses no
+// extra memory.  The index is dropped again when the bucket shrinks
+// to half of this, so that a bucket hovering around the limit does
+// not keep building and dropping it.
+#define INDEX_MIN 32
+
+static const size_t NPOS = (size_t) -1;
+
+static inline size_t home(const Link* l, size_t mask)
+{
+    // Fibonacci hashing; the low bits of an address are always zero.
+    uint64_t p = (uint64_t) (uintptr_t) l;
+    return (size_t) (((p >> 4) * 0x9E3779B97F4A7C15ULL) >> 32) & mask;
+}
+
+IncomingBuckets::Bucket* IncomingBuckets::find_bucket(Type t)
+{
+    for (Bucket& b : _buckets)
+        if (b.type == t) return &b;
+    return nullptr;
+}
+
+/// The slot of the link in the bucket, or NPOS if it is not there.
+size_t IncomingBuckets::find(const Bucket& b, const Link* l)
+{
+    if (not b.index) {
+        size_t n = b.entries.size();
+        for (size_t i = 0; i < n; i++)
+            if (b.entries[i].link == l) return i;
+        return NPOS;
+    }
+
+    size_t mask = b.index_size() - 1;
+    for (size_t i = home(l, mask); 0 != b.index[i]; i = (i + 1) & mask) {
+        size_t slot = b.index[i] - 1;
+        if (b.entries[slot].link == l) return slot;
+    }
+    return NPOS;
+}
+
+/// Rebuild the index from scratch, sized for the current number of
+/// entries; or drop it, if the bucket has become small.
+void IncomingBuckets::reindex(Bucket& b)
+{
+    size_t n = b.entries.size();
+    if (n < INDEX_MIN / 2) {
+        b.index.reset();
+        return;
+    }
+
+    // Between a quarter and half full.
+    uint8_t bits = 4;
+    while ((((size_t) 1) << bits) < 2 * n) bits++;
+    size_t cap = ((size_t) 1) << bits;
+    b.index.reset(new uint32_t[cap]());
+    b.index_bits = bits;
+
+    size_t mask = cap - 1;
+    for (size_t slot = 0; slot < n; slot++) {
+        size_t i = home(b.entries[slot].link, mask);
+        while (0 != b.index[i]) i = (i + 1) & mask;
+        b.index[i] = slot + 1;
+    }
+}
+
+/// Index the entry just placed at the given slot.
+void IncomingBuckets::index_add(Bucket& b, size_t slot)
+{
+    size_t n = b.entries.size();
+    if (not b.index) {
+        if (INDEX_MIN < n) reindex(b);
+        return;
+    }
+
+    // Keep the load factor under three quarters.
+    if (3 * b.index_size() < 4 * n) {
+        reindex(b);
+        return;
+    }
+
+    size_t mask = b.index_size() - 1;
+    size_t i = home(b.entries[slot].link, mask);
+    while (0 != b.index[i]) i = (i + 1) & mask;
+    b.index[i] = slot + 1;
+}
+
+/// Remove the link from the index, shifting back the entries after
+/// it, so that no probe sequence is left with a gap in it.
+void IncomingBuckets::index_remove(Bucket& b, const Link* l)
+{
+    size_t mask = b.index_size() - 1;
+    size_t i = home(l, mask);
+    while (b.entries[b.index[i] - 1].link != l) i = (i + 1) & mask;
+    b.index[i] = 0;
+
+    for (size_t j = (i + 1) & mask; 0 != b.index[j]; j = (j + 1) & mask) {
+        size_t k = home(b.entries[b.index[j] - 1].link, mask);
+
+        // The entry at j can stay, if its home is cyclically in (i, j].
+        bool stays = (i <= j) ? (i < k and k <= j) : (i < k or k <= j);
+        if (stays) continue;
+
+        b.index[i] = b.index[j];
+        b.index[j] = 0;
+        i = j;
+    }
+}
+
+/// The link has moved from one slot to another.
+void IncomingBuckets::index_move(Bucket& b, const Link* l,
+                                 size_t from, size_t to)
+{
+    size_t mask = b.index_size() - 1;
+    size_t i = home(l, mask);
+    while (b.index[i] != from + 1) i = (i + 1) & mask;
+    b.index[i] = to + 1;
+}
+
+bool IncomingBuckets::insert(const LinkPtr& lp)
+{
+    Type t = lp->getType();
+    Bucket* b = find_bucket(t);
+    if (nullptr == b) {
+        _buckets.emplace_back();
+        b = &_buckets.back();
+        b->type = t;
+        b->index_bits = 0;
+    }
+
+    size_t slot = find(*b, lp.get());
+    if (NPOS != slot) {
+        // A link that went away without being removed, and another
+        // one that was then made at the same address.
+        if (b->entries[slot].wink.expired()) {
+            b->entries[slot].wink = lp;
+            return true;
+        }
+        return false;
+    }
+
+    b->entries.push_back({lp.get(), lp});
+    index_add(*b, b->entries.size() - 1);
+    _size++;
+    return true;
+}
+
+bool IncomingBuckets::erase(const LinkPtr& lp)
+{
+    Bucket* b = find_bucket(lp->getType());
+    if (nullptr == b) return false;
+
+    const Link* l = lp.get();
+    size_t slot = find(*b, l);
+    if (NPOS == slot) return false;
+
+    bool indexed = (nullptr != b->index);
+    if (indexed) index_remove(*b, l);
+
+    // Fill the hole with the last entry.
+    size_t last = b->entries.size() - 1;
+    if (slot != last) {
+        if (indexed) index_move(*b, b->entries[last].link, last, slot);
+        b->entries[slot] = std::move(b->entries[last]);
+    }
+    b->entries.pop_back();
+    _size--;
+
+    size_t n = b->entries.size();
+    if (0 == n) {
+        if (b != &_buckets.back())
+            *b = std::move(_buckets.back());
+        _buckets.pop_back();
+        if (_buckets.empty()) clear();
+        return true;
+    }
+
+    // Give back memory after a large bucket has mostly emptied out.
+    if (indexed and 8 * n < b->index_size())
+        reindex(*b);
+    if (64 < b->entries.capacity() and 4 * n < b->entries.capacity())
+        b->entries.shrink_to_fit();
+    return true;
+}
+
+void IncomingBuckets::clear()
+{
+    std::vector<Bucket>().swap(_buckets);
+    _size = 0;
+}
+
+size_t IncomingBuckets::size(Type t) const
+{
+    for (const Bucket& b : _buckets)
+        if (b.type == t) return b.entries.size();
+    return 0;
+}
+
+size_t IncomingBuckets::bytes() const
+{
+    size_t total = _buckets.capacity() * sizeof(Bucket);
+    for (const Bucket& b : _buckets)
+        total += b.entries.capacity() * sizeof(Entry)
+               + b.index_size() * sizeof(uint32_t);
+    return total;
+}
+
+/* ===================== END OF FILE ===================== */
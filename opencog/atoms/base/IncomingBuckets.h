@@ -0,0 +1,154 @@
+/*
+ * opencog/atoms/base/IncomingBuckets.h
+ *
+ * Copyright (C) 2017 OpenCog Foundation
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License v3 as
+ * published by the Free Software Foundation and including the exceptions
+ * at http://opencog.org/wiki/Licenses
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, write to:
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _OPENCOG_INCOMING_BUCKETS_H
+#define _OPENCOG_INCOMING_BUCKETS_H
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <opencog/atoms/base/types.h>
+
+namespace opencog
+{
+/** \addtogroup grp_atomspace
+ *  @{
+ */
+
+class Link;
+typedef std::shared_ptr<Link> LinkPtr;
+typedef std::weak_ptr<Link> WinkPtr;
+
+/**
+ * The incoming set of an atom: weak pointers to the links that hold
+ * it, kept in one bucket per link type.
+ *
+ * Each bucket is a plain vector, so walking the incoming set touches
+ * consecutive memory, and asking for the links of one type walks just
+ * that bucket.  A link is removed by moving the last entry of its
+ * bucket into its place, so the buckets never have holes in them.
+ * Small buckets are searched linearly; once a bucket gets big, it also
+ * gets an open-addressing index, from the address of the link to its
+ * place in the bucket, so that removal stays cheap for atoms with
+ * millions of incoming links.
+ *
+ * This is not thread-safe; the atom's lock protects it.
+ */
+class IncomingBuckets
+{
+    struct Entry
+    {
+        // The address identifies the link, even after it has expired.
+        const Link* link;
+        WinkPtr wink;
+    };
+
+    struct Bucket
+    {
+        Type type;
+
+        // Log2 of the number of cells in the index.
+        uint8_t index_bits;
+
+        std::vector<Entry> entries;
+
+        // Slot+1 of each indexed entry; zero marks an empty cell.
+        // Null, unless there are more than INDEX_MIN entries.
+        std::unique_ptr<uint32_t[]> index;
+
+        size_t index_size() const
+        {
+            return index ? ((size_t) 1) << index_bits : 0;
+        }
+    };
+
+    std::vector<Bucket> _buckets;
+    size_t _size;
+
+    Bucket* find_bucket(Type);
+    static size_t find(const Bucket&, const Link*);
+    static void index_add(Bucket&, size_t);
+    static void index_remove(Bucket&, const Link*);
+    static void index_move(Bucket&, const Link*, size_t, size_t);
+    static void reindex(Bucket&);
+
+public:
+    IncomingBuckets() : _size(0) {}
+
+    /// Add the link; returns false if it was already there.
+    bool insert(const LinkPtr&);
+
+    /// Remove the link; returns false if it was not there.
+    bool erase(const LinkPtr&);
+
+    void clear();
+
+    /// The number of links, including any that have expired, but
+    /// have not been removed yet.
+    size_t size() const { return _size; }
+    bool empty() const { return 0 == _size; }
+
+    /// The number of links of the given type.
+    size_t size(Type) const;
+
+    /// An estimate of the heap memory used, in bytes.
+    size_t bytes() const;
+
+    /// Call f on the weak pointer to each link.
+    template <typename Function>
+    void foreach(Function f) const
+    {
+        for (const Bucket& b : _buckets)
+            for (const Entry& e : b.entries)
+                f(e.wink);
+    }
+
+    /// Call f on the weak pointer to each link of the given type.
+    template <typename Function>
+    void foreach_of_type(Type t, Function f) const
+    {
+        for (const Bucket& b : _buckets) {
+            if (b.type != t) continue;
+            for (const Entry& e : b.entries)
+                f(e.wink);
+            return;
+        }
+    }
+
+    /// Call f on the weak pointer to each link whose type passes
+    /// the predicate.  The predicate is called once per type.
+    template <typename Predicate, typename Function>
+    void foreach_if(Predicate type_ok, Function f) const
+    {
+        for (const Bucket& b : _buckets) {
+            if (not type_ok(b.type)) continue;
+            for (const Entry& e : b.entries)
+                f(e.wink);
+        }
+    }
+};
+
+/** @}*/
+} // namespace opencog
+
+#endif // _OPENCOG_INCOMING_BUCKETS_H
@@ -25,6 +25,7 @@
 #define _OPENCOG_PATTERN_H
 
 #include <map>
+#include <memory>
 #include <set>
 #include <stack>
 #include <unordered_map>
@@ -36,6 +37,8 @@
 
 namespace opencog {
 
+struct QueryPlan;
+
 /** \addtogroup grp_atomspace
  *  @{
  */
@@ -136,6 +139,12 @@ struct Pattern
 
 	ConnectTermMap   connected_terms_map;  // setup by make_term_trees()
 
+	// The search plan that the pattern matcher worked out the last
+	// time this pattern was run; it is kept here, so that it does not
+	// have to be worked out again the next time. Set and read with
+	// std::atomic_load/atomic_store; see opencog/query/QueryPlan.h
+	mutable std::shared_ptr<const QueryPlan> plan;
+
 	std::string to_string() const
 	{
 		std::stringstream ss;
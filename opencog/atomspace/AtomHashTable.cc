@@ -0,0 +1,203 @@
+/*
+ * opencog/atomspace/AtomHashTable.cc
+ *
+ * Copyright (C) 2017 OpenCog Foundation
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License v3 as
+ * published by the Free Software Foundation and including the exceptions
+ * at http://opencog.org/wiki/Licenses
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, write to:
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <thread>
+
+#include "AtomHashTable.h"
+#include "EpochGuard.h"
+
+using namespace opencog;
+
+// Slot markers. Atoms are never at these addresses.
+// An empty slot holds a null pointer.
+static Atom* const CLAIMED = reinterpret_cast<Atom*>(1);
+static Atom* const TOMBSTONE = reinterpret_cast<Atom*>(2);
+
+static inline bool is_atom(Atom* p)
+{
+    return nullptr != p and CLAIMED != p and TOMBSTONE != p;
+}
+
+AtomHashTable::AtomHashTable(size_t capacity)
+    : _size(0), _writers(0), _growing(false)
+{
+    size_t cap = 16;
+    while (cap < capacity) cap <<= 1;
+    _array = new SlotArray(cap);
+}
+
+AtomHashTable::~AtomHashTable()
+{
+    delete _array.load();
+}
+
+void AtomHashTable::enter_writer(void)
+{
+    while (true) {
+        while (_growing.load()) std::this_thread::yield();
+        _writers.fetch_add(1);
+        if (not _growing.load()) return;
+        _writers.fetch_sub(1);
+    }
+}
+
+void AtomHashTable::leave_writer(void)
+{
+    _writers.fetch_sub(1);
+}
+
+Handle AtomHashTable::find(const AtomPtr& a, ContentHash ch) const
+{
+    EpochGuard guard;
+    SlotArray* arr = _array.load();
+    size_t i = slot_index(ch) & arr->mask;
+    for (size_t n = 0; n <= arr->mask; n++, i = (i+1) & arr->mask) {
+        const Slot& s = arr->slots[i];
+        Atom* p = s.atom.load();
+        if (nullptr == p) break;
+        if (not is_atom(p)) continue;
+        if (s.hash == ch and *p == *a)
+            return p->getHandle();
+    }
+    return Handle::UNDEFINED;
+}
+
+Handle AtomHashTable::insert(const Handle& h, ContentHash ch)
+{
+    Atom* atom = h.operator->();
+    EpochGuard guard;
+    while (true) {
+        enter_writer();
+        SlotArray* arr = _array.load();
+
+        // Keep the table no more than half full, counting tombstones.
+        if ((arr->used.load() + 1) * 2 > arr->mask + 1) {
+            leave_writer();
+            grow(arr);
+            continue;
+        }
+
+        size_t i = slot_index(ch) & arr->mask;
+        for (size_t n = 0; n <= arr->mask; n++, i = (i+1) & arr->mask) {
+            Slot& s = arr->slots[i];
+            Atom* p = s.atom.load();
+            if (nullptr == p and s.atom.compare_exchange_strong(p, CLAIMED)) {
+                arr->used.fetch_add(1);
+                s.hash = ch;
+                s.owner = h;
+                s.atom.store(atom);
+                _size.fetch_add(1);
+                leave_writer();
+                return h;
+            }
+
+            // Someone else has just claimed this slot. It might be an
+            // equal atom, so wait to see what it is.
+            while (CLAIMED == p) {
+                std::this_thread::yield();
+                p = s.atom.load();
+            }
+
+            if (is_atom(p) and s.hash == ch and *p == *atom) {
+                Handle found(p->getHandle());
+                leave_writer();
+                return found;
+            }
+        }
+
+        // Ran out of room; very unlikely, given the load factor.
+        leave_writer();
+        grow(arr);
+    }
+}
+
+bool AtomHashTable::erase(const Handle& h, ContentHash ch)
+{
+    Atom* atom = h.operator->();
+    enter_writer();
+    SlotArray* arr = _array.load();
+    size_t i = slot_index(ch) & arr->mask;
+    for (size_t n = 0; n <= arr->mask; n++, i = (i+1) & arr->mask) {
+        Slot& s = arr->slots[i];
+        Atom* p = s.atom.load();
+        if (nullptr == p) break;
+        if (atom != p) continue;
+        if (not s.atom.compare_exchange_strong(p, TOMBSTONE)) break;
+
+        // Lookups that are still looking at the atom need it to
+        // stay alive for a little while longer.
+        Handle owner;
+        owner.swap(s.owner);
+        _size.fetch_sub(1);
+        leave_writer();
+        epoch_retire([owner]() mutable { owner = Handle::UNDEFINED; });
+        return true;
+    }
+    leave_writer();
+    return false;
+}
+
+// Rebuild the table, with room to grow, and without the tombstones.
+void AtomHashTable::grow(SlotArray* seen)
+{
+    std::lock_guard<std::mutex> lck(_grow_mtx);
+
+    // Maybe some other thread already did it.
+    if (_array.load() != seen) return;
+
+    _growing.store(true);
+    while (0 < _writers.load()) std::this_thread::yield();
+
+    size_t cap = seen->mask + 1;
+    while (cap < 4 * _size.load()) cap <<= 1;
+
+    SlotArray* arr = new SlotArray(cap);
+    for (size_t j = 0; j <= seen->mask; j++) {
+        Slot& old = seen->slots[j];
+        Atom* p = old.atom.load();
+        if (not is_atom(p)) continue;
+
+        size_t i = slot_index(old.hash) & arr->mask;
+        while (nullptr != arr->slots[i].atom.load())
+            i = (i+1) & arr->mask;
+
+        Slot& s = arr->slots[i];
+        s.hash = old.hash;
+        s.owner.swap(old.owner);
+        s.atom.store(p);
+        arr->used.fetch_add(1);
+    }
+
+    // Lookups may still be walking the old array. The atoms in it
+    // are kept alive by the new one.
+    _array.store(arr);
+    _growing.store(false);
+    epoch_delete(seen);
+}
+
+void AtomHashTable::clear(void)
+{
+    SlotArray* arr = _array.load();
+    _array.store(new SlotArray(16));
+    _size.store(0);
+    delete arr;
+}
@@ -0,0 +1,144 @@
+/*
+ * opencog/atomspace/AtomHashTable.h
+ *
+ * Copyright (C) 2017 OpenCog Foundation
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License v3 as
+ * published by the Free Software Foundation and including the exceptions
+ * at http://opencog.org/wiki/Licenses
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, write to:
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _OPENCOG_ATOM_HASH_TABLE_H
+#define _OPENCOG_ATOM_HASH_TABLE_H
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+
+#include <opencog/atoms/base/Atom.h>
+#include <opencog/atoms/base/Handle.h>
+
+namespace opencog
+{
+/** \addtogroup grp_atomspace
+ *  @{
+ */
+
+/**
+ * A concurrent set of atoms, keyed by their content hash.
+ *
+ * This is an open-addressing hash table, with linear probing.  Lookups
+ * take no locks at all; they are protected by an EpochGuard, so that
+ * atoms (and old slot arrays) that are removed while a lookup is
+ * looking at them are not freed until it is done.  Inserts claim an
+ * empty slot with a compare-and-swap; two threads inserting equal
+ * atoms will probe the same slots, and the loser finds the winner.
+ * Removal leaves a tombstone behind; tombstones are never re-used,
+ * and are cleared out when the table is rebuilt.
+ *
+ * Inserts and removals run concurrently with one another.  Only
+ * growing the table stops them (but not lookups), briefly.
+ */
+class AtomHashTable
+{
+private:
+    struct Slot
+    {
+        // Either an atom, or one of the markers below.
+        std::atomic<Atom*> atom;
+
+        // Written before the atom is published; never changes after.
+        ContentHash hash;
+
+        // Keeps the atom alive while it is in the table.
+        Handle owner;
+
+        Slot() : atom(nullptr), hash(0) {}
+    };
+
+    struct SlotArray
+    {
+        size_t mask;
+        std::unique_ptr<Slot[]> slots;
+
+        // Slots that are not empty: atoms, claims and tombstones.
+        std::atomic<size_t> used;
+
+        SlotArray(size_t capacity)
+            : mask(capacity - 1), slots(new Slot[capacity]), used(0) {}
+    };
+
+    std::atomic<SlotArray*> _array;
+    std::atomic<size_t> _size;
+
+    // The writer gate. Inserts and removals pass through it; growing
+    // the table closes it and waits for the writers to drain.
+    std::atomic<size_t> _writers;
+    std::atomic<bool> _growing;
+    std::mutex _grow_mtx;
+
+    void enter_writer(void);
+    void leave_writer(void);
+    void grow(SlotArray*);
+
+    static size_t slot_index(ContentHash ch)
+    {
+        // The splitmix64 finalizer; the table is a power of two in
+        // size, so the low bits must depend on all of the hash bits.
+        ch = (ch ^ (ch >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        ch = (ch ^ (ch >> 27)) * 0x94d049bb133111ebULL;
+        return ch ^ (ch >> 31);
+    }
+
+    AtomHashTable(const AtomHashTable&) = delete;
+    AtomHashTable& operator=(const AtomHashTable&) = delete;
+
+public:
+    AtomHashTable(size_t capacity = 16);
+    ~AtomHashTable();
+
+    /// Return the atom in the table that is equal to 'a', if any.
+    Handle find(const AtomPtr& a, ContentHash) const;
+
+    /// Insert 'h', unless an equal atom is already in the table.
+    /// Returns the atom that is in the table afterwards: either 'h'
+    /// itself, or the equal atom that was found.
+    Handle insert(const Handle& h, ContentHash);
+
+    /// Remove exactly this atom. Returns false if it wasn't there.
+    bool erase(const Handle& h, ContentHash);
+
+    size_t size(void) const { return _size.load(); }
+
+    /// Remove everything. Not safe to call concurrently with anything.
+    void clear(void);
+
+    /// Call func on every atom in the table. Not safe to call while
+    /// other threads are inserting or removing atoms.
+    template <typename Function> void
+    foreach(Function func) const
+    {
+        SlotArray* arr = _array.load();
+        for (size_t i = 0; i <= arr->mask; i++) {
+            const Handle& h = arr->slots[i].owner;
+            if (h) func(h);
+        }
+    }
+};
+
+/** @}*/
+} //namespace opencog
+
+#endif // _OPENCOG_ATOM_HASH_TABLE_H
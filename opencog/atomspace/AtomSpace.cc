@@ -276,6 +276,22 @@ Handle AtomSpace::add_atom(const Handle& h, bool async)
     return rh;
 }
 
+HandleSeq AtomSpace::add_atoms(const HandleSeq& hseq)
+{
+    // DeleteLinks that are refused come back undefined, in their
+    // place in the result, as do the links that hold them.
+    HandleSeq rhs(_atom_table.add_atoms(hseq));
+
+    // Atom deletion has not been implemented in the backing store
+    // This is a major to-do item.
+    if (_backing_store)
+        for (size_t i = 0; i < hseq.size(); i++)
+            if (nullptr != hseq[i].operator->() and nullptr == rhs[i])
+// Under construction ....
+                throw RuntimeException(TRACE_INFO, "Not implemented!!!");
+    return rhs;
+}
+
 Handle AtomSpace::add_node(Type t, const string& name,
                            bool async)
 {
@@ -118,12 +118,31 @@ public:
     inline size_t get_num_links() const { return _atom_table.getNumLinks(); }
     inline size_t get_num_atoms_of_type(Type type, bool subclass = false) const
         { return _atom_table.getNumAtomsOfType(type, subclass); }
+    inline FanoutStats get_fanout(Type type, size_t pos) const
+        { return _atom_table.getFanout(type, pos); }
     inline UUID get_uuid(void) const { return _atom_table.get_uuid(); }
 
     //! Clear the atomspace, remove all atoms
     void clear()
         { _atom_table.clear(); }
 
+    /**
+     * Write all of the atoms, with their truth values and values, to
+     * a snapshot file.  The file is written next to the path, and then
+     * renamed, so an existing snapshot is replaced only once the new
+     * one is complete.
+     */
+    void save_snapshot(const std::string& path);
+
+    /**
+     * Add the atoms in a snapshot file to this atomspace.  The file is
+     * mapped into memory, and the atoms are added in large batches, in
+     * order of height.  This is much faster than loading the same atoms
+     * from scheme, or from SQL.  Returns the number of atoms in the
+     * snapshot.
+     */
+    size_t load_snapshot(const std::string& path);
+
     /**
      * Add an atom to the Atom Table.  If the atom already exists
      * then new truth value is ignored, and the existing atom is
@@ -133,6 +152,17 @@ public:
     Handle add_atom(AtomPtr a, bool async=false)
         { return add_atom(a->getHandle(), async); }
 
+    /**
+     * Add a batch of atoms to the Atom Table, in one pass.  This is
+     * equivalent to calling add_atom() on each of them, but is much
+     * cheaper for large batches.  Returns the atoms in the table, in
+     * the same order as the atoms passed in; an atom that could not be
+     * added (a DeleteLink, or a link holding one) is Handle::UNDEFINED
+     * in the result.  Subscribers to the addAtomsSignal get one
+     * notification for the whole batch.
+     */
+    HandleSeq add_atoms(const HandleSeq&);
+
     /**
      * Add a node to the Atom Table.  If the atom already exists
      * then that is returned.
@@ -537,18 +567,29 @@ public:
 
     /* ----------------------------------------------------------- */
     // ---- Signals
+    // Observers are called in the thread that changed the atomspace,
+    // unless async is set; then they are called later, in a thread
+    // of their own. See ObserverBus.h for details.
 
-    boost::signals2::connection addAtomSignal(const AtomSignal::slot_type& function)
+    ObserverConnection addAtomSignal(const AtomSignal::Observer& function,
+                                     bool async = false)
+    {
+        return _atom_table.addAtomSignal().connect(function, async);
+    }
+    ObserverConnection addAtomsSignal(const AtomSeqSignal::Observer& function,
+                                      bool async = false)
     {
-        return _atom_table.addAtomSignal().connect(function);
+        return _atom_table.addAtomsSignal().connect(function, async);
     }
-    boost::signals2::connection removeAtomSignal(const AtomPtrSignal::slot_type& function)
+    ObserverConnection removeAtomSignal(const AtomPtrSignal::Observer& function,
+                                        bool async = false)
     {
-        return _atom_table.removeAtomSignal().connect(function);
+        return _atom_table.removeAtomSignal().connect(function, async);
     }
-    boost::signals2::connection TVChangedSignal(const TVCHSigl::slot_type& function)
+    ObserverConnection TVChangedSignal(const TVCHSigl::Observer& function,
+                                       bool async = false)
     {
-        return _atom_table.TVChangedSignal().connect(function);
+        return _atom_table.TVChangedSignal().connect(function, async);
     }
 };
 
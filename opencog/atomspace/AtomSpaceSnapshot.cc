@@ -0,0 +1,625 @@
+/*
+ * opencog/atomspace/AtomSpaceSnapshot.cc
+ *
+ * Copyright (C) 2017 OpenCog Foundation
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License v3 as
+ * published by the Free Software Foundation and including the exceptions
+ * at http://opencog.org/wiki/Licenses
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, write to:
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * Snapshot files.
+ *
+ * A snapshot is laid out so that it can be mapped into memory and
+ * read in place: a fixed header, and then sections of flat arrays,
+ * each starting on an eight-byte boundary.  Numbers are in the byte
+ * order of the host that wrote the file; the header records it, and
+ * a host of the other byte order refuses the file.
+ *
+ *  TYPES        uint64 string index of each type name, by local type id
+ *  STRING_INDEX uint64 offsets into STRING_DATA, one per string, plus
+ *               the end of the last string
+ *  STRING_DATA  the bytes of the strings, one after another
+ *  LEVELS       uint64 index of the first atom of each height, plus
+ *               the number of atoms
+ *  ATOMS        SnapshotAtom, sorted by height: nodes first, then the
+ *               links that hold only nodes, and so on
+ *  OUTGOING     uint64 atom indexes; each link's outgoing set is
+ *               `arity` entries starting at its `data`
+ *  TVS          for each atom that does not have the default TV, in
+ *               atom order: uint64 atom, then a value (below)
+ *  VALUES       uint64 atom, uint64 key, then a value
+ *
+ * A value is uint32 local type, uint32 count, and then, by type:
+ * for an atom, its uint64 index (the count is 1); for a FloatValue or
+ * a truth value, `count` doubles; for a StringValue, `count` uint64
+ * string indexes; for a LinkValue, `count` values.
+ *
+ * Because atoms are sorted by height, every link comes after all of
+ * the atoms it holds, so the atoms of each height can be added to the
+ * table as one batch.
+ */
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <opencog/atoms/base/ClassServer.h>
+#include <opencog/atoms/base/FloatValue.h>
+#include <opencog/atoms/base/Link.h>
+#include <opencog/atoms/base/LinkValue.h>
+#include <opencog/atoms/base/Node.h>
+#include <opencog/atoms/base/StringValue.h>
+#include <opencog/truthvalue/TruthValue.h>
+#include <opencog/util/exceptions.h>
+#include <opencog/util/Logger.h>
+
+#include "AtomSpace.h"
+
+using namespace opencog;
+
+#define SNAPSHOT_MAGIC "OCSNAPSH"
+#define SNAPSHOT_VERSION 1
+#define SNAPSHOT_BYTE_ORDER 0x01020304
+
+// Atoms are added to the table this many at a time, so that the
+// atoms being built do not all have to be in memory at once.
+#define SNAPSHOT_BATCH (256 * 1024)
+
+enum SnapshotSection
+{
+    TYPES, STRING_INDEX, STRING_DATA, LEVELS,
+    ATOMS, OUTGOING, TVS, VALUES,
+    NUM_SECTIONS
+};
+
+struct SnapshotHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint64_t file_size;
+    uint64_t num_atoms;
+    struct { uint64_t offset, size; } section[NUM_SECTIONS];
+};
+
+struct SnapshotAtom
+{
+    uint32_t type;
+    uint32_t arity;    // zero for nodes
+    uint64_t data;     // name string for nodes; first OUTGOING entry
+};
+
+// ------------------------------------------------------------------
+// Writing
+
+namespace {
+
+/// Everything needed to write a snapshot; the sections are put
+/// together in memory, and then written out one after another.
+struct SnapshotWriter
+{
+    std::string sec[NUM_SECTIONS];
+
+    std::unordered_map<Type, uint32_t> types;
+    std::unordered_map<Handle, uint64_t> index;
+    uint64_t num_strings = 0;
+
+    template<typename T>
+    static void put(std::string& s, const T& v)
+    {
+        s.append((const char*) &v, sizeof(T));
+    }
+
+    uint64_t add_string(const std::string& str)
+    {
+        put(sec[STRING_INDEX], (uint64_t) sec[STRING_DATA].size());
+        sec[STRING_DATA].append(str);
+        return num_strings++;
+    }
+
+    uint32_t add_type(Type t)
+    {
+        auto it = types.find(t);
+        if (types.end() != it) return it->second;
+        uint32_t id = types.size();
+        types.emplace(t, id);
+        put(sec[TYPES], add_string(classserver().getTypeName(t)));
+        return id;
+    }
+
+    /// Values holding atoms that are not in the snapshot cannot be
+    /// written; these return false.
+    bool can_write(const ProtoAtomPtr& v)
+    {
+        if (v->isAtom()) return index.end() != index.find(HandleCast(v));
+        LinkValuePtr lv(LinkValueCast(v));
+        if (nullptr == lv) return true;
+        for (const ProtoAtomPtr& vi : lv->value())
+            if (not can_write(vi)) return false;
+        return true;
+    }
+
+    void put_value(std::string& s, const ProtoAtomPtr& v)
+    {
+        put(s, add_type(v->getType()));
+        if (v->isAtom()) {
+            put(s, (uint32_t) 1);
+            put(s, index.at(HandleCast(v)));
+            return;
+        }
+
+        FloatValuePtr fv(FloatValueCast(v));
+        if (fv) {
+            put(s, (uint32_t) fv->value().size());
+            for (double d : fv->value()) put(s, d);
+            return;
+        }
+
+        StringValuePtr sv(StringValueCast(v));
+        if (sv) {
+            put(s, (uint32_t) sv->value().size());
+            for (const std::string& str : sv->value())
+                put(s, add_string(str));
+            return;
+        }
+
+        LinkValuePtr lv(LinkValueCast(v));
+        if (lv) {
+            put(s, (uint32_t) lv->value().size());
+            for (const ProtoAtomPtr& vi : lv->value())
+                put_value(s, vi);
+            return;
+        }
+
+        throw RuntimeException(TRACE_INFO,
+            "Snapshot: cannot write a value of type %s",
+            classserver().getTypeName(v->getType()).c_str());
+    }
+};
+
+/// Put the atom into the level of its height, after the atoms it
+/// holds, and return the height.  The atoms held by links may be in
+/// a parent atomspace; they go into the snapshot too.
+size_t sort_by_height(const Handle& h,
+                      std::unordered_map<Handle, size_t>& height,
+                      std::vector<HandleSeq>& levels)
+{
+    auto it = height.find(h);
+    if (height.end() != it) return it->second;
+
+    // Links without any atoms in them still go after the nodes.
+    size_t ht = 0;
+    if (h->isLink()) {
+        ht = 1;
+        for (const Handle& ho : h->getOutgoingSet())
+            ht = std::max(ht, sort_by_height(ho, height, levels) + 1);
+    }
+    height.emplace(h, ht);
+    if (levels.size() <= ht) levels.resize(ht + 1);
+    levels[ht].push_back(h);
+    return ht;
+}
+
+} // anonymous namespace
+
+void AtomSpace::save_snapshot(const std::string& path)
+{
+    HandleSeq all;
+    get_handles_by_type(all, ATOM, true);
+
+    std::vector<HandleSeq> levels;
+    {
+        std::unordered_map<Handle, size_t> height;
+        for (const Handle& h : all)
+            sort_by_height(h, height, levels);
+    }
+
+    SnapshotWriter w;
+    uint64_t natoms = 0;
+    for (const HandleSeq& level : levels) {
+        SnapshotWriter::put(w.sec[LEVELS], natoms);
+        for (const Handle& h : level) {
+            w.index.emplace(h, natoms++);
+
+            SnapshotAtom rec;
+            rec.type = w.add_type(h->getType());
+            if (h->isNode()) {
+                rec.arity = 0;
+                rec.data = w.add_string(h->getName());
+            } else {
+                rec.arity = h->getArity();
+                rec.data = w.sec[OUTGOING].size() / sizeof(uint64_t);
+                for (const Handle& ho : h->getOutgoingSet())
+                    SnapshotWriter::put(w.sec[OUTGOING], w.index.at(ho));
+            }
+            SnapshotWriter::put(w.sec[ATOMS], rec);
+
+            TruthValuePtr tv(h->getTruthValue());
+            if (not tv->isDefaultTV()) {
+                SnapshotWriter::put(w.sec[TVS], natoms - 1);
+                w.put_value(w.sec[TVS],
+                    std::const_pointer_cast<TruthValue>(tv));
+            }
+        }
+    }
+    SnapshotWriter::put(w.sec[LEVELS], natoms);
+
+    // The values come last, since keys and the atoms held in values
+    // may be anywhere in the atom section.
+    size_t skipped = 0;
+    for (const Handle& h : all) {
+        for (const Handle& key : h->getKeys()) {
+            ProtoAtomPtr v(h->getValue(key));
+            if (nullptr == v) continue;
+            if (w.index.end() == w.index.find(key) or not w.can_write(v)) {
+                skipped++;
+                continue;
+            }
+            SnapshotWriter::put(w.sec[VALUES], w.index.at(h));
+            SnapshotWriter::put(w.sec[VALUES], w.index.at(key));
+            w.put_value(w.sec[VALUES], v);
+        }
+    }
+    if (skipped)
+        logger().warn("Snapshot: skipped %zu values holding atoms "
+                      "that are not in the atomspace", skipped);
+
+    // The end of the last string.
+    SnapshotWriter::put(w.sec[STRING_INDEX], (uint64_t) w.sec[STRING_DATA].size());
+
+    SnapshotHeader hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, SNAPSHOT_MAGIC, sizeof(hdr.magic));
+    hdr.version = SNAPSHOT_VERSION;
+    hdr.byte_order = SNAPSHOT_BYTE_ORDER;
+    hdr.num_atoms = natoms;
+    uint64_t offset = sizeof(hdr);
+    for (int i = 0; i < NUM_SECTIONS; i++) {
+        offset = (offset + 7) & ~((uint64_t) 7);
+        hdr.section[i].offset = offset;
+        hdr.section[i].size = w.sec[i].size();
+        offset += w.sec[i].size();
+    }
+    hdr.file_size = offset;
+
+    // Write to the side, and rename, so that a crash part way through
+    // leaves the previous snapshot as it was.
+    std::string tmp = path + ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        if (not out)
+            throw IOException(TRACE_INFO,
+                "Snapshot: cannot write %s", tmp.c_str());
+        out.write((const char*) &hdr, sizeof(hdr));
+        uint64_t at = sizeof(hdr);
+        for (int i = 0; i < NUM_SECTIONS; i++) {
+            static const char zeros[8] = {0};
+            out.write(zeros, hdr.section[i].offset - at);
+            out.write(w.sec[i].data(), w.sec[i].size());
+            at = hdr.section[i].offset + w.sec[i].size();
+        }
+        out.flush();
+        if (not out)
+            throw IOException(TRACE_INFO,
+                "Snapshot: failed writing %s", tmp.c_str());
+    }
+    if (0 != rename(tmp.c_str(), path.c_str()))
+        throw IOException(TRACE_INFO,
+            "Snapshot: cannot rename %s to %s: %s",
+            tmp.c_str(), path.c_str(), strerror(errno));
+}
+
+// ------------------------------------------------------------------
+// Reading
+
+namespace {
+
+static void bad_snapshot(const char* what)
+{
+    throw RuntimeException(TRACE_INFO, "Snapshot: %s", what);
+}
+
+/// The file, mapped into memory, with bounds-checked access to its
+/// sections.
+struct SnapshotReader
+{
+    const char* base = nullptr;
+    size_t size = 0;
+    const SnapshotHeader* hdr;
+    std::vector<Type> types;
+
+    SnapshotReader(const std::string& path)
+    {
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            throw IOException(TRACE_INFO, "Snapshot: cannot open %s: %s",
+                path.c_str(), strerror(errno));
+        struct stat st;
+        if (0 != fstat(fd, &st) or st.st_size < (off_t) sizeof(SnapshotHeader)) {
+            close(fd);
+            bad_snapshot("file is too short");
+        }
+        size = st.st_size;
+        void* m = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (MAP_FAILED == m)
+            throw IOException(TRACE_INFO, "Snapshot: cannot map %s: %s",
+                path.c_str(), strerror(errno));
+        base = (const char*) m;
+
+        // The file is read from front to back, once; let the kernel
+        // read ahead, and drop the pages behind.
+        madvise(m, size, MADV_SEQUENTIAL);
+
+        hdr = (const SnapshotHeader*) base;
+        if (memcmp(hdr->magic, SNAPSHOT_MAGIC, sizeof(hdr->magic)))
+            bad_snapshot("not a snapshot file");
+        if (SNAPSHOT_BYTE_ORDER != hdr->byte_order)
+            bad_snapshot("written on a host of the other byte order");
+        if (SNAPSHOT_VERSION != hdr->version)
+            bad_snapshot("unsupported version");
+        if (hdr->file_size != size)
+            bad_snapshot("file is truncated");
+        for (int i = 0; i < NUM_SECTIONS; i++) {
+            const auto& s = hdr->section[i];
+            if (s.offset % 8 or size < s.offset or size - s.offset < s.size)
+                bad_snapshot("section out of bounds");
+        }
+
+        for (uint64_t i = 0; i < count<uint64_t>(TYPES); i++) {
+            std::string name(string(array<uint64_t>(TYPES)[i]));
+            Type t = classserver().getType(name);
+            if (NOTYPE == t)
+                throw RuntimeException(TRACE_INFO,
+                    "Snapshot: unknown type %s", name.c_str());
+            types.push_back(t);
+        }
+    }
+
+    ~SnapshotReader()
+    {
+        if (base) munmap((void*) base, size);
+    }
+
+    template<typename T>
+    const T* array(SnapshotSection s) const
+    {
+        return (const T*) (base + hdr->section[s].offset);
+    }
+
+    template<typename T>
+    uint64_t count(SnapshotSection s) const
+    {
+        return hdr->section[s].size / sizeof(T);
+    }
+
+    std::string string(uint64_t i) const
+    {
+        uint64_t n = count<uint64_t>(STRING_INDEX);
+        if (n <= i + 1) bad_snapshot("bad string index");
+        const uint64_t* off = array<uint64_t>(STRING_INDEX);
+        if (off[i + 1] < off[i] or hdr->section[STRING_DATA].size < off[i + 1])
+            bad_snapshot("bad string offset");
+        return std::string(base + hdr->section[STRING_DATA].offset + off[i],
+                           off[i + 1] - off[i]);
+    }
+
+    Type type(uint32_t id) const
+    {
+        if (types.size() <= id) bad_snapshot("bad type id");
+        return types[id];
+    }
+};
+
+/// Reads the variable-length entries of the TVS and VALUES sections.
+struct Cursor
+{
+    const char* p;
+    const char* end;
+
+    Cursor(const SnapshotReader& r, SnapshotSection s)
+        : p(r.base + r.hdr->section[s].offset),
+          end(p + r.hdr->section[s].size) {}
+
+    bool done() const { return end <= p; }
+
+    template<typename T>
+    T get()
+    {
+        if ((size_t) (end - p) < sizeof(T)) bad_snapshot("truncated section");
+        T v;
+        memcpy(&v, p, sizeof(T));
+        p += sizeof(T);
+        return v;
+    }
+
+    /// The atoms held in values are not known until the table has
+    /// them, so the values are read only after all atoms are in.
+    ProtoAtomPtr get_value(const SnapshotReader& r, const HandleSeq& atoms)
+    {
+        Type t = r.type(get<uint32_t>());
+        uint32_t n = get<uint32_t>();
+        ClassServer& cs = classserver();
+
+        if (cs.isA(t, ATOM)) {
+            uint64_t i = get<uint64_t>();
+            if (atoms.size() <= i) bad_snapshot("bad atom index");
+            return atoms[i];
+        }
+
+        if (cs.isA(t, FLOAT_VALUE)) {
+            if ((size_t) (end - p) / sizeof(double) < n)
+                bad_snapshot("truncated section");
+            std::vector<double> v(n);
+            memcpy(v.data(), p, n * sizeof(double));
+            p += n * sizeof(double);
+            if (cs.isA(t, TRUTH_VALUE))
+                return std::const_pointer_cast<TruthValue>(
+                    TruthValue::factory(t, v));
+            return createFloatValue(t, v);
+        }
+
+        if (cs.isA(t, STRING_VALUE)) {
+            std::vector<std::string> v;
+            for (uint32_t i = 0; i < n; i++)
+                v.push_back(r.string(get<uint64_t>()));
+            return createStringValue(v);
+        }
+
+        if (cs.isA(t, LINK_VALUE)) {
+            std::vector<ProtoAtomPtr> v;
+            for (uint32_t i = 0; i < n; i++)
+                v.push_back(get_value(r, atoms));
+            return createLinkValue(v);
+        }
+
+        throw RuntimeException(TRACE_INFO,
+            "Snapshot: cannot read a value of type %s",
+            cs.getTypeName(t).c_str());
+    }
+};
+
+} // anonymous namespace
+
+size_t AtomSpace::load_snapshot(const std::string& path)
+{
+    SnapshotReader r(path);
+
+    uint64_t natoms = r.hdr->num_atoms;
+    const SnapshotAtom* recs = r.array<SnapshotAtom>(ATOMS);
+    const uint64_t* outgoing = r.array<uint64_t>(OUTGOING);
+    const uint64_t* levels = r.array<uint64_t>(LEVELS);
+    uint64_t noutgoing = r.count<uint64_t>(OUTGOING);
+    uint64_t nlevels = r.count<uint64_t>(LEVELS);
+    if (r.count<SnapshotAtom>(ATOMS) != natoms or 0 == nlevels or
+        0 != levels[0] or natoms != levels[nlevels - 1])
+        bad_snapshot("bad atom or level section");
+
+    // The atoms, as they are in the table.
+    HandleSeq atoms(natoms);
+
+    // The truth values are sorted by atom; they are set on the atoms
+    // as they are built, before the atoms go into the table.
+    Cursor tvs(r, TVS);
+    uint64_t next_tv = tvs.done() ? natoms : tvs.get<uint64_t>();
+
+    size_t nthreads = std::max(1u, std::thread::hardware_concurrency());
+
+    for (uint64_t lv = 0; lv + 1 < nlevels; lv++) {
+        uint64_t level_start = levels[lv];
+        uint64_t level_end = levels[lv + 1];
+        if (level_end < level_start or natoms < level_end)
+            bad_snapshot("bad level");
+
+        for (uint64_t start = level_start; start < level_end;
+             start += SNAPSHOT_BATCH) {
+            uint64_t end = std::min<uint64_t>(level_end, start + SNAPSHOT_BATCH);
+            HandleSeq batch(end - start);
+
+            // Build the atoms, and their hashes, in several threads;
+            // every link holds only atoms of lower levels, all of
+            // which are in the table already.
+            auto build = [&](uint64_t from, uint64_t to)
+            {
+                for (uint64_t i = from; i < to; i++) {
+                    const SnapshotAtom& rec = recs[i];
+                    Type t = r.type(rec.type);
+                    AtomPtr atom;
+                    if (0 == lv) {
+                        if (0 != rec.arity) bad_snapshot("link among the nodes");
+                        atom = createNode(t, r.string(rec.data));
+                    } else {
+                        if (noutgoing < rec.data or
+                            noutgoing - rec.data < rec.arity)
+                            bad_snapshot("bad outgoing set");
+                        HandleSeq oset;
+                        oset.reserve(rec.arity);
+                        for (uint32_t j = 0; j < rec.arity; j++) {
+                            uint64_t o = outgoing[rec.data + j];
+                            if (level_start <= o)
+                                bad_snapshot("atoms are not sorted by height");
+                            oset.push_back(atoms[o]);
+                        }
+                        atom = createLink(oset, t);
+                    }
+                    atom->get_hash();
+                    batch[i - start] = atom->getHandle();
+                }
+            };
+
+            uint64_t n = end - start;
+            if (nthreads < 2 or n < 10000) build(start, end);
+            else {
+                std::vector<std::thread> workers;
+                std::vector<std::exception_ptr> errors(nthreads);
+                uint64_t per = (n + nthreads - 1) / nthreads;
+                for (size_t k = 0; k < nthreads; k++) {
+                    uint64_t from = start + k * per;
+                    uint64_t to = std::min(end, from + per);
+                    if (to <= from) break;
+                    workers.emplace_back([&, k, from, to]() {
+                        try { build(from, to); }
+                        catch (...) { errors[k] = std::current_exception(); }
+                    });
+                }
+                for (std::thread& th : workers) th.join();
+                for (const std::exception_ptr& e : errors)
+                    if (e) std::rethrow_exception(e);
+            }
+
+            for (; next_tv < end; next_tv = tvs.done() ? natoms : tvs.get<uint64_t>()) {
+                if (next_tv < start) bad_snapshot("truth values out of order");
+                ProtoAtomPtr tv(tvs.get_value(r, atoms));
+                TruthValuePtr tvp(TruthValueCast(tv));
+                if (nullptr == tvp) bad_snapshot("not a truth value");
+                batch[next_tv - start]->setTruthValue(tvp);
+            }
+
+            HandleSeq added(_atom_table.add_built(batch));
+            for (uint64_t i = start; i < end; i++) {
+                atoms[i] = added[i - start];
+                if (nullptr == atoms[i])
+                    bad_snapshot("atom could not be added");
+
+                // Atoms that were here already take the snapshot's TV.
+                const Handle& h = batch[i - start];
+                if (atoms[i] != h and not h->getTruthValue()->isDefaultTV())
+                    atoms[i]->setTruthValue(h->getTruthValue());
+            }
+        }
+    }
+
+    Cursor values(r, VALUES);
+    while (not values.done()) {
+        uint64_t a = values.get<uint64_t>();
+        uint64_t k = values.get<uint64_t>();
+        if (natoms <= a or natoms <= k) bad_snapshot("bad value");
+        atoms[a]->setValue(atoms[k], values.get_value(r, atoms));
+    }
+
+    return natoms;
+}
@@ -26,11 +26,15 @@
  */
 
 #include "AtomTable.h"
+#include "EpochGuard.h"
 
+#include <algorithm>
 #include <atomic>
 #include <iterator>
 #include <mutex>
 #include <set>
+#include <thread>
+#include <unordered_map>
 
 #include <stdlib.h>
 #include <boost/bind.hpp>
@@ -56,6 +60,11 @@ using namespace opencog;
 // "no atomtable" (in the persist code).
 static std::atomic<UUID> _id_pool(1);
 
+// add_atoms() builds the incoming sets in parallel for batches at
+// least this big; below it, starting the threads costs more than it
+// saves.
+#define PARALLEL_INCOMING_MIN 50000
+
 AtomTable::AtomTable(AtomTable* parent, AtomSpace* holder, bool transient)
     // Hmm. Right now async doesn't work anyway, so lets not create
     // threads for it. It just makes using gdb that much harder.
@@ -68,13 +77,14 @@ AtomTable::AtomTable(AtomTable* parent, AtomSpace* holder, bool transient)
     _as = holder;
     _environ = parent;
     _uuid = _id_pool.fetch_add(1, std::memory_order_relaxed);
-    _size = 0;
-    _num_nodes = 0;
-    _num_links = 0;
-    size_t ntypes = classserver().getNumberOfClasses();
-    _size_by_type.resize(ntypes);
     _transient = transient;
 
+    _num_shards = transient ? 1 : NUM_SHARDS;
+    _shards.reset(new AtomShard[_num_shards]);
+    size_t ntypes = classserver().getNumberOfClasses();
+    for (size_t i = 0; i < _num_shards; i++)
+        _shards[i]._size_by_type = new TypeCounts(ntypes);
+
     // Connect signal to find out about type additions
     addedTypeConnection =
         classserver().addTypeSignal().connect(
@@ -84,13 +94,12 @@ AtomTable::AtomTable(AtomTable* parent, AtomSpace* holder, bool transient)
 AtomTable::~AtomTable()
 {
     // Disconnect signals. Only then clear the resolver.
-    std::lock_guard<std::recursive_mutex> lck(_mtx);
     addedTypeConnection.disconnect();
 
     // No one who shall look at these atoms shall ever again
     // find a reference to this atomtable.
-    for (auto& pr : _atom_store) {
-        Handle& atom_to_delete = pr.second;
+    for (size_t i = 0; i < _num_shards; i++)
+    _shards[i]._store.foreach([](const Handle& atom_to_delete) {
         atom_to_delete->_atom_space = nullptr;
 
         // Aiee ... We added this link to every incoming set;
@@ -104,7 +113,7 @@ AtomTable::~AtomTable()
                 atom_in_out_set->remove_atom(link_to_delete);
             }
         }
-    }
+    });
 }
 
 void AtomTable::ready_transient(AtomTable* parent, AtomSpace* holder)
@@ -142,36 +151,40 @@ void AtomTable::clear_all_atoms()
         throw opencog::RuntimeException(TRACE_INFO,
                 "AtomTable - clear_all_atoms called on non-transient atom table.");
 
-    // Reset the size to zero.
-    _size = 0;
-    _num_nodes = 0;
-    _num_links = 0;
-
-    // Clear the by-type size cache.
-    Type total_types = _size_by_type.size();
-    for (Type type = ATOM; type < total_types; type++)
-        _size_by_type[type] = 0;
-
-    // Clear the atoms in the set.
-    for (auto& pr : _atom_store) {
-        Handle& atom_to_clear = pr.second;
-        atom_to_clear->_atom_space = nullptr;
-
-        // If this is a link we need to remove this atom from the incoming
-        // sets for any atoms in this atom's outgoing set. See note in
-        // the analogous loop in ~AtomTable above.
-        if (atom_to_clear->isLink()) {
-            LinkPtr link_to_clear = LinkCast(atom_to_clear);
-            for (AtomPtr atom_in_out_set : atom_to_clear->getOutgoingSet()) {
-                atom_in_out_set->remove_atom(link_to_clear);
+    for (size_t i = 0; i < _num_shards; i++)
+    {
+        AtomShard& shard = _shards[i];
+        std::lock_guard<std::mutex> lck(shard._mtx);
+
+        // Reset the size to zero.
+        shard._size = 0;
+        shard._num_nodes = 0;
+        shard._num_links = 0;
+
+        // Clear the by-type size cache.
+        TypeCounts* tc = shard._size_by_type.load();
+        for (size_t t = 0; t < tc->_ntypes; t++) tc->_counts[t] = 0;
+
+        // Clear the atoms in the set.
+        shard._store.foreach([](const Handle& atom_to_clear) {
+            atom_to_clear->_atom_space = nullptr;
+
+            // If this is a link we need to remove this atom from the
+            // incoming sets for any atoms in this atom's outgoing set.
+            // See note in the analogous loop in ~AtomTable above.
+            if (atom_to_clear->isLink()) {
+                LinkPtr link_to_clear = LinkCast(atom_to_clear);
+                for (AtomPtr atom_in_out_set : atom_to_clear->getOutgoingSet()) {
+                    atom_in_out_set->remove_atom(link_to_clear);
+                }
             }
-        }
-    }
+        });
 
-    // Clear the atom store. This will delete all the atoms since
-    // this will be the last shared_ptr referecence, and set the
-    // size of the set to 0.
-    _atom_store.clear();
+        // Clear the atom store. This will delete all the atoms since
+        // this will be the last shared_ptr referecence, and set the
+        // size of the set to 0.
+        shard._store.clear();
+    }
 }
 
 void AtomTable::clear()
@@ -206,6 +219,9 @@ void AtomTable::clear()
 
         // logger().set_level(save);
     }
+
+    std::lock_guard<std::mutex> lck(_fanout_mtx);
+    _fanout.clear();
 }
 
 AtomTable& AtomTable::operator=(const AtomTable& other)
@@ -246,16 +262,8 @@ Handle AtomTable::getNodeHandle(const AtomPtr& orig) const
     }
 
     ContentHash ch = a->get_hash();
-    std::lock_guard<std::recursive_mutex> lck(_mtx);
-
-    auto range = _atom_store.equal_range(ch);
-    auto bkt = range.first;
-    auto end = range.second;
-    for (; bkt != end; bkt++) {
-        if (*((AtomPtr) bkt->second) == *a) {
-            return bkt->second;
-        }
-    }
+    Handle h(get_shard(ch)._store.find(a, ch));
+    if (h) return h;
 
     if (_environ)
         return _environ->getHandle(a);
@@ -282,7 +290,7 @@ Handle AtomTable::getLinkHandle(const AtomPtr& orig, Quotation quotation) const
     // format. One of the troublemakers here is the NumberNode, which
     // will hash incorrectly, unless its in proper format. We exclude
     // unquoted scope links from it, otherwise it will prematurely
-    // abort and possibly miss alpha equivalent atom in _atom_store.
+    // abort and possibly miss alpha equivalent atom in the store.
     if (not unquoted or not classserver().isA(t, SCOPE_LINK)) {
         HandleSeq resolved_seq;
         for (const Handle& ho : seq) {
@@ -313,17 +321,9 @@ Handle AtomTable::getLinkHandle(const AtomPtr& orig, Quotation quotation) const
         a = wanted;
     }
 
-    std::lock_guard<std::recursive_mutex> lck(_mtx);
-
     // So ... check to see if we have it or not.
-    auto range = _atom_store.equal_range(ch);
-    auto bkt = range.first;
-    auto end = range.second;
-    for (; bkt != end; bkt++) {
-        if (*((AtomPtr) bkt->second) == *a) {
-            return bkt->second;
-        }
-    }
+    Handle h(get_shard(ch)._store.find(a, ch));
+    if (h) return h;
 
     if (_environ) {
         return _environ->getHandle(a, quotation);
@@ -455,15 +455,38 @@ Handle AtomTable::add(AtomPtr atom, bool async)
     else if (atom == orig)
         atom = clone_factory(atom_type, atom);
 
-    // Lock before checking to see if this kind of atom is already in
-    // the atomspace.  Lock, to prevent two different threads from
-    // trying to add exactly the same atom.
-    std::unique_lock<std::recursive_mutex> lck(_mtx);
+    // Is this kind of atom already in the atomspace?
     Handle hcheck(getHandle(orig));
     if (hcheck) return hcheck;
 
     atom->copyValues(Handle(orig));
 
+    // The atom must be fully set up before it becomes visible to
+    // other threads, since they may immediately start using it,
+    // e.g. to build new links.
+    atom->keep_incoming_set();
+    atom->setAtomSpace(_as);
+
+    // Two different threads may be trying to add exactly the same
+    // atom. Only one of them gets in; the other one must return the
+    // atom that got in, instead of its own.
+    ContentHash ch = atom->get_hash();
+    AtomShard& shard = get_shard(ch);
+    Handle h(atom->getHandle());
+    hcheck = shard._store.insert(h, ch);
+    if (hcheck != h) {
+        atom->setAtomSpace(nullptr);
+        return hcheck;
+    }
+
+    shard._size++;
+    if (atom->isNode()) shard._num_nodes++;
+    if (atom->isLink()) shard._num_links++;
+    {
+        std::lock_guard<std::mutex> lck(shard._mtx);
+        shard._size_by_type.load()->_counts[atom_type] ++;
+    }
+
     if (atom->isLink()) {
         if (STATE_LINK == atom_type) {
             // If this is a closed StateLink, (i.e. has no variables)
@@ -477,10 +500,10 @@ Handle AtomTable::add(AtomPtr atom, bool async)
 
             StateLinkPtr slp(StateLinkCast(atom));
             if (slp->is_closed()) {
+                std::lock_guard<std::recursive_mutex> slck(_state_mtx);
                 try {
                     Handle alias = slp->get_alias();
                     Handle old_state = StateLink::get_link(alias);
-                    atom->setAtomSpace(_as);
                     alias->swap_atom(LinkCast(old_state), slp);
                     extract(old_state, true);
                 } catch (const InvalidParamException& ex) {}
@@ -493,25 +516,23 @@ Handle AtomTable::add(AtomPtr atom, bool async)
         for (size_t i = 0; i < arity; i++) {
             llc->_outgoing[i]->insert_atom(llc);
         }
-    }
-
-    atom->keep_incoming_set();
-    atom->setAtomSpace(_as);
-
-    _size++;
-    if (atom->isNode()) _num_nodes++;
-    if (atom->isLink()) _num_links++;
-    _size_by_type[atom->_type] ++;
 
-    Handle h(atom->getHandle());
-    _atom_store.insert({atom->get_hash(), h});
+        // Some other thread might have extracted one of the outgoing
+        // atoms while we were busy. If so, then it may have missed us
+        // in its incoming set, and so this link must go too.
+        for (size_t i = 0; _as and i < arity; i++) {
+            if (nullptr == llc->_outgoing[i]->getAtomSpace()) {
+                if (not _transient and not async)
+                    put_atom_into_index(atom);
+                extract(h, true);
+                return h;
+            }
+        }
+    }
 
     if (not _transient and not async)
         put_atom_into_index(atom);
 
-    // We can now unlock, since we are done.
-    lck.unlock();
-
     // Update the indexes asynchronously
     if (not _transient and async)
         _index_queue.enqueue(atom);
@@ -520,24 +541,315 @@ Handle AtomTable::add(AtomPtr atom, bool async)
     return h;
 }
 
+// Atoms in a batch are compared by content, not by address: the
+// batch may well hold several copies of the same atom.
+namespace {
+struct content_hash
+{
+    size_t operator()(const Handle& h) const { return h->get_hash(); }
+};
+struct content_equal
+{
+    bool operator()(const Handle& a, const Handle& b) const
+    {
+        return *a.operator->() == *b.operator->();
+    }
+};
+typedef std::unordered_map<Handle, Handle,
+                           content_hash, content_equal> AtomMap;
+typedef std::unordered_map<Handle, size_t,
+                           content_hash, content_equal> HeightMap;
+}
+
+// Sort the batch by height, so that the outgoing set of each link is
+// handled before the link is. Atoms that are already in the table (or
+// its environment) need no work at all, and are resolved right away;
+// so are links that can never be added. Returns the height of h.
+static size_t sort_by_height(const AtomTable* at, const Handle& h,
+                             HeightMap& height, AtomMap& resolved,
+                             std::vector<HandleSeq>& levels)
+{
+    auto hit = height.find(h);
+    if (height.end() != hit) return hit->second;
+
+    size_t ht = 0;
+    if (at->in_environ(h)) {
+        resolved.emplace(h, h);
+    }
+    else {
+        bool ok = true;
+        if (h->isLink()) {
+            for (const Handle& ho : h->getOutgoingSet()) {
+                // operator->() will be null if its a ProtoAtom that is
+                // not an atom.
+                if (nullptr == ho.operator->()) { ok = false; break; }
+                size_t hto = sort_by_height(at, ho, height, resolved, levels);
+                if (ht < hto + 1) ht = hto + 1;
+            }
+        }
+        if (ok) {
+            if (levels.size() <= ht) levels.resize(ht + 1);
+            levels[ht].push_back(h);
+        }
+        else resolved.emplace(h, Handle::UNDEFINED);
+    }
+    height.emplace(h, ht);
+    return ht;
+}
+
+/// Index the atoms that a batch add put into the table, and tell the
+/// subscribers about them.  This runs once the atoms are in, even if
+/// the batch threw part-way through; the atoms that got in must be
+/// indexed.
+void AtomTable::index_added(const std::vector<AtomPtr>& added,
+                            ShardCounts& counted)
+{
+    // Bump the per-type counts, locking each shard only once.
+    std::sort(counted.begin(), counted.end());
+    for (size_t i = 0; i < counted.size(); ) {
+        AtomShard* shard = counted[i].first;
+        std::lock_guard<std::mutex> lck(shard->_mtx);
+        TypeCounts* tc = shard->_size_by_type.load();
+        for (; i < counted.size() and counted[i].first == shard; i++)
+            tc->_counts[counted[i].second] ++;
+    }
+
+    // Build the incoming sets, locking each target atom only once.
+    // Big batches (snapshot loads, mostly) split the targets among
+    // several threads; each thread scans all of the new links, but
+    // keeps only the targets that hash to it.
+    size_t nparts = 1;
+    if (PARALLEL_INCOMING_MIN <= added.size())
+        nparts = std::max(1u, std::thread::hardware_concurrency());
+    auto build_incoming = [&](size_t part)
+    {
+        std::unordered_map<Atom*, std::vector<LinkPtr>> incoming;
+        for (const AtomPtr& atom : added) {
+            if (not atom->isLink()) continue;
+            LinkPtr llc(LinkCast(atom));
+            for (const Handle& ho : llc->_outgoing) {
+                Atom* target = ho.operator->();
+                if (1 < nparts and part !=
+                    ((uintptr_t) target * 0x9E3779B97F4A7C15ULL >> 32) % nparts)
+                    continue;
+                incoming[target].push_back(llc);
+            }
+        }
+        for (auto& inc : incoming)
+            inc.first->insert_atoms(inc.second);
+    };
+    if (1 == nparts) build_incoming(0);
+    else {
+        std::vector<std::thread> workers;
+        for (size_t part = 0; part < nparts; part++)
+            workers.emplace_back(build_incoming, part);
+        for (std::thread& w : workers) w.join();
+    }
+
+    if (not _transient) {
+        std::vector<Atom*> pats;
+        pats.reserve(added.size());
+        for (const AtomPtr& atom : added)
+            pats.push_back(atom.operator->());
+        typeIndex.insertAtoms(pats);
+
+        // The signals run unlocked, since they may result in more
+        // atom table additions.
+        HandleSeq hadded;
+        hadded.reserve(added.size());
+        for (const AtomPtr& atom : added)
+            hadded.emplace_back(atom->getHandle());
+        if (not _addAtomSignal.empty())
+            for (const Handle& h : hadded)
+                _addAtomSignal(h);
+        if (not _addAtomsSignal.empty() and not hadded.empty())
+            _addAtomsSignal(hadded);
+    }
+
+    // Some other thread might have extracted one of the outgoing
+    // atoms while we were busy. See add() for why this matters.
+    for (const AtomPtr& atom : added) {
+        if (not _as or not atom->isLink()) continue;
+        if (nullptr == atom->getAtomSpace()) continue;
+        for (const Handle& ho : atom->getOutgoingSet()) {
+            if (nullptr == ho->getAtomSpace()) {
+                Handle h(atom->getHandle());
+                extract(h, true);
+                break;
+            }
+        }
+    }
+}
+
+/// Put an atom made for this table (so, not in any other) into its
+/// shard, unless an equal atom is there already.  Returns the atom
+/// that is in the table.  New atoms are appended to `added`, and have
+/// to be passed to index_added() later.
+Handle AtomTable::insert_built(const AtomPtr& atom,
+                               std::vector<AtomPtr>& added,
+                               ShardCounts& counted)
+{
+    // Is this kind of atom already in the atomspace?
+    Handle hcheck(getHandle(atom));
+    if (hcheck) return hcheck;
+
+    atom->keep_incoming_set();
+    atom->setAtomSpace(_as);
+
+    ContentHash ch = atom->get_hash();
+    AtomShard& shard = get_shard(ch);
+    Handle h(atom->getHandle());
+    hcheck = shard._store.insert(h, ch);
+    if (hcheck != h) {
+        atom->setAtomSpace(nullptr);
+        return hcheck;
+    }
+
+    shard._size++;
+    if (atom->isNode()) shard._num_nodes++;
+    if (atom->isLink()) shard._num_links++;
+    counted.emplace_back(&shard, atom->getType());
+    added.push_back(atom);
+    return h;
+}
+
+HandleSeq AtomTable::add_atoms(const HandleSeq& hseq)
+{
+    HeightMap height;
+    AtomMap resolved;
+    std::vector<HandleSeq> levels;
+    for (const Handle& h : hseq)
+        if (nullptr != h.operator->())
+            sort_by_height(this, h, height, resolved, levels);
+
+    // Finding the factory for a type means searching up through the
+    // type hierarchy; do that only once per type in the batch.
+    std::unordered_map<Type, ClassServer::AtomFactory*> factories;
+
+    // The atoms that this call actually put into the table.
+    std::vector<AtomPtr> added;
+    ShardCounts counted;
+
+    try {
+        for (const HandleSeq& level : levels) {
+            for (const Handle& orig : level) {
+                Type atom_type = orig->getType();
+                AtomPtr atom;
+                if (orig->isLink()) {
+                    HandleSeq oset;
+                    oset.reserve(orig->getArity());
+                    for (const Handle& ho : orig->getOutgoingSet()) {
+                        const Handle& hr = resolved.at(ho);
+                        if (nullptr == hr) break;
+                        oset.push_back(hr);
+                    }
+                    if (oset.size() != orig->getArity()) {
+                        resolved.emplace(orig, Handle::UNDEFINED);
+                        continue;
+                    }
+
+                    // DeleteLinks and StateLinks have side effects on
+                    // the rest of the table; let add() deal with them.
+                    // A DeleteLink that is refused is left out, along
+                    // with everything that holds it.
+                    if (DELETE_LINK == atom_type or STATE_LINK == atom_type) {
+                        LinkPtr lp(createLink(oset, atom_type));
+                        lp->copyValues(orig);
+                        Handle h;
+                        try {
+                            h = add(lp, false);
+                        }
+                        catch (const DeleteException&) {}
+                        resolved.emplace(orig, h);
+                        continue;
+                    }
+                    // This link is already our own private copy, so
+                    // unlike add(), there is no need to clone it.
+                    atom = createLink(oset, atom_type);
+                    auto fit = factories.find(atom_type);
+                    if (factories.end() == fit)
+                        fit = factories.emplace(atom_type,
+                            classserver().getFactory(atom_type)).first;
+                    if (fit->second)
+                        atom = (*fit->second)(Handle(atom));
+                }
+                else atom = clone_factory(atom_type, orig);
+
+                atom->copyValues(orig);
+                resolved.emplace(orig, insert_built(atom, added, counted));
+            }
+        }
+    }
+    catch (...) {
+        index_added(added, counted);
+        throw;
+    }
+    index_added(added, counted);
+
+    HandleSeq result;
+    result.reserve(hseq.size());
+    for (const Handle& h : hseq) {
+        if (nullptr == h.operator->()) result.emplace_back(Handle::UNDEFINED);
+        else result.emplace_back(resolved.at(h));
+    }
+    return result;
+}
+
+HandleSeq AtomTable::add_built(const HandleSeq& hseq)
+{
+    std::unordered_map<Type, ClassServer::AtomFactory*> factories;
+    std::vector<AtomPtr> added;
+    ShardCounts counted;
+
+    HandleSeq result;
+    result.reserve(hseq.size());
+    try {
+        for (const Handle& h : hseq) {
+            Type atom_type = h->getType();
+            AtomPtr atom(h);
+            if (h->isLink()) {
+                if (DELETE_LINK == atom_type or STATE_LINK == atom_type) {
+                    result.emplace_back(add(atom, false));
+                    continue;
+                }
+                auto fit = factories.find(atom_type);
+                if (factories.end() == fit)
+                    fit = factories.emplace(atom_type,
+                        classserver().getFactory(atom_type)).first;
+                if (fit->second) atom = (*fit->second)(h);
+            }
+            else if (NUMBER_NODE == atom_type or
+                     classserver().isA(atom_type, TYPE_NODE))
+                atom = clone_factory(atom_type, atom);
+
+            if (atom != h) atom->copyValues(h);
+            result.emplace_back(insert_built(atom, added, counted));
+        }
+    }
+    catch (...) {
+        index_added(added, counted);
+        throw;
+    }
+    index_added(added, counted);
+    return result;
+}
+
 void AtomTable::put_atom_into_index(const AtomPtr& atom)
 {
     if (_transient)
         throw RuntimeException(TRACE_INFO,
           "AtomTable - transient should not index atoms!");
 
-    std::unique_lock<std::recursive_mutex> lck(_mtx);
     Atom* pat = atom.operator->();
     typeIndex.insertAtom(pat);
 
-    // We can now unlock, since we are done. In particular, the signals
-    // need to run unlocked, since they may result in more atom table
-    // additions.
-    lck.unlock();
+    // The signals run unlocked, since they may result in more atom
+    // table additions.
 
     // Now that we are completely done, emit the added signal.
     // Don't emit signal until after the indexes are updated!
-    _addAtomSignal(atom->getHandle());
+    if (not _addAtomSignal.empty())
+        _addAtomSignal(atom->getHandle());
 }
 
 void AtomTable::barrier()
@@ -545,34 +857,47 @@ void AtomTable::barrier()
     _index_queue.flush_queue();
 }
 
+// The counts are kept per-shard, so that adding and removing atoms
+// never contends on a single counter.  The sums are not a snapshot;
+// they may be off by the number of adds and removes in progress.
 size_t AtomTable::getSize() const
 {
-    return _size;
+    size_t result = 0;
+    for (size_t i = 0; i < _num_shards; i++)
+        result += _shards[i]._size.load(std::memory_order_relaxed);
+    return result;
 }
 
 size_t AtomTable::getNumNodes() const
 {
-    return _num_nodes;
+    size_t result = 0;
+    for (size_t i = 0; i < _num_shards; i++)
+        result += _shards[i]._num_nodes.load(std::memory_order_relaxed);
+    return result;
 }
 
 size_t AtomTable::getNumLinks() const
 {
-    return _num_links;
+    size_t result = 0;
+    for (size_t i = 0; i < _num_shards; i++)
+        result += _shards[i]._num_links.load(std::memory_order_relaxed);
+    return result;
 }
 
 size_t AtomTable::getNumAtomsOfType(Type type, bool subclass) const
 {
-    std::lock_guard<std::recursive_mutex> lck(_mtx);
+    // Also count subclasses of this type, if need be.
+    std::vector<Type> types;
+    typeIndex.foreachType(type, subclass,
+        [&](Type t) { types.push_back(t); });
 
-    size_t result = _size_by_type[type];
-    if (subclass)
+    size_t result = 0;
     {
-        // Also count subclasses of this type, if need be.
-        Type ntypes = _size_by_type.size();
-        for (Type t = ATOM; t<ntypes; t++)
+        EpochGuard guard;
+        for (size_t i = 0; i < _num_shards; i++)
         {
-            if (t != type and classserver().isA(type, t))
-                result += _size_by_type[t];
+            const TypeCounts* tc = _shards[i]._size_by_type.load();
+            for (Type t : types) result += tc->get(t);
         }
     }
 
@@ -582,6 +907,118 @@ size_t AtomTable::getNumAtomsOfType(Type type, bool subclass) const
     return result;
 }
 
+// Number of links that a fan-out estimate is made from.
+#define FANOUT_SAMPLE 64
+
+// The links in the incoming set of an atom are counted one by one,
+// unless there are more than this many of them; then all of them are
+// counted, whatever their type and position.
+#define FANOUT_MAX_SCAN 4096
+
+// A fan-out estimate is re-sampled when the number of links has grown
+// or shrunk by more than this factor, and by more than this many links.
+#define FANOUT_DRIFT_FACTOR 2
+#define FANOUT_DRIFT_SLACK 16
+
+// Estimate the fan-out from a sample of the links. Each sampled link
+// leads to one atom, and the atoms with many links are more likely to
+// be reached that way; so each atom is weighted by the inverse of its
+// degree, to get the per-atom averages.
+FanoutStats AtomTable::sampleFanout(Type t, size_t pos, size_t links) const
+{
+    FanoutStats fs;
+    HandleSeq sample;
+    typeIndex.sampleType(t, FANOUT_SAMPLE, links * 31 + t, sample);
+
+    bool unordered = classserver().isA(t, UNORDERED_LINK);
+    size_t used = 0;
+    double inverse = 0.0;
+    for (const Handle& h : sample) {
+        if (h->getArity() <= pos) continue;
+        const Handle& a = h->getOutgoingAtom(pos);
+
+        double degree = 0.0;
+        size_t isz = a->getIncomingSetSize();
+        if (FANOUT_MAX_SCAN < isz) degree = isz;
+        else {
+            for (const LinkPtr& lp : a->getIncomingSetByType(t))
+                if (unordered or lp->getOutgoingAtom(pos) == a) degree++;
+        }
+        if (degree < 1.0) degree = 1.0;
+
+        size_t bin = 0;
+        while (bin + 1 < FanoutStats::NUM_BINS and (2 << bin) <= degree) bin++;
+        fs.histogram[bin] += 1.0 / degree;
+        inverse += 1.0 / degree;
+        used++;
+    }
+
+    if (0 == used) return fs;
+
+    // Not every link need have an atom at this position.
+    fs.links = (links * used) / sample.size();
+    fs.sampled = used;
+    fs.mean = used / inverse;
+    for (double& bin : fs.histogram)
+        bin *= fs.links / (double) used;
+    return fs;
+}
+
+FanoutStats AtomTable::getFanout(Type t, size_t pos) const
+{
+    ClassServer& cs = classserver();
+    if (not cs.isA(t, LINK)) return FanoutStats();
+    if (cs.isA(t, UNORDERED_LINK)) pos = 0;
+
+    // Transient tables are not indexed, and so cannot be sampled.
+    FanoutStats fs;
+    if (not _transient) {
+        size_t links = 0;
+        {
+            EpochGuard guard;
+            for (size_t i = 0; i < _num_shards; i++)
+                links += _shards[i]._size_by_type.load()->get(t);
+        }
+
+        std::pair<Type, size_t> key(t, pos);
+        bool fresh = false;
+        {
+            std::lock_guard<std::mutex> lck(_fanout_mtx);
+            auto it = _fanout.find(key);
+            if (_fanout.end() != it) {
+                size_t then = it->second.first;
+                size_t lo = std::min(then, links);
+                size_t hi = std::max(then, links);
+                fresh = hi - lo <= FANOUT_DRIFT_SLACK or
+                        hi <= FANOUT_DRIFT_FACTOR * lo;
+                if (fresh) fs = it->second.second;
+            }
+        }
+
+        if (not fresh) {
+            fs = sampleFanout(t, pos, links);
+            std::lock_guard<std::mutex> lck(_fanout_mtx);
+            _fanout[key] = std::make_pair(links, fs);
+        }
+    }
+
+    if (nullptr == _environ) return fs;
+
+    // Combine with the parent's statistics, adding up the links and
+    // the distinct atoms.
+    FanoutStats env = _environ->getFanout(t, pos);
+    if (0 == env.links) return fs;
+    if (0 == fs.links) return env;
+
+    double atoms = fs.links / fs.mean + env.links / env.mean;
+    fs.links += env.links;
+    fs.sampled += env.sampled;
+    fs.mean = fs.links / atoms;
+    for (size_t i = 0; i < FanoutStats::NUM_BINS; i++)
+        fs.histogram[i] += env.histogram[i];
+    return fs;
+}
+
 Handle AtomTable::getRandom(RandGen *rng) const
 {
     size_t x = rng->randint(getSize());
@@ -603,6 +1040,10 @@ Handle AtomTable::getRandom(RandGen *rng) const
 
 AtomPtrSet AtomTable::extract(Handle& handle, bool recursive)
 {
+    // The atoms taken out of the hash table are retired to the epoch
+    // reclaimer; leaving the outermost guard hands them over, so that
+    // they don't wait for this thread to retire a whole batch.
+    EpochGuard guard;
     AtomPtrSet result;
 
     // Make sure the atom is fully resolved before we go about
@@ -623,14 +1064,14 @@ AtomPtrSet AtomTable::extract(Handle& handle, bool recursive)
         return other->extract(handle, recursive);
     }
 
-    // Lock before fetching the incoming set. Since getting the
-    // incoming set also grabs a lock, we need this mutex to be
-    // recursive. We need to lock here to avoid confusion if multiple
-    // threads are trying to delete the same atom.
-    std::unique_lock<std::recursive_mutex> lck(_mtx);
-
-    if (atom->isMarkedForRemoval()) return result;
-    atom->markForRemoval();
+    // If multiple threads are trying to delete the same atom, then
+    // only one of them gets to do it. The atom's own lock makes the
+    // check-and-set of the removal flag atomic.
+    {
+        std::lock_guard<std::mutex> alck(atom->_mtx);
+        if (atom->isMarkedForRemoval()) return result;
+        atom->markForRemoval();
+    }
 
     // If recursive-flag is set, also extract all the links in the atom's
     // incoming set
@@ -680,6 +1121,7 @@ AtomPtrSet AtomTable::extract(Handle& handle, bool recursive)
             {
                 // User asked for a non-recursive remove, and the
                 // atom is still referenced. So, do nothing.
+                std::lock_guard<std::mutex> alck(atom->_mtx);
                 handle->unsetRemovalFlag();
                 return result;
             }
@@ -706,6 +1148,21 @@ AtomPtrSet AtomTable::extract(Handle& handle, bool recursive)
                 //
                 // XXX this might not be exactly thread-safe, if
                 // other atomspaces are involved...
+                //
+                // Another thread may have added a new link to the
+                // incoming set, after we copied it above.  It has to
+                // go, as well.
+                AtomTable* itab = iset[i]->getAtomSpace() ?
+                    iset[i]->getAtomTable() : nullptr;
+                if (itab and itab->in_environ(handle) and
+                    not iset[i]->isMarkedForRemoval())
+                {
+                    Handle hi(iset[i]);
+                    AtomPtrSet ex = itab->extract(hi, true);
+                    result.insert(ex.begin(), ex.end());
+                    continue;
+                }
+
                 if (iset[i]->getAtomTable() != NULL and
                     (not iset[i]->getAtomTable()->in_environ(handle) or
                      not iset[i]->isMarkedForRemoval()))
@@ -738,29 +1195,23 @@ AtomPtrSet AtomTable::extract(Handle& handle, bool recursive)
     // removed.  This is needed so that certain subsystems, e.g. the
     // Agent system activity table, can correctly manage the atom;
     // it needs info that gets blanked out during removal.
-    // Pfft. Give up the pretension. This is a recursive lock;
-    // unlocking it once is not enough, because it can still be
-    // recurisvely locked.
-    // lck.unlock();
+    // No table locks are held here.
     _removeAtomSignal(atom);
-    // lck.lock();
+
+    ContentHash ch = atom->get_hash();
+    AtomShard& shard = get_shard(ch);
 
     // Decrements the size of the table
-    _size--;
-    if (atom->isNode()) _num_nodes--;
-    if (atom->isLink()) _num_links--;
-    _size_by_type[atom->_type] --;
-
-    auto range = _atom_store.equal_range(atom->get_hash());
-    auto bkt = range.first;
-    auto end = range.second;
-    for (; bkt != end; bkt++) {
-        if (handle == bkt->second) {
-            _atom_store.erase(bkt);
-            break;
-        }
+    shard._size--;
+    if (atom->isNode()) shard._num_nodes--;
+    if (atom->isLink()) shard._num_links--;
+    {
+        std::lock_guard<std::mutex> lck(shard._mtx);
+        shard._size_by_type.load()->_counts[atom->_type] --;
     }
 
+    shard._store.erase(atom->getHandle(), ch);
+
     Atom* pat = atom.operator->();
     typeIndex.removeAtom(pat);
 
@@ -771,12 +1222,22 @@ AtomPtrSet AtomTable::extract(Handle& handle, bool recursive)
         }
     }
 
-    // XXX Setting the atom table causes AVChanged signals to be emitted.
-    // We should really do this unlocked, but I'm too lazy to fix, and
-    // am hoping no one will notice. This will probably need to be fixed
-    // someday.
     atom->setAtomSpace(nullptr);
 
+    // A link that was added by some other thread, after the incoming
+    // set was examined above, would now be dangling. Those threads
+    // check for a null atomspace after building the incoming set;
+    // anything that got in before that is caught here.
+    if (recursive) {
+        IncomingSet late(atom->getIncomingSet());
+        for (const LinkPtr& lp : late) {
+            if (nullptr == lp->getAtomSpace()) continue;
+            Handle hl(lp);
+            AtomPtrSet ex = lp->getAtomTable()->extract(hl, true);
+            result.insert(ex.begin(), ex.end());
+        }
+    }
+
     result.insert(atom);
     return result;
 }
@@ -784,10 +1245,19 @@ AtomPtrSet AtomTable::extract(Handle& handle, bool recursive)
 // This is the resize callback, when a new type is dynamically added.
 void AtomTable::typeAdded(Type t)
 {
-    std::lock_guard<std::recursive_mutex> lck(_mtx);
     //resize all Type-based indexes
     size_t new_size = classserver().getNumberOfClasses();
-    _size_by_type.resize(new_size);
+    for (size_t i = 0; i < _num_shards; i++)
+    {
+        AtomShard& shard = _shards[i];
+        std::lock_guard<std::mutex> lck(shard._mtx);
+        TypeCounts* old = shard._size_by_type.load();
+        TypeCounts* tc = new TypeCounts(new_size);
+        for (size_t t = 0; t < old->_ntypes and t < new_size; t++)
+            tc->_counts[t] = old->_counts[t].load();
+        shard._size_by_type = tc;
+        epoch_delete(old);
+    }
     typeIndex.resize();
 }
 
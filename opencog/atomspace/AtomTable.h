@@ -25,8 +25,14 @@
 #ifndef _OPENCOG_ATOMTABLE_H
 #define _OPENCOG_ATOMTABLE_H
 
+#include <atomic>
 #include <iostream>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <set>
+#include <utility>
 #include <vector>
 
 #include <boost/signals2.hpp>
@@ -40,6 +46,9 @@
 #include <opencog/atoms/base/Quotation.h>
 #include <opencog/atoms/base/ClassServer.h>
 
+#include <opencog/atomspace/AtomHashTable.h>
+#include <opencog/atomspace/FanoutStats.h>
+#include <opencog/atomspace/ObserverBus.h>
 #include <opencog/atomspace/TypeIndex.h>
 
 class AtomTableUTest;
@@ -52,18 +61,15 @@ namespace opencog
 
 typedef std::set<AtomPtr> AtomPtrSet;
 
-// XXX FIXME boost::signals2 is painfully bloated and slow. It accounts
-// for 5% or 10% of the total performance of the atomspace (try it -
-// comment out the emit-signal functions below, and measure.
-// Alternately, launch gdb, get into the signal, and look at the stack.
-// boost::signals2 uses eleven stack frames to do its thing. Eleven!
-// Really!) Should be enough to use SigSlot in cogutils.  Need to just
-// finish this work.
-typedef boost::signals2::signal<void (const Handle&)> AtomSignal;
-typedef boost::signals2::signal<void (const AtomPtr&)> AtomPtrSignal;
-typedef boost::signals2::signal<void (const Handle&,
-                                      const TruthValuePtr&,
-                                      const TruthValuePtr&)> TVCHSigl;
+// These fire on every mutation of the table, so they are ObserverBus
+// instances, and not boost::signals2, which costs about a dozen stack
+// frames and a mutex per emit, even when no one is listening.
+typedef ObserverBus<const Handle&> AtomSignal;
+typedef ObserverBus<const AtomPtr&> AtomPtrSignal;
+typedef ObserverBus<const HandleSeq&> AtomSeqSignal;
+typedef ObserverBus<const Handle&,
+                    const TruthValuePtr&,
+                    const TruthValuePtr&> TVCHSigl;
 
 class AtomSpace;
 
@@ -79,22 +85,81 @@ class AtomTable
 
 private:
 
-    // Single, global mutex for locking the indexes.
-    // Its recursive because we need to lock twice during atom insertion
-    // and removal: we need to keep the indexes stable while we search
-    // them during add/remove.
-    mutable std::recursive_mutex _mtx;
+    /**
+     * The atoms are spread over a number of shards, according to
+     * their hash.  Each shard has its own lock-free hash table and
+     * its own counters. This way, threads that are adding, removing
+     * or looking up different atoms mostly do not contend with one
+     * another, and lookups never wait at all.
+     */
+    // The number of atoms of each type, in one shard.  The counts
+    // change only with the shard lock held, but are read without it,
+    // under an EpochGuard, since a new type replaces the whole array.
+    struct TypeCounts
+    {
+        size_t _ntypes;
+        std::unique_ptr<std::atomic<size_t>[]> _counts;
+
+        TypeCounts(size_t ntypes)
+            : _ntypes(ntypes), _counts(new std::atomic<size_t>[ntypes])
+        {
+            for (size_t t = 0; t < ntypes; t++) _counts[t] = 0;
+        }
+
+        size_t get(Type t) const
+        {
+            return t < _ntypes ? _counts[t].load(std::memory_order_relaxed)
+                               : 0;
+        }
+    };
+
+    struct AtomShard
+    {
+        // Serializes the changes to the by-type counts.
+        mutable std::mutex _mtx;
 
-    // Cached count of the number of atoms in the table.
-    size_t _size;
-    size_t _num_nodes;
-    size_t _num_links;
+        // All the atoms in this shard, addressible by thier hash.
+        AtomHashTable _store;
 
-    // Cached count of the number of atoms of each type.
-    std::vector<size_t> _size_by_type;
+        // Cached count of the number of atoms in the shard.
+        std::atomic<size_t> _size;
+        std::atomic<size_t> _num_nodes;
+        std::atomic<size_t> _num_links;
 
-    // Index of all the atoms in the table, addressible by thier hash.
-    std::unordered_multimap<ContentHash, Handle> _atom_store;
+        // Cached count of the number of atoms of each type.
+        std::atomic<TypeCounts*> _size_by_type;
+
+        AtomShard()
+            : _size(0), _num_nodes(0), _num_links(0), _size_by_type(nullptr) {}
+        ~AtomShard() { delete _size_by_type.load(); }
+    };
+
+    // Number of shards in a regular table. Transient tables are
+    // single-threaded and short-lived, and get only one shard.
+    static const size_t NUM_SHARDS = 64;
+
+    size_t _num_shards;
+    std::unique_ptr<AtomShard[]> _shards;
+
+    AtomShard& get_shard(ContentHash ch) const
+    {
+        // The low bits of the content hash are not very well mixed,
+        // so use the high bits of a Fibonacci hash of it.
+        size_t mix = (ch * 0x9e3779b97f4a7c15ULL) >> 32;
+        return _shards[mix % _num_shards];
+    }
+
+    // Serializes the replacement of closed StateLinks.
+    std::recursive_mutex _state_mtx;
+
+    // Fan-out statistics, by link type and position, along with the
+    // number of links of that type when they were sampled.  These are
+    // only sampled when asked for, and are re-sampled once the number
+    // of links has changed a lot.
+    mutable std::mutex _fanout_mtx;
+    mutable std::map<std::pair<Type, size_t>,
+                     std::pair<size_t, FanoutStats>> _fanout;
+    FanoutStats sampleFanout(Type, size_t, size_t) const;
 
     //!@{
     //! Index for quick retrieval of certain kinds of atoms.
@@ -115,6 +180,7 @@ private:
 
     /** Provided signals */
     AtomSignal _addAtomSignal;
+    AtomSeqSignal _addAtomsSignal;
     AtomPtrSignal _removeAtomSignal;
 
     /** Signal emitted when the TV changes. */
@@ -143,6 +209,11 @@ private:
     AtomPtr cast_factory(Type atom_type, AtomPtr atom);
     AtomPtr clone_factory(Type atom_type, AtomPtr atom);
 
+    // The parts of add_atoms() that add_built() shares.
+    typedef std::vector<std::pair<AtomShard*, Type>> ShardCounts;
+    Handle insert_built(const AtomPtr&, std::vector<AtomPtr>&, ShardCounts&);
+    void index_added(const std::vector<AtomPtr>&, ShardCounts&);
+
 public:
 
     /**
@@ -198,6 +269,15 @@ public:
     size_t getNumLinks() const;
     size_t getNumAtomsOfType(Type type, bool subclass = true) const;
 
+    /**
+     * Return an estimate of how many links of the given type hold
+     * the same atom at the given position of their outgoing set.
+     * See FanoutStats for details.  This is cheap: the estimate is
+     * made from a small sample, and is kept until the number of links
+     * of that type changes a lot.
+     */
+    FanoutStats getFanout(Type, size_t pos) const;
+
     /**
      * Returns the exact atom for the given name and type.
      * Note: Type must inherit from NODE. Otherwise, it returns
@@ -229,29 +309,25 @@ public:
                      bool subclass = false,
                      bool parent = true) const
     {
-        std::lock_guard<std::recursive_mutex> lck(_mtx);
         if (parent && _environ)
             _environ->getHandlesByType(result, type, subclass, parent);
-        return std::copy(typeIndex.begin(type, subclass),
-                         typeIndex.end(),
-                         result);
+        return typeIndex.getHandles(result, type, subclass);
     }
 
-    /** Calls function 'func' on all atoms */
+    /**
+     * Calls function 'func' on all atoms. No locks are held while
+     * 'func' runs, so it may add or remove atoms; atoms that are
+     * added or removed during the loop may or may not be visited.
+     */
     template <typename Function> void
     foreachHandleByType(Function func,
                         Type type,
                         bool subclass = false,
                         bool parent = true) const
     {
-        std::lock_guard<std::recursive_mutex> lck(_mtx);
         if (parent && _environ)
             _environ->foreachHandleByType(func, type, subclass);
-        std::for_each(typeIndex.begin(type, subclass),
-                      typeIndex.end(),
-             [&](const Handle& h)->void {
-                  (func)(h);
-             });
+        typeIndex.foreachHandle(func, type, subclass);
     }
 
     template <typename Function> void
@@ -260,15 +336,16 @@ public:
                         bool subclass = false,
                         bool parent = true) const
     {
-        std::lock_guard<std::recursive_mutex> lck(_mtx);
         if (parent && _environ)
             _environ->foreachParallelByType(func, type, subclass);
 
+        HandleSeq hs;
+        typeIndex.getHandles(back_inserter(hs), type, subclass);
+
         // Parallelize, always, no matter what!
         opencog::setting_omp(opencog::num_threads(), 1);
 
-        OMP_ALGO::for_each(typeIndex.begin(type, subclass),
-                      typeIndex.end(),
+        OMP_ALGO::for_each(hs.begin(), hs.end(),
              [&](const Handle& h)->void {
                   (func)(h);
              });
@@ -279,6 +356,8 @@ public:
 
     /* Exposes the type iterators so we can do more complicated 
      * looping without having to create a vector to hold the handles.
+     * These iterators are not locked; they must not be used while
+     * other threads are adding or removing atoms.
      *
      * @param The desired type.
      * @param Whether type subclasses should be considered.
@@ -302,16 +381,41 @@ public:
      * force synchronization.
      *
      * XXX The async code path doesn't really do anything yet, since
-     * it also uses the big global lock, at the moment.  This needs
-     * fixing, mostly be creating a second mutex for the atom insertion,
-     * and also giving each index its own unique mutex, to avoid
-     * collisions.  So the API is here, but more work is still needed.
+     * the index queue has no threads.  The table itself is sharded,
+     * so parallel adds of different atoms mostly do not contend.
      *
      * @param The new atom to be added.
      * @return The handle of the newly added atom.
      */
     Handle add(AtomPtr, bool async);
 
+    /**
+     * Adds a whole batch of atoms to the table, in one pass.
+     *
+     * This does the same thing as calling add() on each atom in turn,
+     * but much of the per-atom work is done only once per batch: the
+     * batch is de-duplicated, atoms are added in order of increasing
+     * height (so that the outgoing set of each link is already in the
+     * table), incoming sets and indexes are updated in bulk, and a
+     * single addAtomsSignal is emitted for all of the new atoms.  The
+     * per-atom addAtomSignal is still emitted, if anyone is listening.
+     *
+     * @param The atoms to be added.
+     * @return The atoms in the table, one for each atom passed in.
+     */
+    HandleSeq add_atoms(const HandleSeq&);
+
+    /**
+     * Adds a batch of atoms that were made for this table, by a loader
+     * that builds the atoms itself.  The atoms must not be in any
+     * atomspace, nor be held by anything else, and the outgoing set of
+     * each link must already be in this table.  Unlike add_atoms(),
+     * the atoms are neither copied nor sorted; they go in as they are,
+     * in the order given.  Returns the atoms in the table, one for each
+     * atom passed in.
+     */
+    HandleSeq add_built(const HandleSeq&);
+
     /**
      * Read-write synchronization barrier fence.  When called, this
      * will not return until all the atoms previously added to the
@@ -349,6 +453,7 @@ public:
     Handle getRandom(RandGen* rng) const;
 
     AtomSignal& addAtomSignal() { return _addAtomSignal; }
+    AtomSeqSignal& addAtomsSignal() { return _addAtomsSignal; }
     AtomPtrSignal& removeAtomSignal() { return _removeAtomSignal; }
 
     /** Provide ability for others to find out about TV changes */
@@ -0,0 +1,299 @@
+/*
+ * opencog/atomspace/EpochGuard.cc
+ *
+ * Copyright (C) 2017 OpenCog Foundation
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License v3 as
+ * published by the Free Software Foundation and including the exceptions
+ * at http://opencog.org/wiki/Licenses
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, write to:
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "EpochGuard.h"
+
+using namespace opencog;
+
+namespace {
+
+// One slot per reading thread. The epoch is zero when the thread is
+// not reading. Padded out to a cache line, so that threads entering
+// and leaving guards do not disturb one another.
+struct ReaderSlot
+{
+    std::atomic<uint64_t> epoch;
+    ReaderSlot* next;   // overflow slots only
+    std::atomic<bool> in_use;
+    char pad[64 - sizeof(std::atomic<uint64_t>) - sizeof(ReaderSlot*)
+             - sizeof(std::atomic<bool>)];
+
+    ReaderSlot() : epoch(0), next(nullptr), in_use(false) {}
+};
+
+// A deleter, and what it deletes.
+struct Retiree
+{
+    void (*fn)(void*);
+    void* arg;
+};
+
+struct EpochDomain
+{
+    static const size_t MAX_READERS = 1024;
+
+    std::atomic<uint64_t> global_epoch;
+    std::atomic<size_t> high_water;
+    ReaderSlot slots[MAX_READERS];
+
+    // Slots for the threads beyond MAX_READERS, made as needed, and
+    // reused once their threads exit; never freed.
+    std::atomic<ReaderSlot*> overflow;
+
+    // Deleters waiting for their epoch to drain.
+    std::mutex retire_mtx;
+    std::vector<std::pair<uint64_t, Retiree>> retired;
+    std::atomic<size_t> pending;
+    std::atomic<bool> reclaim_wanted;
+
+    // Readers that entered at this epoch or earlier may be holding
+    // back some of the deleters; only they need to try to reclaim,
+    // when they leave.
+    std::atomic<uint64_t> blocked;
+
+    EpochDomain() : global_epoch(1), high_water(0), overflow(nullptr),
+                    pending(0), reclaim_wanted(false),
+                    blocked(std::numeric_limits<uint64_t>::max())
+    {}
+
+    ReaderSlot* claim_slot(void);
+    uint64_t oldest_reader(void);
+    void reclaim(void);
+};
+
+// Never destroyed; threads may still be leaving guards while the
+// program exits.
+EpochDomain& domain(void)
+{
+    static EpochDomain* dom = new EpochDomain();
+    return *dom;
+}
+
+static bool try_claim(ReaderSlot& s)
+{
+    bool expect = false;
+    return not s.in_use.load(std::memory_order_relaxed) and
+        s.in_use.compare_exchange_strong(expect, true);
+}
+
+// Find a free slot for this thread. If there are more reading threads
+// than slots, use an overflow slot; readers never wait for a slot.
+ReaderSlot* EpochDomain::claim_slot(void)
+{
+    for (size_t i = 0; i < MAX_READERS; i++) {
+        ReaderSlot& s = slots[i];
+        if (not try_claim(s)) continue;
+
+        size_t hw = high_water.load();
+        while (hw < i+1 and not high_water.compare_exchange_weak(hw, i+1))
+            ;
+        return &s;
+    }
+
+    for (ReaderSlot* s = overflow.load(); s; s = s->next)
+        if (try_claim(*s)) return s;
+
+    ReaderSlot* s = new ReaderSlot();
+    s->in_use.store(true);
+    s->next = overflow.load();
+    while (not overflow.compare_exchange_weak(s->next, s))
+        ;
+    return s;
+}
+
+// The epoch of the oldest active reader.
+uint64_t EpochDomain::oldest_reader(void)
+{
+    uint64_t oldest = std::numeric_limits<uint64_t>::max();
+    size_t hw = high_water.load();
+    for (size_t i = 0; i < hw; i++) {
+        uint64_t e = slots[i].epoch.load();
+        if (0 < e and e < oldest) oldest = e;
+    }
+    for (ReaderSlot* s = overflow.load(); s; s = s->next) {
+        uint64_t e = s->epoch.load();
+        if (0 < e and e < oldest) oldest = e;
+    }
+    return oldest;
+}
+
+// Run every deleter whose epoch is older than that of every active
+// reader.  If some other thread is already doing this, then ask it
+// to go around one more time, instead of waiting for it; this way,
+// the last reader to leave always gets everything reclaimed.
+void EpochDomain::reclaim(void)
+{
+    // Avoid writing a shared cache line, if someone already asked.
+    if (not reclaim_wanted.load())
+        reclaim_wanted.store(true);
+    while (reclaim_wanted.load() and retire_mtx.try_lock())
+    {
+        reclaim_wanted.store(false);
+
+        uint64_t oldest = oldest_reader();
+
+        std::vector<Retiree> ready;
+        size_t keep = 0;
+        for (size_t i = 0; i < retired.size(); i++) {
+            if (retired[i].first < oldest)
+                ready.emplace_back(std::move(retired[i].second));
+            else
+                retired[keep++] = std::move(retired[i]);
+        }
+        retired.resize(keep);
+        pending.store(keep);
+
+        // What is left waits for the oldest readers.  One of them may
+        // have left after the scan, but before it could see this; if
+        // so, go around again, on its behalf.
+        if (0 < keep) {
+            blocked.store(oldest);
+            if (oldest_reader() != oldest) reclaim_wanted.store(true);
+        }
+        else blocked.store(std::numeric_limits<uint64_t>::max());
+        retire_mtx.unlock();
+
+        // Deleters run unlocked; they may well drop the last
+        // reference to things that themselves retire more stuff.
+        for (const Retiree& r : ready) r.fn(r.arg);
+    }
+}
+
+struct ThreadRecord
+{
+    ReaderSlot* slot;
+    unsigned depth;
+
+    // Retired by this thread, and not yet handed over.
+    std::vector<Retiree> local;
+
+    ThreadRecord() : slot(nullptr), depth(0) {}
+    ~ThreadRecord()
+    {
+        // The deleters may retire more, so go until there is nothing
+        // left; what readers elsewhere still hold up is reclaimed by
+        // the other threads.
+        while (not local.empty()) hand_over();
+
+        if (nullptr == slot) return;
+        slot->epoch.store(0);
+        slot->in_use.store(false);
+        slot = nullptr;
+    }
+
+    void hand_over(void);
+};
+
+thread_local ThreadRecord thread_rec;
+
+// Stamp the whole local list with one epoch, and move it to the
+// shared list; one lock and one increment of the epoch, for all of
+// them.  The stamp is later than the epoch each object was unlinked
+// in, which only makes it wait longer than it has to.
+void ThreadRecord::hand_over(void)
+{
+    std::vector<Retiree> batch;
+    batch.swap(local);
+    local.reserve(RETIRE_BATCH);
+
+    EpochDomain& dom = domain();
+    {
+        std::lock_guard<std::mutex> lck(dom.retire_mtx);
+        uint64_t e = dom.global_epoch.fetch_add(1);
+        for (const Retiree& r : batch)
+            dom.retired.emplace_back(e, r);
+        dom.pending.store(dom.retired.size());
+
+        // Every reader that entered by now may be holding these back.
+        if (e < dom.blocked.load()) dom.blocked.store(e);
+    }
+
+    // If this thread is not reading, then this might be freed at once.
+    if (0 == depth) dom.reclaim();
+}
+
+} // anonymous namespace
+
+EpochGuard::EpochGuard()
+{
+    ThreadRecord& rec = thread_rec;
+    if (0 < rec.depth++) return;
+
+    EpochDomain& dom = domain();
+    if (nullptr == rec.slot) rec.slot = dom.claim_slot();
+    rec.slot->epoch.store(dom.global_epoch.load());
+}
+
+EpochGuard::~EpochGuard()
+{
+    ThreadRecord& rec = thread_rec;
+    if (0 < --rec.depth) return;
+
+    uint64_t e = rec.slot->epoch.load(std::memory_order_relaxed);
+    rec.slot->epoch.store(0);
+
+    // What was retired while reading goes now; this reclaims, too.
+    if (not rec.local.empty()) {
+        rec.hand_over();
+        return;
+    }
+
+    // Readers that came in after everything pending was retired are
+    // not holding anything back; don't make them take the lock.
+    EpochDomain& dom = domain();
+    if (0 < dom.pending.load(std::memory_order_relaxed) and
+        e <= dom.blocked.load())
+        dom.reclaim();
+}
+
+void opencog::epoch_retire(void (*deleter)(void*), void* obj)
+{
+    ThreadRecord& rec = thread_rec;
+    rec.local.push_back({deleter, obj});
+    if (RETIRE_BATCH <= rec.local.size())
+        rec.hand_over();
+}
+
+void opencog::epoch_retire(std::function<void()> deleter)
+{
+    epoch_retire([](void* p) {
+            std::function<void()>* f = (std::function<void()>*) p;
+            (*f)();
+            delete f;
+        },
+        new std::function<void()>(std::move(deleter)));
+}
+
+void opencog::epoch_reclaim(void)
+{
+    ThreadRecord& rec = thread_rec;
+    if (not rec.local.empty())
+        rec.hand_over();
+    domain().reclaim();
+}
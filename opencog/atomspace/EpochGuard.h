@@ -0,0 +1,99 @@
+/*
+ * opencog/atomspace/EpochGuard.h
+ *
+ * Copyright (C) 2017 OpenCog Foundation
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License v3 as
+ * published by the Free Software Foundation and including the exceptions
+ * at http://opencog.org/wiki/Licenses
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, write to:
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _OPENCOG_EPOCH_GUARD_H
+#define _OPENCOG_EPOCH_GUARD_H
+
+#include <cstddef>
+#include <functional>
+
+namespace opencog
+{
+/** \addtogroup grp_atomspace
+ *  @{
+ */
+
+/**
+ * Epoch-based memory reclamation.
+ *
+ * Lock-free readers cannot take a reference on everything that they
+ * look at, as they walk through a shared data structure. Instead,
+ * they pin the current epoch for as long as they are reading, by
+ * holding an EpochGuard on the stack.  Writers that unlink something
+ * from a shared structure pass it to epoch_retire(); it is destroyed
+ * only after every reader that might still be looking at it has
+ * dropped its guard.
+ *
+ * Guards nest, and are cheap: entering and leaving the outermost
+ * guard costs one store each, into a slot owned by the calling thread.
+ *
+ * Retiring is cheap, too: each thread keeps what it retires in a list
+ * of its own, and hands the list over to be reclaimed once it holds
+ * RETIRE_BATCH deleters, or when the thread leaves its outermost
+ * guard, calls epoch_reclaim(), or exits.  Code that retires things
+ * outside of any guard, and wants them gone soon, should hold a guard
+ * around the work, or call epoch_reclaim() when done.
+ *
+ * Leaving the outermost guard tries to reclaim only if this reader
+ * might be one of those holding back what is pending.
+ */
+class EpochGuard
+{
+public:
+    EpochGuard();
+    ~EpochGuard();
+
+    EpochGuard(const EpochGuard&) = delete;
+    EpochGuard& operator=(const EpochGuard&) = delete;
+};
+
+/** The number of deleters that a thread keeps, before handing them
+ *  over to be reclaimed. */
+static const size_t RETIRE_BATCH = 64;
+
+/**
+ * Run 'deleter' once no reader can still be looking at the object
+ * that it deletes.  The deleter may run in any thread.  It runs once
+ * the calling thread has handed over its list (see above), and the
+ * last guard that was active at that time has been dropped.
+ */
+void epoch_retire(std::function<void()> deleter);
+
+/** The same, as 'deleter(obj)'; this form allocates nothing. */
+void epoch_retire(void (*deleter)(void*), void* obj);
+
+/** Delete 'obj' once no reader can still be looking at it. */
+template<typename T>
+void epoch_delete(const T* obj)
+{
+    epoch_retire([](void* p) { delete static_cast<const T*>(p); },
+                 const_cast<T*>(obj));
+}
+
+/** Hand over this thread's list, and run all of the deleters that
+ *  can be run right now. */
+void epoch_reclaim(void);
+
+/** @}*/
+} //namespace opencog
+
+#endif // _OPENCOG_EPOCH_GUARD_H
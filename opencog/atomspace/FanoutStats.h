@@ -0,0 +1,72 @@
+/*
+ * opencog/atomspace/FanoutStats.h
+ *
+ * Copyright (C) 2017 OpenCog Foundation
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License v3 as
+ * published by the Free Software Foundation and including the exceptions
+ * at http://opencog.org/wiki/Licenses
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, write to:
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _OPENCOG_FANOUT_STATS_H
+#define _OPENCOG_FANOUT_STATS_H
+
+#include <array>
+#include <cstddef>
+
+namespace opencog
+{
+/** \addtogroup grp_atomspace
+ *  @{
+ */
+
+/**
+ * How many links of a given type hold the same atom, at a given
+ * position in their outgoing set.  For example, for EvaluationLinks
+ * at position zero, this says how many EvaluationLinks there are per
+ * predicate; for ListLinks at position one, how many ListLinks have
+ * the same second member.  For unordered links, the position is
+ * ignored: the count is of links that hold the atom anywhere.
+ *
+ * The numbers are estimated from a small random sample of the links,
+ * and are meant for the pattern matcher, to guess at how many
+ * candidates a search step will have to look at.
+ */
+struct FanoutStats
+{
+    // Degrees are binned by powers of two: bin k holds the atoms
+    // with a degree in [2^k, 2^(k+1)).
+    static const size_t NUM_BINS = 24;
+
+    // Number of links of the type, when the sample was taken.
+    size_t links = 0;
+
+    // Number of links that the sample looked at.
+    size_t sampled = 0;
+
+    // Average number of links per distinct atom at the position.
+    // This is the expected fan-out, when stepping up from an atom
+    // at that position.  One, if there are no links at all.
+    double mean = 1.0;
+
+    // Histogram of the degrees of the atoms at the position: the
+    // estimated number of distinct atoms in each bin.
+    std::array<double, NUM_BINS> histogram{};
+};
+
+/** @}*/
+} //namespace opencog
+
+#endif // _OPENCOG_FANOUT_STATS_H
@@ -0,0 +1,497 @@
+/*
+ * opencog/atomspace/ObserverBus.h
+ *
+ * Copyright (C) 2017 OpenCog Foundation
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License v3 as
+ * published by the Free Software Foundation and including the exceptions
+ * at http://opencog.org/wiki/Licenses
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, write to:
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _OPENCOG_OBSERVER_BUS_H
+#define _OPENCOG_OBSERVER_BUS_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+#include <opencog/atomspace/EpochGuard.h>
+
+namespace opencog
+{
+/** \addtogroup grp_atomspace
+ *  @{
+ */
+
+namespace observer_detail
+{
+    // C++11 has no std::index_sequence; this is the usual stand-in.
+    template <size_t...> struct index_seq {};
+    template <size_t N, size_t... I>
+    struct make_index_seq : make_index_seq<N-1, N-1, I...> {};
+    template <size_t... I>
+    struct make_index_seq<0, I...> { typedef index_seq<I...> type; };
+
+    // The part of a bus that a connection needs to know about.
+    class Core
+    {
+    public:
+        virtual ~Core() {}
+        virtual void disconnect(size_t id) = 0;
+        virtual bool connected(size_t id) const = 0;
+    };
+
+    /**
+     * A bounded, multi-producer, single-consumer ring buffer. The
+     * cells are allocated up front, so that pushing an event never
+     * allocates.  This is Dmitry Vyukov's bounded queue: each cell
+     * carries a sequence number that says whether it is ready to be
+     * written, or to be read.
+     */
+    template <typename Event>
+    class Ring
+    {
+        struct Cell
+        {
+            std::atomic<size_t> seq;
+            Event ev;
+        };
+
+        std::unique_ptr<Cell[]> _cells;
+        size_t _mask;
+        size_t _batch;
+        std::atomic<size_t> _head;
+        size_t _tail;       // Only the worker touches this.
+        std::atomic<size_t> _done;
+
+        std::function<void(const Event&)> _deliver;
+        mutable std::mutex _mtx;
+        mutable std::condition_variable _cv;
+        std::atomic<bool> _waiting;
+        std::atomic<bool> _stop;
+
+        bool ready(void) const
+        {
+            return _cells[_tail & _mask].seq.load() == _tail + 1;
+        }
+
+    public:
+        /// Deliver events as they come, until stopped; run by the
+        /// worker thread.
+        void drain(void)
+        {
+            std::vector<Event> batch;
+            batch.reserve(_batch);
+            while (true)
+            {
+                while (batch.size() < _batch and ready())
+                {
+                    Cell& c = _cells[_tail & _mask];
+                    batch.emplace_back(c.ev);
+                    c.ev = Event();
+                    c.seq.store(_tail + _mask + 1);
+                    _tail++;
+                }
+
+                if (0 < batch.size())
+                {
+                    for (const Event& ev : batch) _deliver(ev);
+                    _done.fetch_add(batch.size());
+                    batch.clear();
+                    continue;
+                }
+
+                if (_stop.load()) return;
+
+                // Nothing to do. First, doze for a moment, to let a
+                // batch build up; producers leave a dozing worker
+                // alone. If nothing shows up, sleep until a producer
+                // wakes us.  Waking the worker for every event would
+                // cost a context switch per event.
+                std::unique_lock<std::mutex> lck(_mtx);
+                if (ready() or _stop.load()) continue;
+                _cv.wait_for(lck, std::chrono::milliseconds(1));
+                if (ready() or _stop.load()) continue;
+                _waiting.store(true);
+                if (not ready() and not _stop.load()) _cv.wait(lck);
+                _waiting.store(false);
+            }
+        }
+
+    private:
+        void nudge(void) const
+        {
+            std::lock_guard<std::mutex> lck(_mtx);
+            _cv.notify_one();
+        }
+
+        // Only the first producer to find the worker asleep wakes it;
+        // the rest of them don't need to pay for it.
+        void wake(void)
+        {
+            if (not _waiting.load() or not _waiting.exchange(false)) return;
+            nudge();
+        }
+
+    public:
+        Ring(std::function<void(const Event&)> deliver,
+             size_t capacity, size_t batch)
+            : _batch(batch < 1 ? 1 : batch), _head(0), _tail(0), _done(0),
+              _deliver(deliver), _waiting(false), _stop(false)
+        {
+            size_t cap = 2;
+            while (cap < capacity) cap <<= 1;
+            _cells.reset(new Cell[cap]);
+            _mask = cap - 1;
+            for (size_t i = 0; i < cap; i++) _cells[i].seq.store(i);
+        }
+
+        /// Append an event. Blocks while the ring is full. Events
+        /// pushed after the queue is stopped are dropped.
+        void push(Event&& ev)
+        {
+            size_t pos = _head.load(std::memory_order_relaxed);
+            Cell* c;
+            while (true)
+            {
+                c = &_cells[pos & _mask];
+                size_t seq = c->seq.load(std::memory_order_acquire);
+                intptr_t dif = (intptr_t) seq - (intptr_t) pos;
+                if (0 == dif)
+                {
+                    if (_head.compare_exchange_weak(pos, pos + 1,
+                                            std::memory_order_relaxed))
+                        break;
+                }
+                else if (dif < 0)
+                {
+                    // Full. Make sure the worker is awake, and wait.
+                    if (_stop.load()) return;
+                    wake();
+                    std::this_thread::yield();
+                    pos = _head.load(std::memory_order_relaxed);
+                }
+                else pos = _head.load(std::memory_order_relaxed);
+            }
+            c->ev = std::move(ev);
+            c->seq.store(pos + 1);
+
+            // A full batch is worth a wake-up, even from a doze.
+            if (0 == (pos + 1) % _batch) nudge();
+            else wake();
+        }
+
+        /// Wait until everything pushed so far has been delivered.
+        /// Must not be called from the worker thread.
+        void flush(void) const
+        {
+            size_t target = _head.load();
+            if (_done.load() < target) nudge();
+            while (_done.load() < target and not _stop.load())
+                std::this_thread::yield();
+        }
+
+        /// Deliver what is already queued, and then exit the worker.
+        void stop(void)
+        {
+            _stop.store(true);
+            nudge();
+        }
+    };
+
+    /**
+     * A Ring, drained by a thread of its own.  The worker holds a
+     * reference to the ring, so that the ring outlives the Queue if
+     * the observer, running in the worker, drops the last reference
+     * to the Queue; the worker is then detached, and exits once it
+     * is done with what is left in the ring.
+     */
+    template <typename Event>
+    class Queue
+    {
+        std::shared_ptr<Ring<Event>> _ring;
+        std::thread _worker;
+
+    public:
+        Queue(std::function<void(const Event&)> deliver,
+              size_t capacity, size_t batch)
+            : _ring(std::make_shared<Ring<Event>>(deliver, capacity, batch))
+        {
+            std::shared_ptr<Ring<Event>> ring(_ring);
+            _worker = std::thread([ring]() { ring->drain(); });
+        }
+
+        ~Queue()
+        {
+            stop();
+            join();
+        }
+
+        void push(Event&& ev) { _ring->push(std::move(ev)); }
+        void flush(void) const { _ring->flush(); }
+        void stop(void) { _ring->stop(); }
+
+        /// Wait for the worker to deliver what is queued, and exit.
+        /// Called from the worker itself, this detaches it instead.
+        void join(void)
+        {
+            if (not _worker.joinable()) return;
+            if (std::this_thread::get_id() == _worker.get_id())
+                _worker.detach();
+            else
+                _worker.join();
+        }
+    };
+}
+
+/**
+ * A handle on a subscription to an ObserverBus.  Copyable; dropping it
+ * does NOT unsubscribe.  It is safe to call disconnect() after the bus
+ * itself is gone, and to call it from inside the observer.
+ */
+class ObserverConnection
+{
+    std::weak_ptr<observer_detail::Core> _core;
+    size_t _id;
+
+public:
+    ObserverConnection() : _id(0) {}
+    ObserverConnection(const std::shared_ptr<observer_detail::Core>& core,
+                       size_t id)
+        : _core(core), _id(id) {}
+
+    void disconnect(void)
+    {
+        std::shared_ptr<observer_detail::Core> core(_core.lock());
+        if (core) core->disconnect(_id);
+        _core.reset();
+    }
+
+    bool connected(void) const
+    {
+        std::shared_ptr<observer_detail::Core> core(_core.lock());
+        return core and core->connected(_id);
+    }
+};
+
+/**
+ * A lightweight replacement for boost::signals2, for the signals that
+ * fire on every atomspace mutation.
+ *
+ * Emitting on a bus that has no observers costs one relaxed atomic
+ * load.  Emitting to synchronous observers walks a flat array of
+ * std::function, inside an EpochGuard; it takes no locks, writes no
+ * shared cache line, and does not allocate.  The array is copied on
+ * subscribe and unsubscribe (which are rare), and old copies are
+ * retired to the EpochGuard, to be freed once no emitter can still
+ * be walking them.
+ *
+ * Observers connected with connect_async() are not called by the
+ * emitting thread.  Instead, a copy of the arguments is pushed into a
+ * pre-allocated ring buffer, which a thread dedicated to that observer
+ * drains in batches.  Events are delivered in the order in which they
+ * were pushed; the emitter blocks only if the ring is full.  Use this
+ * for observers that are slow, or that take locks of their own.
+ *
+ * Synchronous observers may emit on the bus, connect, and disconnect,
+ * all from inside the callback.  Disconnecting an async observer waits
+ * for its worker to deliver what is already queued, unless it is the
+ * observer itself that disconnects.
+ */
+template <typename... Args>
+class ObserverBus
+{
+public:
+    typedef std::function<void(Args...)> Observer;
+
+private:
+    typedef std::tuple<typename std::decay<Args>::type...> Event;
+    typedef observer_detail::Queue<Event> Queue;
+
+    struct Entry
+    {
+        size_t id;
+        Observer fn;
+        std::shared_ptr<Queue> queue;   // null for synchronous ones
+    };
+    typedef std::vector<Entry> List;
+
+    class Core : public observer_detail::Core
+    {
+    public:
+        std::atomic<List*> list;
+        std::atomic<size_t> count;
+
+        mutable std::mutex mtx;
+        size_t next_id;
+
+        Core() : list(new List()), count(0), next_id(1) {}
+        ~Core() { delete list.load(); }
+
+        // Publish a new list; the old one goes once no emitter can
+        // still be walking it.  Call with mtx held.
+        void publish(List* nl)
+        {
+            List* old = list.exchange(nl);
+            count.store(nl->size());
+            epoch_delete(old);
+        }
+
+        size_t add(const Observer& fn, const std::shared_ptr<Queue>& q)
+        {
+            size_t id;
+            {
+                std::lock_guard<std::mutex> lck(mtx);
+                id = next_id++;
+                List* nl = new List(*list.load());
+                nl->push_back(Entry{id, fn, q});
+                publish(nl);
+            }
+            return id;
+        }
+
+        void disconnect(size_t id)
+        {
+            std::shared_ptr<Queue> q;
+            {
+                std::lock_guard<std::mutex> lck(mtx);
+                List* cur = list.load();
+                List* nl = new List();
+                for (const Entry& e : *cur)
+                {
+                    if (e.id == id) q = e.queue;
+                    else nl->push_back(e);
+                }
+                if (nl->size() == cur->size()) { delete nl; return; }
+                publish(nl);
+            }
+            if (q) { q->stop(); q->join(); }
+        }
+
+        bool connected(size_t id) const
+        {
+            std::lock_guard<std::mutex> lck(mtx);
+            for (const Entry& e : *list.load())
+                if (e.id == id) return true;
+            return false;
+        }
+
+        void disconnect_all(void)
+        {
+            std::vector<std::shared_ptr<Queue>> qs;
+            {
+                std::lock_guard<std::mutex> lck(mtx);
+                for (const Entry& e : *list.load())
+                    if (e.queue) qs.push_back(e.queue);
+                publish(new List());
+            }
+            for (auto& q : qs) q->stop();
+            for (auto& q : qs) q->join();
+        }
+    };
+
+    std::shared_ptr<Core> _core;
+
+    template <size_t... I>
+    static void call(const Observer& fn, const Event& ev,
+                     observer_detail::index_seq<I...>)
+    {
+        fn(std::get<I>(ev)...);
+    }
+
+    void emit(Args... args) const
+    {
+        EpochGuard guard;
+        for (const Entry& e : *_core->list.load())
+        {
+            if (e.queue) e.queue->push(Event(args...));
+            else e.fn(args...);
+        }
+    }
+
+    ObserverBus(const ObserverBus&) = delete;
+    ObserverBus& operator=(const ObserverBus&) = delete;
+
+public:
+    ObserverBus() : _core(std::make_shared<Core>()) {}
+    ~ObserverBus() { _core->disconnect_all(); }
+
+    /// Call 'fn' in the emitting thread, for every event; or, if
+    /// async is set, in a thread of its own (see connect_async()).
+    ObserverConnection connect(const Observer& fn, bool async = false)
+    {
+        if (async) return connect_async(fn);
+        return ObserverConnection(_core,
+                                  _core->add(fn, std::shared_ptr<Queue>()));
+    }
+
+    /// Call 'fn' in a thread of its own, for every event. Up to
+    /// 'capacity' events can be queued up; the worker takes up to
+    /// 'batch' of them at a time off the queue.
+    ObserverConnection connect_async(const Observer& fn,
+                                     size_t capacity = 4096,
+                                     size_t batch = 256)
+    {
+        typedef typename observer_detail::make_index_seq<sizeof...(Args)>::type
+            Indexes;
+        Observer f(fn);
+        std::shared_ptr<Queue> q(std::make_shared<Queue>(
+            [f](const Event& ev) { call(f, ev, Indexes()); },
+            capacity, batch));
+        return ObserverConnection(_core, _core->add(fn, q));
+    }
+
+    void disconnect_all(void) { _core->disconnect_all(); }
+
+    bool empty(void) const
+    {
+        return 0 == _core->count.load(std::memory_order_relaxed);
+    }
+    size_t num_observers(void) const { return _core->count.load(); }
+
+    /// Wait until the async observers have seen every event that was
+    /// emitted before this call.  Must not be called by one of them.
+    void flush(void) const
+    {
+        // Wait outside of the guard; a reader that sits in a guard
+        // holds up reclaiming everywhere.
+        std::vector<std::shared_ptr<Queue>> qs;
+        {
+            EpochGuard guard;
+            for (const Entry& e : *_core->list.load())
+                if (e.queue) qs.push_back(e.queue);
+        }
+        for (auto& q : qs) q->flush();
+    }
+
+    void operator()(Args... args) const
+    {
+        if (empty()) return;
+        emit(args...);
+    }
+};
+
+/** @}*/
+} //namespace opencog
+
+#endif // _OPENCOG_OBSERVER_BUS_H
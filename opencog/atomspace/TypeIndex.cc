@@ -19,6 +19,9 @@
  * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
  */
 
+#include <algorithm>
+#include <random>
+
 #include "TypeIndex.h"
 #include <opencog/atoms/base/Atom.h>
 #include <opencog/atoms/base/ClassServer.h>
@@ -32,8 +35,69 @@ TypeIndex::TypeIndex(void)
 
 void TypeIndex::resize(void)
 {
+	// Resizing moves the sets around in memory, so no one else may
+	// touch them while this is happening.  The locks are always taken
+	// in the same order, and no one else ever holds more than one.
+	for (std::mutex& m : _locks) m.lock();
 	num_types = classserver().getNumberOfClasses();
 	FixedIntegerIndex::resize(num_types + 1);
+	for (std::mutex& m : _locks) m.unlock();
+}
+
+void TypeIndex::insertAtoms(const std::vector<Atom*>& atoms)
+{
+	std::vector<Atom*> sorted(atoms);
+	std::sort(sorted.begin(), sorted.end(),
+		[](Atom* a, Atom* b) { return a->getType() < b->getType(); });
+
+	size_t i = 0;
+	while (i < sorted.size())
+	{
+		Type t = sorted[i]->getType();
+		std::lock_guard<std::mutex> lck(type_lock(t));
+		for (; i < sorted.size() and sorted[i]->getType() == t; i++)
+			insert(t, sorted[i]);
+	}
+}
+
+void TypeIndex::sampleType(Type t, size_t n, unsigned long seed,
+                           HandleSeq& hs) const
+{
+	std::lock_guard<std::mutex> lck(type_lock(t));
+	const AtomSet& s = idx.at(t);
+	if (s.size() <= n)
+	{
+		for (Atom* a : s)
+			hs.emplace_back(a->getHandle());
+		return;
+	}
+
+	std::minstd_rand rng(seed);
+#ifdef REPRODUCIBLE_ATOMSPACE
+	// No random access into an ordered set; take every k'th atom,
+	// starting at a random place.
+	size_t stride = s.size() / n;
+	size_t skip = rng() % stride;
+	for (Atom* a : s)
+	{
+		if (0 == skip) { hs.emplace_back(a->getHandle()); skip = stride; }
+		skip--;
+	}
+#else
+	// Pick random buckets, and take the first atom in each. Atoms
+	// that share a bucket are a bit less likely to be picked; this
+	// does not matter much, since the buckets are mostly short.
+	size_t nbuckets = s.bucket_count();
+	size_t tries = 8 * n;
+	for (size_t got = 0; got < n and 0 < tries; tries--)
+	{
+		size_t b = rng() % nbuckets;
+		auto it = s.begin(b);
+		if (it == s.end(b)) continue;
+		hs.emplace_back((*it)->getHandle());
+		got++;
+	}
+#endif
 }
 
 // ================================================================
@@ -22,10 +22,12 @@
 #ifndef _OPENCOG_TYPEINDEX_H
 #define _OPENCOG_TYPEINDEX_H
 
+#include <mutex>
 #include <set>
 #include <vector>
 
 #include <opencog/atoms/base/Atom.h>
+#include <opencog/atoms/base/ClassServer.h>
 #include <opencog/atoms/base/Handle.h>
 #include <opencog/atoms/base/types.h>
 #include <opencog/atomspace/FixedIntegerIndex.h>
@@ -45,6 +47,11 @@ namespace opencog
  * too much to try to return in some temporary array.  Iterating is much
  * faster.
  *
+ * The types are guarded by a set of striped locks, so that atoms of
+ * different types can be inserted and removed concurrently, mostly
+ * without contending with one another.  The foreachHandle() and getHandles() methods are safe to
+ * use while other threads are inserting or removing atoms.
+ *
  * @todo The iterator is NOT thread-safe against the insertion or
  * removal of atoms!  Either inserting or removing an atom will cause
  * the iterator references to be freed, leading to mystery crashes!
@@ -53,16 +60,91 @@ class TypeIndex : public FixedIntegerIndex
 {
 	private:
 		size_t num_types;
+
+		// Lock striping: type t is guarded by _locks[t % NUM_LOCKS].
+		// A fixed number of locks means that they never move, even
+		// when new types are added, and the index is resized.
+		static const size_t NUM_LOCKS = 64;
+		mutable std::mutex _locks[NUM_LOCKS];
+		std::mutex& type_lock(Type t) const
+		{
+			return _locks[t % NUM_LOCKS];
+		}
+
+		/// Copy out all of the handles of exactly type t.
+		void copyType(Type t, HandleSeq& hs) const
+		{
+			std::lock_guard<std::mutex> lck(type_lock(t));
+			hs.reserve(hs.size() + idx[t].size());
+			for (Atom* a : idx[t])
+				hs.emplace_back(a->getHandle());
+		}
+
 	public:
 		TypeIndex(void);
 		void resize(void);
 		void insertAtom(Atom* a)
 		{
-			insert(a->getType(), a);
+			Type t = a->getType();
+			std::lock_guard<std::mutex> lck(type_lock(t));
+			insert(t, a);
 		}
 		void removeAtom(Atom* a)
 		{
-			remove(a->getType(), a);
+			Type t = a->getType();
+			std::lock_guard<std::mutex> lck(type_lock(t));
+			remove(t, a);
+		}
+
+		/// Insert a batch of atoms, taking each type lock only once.
+		void insertAtoms(const std::vector<Atom*>&);
+
+		/// Append (about) n atoms of exactly type t, picked at random,
+		/// to hs.  If there are no more than n of them, all are taken.
+		void sampleType(Type t, size_t n, unsigned long seed,
+		                HandleSeq& hs) const;
+
+		/**
+		 * Copy all handles of type t (and its subtypes, if subclass
+		 * is set) to the output iterator.
+		 */
+		template <typename OutputIterator> OutputIterator
+		getHandles(OutputIterator result, Type t, bool subclass) const
+		{
+			HandleSeq hs;
+			foreachType(t, subclass, [&](Type tt) { copyType(tt, hs); });
+			return std::copy(hs.begin(), hs.end(), result);
+		}
+
+		/**
+		 * Call func on every handle of type t (and its subtypes, if
+		 * subclass is set).  The handles of each type are copied out
+		 * under that type's lock, and func is then called with no
+		 * locks held; thus, func is free to add and remove atoms.
+		 * Atoms added or removed while this is running may or may
+		 * not be visited.
+		 */
+		template <typename Function> void
+		foreachHandle(Function func, Type t, bool subclass) const
+		{
+			HandleSeq hs;
+			foreachType(t, subclass, [&](Type tt) {
+				hs.clear();
+				copyType(tt, hs);
+				for (const Handle& h : hs) func(h);
+			});
+		}
+
+		/// Call func on type t and, if subclass is set, on each of
+		/// its subtypes.  A subclass of t is NEVER smaller than t.
+		template <typename Function> void
+		foreachType(Type t, bool subclass, Function func) const
+		{
+			func(t);
+			if (not subclass) return;
+			ClassServer& cs = classserver();
+			for (Type tt = t+1; tt < num_types; tt++)
+				if (cs.isA(tt, t)) func(tt);
 		}
 
 		class iterator
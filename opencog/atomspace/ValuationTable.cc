@@ -22,11 +22,22 @@
 
 #include <opencog/util/exceptions.h>
 #include <opencog/atoms/base/Atom.h>
+#include <opencog/atomspace/EpochGuard.h>
 
 #include "ValuationTable.h"
 
 using namespace opencog;
 
+ValuationTable::Shard::Shard()
+	: _array(new SlotArray(16))
+{
+}
+
+ValuationTable::Shard::~Shard()
+{
+	delete _array.load();
+}
+
 ValuationTable::ValuationTable()
 {
 }
@@ -35,30 +46,90 @@ ValuationTable::~ValuationTable()
 {
 }
 
-/// Associate a value with a particular (key,atom) pair
-/// The atom, key and value are wrapped up in a single valuation.
-void ValuationTable::addValuation(const ValuationPtr& vp)
+/// Find the values of the atom, without taking the shard lock.
+ValuationTable::ValueMapPtr ValuationTable::find(const Handle& atom)
 {
-	const Handle& key = vp->key();
-	const Handle& atom = vp->atom();
+	const Atom* a = atom.operator->();
+	size_t idx = slot_index(a);
+	Shard& sh = get_shard(idx);
 
-	std::lock_guard<std::mutex> lck(_mtx);
+	EpochGuard guard;
+	SlotArray* arr = sh._array.load();
+	for (size_t i = arr->first(idx); ; i = (i+1) & arr->mask)
+	{
+		Slot& s = arr->slots[i];
+		const Atom* p = s.atom.load();
+		if (nullptr == p) return nullptr;
+		if (p == a) return std::atomic_load(&s.values);
+	}
+}
 
-	// Make a record of all the keys being used for this atom.
-	auto ikeys = _keyset.find(atom);
-	if (ikeys == _keyset.end())
+/// Double the size of the shard's table.  The shard lock must be
+/// held.  Readers may still be probing the old table; it is freed
+/// once they are done.
+void ValuationTable::grow(Shard& sh)
+{
+	SlotArray* old = sh._array.load();
+	SlotArray* arr = new SlotArray(2 * (old->mask + 1));
+	for (size_t j = 0; j <= old->mask; j++)
 	{
-		std::set<Handle> keys;
-		keys.insert(key);
-		_keyset.insert(make_pair(atom, keys));
+		Slot& from = old->slots[j];
+		const Atom* p = from.atom.load();
+		if (nullptr == p) continue;
+
+		size_t i = arr->first(slot_index(p));
+		while (nullptr != arr->slots[i].atom.load())
+			i = (i+1) & arr->mask;
+		Slot& to = arr->slots[i];
+		to.owner = from.owner;
+		to.values = std::atomic_load(&from.values);
+		to.atom.store(p);
 	}
-	else
+	arr->used = old->used;
+	sh._array.store(arr);
+	epoch_delete(old);
+}
+
+/// The slot of the atom, filling in a new one if the atom is not in
+/// the table yet.  The shard lock must be held.
+ValuationTable::Slot& ValuationTable::claim(Shard& sh, const Handle& atom,
+                                            size_t idx)
+{
+	const Atom* a = atom.operator->();
+	SlotArray* arr = sh._array.load();
+	size_t i = arr->first(idx);
+	for (; ; i = (i+1) & arr->mask)
 	{
-		ikeys->second.insert(key);
+		const Atom* p = arr->slots[i].atom.load();
+		if (p == a) return arr->slots[i];
+		if (nullptr == p) break;
 	}
 
-	// Record the actual valuation
-	_vindex[std::make_pair(key, atom)] = vp;
+	// Keep the table no more than half full.
+	if (2 * (arr->used + 1) > arr->mask + 1)
+	{
+		grow(sh);
+		arr = sh._array.load();
+		i = arr->first(idx);
+		while (nullptr != arr->slots[i].atom.load())
+			i = (i+1) & arr->mask;
+	}
+
+	// The atom is published last, so that no reader sees a slot
+	// that is only half filled in.
+	Slot& s = arr->slots[i];
+	s.owner = atom;
+	std::atomic_store(&s.values, ValueMapPtr(std::make_shared<ValueMap>()));
+	s.atom.store(a);
+	arr->used++;
+	return s;
+}
+
+/// Associate a value with a particular (key,atom) pair
+/// The atom, key and value are wrapped up in a single valuation.
+void ValuationTable::addValuation(const ValuationPtr& vp)
+{
+	addValuation(vp->key(), vp->atom(), vp->value());
 }
 
 /// Associate a value with a particular (key,atom) pair
@@ -66,42 +137,51 @@ void ValuationTable::addValuation(const Handle& key,
                                   const Handle& atom,
                                   const ProtoAtomPtr& val)
 {
-	ValuationPtr vp(createValuation(key, atom, val));
-	addValuation(vp);
+	size_t idx = slot_index(atom.operator->());
+	Shard& sh = get_shard(idx);
+
+	std::lock_guard<std::mutex> lck(sh._mtx);
+	Slot& s = claim(sh, atom, idx);
+
+	// Copy, update, and swap in the new map; readers holding the old
+	// one keep on using it.
+	std::shared_ptr<ValueMap> vm(std::make_shared<ValueMap>(*s.values));
+	bool found = false;
+	for (auto& kv : *vm)
+	{
+		if (kv.first != key) continue;
+		kv.second = val;
+		found = true;
+		break;
+	}
+	if (not found) vm->emplace_back(key, val);
+	std::atomic_store(&s.values, ValueMapPtr(vm));
 }
 
 ValuationPtr ValuationTable::getValuation(const Handle& key, const Handle& atom)
 {
-	std::lock_guard<std::mutex> lck(_mtx);
-
-	auto vpiter = _vindex.find(std::make_pair(key, atom));
-	if (vpiter == _vindex.end())
-		throw RuntimeException(TRACE_INFO,
-			"There is no value for key %s on atom %s",
-			key->toString().c_str(), atom->toString().c_str());
-	return vpiter->second;
+	return createValuation(key, atom, getValue(key, atom));
 }
 
 ProtoAtomPtr ValuationTable::getValue(const Handle& key, const Handle& atom)
 {
-	return getValuation(key, atom)->value();
+	ValueMapPtr vm(find(atom));
+	if (vm)
+		for (const auto& kv : *vm)
+			if (kv.first == key) return kv.second;
+
+	throw RuntimeException(TRACE_INFO,
+		"There is no value for key %s on atom %s",
+		key->toString().c_str(), atom->toString().c_str());
 }
 
 /// Obtain all of the keys in use for a given atom.
-//
-// XXX FIXME this implementation is ... poor. Its probably just enough
-// to store all keys in use, instead of all keys for a given atom.
-// i.e. this uses too much RAM, and we could get away with just
-// searching the _vindex, instead, which would be slower but more memory
-// efficient.  The point is that the only user of this function is going
-// to be the peristence framework, and so we should optimize for that.
 std::set<Handle> ValuationTable::getKeys(const Handle& atom)
 {
-	std::lock_guard<std::mutex> lck(_mtx);
-
-	auto ikeys = _keyset.find(atom);
-	if (ikeys == _keyset.end())
-		return std::set<Handle>();
-
-	return ikeys->second;
+	std::set<Handle> keys;
+	ValueMapPtr vm(find(atom));
+	if (vm)
+		for (const auto& kv : *vm)
+			keys.insert(kv.first);
+	return keys;
 }
@@ -23,9 +23,12 @@
 #ifndef _OPENCOG_VALUTATION_TABLE_H
 #define _OPENCOG_VALUTATION_TABLE_H
 
-#include <map>
+#include <atomic>
+#include <memory>
 #include <mutex>
 #include <set>
+#include <utility>
+#include <vector>
 
 #include <opencog/atoms/base/Handle.h>
 #include <opencog/atoms/base/Valuation.h>
@@ -38,6 +41,20 @@ namespace opencog
 
 /**
  * This class provides a mechanism to store valuations for atoms.
+ *
+ * The values of each atom are kept together, in a small flat map from
+ * key to value, which is never changed once it has been published:
+ * setting a value makes a new map, and swaps it in.  The atoms are
+ * spread over a number of shards, by address; each shard finds the
+ * maps of its atoms with an open-addressing hash table.
+ *
+ * Reads don't take the shard lock: the table is probed under an
+ * EpochGuard, so that a slot array that is replaced while a reader is
+ * looking at it stays around until it is done, and the map itself is
+ * held by a shared pointer, loaded atomically.  Writes lock just the
+ * one shard that the atom is in.  This way, threads reading and
+ * writing the values of many atoms hardly ever wait for one another.
+ *
  * XXX FIXME:  An alternative sould be to store values directly
  * with each atom. That would make access to values faster, but
  * some number of bytes in each atom, to hold the needed map.
@@ -48,11 +65,78 @@ class ValuationTable
 {
 private:
 
-	// Single, global mutex for locking the indexes.
-	mutable std::mutex _mtx;
+	// All of the values on one atom.
+	typedef std::vector<std::pair<Handle, ProtoAtomPtr>> ValueMap;
+	typedef std::shared_ptr<const ValueMap> ValueMapPtr;
+
+	struct Slot
+	{
+		// Null while the slot is empty; set last, when the slot is
+		// filled in, and never changed after that.
+		std::atomic<const Atom*> atom;
+
+		// Keeps the atom alive while it is in the table.
+		Handle owner;
+
+		// Only ever accessed with std::atomic_load/atomic_store.
+		ValueMapPtr values;
+
+		Slot() : atom(nullptr) {}
+	};
+
+	static const size_t NUM_SHARDS = 64;
+	static const int SHARD_BITS = 6;
+
+	struct SlotArray
+	{
+		size_t mask;
+		int shift;
+		std::unique_ptr<Slot[]> slots;
+		size_t used;
+
+		// The capacity is a power of two, and at least two.
+		SlotArray(size_t capacity)
+			: mask(capacity - 1), shift(64), slots(new Slot[capacity]), used(0)
+		{
+			for (size_t c = capacity; 1 < c; c >>= 1) shift--;
+		}
+
+		// Where the probe for an atom starts: the bits of its hash
+		// just below the shard bits, as many as the table needs.
+		size_t first(size_t idx) const
+		{
+			return (idx << SHARD_BITS) >> shift;
+		}
+	};
+
+	struct Shard
+	{
+		// Serializes the writers; readers don't take it.
+		std::mutex _mtx;
+		std::atomic<SlotArray*> _array;
+
+		Shard();
+		~Shard();
+	};
+
+	Shard _shards[NUM_SHARDS];
+
+	static size_t slot_index(const Atom* a)
+	{
+		// Fibonacci hash of the address; the shard is picked with
+		// the high bits, and the slot with the bits below those.
+		// (The low bits of the product are poorly mixed.)
+		return (((uintptr_t) a) >> 4) * 0x9e3779b97f4a7c15ULL;
+	}
+
+	Shard& get_shard(size_t idx)
+	{
+		return _shards[idx >> (64 - SHARD_BITS)];
+	}
 
-	std::unordered_map<HandlePair, ValuationPtr> _vindex;
-	std::unordered_map<Handle, std::set<Handle>> _keyset;
+	ValueMapPtr find(const Handle&);
+	Slot& claim(Shard&, const Handle&, size_t);
+	void grow(Shard&);
 
 	/**
 	 * Override and declare copy constructor and equals operator as
@@ -66,8 +150,8 @@ public:
 	ValuationTable();
 	~ValuationTable();
 
-   void addValuation(const ValuationPtr&);
-   void addValuation(const Handle&, const Handle&, const ProtoAtomPtr&);
+	void addValuation(const ValuationPtr&);
+	void addValuation(const Handle&, const Handle&, const ProtoAtomPtr&);
 	ValuationPtr getValuation(const Handle&, const Handle&);
 	ProtoAtomPtr getValue(const Handle&, const Handle&);
 
@@ -0,0 +1,384 @@
+/*
+ * LoadAtomese.cc
+ *
+ * Copyright (C) 2017 OpenCog Foundation
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License v3 as
+ * published by the Free Software Foundation and including the exceptions
+ * at http://opencog.org/wiki/Licenses
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, write to:
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdlib.h>
+
+#include <algorithm>
+#include <fstream>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <opencog/util/exceptions.h>
+#include <opencog/atoms/base/ClassServer.h>
+#include <opencog/atoms/base/Link.h>
+#include <opencog/atoms/base/Node.h>
+#include <opencog/truthvalue/CountTruthValue.h>
+#include <opencog/truthvalue/SimpleTruthValue.h>
+#include "LoadAtomese.h"
+
+namespace opencog {
+
+// Top-level atoms per call to add_atoms().
+#define BATCH_SIZE 10000
+
+// Bytes read from the file at a time.
+#define CHUNK_SIZE (4 * 1024 * 1024)
+
+static bool is_delim(char c)
+{
+    return ' ' == c or '\t' == c or '\n' == c or '\r' == c or '\f' == c
+        or '(' == c or ')' == c or '"' == c or ';' == c;
+}
+
+/// Skip white space and comments.  Block comments are #! ... !# and
+/// #| ... |#.  Stops at the start of a block comment that does not
+/// end before the end of the text.
+static const char* skip_space(const char* p, const char* end)
+{
+    while (p < end) {
+        char c = *p;
+        if (' ' == c or '\t' == c or '\n' == c or '\r' == c or '\f' == c) {
+            p++;
+        } else if (';' == c) {
+            while (p < end and '\n' != *p) p++;
+        } else if ('#' == c and p + 1 < end and ('!' == p[1] or '|' == p[1])) {
+            char close = p[1];
+            const char* q = p + 2;
+            while (q + 1 < end and not (close == q[0] and '#' == q[1])) q++;
+            if (end <= q + 1) break;
+            p = q + 2;
+        } else break;
+    }
+    return p;
+}
+
+/// Where the expression starting at p ends, or nullptr, if it does
+/// not end before the end of the text.
+static const char* form_end(const char* p, const char* end)
+{
+    if ('\'' == *p) p++;
+    if (p == end) return nullptr;
+    if ('(' != *p) {
+        while (p < end and not is_delim(*p)) p++;
+        return p;
+    }
+
+    size_t depth = 0;
+    while (p < end) {
+        char c = *p;
+        if ('"' == c) {
+            for (p++; p < end and '"' != *p; p++)
+                if ('\\' == *p) p++;
+            if (end <= p) return nullptr;
+            p++;
+        } else if (';' == c) {
+            while (p < end and '\n' != *p) p++;
+        } else {
+            p++;
+            if ('(' == c) depth++;
+            else if (')' == c and 0 == --depth) return p;
+        }
+    }
+    return nullptr;
+}
+
+namespace {
+
+/// Turns the text of top-level expressions into atoms, which are not
+/// yet in any atomspace.
+class Parser
+{
+    const char* _text;
+    const char* _p;
+    const char* _end;
+    size_t _first_line;
+
+    // The type of each name seen so far, and whether it is a node
+    // type; NOTYPE if it is not the name of an atom type.
+    std::unordered_map<std::string, std::pair<Type, bool>> _types;
+
+public:
+    // The atoms given a truth value, with the value.
+    std::vector<std::pair<Handle, TruthValuePtr>> tvs;
+
+    void reset(const char* text, const char* end, size_t first_line)
+    {
+        _text = _p = text;
+        _end = end;
+        _first_line = first_line;
+    }
+
+    [[noreturn]] void fail(const char* what)
+    {
+        size_t line = _first_line + std::count(_text, _p, '\n');
+        std::string near(_p, _p + std::min((ptrdiff_t) 40, _end - _p));
+        throw SyntaxException(TRACE_INFO,
+            "load_atomese: line %zu: %s, near: %s", line, what, near.c_str());
+    }
+
+    void skip() { _p = skip_space(_p, _end); }
+
+    std::string token()
+    {
+        const char* start = _p;
+        while (_p < _end and not is_delim(*_p)) _p++;
+        if (start == _p) fail("expecting a name");
+        return std::string(start, _p);
+    }
+
+    std::string string_literal()
+    {
+        std::string s;
+        for (_p++; _p < _end and '"' != *_p; _p++) {
+            if ('\\' != *_p) { s += *_p; continue; }
+            if (++_p == _end) break;
+            switch (*_p) {
+                case 'n': s += '\n'; break;
+                case 't': s += '\t'; break;
+                default: s += *_p; break;
+            }
+        }
+        if (_end <= _p) fail("unterminated string");
+        _p++;
+        return s;
+    }
+
+    double number()
+    {
+        skip();
+        std::string tok(token());
+        char* last;
+        double d = strtod(tok.c_str(), &last);
+        if (*last) fail("expecting a number");
+        return d;
+    }
+
+    Type atom_type(const std::string& name, bool& is_node)
+    {
+        auto it = _types.find(name);
+        if (it != _types.end()) {
+            is_node = it->second.second;
+            return it->second.first;
+        }
+
+        ClassServer& cs = classserver();
+        Type t = cs.getType(name);
+        if (NOTYPE == t) t = cs.getType(name + "Node");
+        if (NOTYPE == t) t = cs.getType(name + "Link");
+        is_node = cs.isA(t, NODE);
+        if (not is_node and not cs.isA(t, LINK)) t = NOTYPE;
+        _types.emplace(name, std::make_pair(t, is_node));
+        return t;
+    }
+
+    /// Parse "(stv ...)" and the like; the name is already read.
+    /// Returns null if the name is not that of a truth value.
+    TruthValuePtr truth_value(const std::string& name)
+    {
+        TruthValuePtr tv;
+        if ("stv" == name or "cog-new-stv" == name) {
+            double m = number();
+            double c = number();
+            tv = SimpleTruthValue::createTV(m, c);
+        } else if ("ctv" == name or "cog-new-ctv" == name) {
+            double m = number();
+            double c = number();
+            double n = number();
+            tv = CountTruthValue::createTV(m, c, n);
+        } else return tv;
+
+        skip();
+        if (_p == _end or ')' != *_p) fail("expecting a closing paren");
+        _p++;
+        return tv;
+    }
+
+    /// Parse an expression starting with an open paren.  Returns
+    /// either an atom, or else a truth value, for the caller to use.
+    Handle expression(TruthValuePtr& tv)
+    {
+        _p++;
+        skip();
+        std::string name(token());
+
+        tv = truth_value(name);
+        if (tv) return Handle::UNDEFINED;
+
+        bool is_node;
+        Type t = atom_type(name, is_node);
+        if (NOTYPE == t) fail("not an atom type");
+
+        std::string node_name;
+        bool have_name = false;
+        HandleSeq oset;
+        TruthValuePtr mytv;
+        while (true) {
+            skip();
+            if (_p == _end) fail("expecting a closing paren");
+            char c = *_p;
+            if (')' == c) { _p++; break; }
+
+            if ('"' == c and is_node and not have_name) {
+                node_name = string_literal();
+                have_name = true;
+            } else if ('(' == c) {
+                TruthValuePtr argtv;
+                Handle h(expression(argtv));
+                if (argtv) mytv = argtv;
+                else if (is_node) fail("a node cannot hold atoms");
+                else oset.emplace_back(h);
+            } else if (is_node and not have_name) {
+                // Numbers, for NumberNodes.
+                node_name = token();
+                have_name = true;
+            } else fail("unexpected token");
+        }
+
+        Handle h;
+        if (is_node) {
+            if (not have_name) fail("a node needs a name");
+            h = createNode(t, node_name);
+        } else {
+            h = createLink(oset, t);
+        }
+        if (mytv) tvs.emplace_back(h, mytv);
+        return h;
+    }
+
+    /// Parse one top-level expression, which must be an atom.
+    Handle top_level()
+    {
+        skip();
+        if ('\'' == *_p) _p++;
+        if (_p == _end or '(' != *_p) fail("not an atom expression");
+
+        TruthValuePtr tv;
+        Handle h(expression(tv));
+        if (tv) fail("a truth value, outside of any atom");
+        return h;
+    }
+
+    const char* where() const { return _p; }
+};
+
+/// Adds the batch of top-level atoms, and then their truth values.
+class Batch
+{
+    AtomSpace& _as;
+
+public:
+    HandleSeq atoms;
+
+    Batch(AtomSpace& as) : _as(as) {}
+
+    HandleSeq flush(Parser& parser)
+    {
+        HandleSeq added(_as.add_atoms(atoms));
+        atoms.clear();
+
+        for (const auto& pr : parser.tvs) {
+            Handle h(_as.get_atom(pr.first));
+            if (h) h->setTruthValue(pr.second);
+        }
+        parser.tvs.clear();
+        return added;
+    }
+};
+
+} // anonymous namespace
+
+HandleSeq load_atomese(AtomSpace& as, const std::string& text)
+{
+    const char* p = text.data();
+    const char* end = p + text.size();
+
+    Parser parser;
+    parser.reset(p, end, 1);
+    Batch batch(as);
+    HandleSeq result;
+    while (true) {
+        parser.skip();
+        if (parser.where() == end) break;
+        batch.atoms.emplace_back(parser.top_level());
+        if (BATCH_SIZE <= batch.atoms.size()) {
+            HandleSeq added(batch.flush(parser));
+            result.insert(result.end(), added.begin(), added.end());
+        }
+    }
+    HandleSeq added(batch.flush(parser));
+    result.insert(result.end(), added.begin(), added.end());
+    return result;
+}
+
+size_t load_atomese_file(AtomSpace& as, const std::string& filename)
+{
+    std::ifstream in(filename, std::ios::binary);
+    if (not in)
+        throw IOException(TRACE_INFO,
+            "load_atomese_file: cannot open %s", filename.c_str());
+
+    Parser parser;
+    Batch batch(as);
+    size_t count = 0;
+    size_t line = 1;
+
+    // The buffer holds whatever did not make a whole expression the
+    // last time around, followed by the next chunk of the file.
+    std::string buf;
+    std::vector<char> chunk(CHUNK_SIZE);
+    bool eof = false;
+    while (not eof) {
+        in.read(chunk.data(), chunk.size());
+        buf.append(chunk.data(), in.gcount());
+        eof = not in;
+
+        const char* start = buf.data();
+        const char* end = start + buf.size();
+        const char* p = start;
+        const char* counted = start;
+        while (true) {
+            p = skip_space(p, end);
+            if (p == end or '#' == *p) break;
+            const char* fe = form_end(p, end);
+            if (nullptr == fe) break;
+
+            line += std::count(counted, p, '\n');
+            counted = p;
+            parser.reset(p, fe, line);
+            batch.atoms.emplace_back(parser.top_level());
+            if (BATCH_SIZE <= batch.atoms.size())
+                count += batch.flush(parser).size();
+            p = fe;
+        }
+        line += std::count(counted, p, '\n');
+
+        if (eof and p != end) {
+            parser.reset(p, end, line);
+            parser.fail("unbalanced parentheses or unterminated comment");
+        }
+        buf.erase(0, p - start);
+    }
+    count += batch.flush(parser).size();
+    return count;
+}
+
+}
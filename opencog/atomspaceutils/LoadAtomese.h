@@ -0,0 +1,67 @@
+/*
+ * LoadAtomese.h
+ *
+ * Copyright (C) 2017 OpenCog Foundation
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License v3 as
+ * published by the Free Software Foundation and including the exceptions
+ * at http://opencog.org/wiki/Licenses
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, write to:
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _OPENCOG_LOAD_ATOMESE_H
+#define _OPENCOG_LOAD_ATOMESE_H
+
+#include <string>
+
+#include <opencog/atomspace/AtomSpace.h>
+#include <opencog/atoms/base/Handle.h>
+
+namespace opencog
+{
+/** \addtogroup grp_atomspace
+ *  @{
+ */
+
+/**
+ * Load atoms written in scheme, without going through guile.
+ *
+ * Only plain atomese is understood: nested atom expressions, such as
+ *
+ *    (InheritanceLink (stv 0.9 0.8)
+ *       (ConceptNode "cat")
+ *       (ConceptNode "animal"))
+ *
+ * with truth values given as (stv m c) or (ctv m c n), or with their
+ * cog-new-stv and cog-new-ctv spellings.  Type names may leave off
+ * their Node or Link suffix, as in (Concept "cat").  Comments are
+ * skipped.  Anything else, e.g. (define ...) or (use-modules ...),
+ * throws a SyntaxException, giving the line it is on; such files
+ * have to be loaded with guile.
+ *
+ * The atoms are added to the atomspace in large batches, with
+ * AtomSpace::add_atoms().  Truth values are set on the atoms even
+ * if they were already in the atomspace, as guile would do.
+ */
+
+/// Load the atoms in the text.  Returns the top-level atoms, in order.
+HandleSeq load_atomese(AtomSpace&, const std::string& text);
+
+/// Load the atoms in the file, a few megabytes at a time.  Returns
+/// the number of top-level atoms loaded.
+size_t load_atomese_file(AtomSpace&, const std::string& filename);
+
+/** @}*/
+}
+
+#endif // _OPENCOG_LOAD_ATOMESE_H
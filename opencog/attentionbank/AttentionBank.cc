@@ -24,6 +24,7 @@
 
 #include <boost/bind.hpp>
 #include <opencog/util/Config.h>
+#include <opencog/util/oc_assert.h>
 
 #include <opencog/atoms/base/Handle.h>
 #include <opencog/atomspace/AtomSpace.h>
@@ -89,13 +90,61 @@ void AttentionBank::change_av(const Handle& h, AttentionValuePtr newav)
     int oldBin = ImportanceIndex::importanceBin(oldav->getSTI());
     int newBin = ImportanceIndex::importanceBin(newav->getSTI());
 
-    // If the atom importance has changed its bin,
-    // update the importance index.
-    if (oldBin != newBin) updateImportanceIndex(h, oldBin, newBin);
+    // If the atom importance has changed, update the importance index;
+    // even within the same bin, it may move in or out of the top K.
+    if (oldav->getSTI() != newav->getSTI())
+        updateImportanceIndex(h, oldBin, newBin);
 
     AVChanged(h, oldav, newav);
 }
 
+void AttentionBank::change_av(const HandleSeq& hs,
+                              const std::vector<AttentionValuePtr>& avs)
+{
+    OC_ASSERT(hs.size() == avs.size(),
+              "change_av: %zu atoms, but %zu attention values",
+              hs.size(), avs.size());
+
+    size_t n = hs.size();
+    std::vector<AttentionValuePtr> oldavs(n);
+    {
+        std::lock_guard<std::mutex> lck(_idx_mtx);
+        for (size_t i = 0; i < n; i++) {
+            AttentionValuePtr& av = _atom_index[hs[i]];
+            oldavs[i] = av ? av : AttentionValue::DEFAULT_AV();
+            av = avs[i];
+        }
+    }
+
+    // Only the atoms whose STI changed go through the importance index.
+    std::vector<Atom*> atoms;
+    std::vector<int> oldbins, newbins;
+    long stiDiff = 0, ltiDiff = 0;
+    for (size_t i = 0; i < n; i++) {
+        AttentionValue::sti_t oldSti = oldavs[i]->getSTI();
+        AttentionValue::sti_t newSti = avs[i]->getSTI();
+
+        // Summed as the single-atom updates would add them to the funds.
+        stiDiff += (long) (oldSti - newSti);
+        ltiDiff += (long) (oldavs[i]->getLTI() - avs[i]->getLTI());
+
+        if (oldSti == newSti) continue;
+        atoms.push_back(hs[i].operator->());
+        oldbins.push_back(ImportanceIndex::importanceBin(oldSti));
+        newbins.push_back(ImportanceIndex::importanceBin(newSti));
+    }
+    _importanceIndex.updateImportance(atoms, oldbins, newbins);
+
+    updateSTIFunds(stiDiff);
+    updateLTIFunds(ltiDiff);
+    updateSTIExtrema();
+
+    logger().fine("change_av: %zu atoms, fundsSTI = %d", n, fundsSTI.load());
+
+    for (size_t i = 0; i < n; i++)
+        notifyAVChanged(hs[i], oldavs[i], avs[i]);
+}
+
 void AttentionBank::set_sti(const Handle& h, AttentionValue::sti_t stiValue)
 {
     AttentionValuePtr old_av = AttentionValue::DEFAULT_AV();
@@ -149,6 +198,19 @@ AttentionValuePtr AttentionBank::get_av(const Handle& h)
     return pr->second;
 }
 
+std::vector<AttentionValuePtr> AttentionBank::get_av(const HandleSeq& hs)
+{
+    std::vector<AttentionValuePtr> avs;
+    avs.reserve(hs.size());
+    std::lock_guard<std::mutex> lck(_idx_mtx);
+    for (const Handle& h : hs) {
+        auto pr = _atom_index.find(h);
+        avs.push_back(pr == _atom_index.end() ?
+                      AttentionValue::DEFAULT_AV() : pr->second);
+    }
+    return avs;
+}
+
 void AttentionBank::AVChanged(const Handle& h,
                               const AttentionValuePtr& old_av,
                               const AttentionValuePtr& new_av)
@@ -160,7 +222,16 @@ void AttentionBank::AVChanged(const Handle& h,
     // subtract the new attention values from the AttentionBank funds
     updateSTIFunds(oldSti - newSti);
     updateLTIFunds(old_av->getLTI() - new_av->getLTI());
+    updateSTIExtrema();
+
+    logger().fine("AVChanged: fundsSTI = %d, old_av: %d, new_av: %d",
+                   fundsSTI.load(), oldSti, newSti);
+
+    notifyAVChanged(h, old_av, new_av);
+}
 
+void AttentionBank::updateSTIExtrema(void)
+{
     // Update MinMax STI values
     AttentionValue::sti_t minSTISeen = 0;
     UnorderedHandleSet minbin = _importanceIndex.getMinBinContents();
@@ -184,9 +255,14 @@ void AttentionBank::AVChanged(const Handle& h,
 
     updateMinSTI(minSTISeen);
     updateMaxSTI(maxSTISeen);
+}
 
-    logger().fine("AVChanged: fundsSTI = %d, old_av: %d, new_av: %d",
-                   fundsSTI.load(), oldSti, newSti);
+void AttentionBank::notifyAVChanged(const Handle& h,
+                                    const AttentionValuePtr& old_av,
+                                    const AttentionValuePtr& new_av)
+{
+    AttentionValue::sti_t oldSti = old_av->getSTI();
+    AttentionValue::sti_t newSti = new_av->getSTI();
 
     // Notify any interested parties that the AV changed.
     _AVChangedSignal(h, old_av, new_av);
@@ -222,6 +298,29 @@ void AttentionBank::stimulate(const Handle& h, double stimulus)
     change_av(h, new_av);
 }
 
+void AttentionBank::stimulate(const HandleSeq& hs, double stimulus)
+{
+    AttentionValue::sti_t stiWage = calculateSTIWage() * stimulus;
+    AttentionValue::lti_t ltiWage = calculateLTIWage() * stimulus;
+
+    // As above, a change made by another thread, after this reads the
+    // old values, is lost.
+    std::vector<AttentionValuePtr> avs;
+    avs.reserve(hs.size());
+    {
+        std::lock_guard<std::mutex> lck(_idx_mtx);
+        for (const Handle& h : hs) {
+            AttentionValuePtr av = AttentionValue::DEFAULT_AV();
+            auto pr = _atom_index.find(h);
+            if (pr != _atom_index.end()) av = pr->second;
+            avs.push_back(createAV(av->getSTI() + stiWage,
+                                   av->getLTI() + ltiWage,
+                                   av->getVLTI()));
+        }
+    }
+    change_av(hs, avs);
+}
+
 void AttentionBank::updateMaxSTI(AttentionValue::sti_t m)
 {
     std::lock_guard<std::mutex> lock(_lock_maxSTI);
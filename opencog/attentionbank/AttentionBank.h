@@ -30,12 +30,11 @@
 #include <mutex>
 #include <unordered_map>
 
-#include <boost/signals2.hpp>
-
 #include <opencog/util/async_method_caller.h>
 #include <opencog/util/recent_val.h>
 
 #include <opencog/truthvalue/AttentionValue.h>
+#include <opencog/atomspace/ObserverBus.h>
 #include <opencog/attentionbank/ImportanceIndex.h>
 #include <opencog/attentionbank/StochasticImportanceDiffusion.h>
 
@@ -46,14 +45,14 @@ namespace opencog
  */
 
 /* Attention Value changed */
-typedef boost::signals2::signal<void (const Handle&,
-                                      const AttentionValuePtr&,
-                                      const AttentionValuePtr&)> AVCHSigl;
+typedef ObserverBus<const Handle&,
+                    const AttentionValuePtr&,
+                    const AttentionValuePtr&> AVCHSigl;
 
 /* Attentional Focus changed */
-typedef boost::signals2::signal<void (const Handle&,
-                                      const AttentionValuePtr&,
-                                      const AttentionValuePtr&)> AFCHSigl;
+typedef ObserverBus<const Handle&,
+                    const AttentionValuePtr&,
+                    const AttentionValuePtr&> AFCHSigl;
 
 class AtomSpace;
 class AttentionBank
@@ -66,8 +65,10 @@ class AttentionBank
 
     /** AV changes */
     void AVChanged(const Handle&, const AttentionValuePtr&, const AttentionValuePtr&);
+    void updateSTIExtrema(void);
+    void notifyAVChanged(const Handle&, const AttentionValuePtr&, const AttentionValuePtr&);
 
-    boost::signals2::connection _removeAtomConnection;
+    ObserverConnection _removeAtomConnection;
 
     /**
      * Boundary at which an atom is considered within the attentional
@@ -137,6 +138,11 @@ public:
      * Get the attention value of an atom.
      */
     AttentionValuePtr get_av(const Handle&);
+
+    /**
+     * Get the attention values of many atoms, under one lock.
+     */
+    std::vector<AttentionValuePtr> get_av(const HandleSeq&);
     AttentionValue::sti_t get_sti(const Handle& h) {
         return get_av(h)->getSTI();
     }
@@ -151,6 +157,16 @@ public:
      * Change the attention value of an atom.
      */
     void change_av(const Handle&, AttentionValuePtr);
+
+    /**
+     * Change the attention values of many atoms at once; the i'th atom
+     * gets the i'th attention value.  The effect is the same as that of
+     * calling change_av() on each in turn, and the same signals are
+     * sent, but the index lock is taken once, the atoms are moved
+     * between importance bins a bin at a time, and the funds and the
+     * min/max STI are updated once for the whole batch.
+     */
+    void change_av(const HandleSeq&, const std::vector<AttentionValuePtr>&);
     void set_sti(const Handle&, AttentionValue::sti_t);
     void set_lti(const Handle&, AttentionValue::lti_t);
     void inc_vlti(const Handle& h) { change_vlti(h, +1); }
@@ -165,6 +181,13 @@ public:
      */
     void stimulate(const Handle&, double stimulus);
 
+    /**
+     * Stimulate many atoms by the same amount, as one batch.  The wages
+     * are worked out once, from the funds before the batch; an atom
+     * that is listed twice is stimulated once.
+     */
+    void stimulate(const HandleSeq&, double stimulus);
+
     /**
      * Get the total amount of STI in the AttentionBank, sum of
      * STI across all atoms.
@@ -361,10 +384,12 @@ public:
 
     /**
      * Updates the importance index for the given atom. According to the
-     * new importance of the atom, it may change importance bins.
+     * new importance of the atom, it may change importance bins, and
+     * move in or out of the top K STI valued atoms.
      *
      * @param The atom whose importance index will be updated.
      * @param The old importance bin where the atom originally was.
+     * @param The new importance bin.
      */
     void updateImportanceIndex(const Handle& h, int oldbin, int newbin)
     {
@@ -21,6 +21,8 @@
  */
 
 #include <algorithm>
+#include <iterator>
+#include <thread>
 #include <boost/range/adaptor/reversed.hpp>
 
 #include <opencog/util/functional.h>
@@ -45,12 +47,20 @@ using namespace opencog;
 #define GROUP_NUM 12
 #define IMPORTANCE_INDEX_SIZE (GROUP_NUM*GROUP_SIZE)+GROUP_NUM //104
 
+// Batches with fewer moves than this are rebinned in the calling
+// thread; starting threads would cost more than it saves.
+#define PARALLEL_REBIN_MIN 4096
+
 // ==============================================================
 
 ImportanceIndex::ImportanceIndex(AttentionBank& bank)
-    : _bank(bank), _index(IMPORTANCE_INDEX_SIZE+1)
+    : _bank(bank), _index(IMPORTANCE_INDEX_SIZE+1),
+      outsideMaxSTI(AttentionValue::MINSTI),
+      topKSnapshot(std::make_shared<const HandleSeq>()),
+      topKChanged(false)
 {
     minAFSize = config().get_int("ECAN_MIN_AF_SIZE", 100);
+    topKSTIValuedHandles.reserve(minAFSize);
 }
 
 unsigned int ImportanceIndex::importanceBin(short importance)
@@ -82,57 +92,263 @@ unsigned int ImportanceIndex::importanceBin(short importance)
 
 void ImportanceIndex::updateImportance(Atom* atom, int oldbin, int newbin)
 {
-    if (oldbin == newbin) return;
-
-    _index.remove(oldbin, atom);
-    _index.insert(newbin, atom);
+    if (oldbin != newbin) {
+        _index.remove(oldbin, atom);
+        _index.insert(newbin, atom);
+    }
     updateTopStiValues(atom);
 }
 
+void ImportanceIndex::updateImportance(const std::vector<Atom*>& atoms,
+                                       const std::vector<int>& oldbins,
+                                       const std::vector<int>& newbins)
+{
+    // The changes to each bin, in the order of the batch, so that an
+    // atom that moves more than once ends up in the right place.
+    std::vector<std::vector<std::pair<Atom*, bool>>> changes(_index.bin_size());
+    size_t nmoves = 0;
+    for (size_t i = 0; i < atoms.size(); i++)
+    {
+        if (oldbins[i] == newbins[i]) continue;
+        changes[oldbins[i]].emplace_back(atoms[i], false);
+        changes[newbins[i]].emplace_back(atoms[i], true);
+        nmoves++;
+    }
+
+    // Each bin has its own lock, so the bins can be done in parallel.
+    std::atomic<size_t> next(0);
+    auto work = [&]() {
+        for (size_t b = next++; b < changes.size(); b = next++)
+            if (not changes[b].empty()) _index.update(b, changes[b]);
+    };
+
+    unsigned nthreads = 1;
+    if (PARALLEL_REBIN_MIN <= nmoves)
+        nthreads = std::max(1u, std::thread::hardware_concurrency());
+
+    std::vector<std::thread> pool;
+    for (unsigned i = 1; i < nthreads; i++)
+        pool.push_back(std::thread(work));
+    work();
+    for (std::thread& t : pool) t.join();
+
+    // Atoms in the heap that went down are not replaced one at a time;
+    // if any went below an atom outside, the heap is remade at the end.
+    std::lock_guard<std::mutex> lock(topKSTIUpdateMutex);
+    for (Atom* atom : atoms) topKUpdate(atom, false);
+    if (not topKSTIValuedHandles.empty() and
+        topKSTIValuedHandles[0].second < outsideMaxSTI)
+        topKRebuild();
+}
+
 void ImportanceIndex::removeAtom(Atom* atom, int bin)
 {
     _index.remove(bin, atom);
-    
+
     std::lock_guard<std::mutex> lock(topKSTIUpdateMutex);
-    // Also remove from topKSTIValueHandles vector
-    Handle h = atom->getHandle();
-    auto it = std::find_if(topKSTIValuedHandles.begin(), topKSTIValuedHandles.end()
-            ,[&h](HandleSTIPair p){return p.first == h; });
-    if(it != topKSTIValuedHandles.end()) topKSTIValuedHandles.erase(it);
-    //TODO Find the next highest STI valued atom to replace the removed one.
+    auto it = topKPosition.find(atom->getHandle());
+    if (it == topKPosition.end()) return;
+
+    // Fill its place with the best atom left outside.
+    topKErase(it->second);
+    topKRefill();
+    topKChanged = true;
+}
+
+// ==============================================================
+// The top K is a binary min-heap; topKPosition says where each atom
+// is in it.  All of these are called with topKSTIUpdateMutex held.
+
+void ImportanceIndex::topKSet(size_t i, const HandleSTIPair& p)
+{
+    topKSTIValuedHandles[i] = p;
+    topKPosition[p.first] = i;
+}
+
+void ImportanceIndex::topKSiftUp(size_t i)
+{
+    HandleSTIPair p(topKSTIValuedHandles[i]);
+    while (0 < i) {
+        size_t parent = (i - 1) / 2;
+        if (topKSTIValuedHandles[parent].second <= p.second) break;
+        topKSet(i, topKSTIValuedHandles[parent]);
+        i = parent;
+    }
+    topKSet(i, p);
+}
+
+void ImportanceIndex::topKSiftDown(size_t i)
+{
+    size_t n = topKSTIValuedHandles.size();
+    HandleSTIPair p(topKSTIValuedHandles[i]);
+    while (true) {
+        size_t child = 2 * i + 1;
+        if (n <= child) break;
+        if (child + 1 < n and
+            topKSTIValuedHandles[child + 1].second <
+            topKSTIValuedHandles[child].second)
+            child++;
+        if (p.second <= topKSTIValuedHandles[child].second) break;
+        topKSet(i, topKSTIValuedHandles[child]);
+        i = child;
+    }
+    topKSet(i, p);
+}
+
+void ImportanceIndex::topKErase(size_t i)
+{
+    topKPosition.erase(topKSTIValuedHandles[i].first);
+    size_t last = topKSTIValuedHandles.size() - 1;
+    if (i != last) {
+        AttentionValue::sti_t sti = topKSTIValuedHandles[i].second;
+        topKSet(i, topKSTIValuedHandles[last]);
+        topKSTIValuedHandles.pop_back();
+        if (topKSTIValuedHandles[i].second < sti) topKSiftUp(i);
+        else topKSiftDown(i);
+        return;
+    }
+    topKSTIValuedHandles.pop_back();
+}
+
+/// Put the atom with the highest STI, out of all those outside of the
+/// heap, into the heap, if there is room for it, or if it beats the
+/// lowest one in the heap.  The bins are ordered by STI, so the search
+/// stops at the first bin, from the top, that has any atom that is not
+/// in the heap already; most of the atoms looked at before that are
+/// ones that are in the heap.
+void ImportanceIndex::topKRefill()
+{
+    Atom* best = nullptr;
+    AttentionValue::sti_t bestSTI = AttentionValue::MINSTI;
+    std::vector<Atom*> bin;
+    for (int i = IMPORTANCE_INDEX_SIZE; i >= 0 and nullptr == best; i--)
+    {
+        bin.clear();
+        _index.getContent(i, std::back_inserter(bin));
+        for (Atom* atom : bin)
+        {
+            Handle h(atom->getHandle());
+            if (topKPosition.count(h)) continue;
+            AttentionValue::sti_t sti = _bank.get_sti(h);
+            if (nullptr == best or bestSTI < sti) {
+                best = atom;
+                bestSTI = sti;
+            }
+        }
+    }
+
+    // Nothing outside of the heap is better than this now; that stays
+    // true if the best one goes in, and the lowest one comes out.
+    outsideMaxSTI = bestSTI;
+    if (nullptr == best) return;
+
+    HandleSTIPair p(best->getHandle(), bestSTI);
+    if (static_cast<int>(topKSTIValuedHandles.size()) < minAFSize) {
+        topKSTIValuedHandles.push_back(p);
+        topKSiftUp(topKSTIValuedHandles.size() - 1);
+    } else if (topKSTIValuedHandles[0].second < bestSTI) {
+        topKPosition.erase(topKSTIValuedHandles[0].first);
+        topKSet(0, p);
+        topKSiftDown(0);
+    }
 }
 
 void ImportanceIndex::updateTopStiValues(Atom* atom)
 {
     std::lock_guard<std::mutex> lock(topKSTIUpdateMutex);
+    topKUpdate(atom);
+}
 
-    auto insertHandle = [this](Handle h){
-        // delete if this handle is already in the vector. TODO find efficient
-        // way of doing this.
-        auto it = std::find_if(topKSTIValuedHandles.begin(), topKSTIValuedHandles.end()
-                ,[&h](HandleSTIPair p){return p.first == h; });
-        if(it != topKSTIValuedHandles.end()) topKSTIValuedHandles.erase(it);
-
-        HandleSTIPair p(h, _bank.get_sti(h));
-        it = std::lower_bound(topKSTIValuedHandles.begin(),
-                topKSTIValuedHandles.end(), p,
-                [=](const HandleSTIPair& hsti1, const HandleSTIPair& hsti2){
-                return hsti1.second < hsti2.second;
-                });
-        topKSTIValuedHandles.insert(it,HandleSTIPair(h, _bank.get_sti(h)));
-    };
+/// Remake the heap from the top bins, and the atoms in it now.
+void ImportanceIndex::topKRebuild()
+{
+    std::vector<HandleSTIPair> cands(topKSTIValuedHandles);
+
+    // Enough bins, from the top, to hold K atoms.  Any atom in the
+    // bins below has a lower STI than all of these.
+    std::vector<Atom*> bin;
+    int seen = 0;
+    AttentionValue::sti_t lowest = AttentionValue::MAXSTI;
+    bool allbins = true;
+    for (int i = IMPORTANCE_INDEX_SIZE; i >= 0; i--)
+    {
+        if (minAFSize <= seen) {
+            allbins = false;
+            break;
+        }
+        bin.clear();
+        _index.getContent(i, std::back_inserter(bin));
+        for (Atom* atom : bin)
+        {
+            Handle h(atom->getHandle());
+            AttentionValue::sti_t sti;
+            auto it = topKPosition.find(h);
+            if (it != topKPosition.end()) {
+                sti = topKSTIValuedHandles[it->second].second;
+            } else {
+                sti = _bank.get_sti(h);
+                cands.push_back(HandleSTIPair(h, sti));
+            }
+            lowest = std::min(lowest, sti);
+            seen++;
+        }
+    }
 
+    auto lower = [](const HandleSTIPair& a, const HandleSTIPair& b) {
+        return a.second < b.second; };
+    size_t k = std::min(cands.size(), static_cast<size_t>(minAFSize));
+    std::nth_element(cands.begin(), cands.begin() + k, cands.end(),
+        [](const HandleSTIPair& a, const HandleSTIPair& b) {
+            return a.second > b.second; });
+
+    outsideMaxSTI = AttentionValue::MINSTI;
+    if (k < cands.size())
+        outsideMaxSTI = std::max_element(cands.begin() + k, cands.end(),
+                                         lower)->second;
+    if (not allbins)
+        outsideMaxSTI = std::max(outsideMaxSTI, lowest);
+
+    topKSTIValuedHandles.clear();
+    topKPosition.clear();
+    for (size_t i = 0; i < k; i++) {
+        topKSTIValuedHandles.push_back(cands[i]);
+        topKSiftUp(i);
+    }
+}
+
+void ImportanceIndex::topKUpdate(Atom* atom, bool refill)
+{
     Handle h = atom->getHandle();
     AttentionValue::sti_t sti = _bank.get_sti(h);
-    if(static_cast<int>(topKSTIValuedHandles.size()) < minAFSize){
-        insertHandle(atom->getHandle());
-    } else if (topKSTIValuedHandles.begin()->second < sti) {
-        topKSTIValuedHandles.erase(topKSTIValuedHandles.begin());
-        insertHandle(h);
+
+    auto it = topKPosition.find(h);
+    if (it != topKPosition.end()) {
+        // Already in; move it to where its new STI puts it.
+        size_t i = it->second;
+        AttentionValue::sti_t old = topKSTIValuedHandles[i].second;
+        topKSTIValuedHandles[i].second = sti;
+        if (sti < old) topKSiftUp(i);
+        else topKSiftDown(i);
+
+        // If it went down, some atom outside might beat it now.
+        if (refill and sti < old and sti < outsideMaxSTI) topKRefill();
+    } else if (static_cast<int>(topKSTIValuedHandles.size()) < minAFSize) {
+        topKSTIValuedHandles.push_back(HandleSTIPair(h, sti));
+        topKSiftUp(topKSTIValuedHandles.size() - 1);
+    } else if (topKSTIValuedHandles[0].second < sti) {
+        // Push out the lowest one.
+        AttentionValue::sti_t out = topKSTIValuedHandles[0].second;
+        topKPosition.erase(topKSTIValuedHandles[0].first);
+        topKSet(0, HandleSTIPair(h, sti));
+        topKSiftDown(0);
+        outsideMaxSTI = std::max(outsideMaxSTI, out);
+    } else {
+        outsideMaxSTI = std::max(outsideMaxSTI, sti);
+        return;
     }
+    topKChanged = true;
 }
 
-
 UnorderedHandleSet ImportanceIndex::getHandleSet(
         AttentionValue::sti_t lowerBound,
         AttentionValue::sti_t upperBound) const
@@ -217,11 +433,25 @@ UnorderedHandleSet ImportanceIndex::getMinBinContents()
 
 HandleSeq ImportanceIndex::getTopSTIValuedHandles()
 {
+    if (not topKChanged)
+        return *std::atomic_load(&topKSnapshot);
+
+    // Sort a copy of the heap, and publish it for the readers that
+    // come after.
     std::lock_guard<std::mutex> lock(topKSTIUpdateMutex);
-    HandleSeq hseq;
-    for(HandleSTIPair p : topKSTIValuedHandles)
-        hseq.push_back(p.first);
-    return  hseq;
+    std::vector<HandleSTIPair> sorted(topKSTIValuedHandles);
+    std::sort(sorted.begin(), sorted.end(),
+              [](const HandleSTIPair& a, const HandleSTIPair& b) {
+                  return a.second < b.second; });
+
+    auto hseq = std::make_shared<HandleSeq>();
+    hseq->reserve(sorted.size());
+    for (const HandleSTIPair& p : sorted)
+        hseq->push_back(p.first);
+    std::atomic_store(&topKSnapshot,
+                      std::shared_ptr<const HandleSeq>(hseq));
+    topKChanged = false;
+    return *hseq;
 }
 
 size_t ImportanceIndex::bin_size() const
@@ -23,7 +23,9 @@
 #ifndef _OPENCOG_IMPORTANCEINDEX_H
 #define _OPENCOG_IMPORTANCEINDEX_H
 
+#include <atomic>
 #include <mutex>
+#include <unordered_map>
 #include <opencog/truthvalue/AttentionValue.h>
 #include <opencog/attentionbank/ThreadSafeFixedIntegerIndex.h>
 
@@ -44,11 +46,34 @@ class ImportanceIndex
 private:
     AttentionBank& _bank;
     ThreadSafeFixedIntegerIndex _index;
+
+    // The atoms with the top K STI values, in a min-heap, so that the
+    // one to be pushed out is always at the top.  The position of each
+    // atom in the heap is indexed, so that a change of its STI moves it
+    // in O(log K).
     std::vector<HandleSTIPair> topKSTIValuedHandles; // TOP K STI values
+    std::unordered_map<Handle, size_t> topKPosition;
     std::mutex topKSTIUpdateMutex;
     int minAFSize;
 
+    // No atom outside of the heap has a higher STI than this.  It is
+    // raised as atoms are seen, and made exact whenever the bins are
+    // searched for the best atom outside of the heap.
+    AttentionValue::sti_t outsideMaxSTI;
+
+    // The heap, sorted, as readers get it; remade on the first read
+    // after the heap changed.
+    std::shared_ptr<const HandleSeq> topKSnapshot;
+    std::atomic<bool> topKChanged;
+
     void updateTopStiValues(Atom* atom);
+    void topKUpdate(Atom*, bool refill=true);
+    void topKSet(size_t, const HandleSTIPair&);
+    void topKSiftUp(size_t);
+    void topKSiftDown(size_t);
+    void topKErase(size_t);
+    void topKRefill();
+    void topKRebuild();
 
 public:
     ImportanceIndex(AttentionBank&);
@@ -57,13 +82,26 @@ public:
     /**
      * Updates the importance index for the given atom.
      * According to the new importance of the atom, it may change importance
-     * bins.
+     * bins, and move in or out of the top K.  This must be called on every
+     * change of the atom's STI, even if it stays in the same bin.
      *
      * @param The atom whose importance index will be updated.
      * @param The old importance bin where the atom originally was.
+     * @param The new importance bin.
      */
     void updateImportance(Atom*, int, int);
 
+    /**
+     * The same, for many atoms at once; the i'th atom moves from the
+     * i'th old bin to the i'th new one.  The moves are grouped by bin,
+     * so that each bin is locked once, and for big batches, the bins
+     * are done in parallel.  An atom may be in the batch more than
+     * once; the moves are done in order.
+     */
+    void updateImportance(const std::vector<Atom*>&,
+                          const std::vector<int>&,
+                          const std::vector<int>&);
+
     UnorderedHandleSet getHandleSet(AttentionValue::sti_t,
                                     AttentionValue::sti_t) const;
 
@@ -102,7 +140,8 @@ public:
     UnorderedHandleSet getMinBinContents();
     
     /**
-     * Get latest top K sti values.
+     * Get latest top K sti values, lowest STI first.  This takes no
+     * lock, unless the top K changed since the last call.
      */
      HandleSeq getTopSTIValuedHandles();
 
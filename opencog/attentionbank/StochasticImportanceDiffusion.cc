@@ -25,6 +25,7 @@
 
 #include <algorithm>
 #include <math.h>
+#include <thread>
 
 #include <opencog/attentionbank/AttentionBank.h>
 #include "StochasticImportanceDiffusion.h"
@@ -32,6 +33,9 @@
 using namespace opencog;
 using namespace opencog::ecan;
 
+// Batches with fewer atoms than this are scaled in the calling thread.
+#define PARALLEL_DIFFUSION_MIN 65536
+
 unsigned int StochasticDiffusionAmountCalculator::bin_index(const Handle& h)
 {
     return _ab->_importanceIndex.importanceBin(_ab->get_sti(h));
@@ -42,16 +46,22 @@ size_t StochasticDiffusionAmountCalculator::bin_size(unsigned int index)
    return _ab->_importanceIndex.size(index);
 }
 
-void StochasticDiffusionAmountCalculator::update_bin(const Handle& h)
+DiffusionRecordBin* StochasticDiffusionAmountCalculator::find_bin(unsigned int index)
 {
-    unsigned short index = bin_index(h);
     auto it = std::find_if(_bins.begin(),_bins.end(),
             [=](const DiffusionRecordBin& bin){ return (bin.index == index); });
+    return (it == _bins.end()) ? nullptr : &*it;
+}
+
+void StochasticDiffusionAmountCalculator::update_bin(const Handle& h)
+{
+    unsigned short index = bin_index(h);
+    DiffusionRecordBin* it = find_bin(index);
 
-    if (it == _bins.end())
+    if (nullptr == it)
     {
         _bins.push_back(DiffusionRecordBin());
-        it = _bins.begin() + _bins.size()-1;
+        it = &_bins.back();
     }
     DiffusionRecordBin& bin = *it;
 
@@ -137,3 +147,107 @@ float StochasticDiffusionAmountCalculator::diffused_value(const Handle& h,
     float average_elapsed_time = elapsed_time(h);
     return _ab->get_sti(h) * pow((1 - decay_rate), average_elapsed_time);
 }
+
+/**
+ *  Multiplies each run of STI values by the decay factor of its bin.
+ *  @param sti STI values, sorted by bin
+ *  @param start start[b] is where the run of bin b begins
+ *  @param factor the decay factor of each bin
+ *  @param lo, hi the part of the STI values to do
+ */
+static void scale_runs(float* sti, const std::vector<size_t>& start,
+                       const std::vector<float>& factor, size_t lo, size_t hi)
+{
+    for (size_t b = 0; b < factor.size(); b++) {
+        size_t first = std::max(lo, start[b]);
+        size_t last = std::min(hi, start[b+1]);
+        float f = factor[b];
+        // A plain loop over contiguous floats, which the compiler
+        // turns into SIMD code.
+        for (size_t j = first; j < last; j++)
+            sti[j] *= f;
+    }
+}
+
+std::vector<float> StochasticDiffusionAmountCalculator::decay(
+        const std::vector<AttentionValuePtr>& avs, float decay_rate)
+{
+    size_t n = avs.size();
+
+    // Sort the atoms by bin, with a counting sort.
+    size_t nbins = _ab->_importanceIndex.bin_size();
+    std::vector<unsigned int> bins(n);
+    std::vector<size_t> start(nbins + 1, 0);
+    for (size_t i = 0; i < n; i++) {
+        bins[i] = ImportanceIndex::importanceBin(avs[i]->getSTI());
+        start[bins[i] + 1]++;
+    }
+    for (size_t b = 0; b < nbins; b++)
+        start[b+1] += start[b];
+
+    std::vector<float> sti(n);
+    std::vector<size_t> order(n);
+    std::vector<size_t> next(start.begin(), start.end() - 1);
+    for (size_t i = 0; i < n; i++) {
+        size_t j = next[bins[i]]++;
+        sti[j] = avs[i]->getSTI();
+        order[j] = i;
+    }
+
+    // One decay factor, and one record update, per bin; every atom in
+    // the bin counts toward its update rate.
+    std::vector<float> factor(nbins, 1.0f);
+    for (size_t b = 0; b < nbins; b++) {
+        size_t count = start[b+1] - start[b];
+        if (0 == count) continue;
+
+        DiffusionRecordBin* rec = find_bin(b);
+        if (rec)
+            factor[b] = pow((1 - decay_rate), rec->size / rec->update_rate);
+        else {
+            _bins.push_back(DiffusionRecordBin());
+            rec = &_bins.back();
+        }
+
+        rec->index = b;
+        rec->count += count;
+        duration<float> sec = high_resolution_clock::now() - rec->last_update;
+        rec->update_rate = rec->count / sec.count();
+        rec->last_update = high_resolution_clock::now();
+        rec->size = bin_size(b);
+    }
+
+    unsigned nthreads = 1;
+    if (PARALLEL_DIFFUSION_MIN <= n)
+        nthreads = std::max(1u, std::thread::hardware_concurrency());
+
+    std::vector<std::thread> pool;
+    size_t chunk = (n + nthreads - 1) / nthreads;
+    for (unsigned t = 1; t < nthreads; t++)
+        pool.push_back(std::thread(scale_runs, sti.data(), std::cref(start),
+                                   std::cref(factor), t * chunk,
+                                   std::min(n, (t + 1) * chunk)));
+    scale_runs(sti.data(), start, factor, 0, std::min(n, chunk));
+    for (std::thread& t : pool) t.join();
+
+    std::vector<float> out(n);
+    for (size_t j = 0; j < n; j++)
+        out[order[j]] = sti[j];
+    return out;
+}
+
+std::vector<float> StochasticDiffusionAmountCalculator::diffused_values(
+        const HandleSeq& hs, float decay_rate)
+{
+    return decay(_ab->get_av(hs), decay_rate);
+}
+
+void StochasticDiffusionAmountCalculator::diffuse(const HandleSeq& hs,
+                                                  float decay_rate)
+{
+    std::vector<AttentionValuePtr> avs(_ab->get_av(hs));
+    std::vector<float> values(decay(avs, decay_rate));
+    for (size_t i = 0; i < hs.size(); i++)
+        avs[i] = createAV(values[i], avs[i]->getLTI(), avs[i]->getVLTI());
+    _ab->change_av(hs, avs);
+}
@@ -29,10 +29,12 @@
 #include <chrono>
 #include <vector>
 
+#include <opencog/atoms/base/Handle.h>
+#include <opencog/truthvalue/AttentionValue.h>
+
 using namespace std::chrono;
 namespace opencog
 {
-    class Handle;
     class AtomSpace;
     class AttentionBank;
     namespace ecan
@@ -69,6 +71,9 @@ namespace opencog
             unsigned int bin_index(const Handle& h);
             size_t bin_size(unsigned int index);
             void update_bin(const Handle& h);
+            DiffusionRecordBin* find_bin(unsigned int index);
+            std::vector<float> decay(const std::vector<AttentionValuePtr>&,
+                                     float decay_rate);
 
             public:
             StochasticDiffusionAmountCalculator(AtomSpace * as);
@@ -78,6 +83,26 @@ namespace opencog
                     std::vector<DiffusionRecordBin>& recent, float bias);
             float diffused_value(const Handle& h, float decay_rate);
             float elapsed_time(const Handle& h);
+
+            /**
+             * The diffused values of many atoms at once.  The atoms are
+             * sorted by bin, so that the decay factor is worked out once
+             * per bin, and applied to a contiguous run of STI values;
+             * big batches are split over several threads.  Every atom
+             * in a bin gets the elapsed time from before the batch.  The
+             * bin record is then updated once, with all of the batch's
+             * atoms in that bin added to its count, as if each had been
+             * diffused on its own; so the update rate comes out the
+             * same as with diffused_value().
+             */
+            std::vector<float> diffused_values(const HandleSeq& hs,
+                                               float decay_rate);
+
+            /**
+             * Work out the diffused values of the atoms, as above, and
+             * write them back to the AttentionBank as one batch.
+             */
+            void diffuse(const HandleSeq& hs, float decay_rate);
         };
     }
 }
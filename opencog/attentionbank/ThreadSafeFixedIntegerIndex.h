@@ -77,6 +77,20 @@ class ThreadSafeFixedIntegerIndex : public FixedIntegerIndex
             FixedIntegerIndex::remove(i,a);
         }
 
+        /**
+         * Make many changes to bin i, under one lock: each atom is
+         * inserted if its flag is set, else removed, in order.
+         */
+        void update(size_t i, const std::vector<std::pair<Atom*, bool>>& ops)
+        {
+            std::lock_guard<std::mutex> lck(*_locks[i]);
+            for (const auto& op : ops)
+            {
+                if (op.second) FixedIntegerIndex::insert(i, op.first);
+                else FixedIntegerIndex::remove(i, op.first);
+            }
+        }
+
         size_t size(size_t i) const
         {
             std::lock_guard<std::mutex> lck(*_locks[i]);
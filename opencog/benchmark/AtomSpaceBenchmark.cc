@@ -4,6 +4,7 @@
 #include <ctime>
 #include <iostream>
 #include <fstream>
+#include <malloc.h>
 #include <sys/time.h>
 #include <sys/resource.h>
 
@@ -93,30 +94,29 @@ AtomSpaceBenchmark::~AtomSpaceBenchmark()
 // to store the AttentionValues.
 size_t AtomSpaceBenchmark::estimateOfAtomSize(Handle h)
 {
+    // Simple truth values are packed into the atom itself, and cost
+    // nothing extra; the others are boxed.
     size_t total = 0;
     if (h->getTruthValue() != TruthValue::DEFAULT_TV())
     {
         Type tvt = h->getTruthValue()->getType();
-        if (tvt == SIMPLE_TRUTH_VALUE)
-            total += sizeof(SimpleTruthValue);
-        else
         if (tvt == COUNT_TRUTH_VALUE)
-            total += sizeof(CountTruthValue);
+            total += sizeof(TruthValuePtr) + sizeof(CountTruthValue);
         else
         if (tvt == INDEFINITE_TRUTH_VALUE)
-            total += sizeof(IndefiniteTruthValue);
+            total += sizeof(TruthValuePtr) + sizeof(IndefiniteTruthValue);
     }
 
     NodePtr n(NodeCast(h));
     if (n)
     {
-        total = sizeof(Node);
+        total += sizeof(Node);
         total += n->getName().capacity();
     }
     else
     {
         LinkPtr l(LinkCast(h));
-        total = sizeof(Link);
+        total += sizeof(Link);
         total += l->getOutgoingSet().capacity() * sizeof(Handle);
         for (Handle ho: l->getOutgoingSet())
         {
@@ -138,6 +138,68 @@ long AtomSpaceBenchmark::getMemUsage()
     return rss;
 }
 
+// Bytes in use on the heap, as malloc counts them.
+static size_t heapInUse()
+{
+#if defined(__GLIBC__) && __GLIBC_PREREQ(2, 33)
+    return mallinfo2().uordblks;
+#elif defined(__GLIBC__)
+    return mallinfo().uordblks;
+#else
+    return 0;
+#endif
+}
+
+// Heap bytes per atom, for many ConceptNodes in an atomspace: bare,
+// then with a simple truth value set on each, then with a count truth
+// value on each.  Also, what each simple truth value would cost if it
+// were boxed, the way all of them used to be.
+static void printHeapPerAtom()
+{
+    const size_t n = 100000;
+    cout << "==Heap memory per atom, over " << n << " ConceptNodes==" << endl;
+    if (0 == heapInUse())
+    {
+        cout << "Not measured; needs glibc's mallinfo()" << endl;
+        return;
+    }
+
+    AtomSpace as;
+    HandleSeq hs;
+    hs.reserve(n);
+
+    size_t before = heapInUse();
+    for (size_t i = 0; i < n; i++)
+        hs.push_back(as.add_node(CONCEPT_NODE, "heap test " + std::to_string(i)));
+    size_t bare = heapInUse();
+
+    for (size_t i = 0; i < n; i++)
+        hs[i]->setTruthValue(SimpleTruthValue::createTV(double(i) / n, 0.9));
+    size_t simple = heapInUse();
+
+    for (size_t i = 0; i < n; i++)
+        hs[i]->setTruthValue(CountTruthValue::createTV(double(i) / n, 0.9, 10));
+    size_t counted = heapInUse();
+
+    std::vector<TruthValuePtr*> boxes;
+    boxes.reserve(n);
+    size_t unboxed = heapInUse();
+    for (size_t i = 0; i < n; i++)
+        boxes.push_back(new TruthValuePtr(
+            SimpleTruthValue::createTV(double(i) / n, 0.9)));
+    size_t boxed = heapInUse();
+    for (TruthValuePtr* b : boxes) delete b;
+
+    auto per = [n](size_t from, size_t to) {
+        return (double(to) - double(from)) / n;
+    };
+    cout << "ConceptNode, default TV = " << per(before, bare) << endl;
+    cout << "  plus a SimpleTruthValue (packed) = " << per(bare, simple) << endl;
+    cout << "  plus a CountTruthValue (boxed) = " << per(simple, counted) << endl;
+    cout << "A SimpleTruthValue, if it were boxed = "
+         << per(unboxed, boxed) << endl;
+}
+
 void AtomSpaceBenchmark::printTypeSizes()
 {
     // Note that these are just the type size, it doesn't include the size of
@@ -183,6 +245,16 @@ void AtomSpaceBenchmark::printTypeSizes()
     Handle el = LK(EVALUATION_LINK, np, ll);
     cout << "EvaluationLink with two ConceptNodes = "
          << estimateOfAtomSize(el) << endl;
+
+    h->setTruthValue(SimpleTruthValue::createTV(0.8, 0.9));
+    cout << "Empty ListLink, with a SimpleTruthValue = "
+         << estimateOfAtomSize(h) << endl;
+    h->setTruthValue(CountTruthValue::createTV(0.8, 0.9, 10));
+    cout << "Empty ListLink, with a CountTruthValue = "
+         << estimateOfAtomSize(h) << endl;
+    cout << DIVIDER_LINE << endl;
+
+    printHeapPerAtom();
 }
 
 void AtomSpaceBenchmark::showMethods()
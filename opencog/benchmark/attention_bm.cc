@@ -0,0 +1,189 @@
+/*
+ * benchmark/attention_bm.cc
+ *
+ * Cost of rent and wage cycles, and of importance diffusion, over the
+ * whole attentional focus, one atom at a time and in batches.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License v3 as
+ * published by the Free Software Foundation and including the exceptions
+ * at http://opencog.org/wiki/Licenses
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, write to:
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <opencog/atomspace/AtomSpace.h>
+#include <opencog/attentionbank/AttentionBank.h>
+#include <opencog/attentionbank/StochasticImportanceDiffusion.h>
+
+using namespace opencog;
+
+// Rent taken from every atom, every cycle.
+#define RENT 10
+
+// Decay rate for diffusion.
+#define DECAY 0.1f
+
+static float fsink = 0;
+
+static double ns_per(std::function<void()> body, size_t reps, size_t n)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (size_t r = 0; r < reps; r++) body();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count()
+        / (reps * n);
+}
+
+// n atoms, all in the focus, with their STI spread over the bins.
+static HandleSeq make_focus(AtomSpace& as, AttentionBank& ab, size_t n)
+{
+    HandleSeq hs;
+    for (size_t i = 0; i < n; i++) {
+        hs.push_back(as.add_node(CONCEPT_NODE, "focus " + std::to_string(i)));
+        ab.set_sti(hs[i], 100 + (i * 7919) % 20000);
+    }
+    return hs;
+}
+
+// Rent, taken from each atom with its own change_av call.
+static void rent_single(AttentionBank& ab, const HandleSeq& hs)
+{
+    for (const Handle& h : hs) {
+        AttentionValuePtr av = ab.get_av(h);
+        ab.change_av(h, createAV(av->getSTI() - RENT,
+                                 av->getLTI(), av->getVLTI()));
+    }
+}
+
+// The same, as one batch.
+static void rent_batch(AttentionBank& ab, const HandleSeq& hs)
+{
+    std::vector<AttentionValuePtr> avs;
+    avs.reserve(hs.size());
+    for (const Handle& h : hs) {
+        AttentionValuePtr av = ab.get_av(h);
+        avs.push_back(createAV(av->getSTI() - RENT,
+                               av->getLTI(), av->getVLTI()));
+    }
+    ab.change_av(hs, avs);
+}
+
+static void wage_single(AttentionBank& ab, const HandleSeq& hs)
+{
+    for (const Handle& h : hs) ab.stimulate(h, 1.0);
+}
+
+static void wage_batch(AttentionBank& ab, const HandleSeq& hs)
+{
+    ab.stimulate(hs, 1.0);
+}
+
+static void bench(size_t n, size_t cycles)
+{
+    AtomSpace as1, as2;
+    AttentionBank ab1(&as1), ab2(&as2);
+    HandleSeq single(make_focus(as1, ab1, n));
+    HandleSeq batch(make_focus(as2, ab2, n));
+
+    double rs = ns_per([&]() { rent_single(ab1, single); }, cycles, n);
+    double rb = ns_per([&]() { rent_batch(ab2, batch); }, cycles, n);
+    double ws = ns_per([&]() { wage_single(ab1, single); }, cycles, n);
+    double wb = ns_per([&]() { wage_batch(ab2, batch); }, cycles, n);
+
+    printf("  %8zu atoms: rent: single %9.1f ns/atom  batch %7.1f ns/atom"
+           "  (%.1fx)\n", n, rs, rb, rs / rb);
+    printf("  %8zu atoms: wage: single %9.1f ns/atom  batch %7.1f ns/atom"
+           "  (%.1fx)\n", n, ws, wb, ws / wb);
+}
+
+// Diffusion, with the diffusion calculator, which works on the
+// attentionbank() of the atomspace.  Both halves of the focus are in
+// the same atomspace; each has its own calculator.
+static void bench_diffusion(AtomSpace& as, size_t n, size_t cycles)
+{
+    AttentionBank& ab = attentionbank(&as);
+    HandleSeq all(make_focus(as, ab, 2 * n));
+    HandleSeq single(all.begin(), all.begin() + n);
+    HandleSeq batch(all.begin() + n, all.end());
+    ecan::StochasticDiffusionAmountCalculator calc1(&as), calc2(&as);
+
+    // Just working out the values.
+    double vs = ns_per([&]() {
+        for (const Handle& h : single) fsink += calc1.diffused_value(h, DECAY);
+    }, cycles, n);
+    double vb = ns_per([&]() {
+        fsink += calc2.diffused_values(batch, DECAY)[0];
+    }, cycles, n);
+
+    // Working them out, and writing them back.
+    double ds = ns_per([&]() {
+        for (const Handle& h : single) {
+            AttentionValuePtr av = ab.get_av(h);
+            ab.change_av(h, createAV(calc1.diffused_value(h, DECAY),
+                                     av->getLTI(), av->getVLTI()));
+        }
+    }, cycles, n);
+    double db = ns_per([&]() { calc2.diffuse(batch, DECAY); }, cycles, n);
+
+    printf("  %8zu atoms: values: single %9.1f ns/atom  batch %7.1f ns/atom"
+           "  (%.1fx)\n", n, vs, vb, vs / vb);
+    printf("  %8zu atoms: diffuse: single %8.1f ns/atom  batch %7.1f ns/atom"
+           "  (%.1fx)\n", n, ds, db, ds / db);
+    as.clear();
+}
+
+int main(int argc, char** argv)
+{
+    const char* usage = "Rent, wages and diffusion over the attentional focus\n"
+     "Usage: attention_bm [options]\n"
+     "-n <int>  \tLargest number of atoms in the focus (default: 10000)\n"
+     "-c <int>  \tCycles of rent, wages and diffusion to time (default: 5)\n";
+
+    size_t maxn = 10000;
+    size_t cycles = 5;
+
+    int c;
+    opterr = 0;
+    while ((c = getopt (argc, argv, "n:c:")) != -1) {
+        switch (c)
+        {
+            case 'n':
+                maxn = atoi(optarg);
+                break;
+            case 'c':
+                cycles = atoi(optarg);
+                break;
+            default:
+                fprintf (stderr, "%s", usage);
+                exit(1);
+        }
+    }
+
+    printf("Cycles over the whole focus:\n");
+    for (size_t n = 100; n <= maxn; n *= 10) bench(n, cycles);
+
+    // The attentionbank() is never freed, so neither is its atomspace.
+    AtomSpace* as = new AtomSpace();
+    printf("Diffusion over the whole focus:\n");
+    for (size_t n = 100; n <= maxn; n *= 10) bench_diffusion(*as, n, cycles);
+
+    return fsink == 42.0f;
+}
@@ -0,0 +1,151 @@
+/*
+ * benchmark/cache_bm.cc
+ *
+ * A random walk over the graph, one incoming set at a time, through the
+ * memcached atom cache, with and without prefetching.  The cache is
+ * the in-process stand-in for memcached, made to take a while over
+ * each round trip, as a server on the network would.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License v3 as
+ * published by the Free Software Foundation and including the exceptions
+ * at http://opencog.org/wiki/Licenses
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, write to:
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <functional>
+#include <random>
+#include <string>
+
+#include <opencog/atoms/base/Link.h>
+#include <opencog/atomspace/AtomSpace.h>
+#include <opencog/persist/memcache/AtomCache.h>
+#include <opencog/persist/memcache/InProcessCache.h>
+#include <opencog/truthvalue/SimpleTruthValue.h>
+
+using namespace opencog;
+
+static double secs(const std::function<void(void)>& fn)
+{
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(end - start).count();
+}
+
+// A random walk from node "0", fetching the incoming set of each node
+// on the way, and then stepping to one of the nodes linked to it.
+static void walk(AtomSpace& as, size_t nwalk)
+{
+    std::mt19937 rng(7);
+    Handle h = as.add_node(CONCEPT_NODE, "0");
+    for (size_t i = 0; i < nwalk; i++)
+    {
+        as.fetch_incoming_set(h);
+        HandleSeq next;
+        for (const LinkPtr& lp : h->getIncomingSet())
+            for (const Handle& ho : lp->getOutgoingSet())
+                if (ho != h) next.push_back(ho);
+        if (next.empty()) break;
+        h = next[rng() % next.size()];
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const char* usage = "Walk the graph through the memcached atom cache\n"
+     "Usage: cache_bm [options]\n"
+     "-n <int>  \tNumber of nodes (default: 20000)\n"
+     "-l <int>  \tNumber of links per node (default: 4)\n"
+     "-w <int>  \tNumber of incoming sets to fetch (default: 2000)\n"
+     "-d <int>  \tMicroseconds per round trip (default: 200)\n";
+
+    size_t nnodes = 20000;
+    size_t degree = 4;
+    size_t nwalk = 2000;
+    size_t delay = 200;
+
+    int c;
+    opterr = 0;
+    while ((c = getopt (argc, argv, "n:l:w:d:")) != -1) {
+        switch (c)
+        {
+            case 'n':
+                nnodes = atoi(optarg);
+                break;
+            case 'l':
+                degree = atoi(optarg);
+                break;
+            case 'w':
+                nwalk = atoi(optarg);
+                break;
+            case 'd':
+                delay = atoi(optarg);
+                break;
+            default:
+                fprintf (stderr, "%s", usage);
+                exit(1);
+        }
+    }
+
+    // Each node is in about 2 * degree links, to random other nodes.
+    AtomSpace as;
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<size_t> pick(0, nnodes - 1);
+    for (size_t i = 0; i < nnodes; i++)
+        for (size_t j = 0; j < degree; j++)
+        {
+            Handle l = as.add_link(LIST_LINK,
+                as.add_node(CONCEPT_NODE, std::to_string(i)),
+                as.add_node(CONCEPT_NODE, std::to_string(pick(rng))));
+            l->setTruthValue(SimpleTruthValue::createTV(0.5, 0.5));
+        }
+
+    InProcessCache client;
+    {
+        AtomCache cache(&client);
+        HandleSeq links;
+        as.get_handles_by_type(links, LIST_LINK);
+        double t = secs([&]() {
+            for (const Handle& h : links) cache.storeAtom(h);
+        });
+        printf("%-22s %8.3f sec  %10.0f atoms per sec\n", "store:",
+               t, as.get_size() / t);
+    }
+
+    client.set_delay(std::chrono::microseconds(delay));
+    for (bool prefetch : {false, true})
+    {
+        AtomCache cache(&client);
+        cache.set_prefetch(prefetch);
+        AtomSpace as2;
+        cache.registerWith(&as2);
+        client.reset_counts();
+
+        double t = secs([&]() { walk(as2, nwalk); });
+        printf("%-22s %8.3f sec  %10.0f incoming sets per sec\n",
+               prefetch ? "walk, prefetch:" : "walk, no prefetch:",
+               t, nwalk / t);
+        printf("%-22s %8.2f round trips, %.1f keys per incoming set, "
+               "%zu prefetched\n", "",
+               client.round_trips() / (double) nwalk,
+               client.keys_fetched() / (double) nwalk,
+               cache.prefetch_hits());
+        cache.unregisterWith(&as2);
+    }
+    return 0;
+}
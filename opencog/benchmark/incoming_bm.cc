@@ -0,0 +1,251 @@
+/*
+ * benchmark/incoming_bm.cc
+ *
+ * Memory use and speed of the incoming set, compared to the
+ * std::set<WinkPtr> that it replaced.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License v3 as
+ * published by the Free Software Foundation and including the exceptions
+ * at http://opencog.org/wiki/Licenses
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, write to:
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <new>
+#include <random>
+#include <set>
+#include <sstream>
+#include <vector>
+
+#include <opencog/atoms/base/IncomingBuckets.h>
+#include <opencog/atoms/base/Link.h>
+#include <opencog/atoms/base/Node.h>
+#include <opencog/atomspace/AtomSpace.h>
+
+using namespace opencog;
+
+// Count the bytes on the heap, so that the containers can be weighed.
+// Each block carries its size in front of it.
+static std::atomic<size_t> heap_bytes(0);
+
+void* operator new(size_t sz)
+{
+    size_t* p = (size_t*) malloc(sz + 16);
+    if (nullptr == p) throw std::bad_alloc();
+    p[0] = sz;
+    heap_bytes.fetch_add(sz, std::memory_order_relaxed);
+    return p + 2;
+}
+
+void operator delete(void* ptr) noexcept
+{
+    if (nullptr == ptr) return;
+    size_t* p = ((size_t*) ptr) - 2;
+    heap_bytes.fetch_sub(p[0], std::memory_order_relaxed);
+    free(p);
+}
+
+// What the incoming set used to be.
+typedef std::set<WinkPtr, std::owner_less<WinkPtr>> OldSet;
+
+// The atom types are only known after the type tables are set up,
+// so this is filled in by main().
+static std::vector<Type> link_types;
+
+static size_t sink = 0;
+
+static double ns_per(std::function<void()> body, size_t reps, size_t n)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (size_t r = 0; r < reps; r++) body();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count()
+        / (reps * n);
+}
+
+// Links holding a hub, of ntypes different types.
+static std::vector<LinkPtr> make_links(size_t n, size_t ntypes)
+{
+    Handle hub(createNode(CONCEPT_NODE, "hub"));
+    std::vector<LinkPtr> links;
+    for (size_t i = 0; i < n; i++) {
+        std::ostringstream oss;
+        oss << "leaf " << i;
+        Handle leaf(createNode(CONCEPT_NODE, oss.str()));
+        links.push_back(createLink(link_types[i % ntypes], hub, leaf));
+    }
+    return links;
+}
+
+// Heap bytes per link, for many incoming sets of the given degree.
+static void bench_bytes(size_t degree, size_t ntypes)
+{
+    size_t nsets = std::max((size_t) 1, (size_t) 100000 / degree);
+    std::vector<LinkPtr> links(make_links(degree, ntypes));
+
+    size_t before = heap_bytes.load();
+    std::vector<OldSet> olds(nsets);
+    for (OldSet& s : olds)
+        for (const LinkPtr& l : links) s.insert(l);
+    double old_per = (heap_bytes.load() - before) / double(nsets * degree);
+    olds.clear();
+    olds.shrink_to_fit();
+
+    before = heap_bytes.load();
+    std::vector<IncomingBuckets> news(nsets);
+    for (IncomingBuckets& s : news)
+        for (const LinkPtr& l : links) s.insert(l);
+    double new_per = (heap_bytes.load() - before) / double(nsets * degree);
+
+    printf("  degree %8zu, %zu types: std::set %6.1f bytes/link  "
+           "buckets %6.1f bytes/link\n", degree, ntypes, old_per, new_per);
+}
+
+// Walking the whole set, and the links of one type, on the bare
+// containers.
+static void bench_iterate(size_t degree, size_t ntypes, size_t reps)
+{
+    std::vector<LinkPtr> links(make_links(degree, ntypes));
+    OldSet olds;
+    IncomingBuckets news;
+    for (const LinkPtr& l : links) { olds.insert(l); news.insert(l); }
+
+    double old_all = ns_per([&]() {
+        for (const WinkPtr& w : olds)
+            if (LinkPtr l = w.lock()) sink++;
+    }, reps, degree);
+    double new_all = ns_per([&]() {
+        news.foreach([&](const WinkPtr& w)
+            { if (LinkPtr l = w.lock()) sink++; });
+    }, reps, degree);
+
+    // Per link of the wanted type.
+    size_t nwant = news.size(LIST_LINK);
+    double old_type = ns_per([&]() {
+        for (const WinkPtr& w : olds) {
+            LinkPtr l(w.lock());
+            if (l and LIST_LINK == l->getType()) sink++;
+        }
+    }, reps, nwant);
+    double new_type = ns_per([&]() {
+        news.foreach_of_type(LIST_LINK, [&](const WinkPtr& w)
+            { if (LinkPtr l = w.lock()) sink++; });
+    }, reps, nwant);
+
+    printf("  degree %8zu, %zu types: all: std::set %6.1f ns/link  "
+           "buckets %6.1f ns/link;  by type: std::set %7.1f ns/link  "
+           "buckets %6.1f ns/link\n",
+           degree, ntypes, old_all, new_all, old_type, new_type);
+}
+
+// Adding all the links, and then removing them in random order.
+static void bench_churn(size_t degree, size_t ntypes, size_t reps)
+{
+    std::vector<LinkPtr> links(make_links(degree, ntypes));
+    std::vector<LinkPtr> shuffled(links);
+    std::shuffle(shuffled.begin(), shuffled.end(), std::mt19937(42));
+
+    double old_ns = ns_per([&]() {
+        OldSet s;
+        for (const LinkPtr& l : links) s.insert(l);
+        for (const LinkPtr& l : shuffled) s.erase(l);
+    }, reps, degree);
+    double new_ns = ns_per([&]() {
+        IncomingBuckets s;
+        for (const LinkPtr& l : links) s.insert(l);
+        for (const LinkPtr& l : shuffled) s.erase(l);
+    }, reps, degree);
+
+    printf("  degree %8zu, %zu types: insert+erase: std::set %6.1f ns/link  "
+           "buckets %6.1f ns/link\n", degree, ntypes, old_ns, new_ns);
+}
+
+// The same, through the Atom API, on atoms in an atomspace.
+static void bench_atom(size_t degree, size_t ntypes, size_t reps)
+{
+    AtomSpace as;
+    Handle hub(as.add_node(CONCEPT_NODE, "hub"));
+    for (size_t i = 0; i < degree; i++) {
+        std::ostringstream oss;
+        oss << "leaf " << i;
+        as.add_link(link_types[i % ntypes],
+                    hub, as.add_node(CONCEPT_NODE, oss.str()));
+    }
+
+    double all = ns_per([&]() {
+        sink += hub->getIncomingSet().size();
+    }, reps, degree);
+    size_t nwant = hub->getIncomingSetByType(LIST_LINK).size();
+    double by_type = ns_per([&]() {
+        sink += hub->getIncomingSetByType(LIST_LINK).size();
+    }, reps, nwant);
+
+    printf("  degree %8zu, %zu types: getIncomingSet %6.1f ns/link  "
+           "getIncomingSetByType %6.1f ns/link\n",
+           degree, ntypes, all, by_type);
+}
+
+int main(int argc, char** argv)
+{
+    const char* usage = "Memory use and speed of the incoming set\n"
+     "Usage: incoming_bm [options]\n"
+     "-n <int>  \tLargest incoming set (default: 1000000)\n"
+     "-T <int>  \tNumber of link types in the incoming sets (default: 4)\n";
+
+    size_t maxdeg = 1000000;
+    size_t ntypes = 4;
+
+    int c;
+    opterr = 0;
+    while ((c = getopt (argc, argv, "n:T:")) != -1) {
+        switch (c)
+        {
+            case 'n':
+                maxdeg = atoi(optarg);
+                break;
+            case 'T':
+                ntypes = atoi(optarg);
+                break;
+            default:
+                fprintf (stderr, "%s", usage);
+                exit(1);
+        }
+    }
+    link_types = { LIST_LINK, SET_LINK, MEMBER_LINK, INHERITANCE_LINK,
+                   SUBSET_LINK, SIMILARITY_LINK, AND_LINK, OR_LINK };
+    ntypes = std::max((size_t) 1, std::min(ntypes, link_types.size()));
+
+    std::vector<size_t> degrees;
+    for (size_t d = 1; d <= maxdeg; d *= 10) degrees.push_back(d);
+
+    printf("Memory:\n");
+    for (size_t d : degrees) bench_bytes(d, ntypes);
+
+    printf("Iteration:\n");
+    for (size_t d : degrees) bench_iterate(d, ntypes, 1 + 10000000 / d);
+
+    printf("Insert and remove:\n");
+    for (size_t d : degrees) bench_churn(d, ntypes, 1 + 1000000 / d);
+
+    printf("Atom API:\n");
+    for (size_t d : degrees) bench_atom(d, ntypes, 1 + 1000000 / d);
+
+    return sink == 42;
+}
@@ -0,0 +1,165 @@
+/*
+ * benchmark/journal_bm.cc
+ *
+ * How much journaling slows down adding atoms, with the changes
+ * committed in groups, and with a sync after every change; and how
+ * long checkpoints and recovery take.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License v3 as
+ * published by the Free Software Foundation and including the exceptions
+ * at http://opencog.org/wiki/Licenses
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, write to:
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <functional>
+#include <string>
+
+#include <opencog/atoms/base/Link.h>
+#include <opencog/atomspace/AtomSpace.h>
+#include <opencog/persist/journal/AtomJournal.h>
+#include <opencog/truthvalue/SimpleTruthValue.h>
+
+using namespace opencog;
+
+static double secs(const std::function<void(void)>& fn)
+{
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(end - start).count();
+}
+
+static void report(const char* what, size_t n, double t)
+{
+    printf("%-26s %8.3f sec  %10.0f changes per sec\n", what, t, n / t);
+}
+
+static void remove_dir(const std::string& dir)
+{
+    DIR* dp = opendir(dir.c_str());
+    if (nullptr == dp) return;
+    struct dirent* de;
+    while (nullptr != (de = readdir(dp)))
+        if ('.' != de->d_name[0])
+            unlink((dir + "/" + de->d_name).c_str());
+    closedir(dp);
+    rmdir(dir.c_str());
+}
+
+// Add the links numbered from..to, each with a truth value; that is
+// four changes per link, after the first few.
+static void add_links(AtomSpace& as, size_t from, size_t to,
+                      const std::function<void(void)>& after_each)
+{
+    Handle pred = as.add_node(PREDICATE_NODE, "journal_bm");
+    for (size_t i = from; i < to; i++)
+    {
+        Handle l = as.add_link(EVALUATION_LINK, pred,
+            as.add_link(LIST_LINK,
+                as.add_node(CONCEPT_NODE, std::to_string(i)),
+                as.add_node(CONCEPT_NODE, std::to_string(i / 2))));
+        l->setTruthValue(SimpleTruthValue::createTV(0.5, 0.001 * (i % 1000)));
+        after_each();
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const char* usage = "Journal the changes to an atomspace\n"
+     "Usage: journal_bm [options]\n"
+     "-n <int>  \tNumber of links (default: 200000)\n"
+     "-s <int>  \tNumber of links to add with a sync after each\n"
+     "          \t(default: 1000)\n"
+     "-d <dir>  \tJournal directory (default: /tmp/journal_bm)\n";
+
+    size_t nlinks = 200000;
+    size_t nsync = 1000;
+    std::string dir = "/tmp/journal_bm";
+
+    int c;
+    opterr = 0;
+    while ((c = getopt (argc, argv, "n:s:d:")) != -1) {
+        switch (c)
+        {
+            case 'n':
+                nlinks = atoi(optarg);
+                break;
+            case 's':
+                nsync = atoi(optarg);
+                break;
+            case 'd':
+                dir = optarg;
+                break;
+            default:
+                fprintf (stderr, "%s", usage);
+                exit(1);
+        }
+    }
+    remove_dir(dir);
+
+    // Each link is four atoms and one truth value.
+    size_t nchanges = 5 * nlinks;
+    auto nothing = []() {};
+
+    AtomSpace plain;
+    double t = secs([&]() { add_links(plain, 0, nlinks, nothing); });
+    report("no journal:", nchanges, t);
+
+    AtomSpace as;
+    {
+        AtomJournal journal(&as, dir);
+        journal.set_checkpoint_interval(std::chrono::seconds(0));
+
+        t = secs([&]() {
+            add_links(as, 0, nlinks, nothing);
+            journal.sync();
+        });
+        report("group commit:", nchanges, t);
+        printf("%-26s %8.1f MB, %.0f bytes per change\n", "journal size:",
+               journal.bytes_written() / 1e6,
+               journal.bytes_written() / (double) nchanges);
+
+        t = secs([&]() {
+            add_links(as, nlinks, nlinks + nsync,
+                      [&]() { journal.sync(); });
+        });
+        report("sync every link:", 5 * nsync, t);
+
+        t = secs([&]() { journal.checkpoint(); });
+        report("checkpoint:", as.get_size(), t);
+
+        // Touch a tenth of the links; the next checkpoint has just those.
+        size_t ntouch = nlinks / 10;
+        Handle pred = as.get_node(PREDICATE_NODE, "journal_bm");
+        IncomingSet evs(pred->getIncomingSet());
+        for (size_t i = 0; i < ntouch and i < evs.size(); i++)
+            evs[i]->setTruthValue(SimpleTruthValue::createTV(0.9, 0.9));
+        t = secs([&]() { journal.checkpoint(); });
+        report("incremental checkpoint:", ntouch, t);
+
+        add_links(as, nlinks + nsync, 2 * nlinks, nothing);
+    }
+
+    AtomSpace as2;
+    t = secs([&]() { AtomJournal recovered(&as2, dir); });
+    report("recovery:", as2.get_size(), t);
+
+    remove_dir(dir);
+    return 0;
+}
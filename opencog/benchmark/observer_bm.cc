@@ -0,0 +1,138 @@
+/*
+ * benchmark/observer_bm.cc
+ *
+ * Cost of the atomspace change signals, with and without observers.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License v3 as
+ * published by the Free Software Foundation and including the exceptions
+ * at http://opencog.org/wiki/Licenses
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, write to:
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <boost/signals2.hpp>
+
+#include <opencog/atoms/base/Node.h>
+#include <opencog/atomspace/AtomSpace.h>
+#include <opencog/atomspace/ObserverBus.h>
+
+using namespace opencog;
+
+static std::atomic<size_t> sink(0);
+
+static void observe(const Handle&) { sink.fetch_add(1, std::memory_order_relaxed); }
+
+static double ns_per(std::function<void(size_t)> body, size_t n)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < n; i++) body(i);
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / n;
+}
+
+// The bare cost of emitting one event, on the old and the new
+// signal types.
+static void bench_emit(size_t nobs, size_t n)
+{
+    Handle h(createNode(CONCEPT_NODE, "emit"));
+
+    boost::signals2::signal<void (const Handle&)> bsig;
+    for (size_t i = 0; i < nobs; i++) bsig.connect(observe);
+    double bns = ns_per([&](size_t) { bsig(h); }, n);
+
+    ObserverBus<const Handle&> bus;
+    for (size_t i = 0; i < nobs; i++) bus.connect(observe);
+    double ons = ns_per([&](size_t) { bus(h); }, n);
+
+    printf("  emit,    %2zu observers: boost::signals2 %8.1f ns  "
+           "ObserverBus %8.1f ns\n", nobs, bns, ons);
+}
+
+// The cost of adding a node to the atomspace, with observers on the
+// add signal.
+static void bench_add(size_t nobs, bool async, size_t n)
+{
+    std::vector<std::string> names;
+    for (size_t i = 0; i < n; i++) {
+        std::ostringstream oss;
+        oss << "node " << i;
+        names.push_back(oss.str());
+    }
+
+    AtomSpace as;
+    std::vector<ObserverConnection> conns;
+    for (size_t i = 0; i < nobs; i++)
+        conns.push_back(as.addAtomSignal(observe, async));
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < n; i++)
+        as.add_node(CONCEPT_NODE, names[i]);
+    auto end = std::chrono::steady_clock::now();
+    double ns = std::chrono::duration<double, std::nano>(end - start).count() / n;
+
+    // Don't leave the async workers running into the next round.
+    for (ObserverConnection& c : conns) c.disconnect();
+
+    printf("  add_node, %2zu %s observers: %8.1f ns per add\n",
+           nobs, async ? "async" : "sync ", ns);
+}
+
+int main(int argc, char** argv)
+{
+    const char* usage = "Cost of the AtomSpace change signals\n"
+     "Usage: observer_bm [options]\n"
+     "-n <int>  \tNumber of emits, or adds, per run (default: 1000000)\n"
+     "-N <int>  \tNumber of observers in the many-observer runs (default: 8)\n";
+
+    size_t n = 1000000;
+    size_t many = 8;
+
+    int c;
+    opterr = 0;
+    while ((c = getopt (argc, argv, "n:N:")) != -1) {
+        switch (c)
+        {
+            case 'n':
+                n = atoi(optarg);
+                break;
+            case 'N':
+                many = atoi(optarg);
+                break;
+            default:
+                fprintf (stderr, "%s", usage);
+                exit(1);
+        }
+    }
+
+    printf("Signal emit:\n");
+    for (size_t nobs : {(size_t) 0, (size_t) 1, many})
+        bench_emit(nobs, n);
+
+    printf("Atom add:\n");
+    for (size_t nobs : {(size_t) 0, (size_t) 1, many})
+        bench_add(nobs, false, n);
+    for (size_t nobs : {(size_t) 1, many})
+        bench_add(nobs, true, n);
+
+    return 0;
+}
@@ -0,0 +1,326 @@
+/*
+ * benchmark/parallel_bm.cc
+ *
+ * Multi-threaded AtomSpace benchmark.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License v3 as
+ * published by the Free Software Foundation and including the exceptions
+ * at http://opencog.org/wiki/Licenses
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, write to:
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include <opencog/atoms/base/FloatValue.h>
+#include <opencog/atoms/base/Link.h>
+#include <opencog/atoms/base/Node.h>
+#include <opencog/atomspace/AtomSpace.h>
+#include <opencog/truthvalue/SimpleTruthValue.h>
+
+using namespace opencog;
+
+// Each method is handed the atomspace, the thread number, the number
+// of threads, and the number of operations each thread should do.
+// The setup method (if any) is run once, single-threaded, before the
+// timer is started.
+struct ParallelMethod
+{
+    std::function<void(AtomSpace*, size_t, size_t)> setup;
+    std::function<void(AtomSpace*, size_t, size_t, size_t)> run;
+    std::string desc;
+};
+
+static std::string node_name(size_t thread, size_t i)
+{
+    std::ostringstream oss;
+    oss << "thread " << thread << " node " << i;
+    return oss.str();
+}
+
+// Pre-populate the atomspace with n nodes, shared by all threads.
+static void add_shared_nodes(AtomSpace* as, size_t nthreads, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+        as->add_node(CONCEPT_NODE, node_name(0, i));
+}
+
+// The nodes, and the key, for the value methods; looking them up by
+// name would cost more than getting or setting the value.
+static HandleSeq value_nodes;
+static Handle value_key;
+
+static void add_value_nodes(AtomSpace* as, size_t nthreads, size_t n)
+{
+    add_shared_nodes(as, nthreads, n);
+    value_key = as->add_node(PREDICATE_NODE, "feature vector");
+    value_nodes.clear();
+    for (size_t i = 0; i < n; i++)
+        value_nodes.push_back(as->get_handle(CONCEPT_NODE, node_name(0, i)));
+}
+
+static void add_values(AtomSpace* as, size_t nthreads, size_t n)
+{
+    add_value_nodes(as, nthreads, n);
+    for (size_t i = 0; i < n; i++)
+        value_nodes[i]->setValue(value_key,
+            createFloatValue(std::vector<double>({1.0, 2.0, 3.0, (double) i})));
+}
+
+// A few hot atoms, whose truth values every thread uses.
+static const size_t NUM_HOT = 4;
+static HandleSeq hot_nodes;
+
+static void add_hot_nodes(AtomSpace* as, size_t nthreads, size_t n)
+{
+    hot_nodes.clear();
+    for (size_t i = 0; i < NUM_HOT; i++) {
+        Handle h(as->add_node(CONCEPT_NODE, node_name(0, i)));
+        h->setTruthValue(SimpleTruthValue::createTV(0.5, 0.5));
+        hot_nodes.push_back(h);
+    }
+}
+
+static std::map<std::string, ParallelMethod> methods =
+{
+    {"addNode", {nullptr,
+        [](AtomSpace* as, size_t thr, size_t nthr, size_t n) {
+            for (size_t i = 0; i < n; i++)
+                as->add_node(CONCEPT_NODE, node_name(thr, i));
+        },
+        "Each thread adds distinct nodes"}},
+
+    {"addDupNode", {nullptr,
+        [](AtomSpace* as, size_t thr, size_t nthr, size_t n) {
+            for (size_t i = 0; i < n; i++)
+                as->add_node(CONCEPT_NODE, node_name(0, i));
+        },
+        "All threads add the same nodes"}},
+
+    {"addLink", {add_shared_nodes,
+        [](AtomSpace* as, size_t thr, size_t nthr, size_t n) {
+            for (size_t i = 0; i < n; i++) {
+                Handle ha(as->get_handle(CONCEPT_NODE, node_name(0, i)));
+                Handle hb(as->get_handle(CONCEPT_NODE,
+                                         node_name(0, (i + thr + 1) % n)));
+                as->add_link(LIST_LINK, ha, hb);
+            }
+        },
+        "Each thread adds links between shared nodes"}},
+
+    {"addBatch", {nullptr,
+        [](AtomSpace* as, size_t thr, size_t nthr, size_t n) {
+            const size_t batch_size = 1000;
+            HandleSeq batch;
+            for (size_t i = 0; i < n; i++) {
+                Handle h(createNode(CONCEPT_NODE, node_name(thr, i)));
+                batch.push_back(Handle(createLink(LIST_LINK, h)));
+                if (batch_size == batch.size() or i+1 == n) {
+                    as->add_atoms(batch);
+                    batch.clear();
+                }
+            }
+        },
+        "Each thread adds distinct links (and their nodes) with add_atoms"}},
+
+    {"getHandle", {add_shared_nodes,
+        [](AtomSpace* as, size_t thr, size_t nthr, size_t n) {
+            for (size_t i = 0; i < n; i++)
+                as->get_handle(CONCEPT_NODE, node_name(0, (i + thr) % n));
+        },
+        "Each thread looks up existing nodes"}},
+
+    {"getSize", {add_shared_nodes,
+        [](AtomSpace* as, size_t thr, size_t nthr, size_t n) {
+            for (size_t i = 0; i < n; i++) {
+                as->get_size();
+                as->get_num_atoms_of_type(CONCEPT_NODE);
+            }
+        },
+        "Each thread reads the atom counts"}},
+
+    {"addRemove", {nullptr,
+        [](AtomSpace* as, size_t thr, size_t nthr, size_t n) {
+            for (size_t i = 0; i < n; i++) {
+                Handle h(as->add_node(CONCEPT_NODE, node_name(thr, i)));
+                as->extract_atom(h);
+            }
+        },
+        "Each thread adds and then removes distinct nodes"}},
+
+    {"mixed", {add_shared_nodes,
+        [](AtomSpace* as, size_t thr, size_t nthr, size_t n) {
+            for (size_t i = 0; i < n; i++) {
+                if (i % 4 == 0)
+                    as->add_node(CONCEPT_NODE, node_name(thr + 1, i));
+                else
+                    as->get_handle(CONCEPT_NODE, node_name(0, (i + thr) % n));
+            }
+        },
+        "Three lookups for every add"}},
+
+    {"setValue", {add_value_nodes,
+        [](AtomSpace* as, size_t thr, size_t nthr, size_t n) {
+            ProtoAtomPtr fv(createFloatValue(
+                std::vector<double>({1.0, 2.0, 3.0, (double) thr})));
+            for (size_t i = 0; i < n; i++)
+                value_nodes[(i + thr) % n]->setValue(value_key, fv);
+        },
+        "Each thread sets values on shared nodes"}},
+
+    {"getValue", {add_values,
+        [](AtomSpace* as, size_t thr, size_t nthr, size_t n) {
+            for (size_t i = 0; i < n; i++)
+                value_nodes[(i + thr) % n]->getValue(value_key);
+        },
+        "Each thread gets values from shared nodes"}},
+
+    {"mixedValue", {add_values,
+        [](AtomSpace* as, size_t thr, size_t nthr, size_t n) {
+            ProtoAtomPtr fv(createFloatValue(
+                std::vector<double>({1.0, 2.0, 3.0, (double) thr})));
+            for (size_t i = 0; i < n; i++) {
+                const Handle& h(value_nodes[(i * 7 + thr) % n]);
+                if (i % 10 == 0)
+                    h->setValue(value_key, fv);
+                else
+                    h->getValue(value_key);
+            }
+        },
+        "Nine value gets for every set"}},
+
+    {"getTV", {add_hot_nodes,
+        [](AtomSpace* as, size_t thr, size_t nthr, size_t n) {
+            for (size_t i = 0; i < n; i++)
+                hot_nodes[(i + thr) % NUM_HOT]->getTruthValue();
+        },
+        "Each thread reads the truth values of a few hot atoms"}},
+
+    {"setTV", {add_hot_nodes,
+        [](AtomSpace* as, size_t thr, size_t nthr, size_t n) {
+            TruthValuePtr tv(SimpleTruthValue::createTV(0.1 * (thr % 10), 0.9));
+            for (size_t i = 0; i < n; i++)
+                hot_nodes[(i + thr) % NUM_HOT]->setTruthValue(tv);
+        },
+        "Each thread sets the truth values of a few hot atoms"}},
+
+    {"mergeTV", {add_hot_nodes,
+        [](AtomSpace* as, size_t thr, size_t nthr, size_t n) {
+            for (size_t i = 0; i < n; i++) {
+                const Handle& h(hot_nodes[(i + thr) % NUM_HOT]);
+                if (i % 10 == 0)
+                    h->merge(SimpleTruthValue::createTV(0.3, 0.01 * (i % 100)));
+                else
+                    h->getTruthValue();
+            }
+        },
+        "Nine truth value reads for every merge, on a few hot atoms"}},
+};
+
+static double run_method(const ParallelMethod& m, size_t nthreads, size_t n)
+{
+    AtomSpace as;
+    if (m.setup) m.setup(&as, nthreads, n);
+
+    std::vector<std::thread> pool;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t t = 0; t < nthreads; t++)
+        pool.push_back(std::thread(m.run, &as, t, nthreads, n));
+    for (std::thread& t : pool) t.join();
+    auto end = std::chrono::steady_clock::now();
+
+    return std::chrono::duration<double>(end - start).count();
+}
+
+int main(int argc, char** argv)
+{
+    const char* usage = "Multi-threaded benchmark for the OpenCog AtomSpace\n"
+     "Usage: parallel_bm [-m <method>] [options]\n"
+     "-m <methodname>\tMethod to benchmark (may be repeated)\n"
+     "-A        \tBenchmark all methods\n"
+     "-l        \tList valid method names to benchmark\n"
+     "-t <int>  \tMaximum number of threads; the thread count is doubled\n"
+     "          \tfrom one, up to this (default: hardware concurrency)\n"
+     "-n <int>  \tNumber of operations per thread (default: 100000)\n";
+
+    std::vector<std::string> todo;
+    size_t max_threads = std::thread::hardware_concurrency();
+    size_t nops = 100000;
+    if (0 == max_threads) max_threads = 1;
+
+    int c;
+    opterr = 0;
+    while ((c = getopt (argc, argv, "m:Alt:n:")) != -1) {
+        switch (c)
+        {
+            case 'm':
+                if (methods.find(optarg) == methods.end()) {
+                    std::cerr << "Unknown method " << optarg << std::endl;
+                    exit(1);
+                }
+                todo.push_back(optarg);
+                break;
+            case 'A':
+                for (const auto& pr : methods) todo.push_back(pr.first);
+                break;
+            case 'l':
+                for (const auto& pr : methods)
+                    std::cout << pr.first << "\t" << pr.second.desc << std::endl;
+                exit(0);
+            case 't':
+                max_threads = atoi(optarg);
+                break;
+            case 'n':
+                nops = atoi(optarg);
+                break;
+            default:
+                fprintf (stderr, "%s", usage);
+                exit(1);
+        }
+    }
+
+    if (todo.empty()) {
+        fprintf (stderr, "%s", usage);
+        exit(1);
+    }
+
+    for (const std::string& name : todo) {
+        const ParallelMethod& m = methods[name];
+        std::cout << "Benchmarking " << name << ": " << m.desc << std::endl;
+        std::vector<size_t> counts;
+        for (size_t nthr = 1; nthr < max_threads; nthr *= 2)
+            counts.push_back(nthr);
+        counts.push_back(max_threads);
+
+        double base = 0.0;
+        for (size_t nthr : counts) {
+            double secs = run_method(m, nthr, nops);
+            double rate = (nthr * nops) / secs;
+            if (1 == nthr) base = rate;
+            printf("  threads: %3zu  %10.3f secs  %12.0f ops/sec  speedup: %.2f\n",
+                   nthr, secs, rate, rate / base);
+        }
+        std::cout << "------------------------------" << std::endl;
+    }
+    return 0;
+}
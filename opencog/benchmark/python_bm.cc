@@ -0,0 +1,155 @@
+/*
+ * benchmark/python_bm.cc
+ *
+ * Evaluations of a "py:" GroundedPredicateNode per second, per thread,
+ * with the predicate run in-process, and in a pool of worker processes.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License v3 as
+ * published by the Free Software Foundation and including the exceptions
+ * at http://opencog.org/wiki/Licenses
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, write to:
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <opencog/atoms/execution/EvaluationLink.h>
+#include <opencog/atomspace/AtomSpace.h>
+#include <opencog/cython/PythonEval.h>
+
+using namespace opencog;
+
+// Evaluations per second, per thread.
+static double run_evals(AtomSpace* as, const Handle& evl,
+                        size_t nthreads, size_t n)
+{
+    std::vector<std::thread> pool;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t t = 0; t < nthreads; t++)
+        pool.push_back(std::thread([&]() {
+            for (size_t i = 0; i < n; i++)
+                EvaluationLink::do_evaluate(as, evl);
+        }));
+    for (std::thread& t : pool) t.join();
+    auto end = std::chrono::steady_clock::now();
+
+    return n / std::chrono::duration<double>(end - start).count();
+}
+
+static void run_all(AtomSpace* as, const Handle& evl,
+                    const std::vector<size_t>& counts, size_t n)
+{
+    for (size_t nthr : counts)
+        printf("  threads: %3zu  %10.0f evaluations/sec/thread\n",
+               nthr, run_evals(as, evl, nthr, n));
+}
+
+int main(int argc, char** argv)
+{
+    const char* usage = "Evaluations of a python predicate, per second "
+     "per thread\n"
+     "Usage: python_bm [options]\n"
+     "-t <int>  \tMaximum number of threads; the thread count is doubled\n"
+     "          \tfrom one, up to this (default: hardware concurrency)\n"
+     "-n <int>  \tNumber of evaluations per thread (default: 2000)\n"
+     "-k <int>  \tLoop iterations the predicate runs in python, per\n"
+     "          \tevaluation (default: 1000)\n"
+     "-w <int>  \tWorker processes for the pool (default: -t)\n";
+
+    size_t max_threads = std::thread::hardware_concurrency();
+    size_t nevals = 2000;
+    size_t work = 1000;
+    size_t workers = 0;
+    if (0 == max_threads) max_threads = 1;
+
+    int c;
+    opterr = 0;
+    while ((c = getopt (argc, argv, "t:n:k:w:")) != -1) {
+        switch (c)
+        {
+            case 't':
+                max_threads = atoi(optarg);
+                break;
+            case 'n':
+                nevals = atoi(optarg);
+                break;
+            case 'k':
+                work = atoi(optarg);
+                break;
+            case 'w':
+                workers = atoi(optarg);
+                break;
+            default:
+                fprintf (stderr, "%s", usage);
+                exit(1);
+        }
+    }
+    if (0 == workers) workers = max_threads;
+
+    // The worker processes can only see predicates that are in a
+    // module, so the predicate is written to one.
+    char dir[] = "/tmp/python_bm.XXXXXX";
+    if (nullptr == mkdtemp(dir)) {
+        perror("python_bm: mkdtemp");
+        exit(1);
+    }
+    std::string module(std::string(dir) + "/python_bm_pred.py");
+    FILE* f = fopen(module.c_str(), "w");
+    if (nullptr == f) {
+        perror("python_bm: fopen");
+        exit(1);
+    }
+    fprintf(f,
+        "from opencog.atomspace import TruthValue\n"
+        "def bm_pred(atom):\n"
+        "    x = 0\n"
+        "    for i in xrange(%zu):\n"
+        "        x += i * i\n"
+        "    return TruthValue(1.0, 1.0)\n", work);
+    fclose(f);
+
+    AtomSpace as;
+    PythonEval& python = PythonEval::instance(&as);
+    python.apply_script(
+        "import sys\n"
+        "sys.dont_write_bytecode = True\n"
+        "sys.path.insert(0, '" + std::string(dir) + "')\n"
+        "import python_bm_pred\n");
+
+    Handle evl(as.add_link(EVALUATION_LINK,
+        as.add_node(GROUNDED_PREDICATE_NODE, "py: python_bm_pred.bm_pred"),
+        as.add_link(LIST_LINK, as.add_node(CONCEPT_NODE, "bm arg"))));
+
+    std::vector<size_t> counts;
+    for (size_t nthr = 1; nthr < max_threads; nthr *= 2)
+        counts.push_back(nthr);
+    counts.push_back(max_threads);
+
+    printf("in-process:\n");
+    run_all(&as, evl, counts, nevals);
+
+    python.set_worker_processes(workers);
+    printf("pool of %zu worker processes:\n", workers);
+    run_all(&as, evl, counts, nevals);
+    python.set_worker_processes(0);
+
+    unlink(module.c_str());
+    rmdir(dir);
+    return 0;
+}
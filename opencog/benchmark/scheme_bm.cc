@@ -0,0 +1,127 @@
+/*
+ * benchmark/scheme_bm.cc
+ *
+ * Calls into scheme per second, per thread, the way that the pattern
+ * matcher makes them: by evaluating a string, by applying a function
+ * by name, and by executing an ExecutionOutputLink with a grounded
+ * schema.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License v3 as
+ * published by the Free Software Foundation and including the exceptions
+ * at http://opencog.org/wiki/Licenses
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, write to:
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#include <opencog/atoms/execution/ExecutionOutputLink.h>
+#include <opencog/atomspace/AtomSpace.h>
+#include <opencog/guile/SchemeEval.h>
+
+using namespace opencog;
+
+// Each call is handed the atomspace and the evaluator of its thread,
+// and the arguments to pass.
+typedef std::function<void(AtomSpace*, SchemeEval*, const Handle&)> Call;
+
+static Handle schema;
+
+static const std::vector<std::pair<const char*, Call>> calls =
+{
+    {"eval", [](AtomSpace* as, SchemeEval* ev, const Handle& args) {
+        ev->eval_h("(bm-identity (ConceptNode \"bm arg\"))");
+    }},
+    {"apply", [](AtomSpace* as, SchemeEval* ev, const Handle& args) {
+        ev->apply("bm-identity", args);
+    }},
+    {"execute", [](AtomSpace* as, SchemeEval* ev, const Handle& args) {
+        ExecutionOutputLink::do_execute(as, schema, args);
+    }},
+};
+
+// Calls per second, per thread.
+static double run_calls(AtomSpace* as, const Call& call,
+                        size_t nthreads, size_t n)
+{
+    Handle args(as->add_link(LIST_LINK,
+                             as->add_node(CONCEPT_NODE, "bm arg")));
+
+    std::vector<std::thread> pool;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t t = 0; t < nthreads; t++)
+        pool.push_back(std::thread([&]() {
+            SchemeEval* ev = SchemeEval::get_evaluator(as);
+            for (size_t i = 0; i < n; i++) call(as, ev, args);
+        }));
+    for (std::thread& t : pool) t.join();
+    auto end = std::chrono::steady_clock::now();
+
+    return n / std::chrono::duration<double>(end - start).count();
+}
+
+int main(int argc, char** argv)
+{
+    const char* usage = "Calls into scheme, per second per thread\n"
+     "Usage: scheme_bm [options]\n"
+     "-t <int>  \tMaximum number of threads; the thread count is doubled\n"
+     "          \tfrom one, up to this (default: hardware concurrency)\n"
+     "-n <int>  \tNumber of calls per thread (default: 100000)\n";
+
+    size_t max_threads = std::thread::hardware_concurrency();
+    size_t ncalls = 100000;
+    if (0 == max_threads) max_threads = 1;
+
+    int c;
+    opterr = 0;
+    while ((c = getopt (argc, argv, "t:n:")) != -1) {
+        switch (c)
+        {
+            case 't':
+                max_threads = atoi(optarg);
+                break;
+            case 'n':
+                ncalls = atoi(optarg);
+                break;
+            default:
+                fprintf (stderr, "%s", usage);
+                exit(1);
+        }
+    }
+
+    AtomSpace as;
+    SchemeEval::prewarm(max_threads);
+    SchemeEval* ev = SchemeEval::get_evaluator(&as);
+    ev->eval("(use-modules (opencog))");
+    ev->eval("(define (bm-identity x) x)");
+    schema = as.add_node(GROUNDED_SCHEMA_NODE, "scm: bm-identity");
+
+    std::vector<size_t> counts;
+    for (size_t nthr = 1; nthr < max_threads; nthr *= 2)
+        counts.push_back(nthr);
+    counts.push_back(max_threads);
+
+    for (const auto& pr : calls) {
+        printf("%s:\n", pr.first);
+        for (size_t nthr : counts)
+            printf("  threads: %3zu  %10.0f calls/sec/thread\n",
+                   nthr, run_calls(&as, pr.second, nthr, ncalls));
+    }
+    return 0;
+}
@@ -0,0 +1,141 @@
+/*
+ * benchmark/serial_bm.cc
+ *
+ * Throughput of the binary atom format, against s-expressions, when
+ * writing atoms out and reading them back in.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License v3 as
+ * published by the Free Software Foundation and including the exceptions
+ * at http://opencog.org/wiki/Licenses
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, write to:
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <functional>
+#include <string>
+
+#include <opencog/atomspace/AtomSpace.h>
+#include <opencog/atomspaceutils/LoadAtomese.h>
+#include <opencog/persist/serial/AtomDecoder.h>
+#include <opencog/persist/serial/AtomEncoder.h>
+#include <opencog/truthvalue/SimpleTruthValue.h>
+
+using namespace opencog;
+
+static double secs(const std::function<void(void)>& fn)
+{
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(end - start).count();
+}
+
+static void report(const char* what, size_t natoms, size_t nbytes, double t)
+{
+    printf("%-22s %10zu atoms %12.0f atoms/sec %8.1f MB/sec\n",
+           what, natoms, natoms / t, nbytes / t / 1e6);
+}
+
+int main(int argc, char** argv)
+{
+    const char* usage = "Write and read atoms, as binary and as s-expressions\n"
+     "Usage: serial_bm [options]\n"
+     "-n <int>  \tNumber of links to write (default: 200000)\n"
+     "-b <int>  \tBinary block size, in bytes (default: 65536)\n";
+
+    size_t nlinks = 200000;
+    size_t block_size = 64 * 1024;
+
+    int c;
+    opterr = 0;
+    while ((c = getopt (argc, argv, "n:b:")) != -1) {
+        switch (c)
+        {
+            case 'n':
+                nlinks = atoi(optarg);
+                break;
+            case 'b':
+                block_size = atoi(optarg);
+                break;
+            default:
+                fprintf (stderr, "%s", usage);
+                exit(1);
+        }
+    }
+
+    // Links of the usual shape: a predicate, and a list of two concepts.
+    AtomSpace as;
+    HandleSeq links;
+    Handle pred = as.add_node(PREDICATE_NODE, "serial_bm");
+    for (size_t i = 0; i < nlinks; i++)
+    {
+        Handle l = as.add_link(EVALUATION_LINK, pred,
+            as.add_link(LIST_LINK,
+                as.add_node(CONCEPT_NODE, std::to_string(i)),
+                as.add_node(CONCEPT_NODE, std::to_string(i / 2))));
+        l->setTruthValue(SimpleTruthValue::createTV(0.5, i / (double) nlinks));
+        links.push_back(l);
+    }
+    size_t natoms = as.get_size();
+    printf("%zu links, %zu atoms in all\n\n", nlinks, natoms);
+
+    // s-expressions, as the guile dumps write them.
+    std::string text;
+    double t = secs([&]() {
+        for (const Handle& h : links)
+            text += h->toShortString();
+    });
+    report("s-expression write:", natoms, text.size(), t);
+
+    AtomSpace as_text;
+    t = secs([&]() { load_atomese(as_text, text); });
+    report("s-expression read:", as_text.get_size(), text.size(), t);
+
+    // The binary format, a block at a time.
+    std::string bytes;
+    t = secs([&]() {
+        AtomEncoder enc([&](const std::string& block) { bytes += block; },
+                        block_size);
+        enc.add(links);
+    });
+    report("binary write:", natoms, bytes.size(), t);
+
+    size_t ndecoded = 0;
+    t = secs([&]() {
+        AtomDecoder dec([&](AtomDecoder::Block& block) {
+            ndecoded += block.atoms.size();
+        });
+        dec.feed(bytes);
+        dec.finish();
+    });
+    report("binary decode only:", ndecoded, bytes.size(), t);
+
+    AtomSpace as_bin;
+    t = secs([&]() {
+        AtomDecoder dec([&](AtomDecoder::Block& block) {
+            AtomDecoder::add_to(as_bin, block);
+        });
+        dec.feed(bytes);
+        dec.finish();
+    });
+    report("binary read:", as_bin.get_size(), bytes.size(), t);
+
+    printf("\ns-expressions: %zu bytes; binary: %zu bytes (%.0f%%)\n",
+           text.size(), bytes.size(), 100.0 * bytes.size() / text.size());
+
+    return 0;
+}
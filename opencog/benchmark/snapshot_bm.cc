@@ -0,0 +1,125 @@
+/*
+ * benchmark/snapshot_bm.cc
+ *
+ * How long it takes to save an atomspace to a snapshot file, and to
+ * load it back, compared to loading the same atoms as s-expressions.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License v3 as
+ * published by the Free Software Foundation and including the exceptions
+ * at http://opencog.org/wiki/Licenses
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, write to:
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <functional>
+#include <string>
+
+#include <opencog/atomspace/AtomSpace.h>
+#include <opencog/atomspaceutils/LoadAtomese.h>
+#include <opencog/truthvalue/SimpleTruthValue.h>
+
+using namespace opencog;
+
+static double secs(const std::function<void(void)>& fn)
+{
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(end - start).count();
+}
+
+static void report(const char* what, size_t natoms, double t)
+{
+    printf("%-22s %8.2f sec  %8.2f sec per million atoms\n",
+           what, t, t * 1e6 / natoms);
+}
+
+int main(int argc, char** argv)
+{
+    const char* usage = "Save and load atomspace snapshots\n"
+     "Usage: snapshot_bm [options]\n"
+     "-n <int>  \tNumber of links (default: 1000000); there are\n"
+     "          \tabout three atoms per link\n"
+     "-f <file> \tSnapshot file (default: /tmp/snapshot_bm.snap)\n"
+     "-s        \tAlso time loading the same atoms as s-expressions\n";
+
+    size_t nlinks = 1000000;
+    std::string path = "/tmp/snapshot_bm.snap";
+    bool sexpr = false;
+
+    int c;
+    opterr = 0;
+    while ((c = getopt (argc, argv, "n:f:s")) != -1) {
+        switch (c)
+        {
+            case 'n':
+                nlinks = atoi(optarg);
+                break;
+            case 'f':
+                path = optarg;
+                break;
+            case 's':
+                sexpr = true;
+                break;
+            default:
+                fprintf (stderr, "%s", usage);
+                exit(1);
+        }
+    }
+
+    // Links of the usual shape: a predicate, and a list of two concepts.
+    AtomSpace as;
+    Handle pred = as.add_node(PREDICATE_NODE, "snapshot_bm");
+    HandleSeq links;
+    for (size_t i = 0; i < nlinks; i++)
+    {
+        Handle l = as.add_link(EVALUATION_LINK, pred,
+            as.add_link(LIST_LINK,
+                as.add_node(CONCEPT_NODE, std::to_string(i)),
+                as.add_node(CONCEPT_NODE, std::to_string(i / 2))));
+        l->setTruthValue(SimpleTruthValue::createTV(0.5, i / (double) nlinks));
+        links.push_back(l);
+    }
+    size_t natoms = as.get_size();
+    printf("%zu atoms\n\n", natoms);
+
+    double t = secs([&]() { as.save_snapshot(path); });
+    report("save_snapshot:", natoms, t);
+
+    struct stat st;
+    stat(path.c_str(), &st);
+
+    AtomSpace as2;
+    t = secs([&]() { as2.load_snapshot(path); });
+    report("load_snapshot:", as2.get_size(), t);
+    printf("%-22s %8.1f MB, %.0f bytes per atom\n", "snapshot size:",
+           st.st_size / 1e6, st.st_size / (double) natoms);
+
+    if (sexpr)
+    {
+        std::string text;
+        for (const Handle& h : links)
+            text += h->toShortString();
+        AtomSpace as3;
+        t = secs([&]() { load_atomese(as3, text); });
+        report("load_atomese:", as3.get_size(), t);
+    }
+
+    unlink(path.c_str());
+    return 0;
+}
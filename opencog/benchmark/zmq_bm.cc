@@ -0,0 +1,156 @@
+/*
+ * benchmark/zmq_bm.cc
+ *
+ * Round-trip throughput of the ZeroMQ backing store, against a server
+ * running in the same process, so that no network is involved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License v3 as
+ * published by the Free Software Foundation and including the exceptions
+ * at http://opencog.org/wiki/Licenses
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, write to:
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <opencog/atomspace/AtomSpace.h>
+#include <opencog/atomspace/AtomTable.h>
+#include <opencog/persist/zmq/atomspace/ZMQClient.h>
+#include <opencog/persist/zmq/atomspace/ZMQServer.h>
+
+using namespace opencog;
+
+static double secs(const std::function<void(void)>& fn)
+{
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(end - start).count();
+}
+
+int main(int argc, char** argv)
+{
+    const char* usage = "Round trips to an in-process ZeroMQ backing store\n"
+     "Usage: zmq_bm [options]\n"
+     "-n <int>  \tNumber of atoms to store (default: 100000)\n"
+     "-b <int>  \tAtoms per store message (default: 1000)\n"
+     "-p <int>  \tRequests in flight at once (default: 64)\n"
+     "-t <int>  \tThreads making single fetches (default: 4)\n"
+     "-a <addr> \tAddress to serve on, and connect to\n"
+     "          \t(default: inproc://zmq_bm; ipc:// also works)\n";
+
+    size_t natoms = 100000;
+    size_t batch = 1000;
+    size_t in_flight = 64;
+    size_t nthreads = 4;
+    std::string address = "inproc://zmq_bm";
+
+    int c;
+    opterr = 0;
+    while ((c = getopt (argc, argv, "n:b:p:t:a:")) != -1) {
+        switch (c)
+        {
+            case 'n':
+                natoms = atoi(optarg);
+                break;
+            case 'b':
+                batch = atoi(optarg);
+                break;
+            case 'p':
+                in_flight = atoi(optarg);
+                break;
+            case 't':
+                nthreads = atoi(optarg);
+                break;
+            case 'a':
+                address = optarg;
+                break;
+            default:
+                fprintf (stderr, "%s", usage);
+                exit(1);
+        }
+    }
+
+    AtomSpace server_as;
+    ZMQServer server(&server_as, address);
+    ZMQClient client(address, server.context());
+    client.set_max_in_flight(in_flight);
+
+    AtomSpace as;
+    HandleSeq atoms;
+    for (size_t i = 0; i < natoms; i++)
+        atoms.push_back(as.add_link(LIST_LINK,
+            as.add_node(CONCEPT_NODE, std::to_string(i)),
+            as.add_node(PREDICATE_NODE, "zmq_bm")));
+
+    // One message, and one round trip, per atom.
+    size_t nsync = std::min<size_t>(natoms, 10000);
+    double t = secs([&]() {
+        for (size_t i = 0; i < nsync; i++)
+            client.storeAtom(atoms[i], true);
+    });
+    printf("synchronous store:  %10zu atoms  %12.0f atoms/sec\n",
+           nsync, nsync / t);
+
+    // Batched and pipelined.
+    server_as.clear();
+    client.set_batch_size(batch);
+    t = secs([&]() {
+        for (const Handle& h : atoms)
+            client.storeAtom(h);
+        client.flushStoreQueue();
+    });
+    printf("batched store:      %10zu atoms  %12.0f atoms/sec  "
+           "(%zu per message)\n", natoms, natoms / t, batch);
+
+    // Single fetches, from several threads, all on the one connection.
+    size_t nfetch = std::min<size_t>(natoms, 10000);
+    for (size_t nthr = 1; nthr <= nthreads; nthr *= 2)
+    {
+        std::vector<std::thread> pool;
+        t = secs([&]() {
+            for (size_t n = 0; n < nthr; n++)
+                pool.push_back(std::thread([&, n]() {
+                    for (size_t i = n; i < nfetch; i += nthr)
+                        client.getNode(CONCEPT_NODE, std::to_string(i).c_str());
+                }));
+            for (std::thread& th : pool) th.join();
+        });
+        printf("getNode, %2zu threads: %8zu fetches %12.0f fetches/sec\n",
+               nthr, nfetch, nfetch / t);
+    }
+
+    // Bulk fetches.
+    AtomTable table;
+    t = secs([&]() { client.loadType(table, LIST_LINK); });
+    printf("loadType:           %10zu atoms  %12.0f atoms/sec\n",
+           table.getSize(), table.getSize() / t);
+
+    AtomTable table2;
+    HandleSeq nodes;
+    for (size_t i = 0; i < nfetch; i++)
+        nodes.push_back(table2.add(
+            createNode(CONCEPT_NODE, std::to_string(i)), false));
+    t = secs([&]() { client.getIncomingSets(table2, nodes); });
+    printf("getIncomingSets:    %10zu sets   %12.0f sets/sec\n",
+           nfetch, nfetch / t);
+
+    return 0;
+}
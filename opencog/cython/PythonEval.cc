@@ -369,6 +369,8 @@ PythonEval::PythonEval(AtomSpace* atomspace)
     // Remember our atomspace.
     _atomspace = atomspace;
     _paren_count = 0;
+    _worker_processes = 0;
+    _pyPool = nullptr;
 
     // Initialize Python objects and imports.
     //
@@ -391,6 +393,14 @@ PythonEval::~PythonEval()
     PyGILState_STATE gstate;
     gstate = PyGILState_Ensure();
 
+    // Stop the worker pool, if any.
+    if (_pyPool) {
+        PyObject* pyResult = PyObject_CallMethod(_pyPool, (char*) "stop", NULL);
+        if (pyResult) Py_DECREF(pyResult);
+        else PyErr_Clear();
+        Py_DECREF(_pyPool);
+    }
+
     // Decrement reference counts for instance Python object references.
     Py_DECREF(_pyGlobal);
     Py_DECREF(_pyLocal);
@@ -694,6 +704,16 @@ PyObject* PythonEval::module_for_function(const std::string& moduleFunction,
             pyModule = _modules[moduleName];
         }
 
+        // ... or it might have been imported some other way, from
+        // anywhere on sys.path.
+        if (nullptr == pyModule) {
+            pyModule = PyDict_GetItemString(PyImport_GetModuleDict(),
+                                            moduleName.c_str());
+            // Borrowed; _modules keeps a reference of its own.
+            Py_XINCREF(pyModule);
+            _modules[moduleName] = pyModule;
+        }
+
         // If found, we are done.
         if (pyModule) {
             functionName = moduleFunction.substr(index+1);
@@ -706,15 +726,15 @@ PyObject* PythonEval::module_for_function(const std::string& moduleFunction,
 
 /**
  * Call the user defined function with the arguments passed in the
- * ListLink handle 'arguments'.
+ * ListLink handle 'arguments', working in the atomspace `as`.  If
+ * `pooled`, the function is called in one of the worker processes.
  *
  * On error throws an exception.
  */
 PyObject* PythonEval::call_user_function(const std::string& moduleFunction,
-                                         Handle arguments)
+                                         Handle arguments, AtomSpace* as,
+                                         bool pooled)
 {
-    std::lock_guard<std::recursive_mutex> lck(_mtx);
-
     // Grab the GIL.
     PyGILState_STATE gstate = PyGILState_Ensure();
 
@@ -787,7 +807,7 @@ PyObject* PythonEval::call_user_function(const std::string& moduleFunction,
     // Create the Python tuple for the function call with python
     // atoms for each of the atoms in the link arguments.
     PyObject* pyArguments = PyTuple_New(actualArgumentCount);
-    PyObject* pyAtomSpace = this->atomspace_py_object(_atomspace);
+    PyObject* pyAtomSpace = this->atomspace_py_object(as ? as : _atomspace);
     const HandleSeq& argumentHandles = arguments->getOutgoingSet();
     int tupleItem = 0;
     for (const Handle& h: argumentHandles)
@@ -806,7 +826,12 @@ PyObject* PythonEval::call_user_function(const std::string& moduleFunction,
     Py_DECREF(pyAtomSpace);
 
     // Execute the user function and store its return value.
-    PyObject* pyReturnValue = PyObject_CallObject(pyUserFunc, pyArguments);
+    PyObject* pyReturnValue;
+    if (pooled)
+        pyReturnValue = PyObject_CallMethod(_pyPool, (char*) "apply_tv",
+                (char*) "sO", moduleFunction.c_str(), pyArguments);
+    else
+        pyReturnValue = PyObject_CallObject(pyUserFunc, pyArguments);
 
     // Cleanup the reference counts for Python objects we no longer reference.
     // Since we promoted the borrowed pyExecuteUserFunc reference, we need
@@ -835,11 +860,8 @@ PyObject* PythonEval::call_user_function(const std::string& moduleFunction,
 
 Handle PythonEval::apply(AtomSpace* as, const std::string& func, Handle varargs)
 {
-    std::lock_guard<std::recursive_mutex> lck(_mtx);
-    RAII raii(this, as);
-
     // Get the atom object returned by this user function.
-    PyObject* pyReturnAtom = this->call_user_function(func, varargs);
+    PyObject* pyReturnAtom = this->call_user_function(func, varargs, as);
 
     // If we got a non-null atom were no errors.
     if (pyReturnAtom) {
@@ -887,11 +909,9 @@ Handle PythonEval::apply(AtomSpace* as, const std::string& func, Handle varargs)
  */
 TruthValuePtr PythonEval::apply_tv(AtomSpace *as, const std::string& func, Handle varargs)
 {
-    std::lock_guard<std::recursive_mutex> lck(_mtx);
-    RAII raii(this, as);
-
     // Get the python truth value object returned by this user function.
-    PyObject *pyTruthValue = call_user_function(func, varargs);
+    PyObject *pyTruthValue = call_user_function(func, varargs, as,
+                                                0 < _worker_processes);
 
     // If we got a non-null truth value there were no errors.
     if (NULL == pyTruthValue)
@@ -945,8 +965,6 @@ TruthValuePtr PythonEval::apply_tv(AtomSpace *as, const std::string& func, Handl
 void PythonEval::apply_as(const std::string& moduleFunction,
                           AtomSpace* as_argument)
 {
-    std::lock_guard<std::recursive_mutex> lck(_mtx);
-
     PyObject *pyError, *pyModule, *pyUserFunc;
     PyObject *pyDict;
     std::string functionName;
@@ -1050,8 +1068,6 @@ void PythonEval::apply_as(const std::string& moduleFunction,
 
 std::string PythonEval::apply_script(const std::string& script)
 {
-    std::lock_guard<std::recursive_mutex> lck(_mtx);
-
     // Grab the GIL
     PyGILState_STATE gstate = PyGILState_Ensure();
 
@@ -1082,6 +1098,37 @@ std::string PythonEval::apply_script(const std::string& script)
     return "";
 }
 
+void PythonEval::set_worker_processes(unsigned n)
+{
+    std::lock_guard<std::recursive_mutex> lck(_mtx);
+
+    // Grab the GIL.
+    PyGILState_STATE gstate = PyGILState_Ensure();
+
+    if (nullptr == _pyPool)
+        _pyPool = PyImport_ImportModule("opencog.grounded_pool");
+
+    // Calls already on their way to the old pool fail, if it is
+    // stopped under them.
+    _worker_processes = 0;
+    PyObject* pyResult = nullptr;
+    if (_pyPool)
+        pyResult = PyObject_CallMethod(_pyPool, (char*) "start",
+                                       (char*) "I", n);
+
+    if (nullptr == pyResult) {
+        std::string errorString;
+        this->build_python_error_message("set_worker_processes", errorString);
+        PyGILState_Release(gstate);
+        throw RuntimeException(TRACE_INFO, "%s", errorString.c_str());
+    }
+    Py_DECREF(pyResult);
+    _worker_processes = n;
+
+    // Release the GIL. No Python API allowed beyond this point.
+    PyGILState_Release(gstate);
+}
+
 void PythonEval::add_to_sys_path(std::string path)
 {
     PyObject* pyPathString = PyBytes_FromString(path.c_str());
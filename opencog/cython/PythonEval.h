@@ -40,6 +40,7 @@
 
 #include "PyIncludeWrapper.h"
 
+#include <atomic>
 #include <condition_variable>
 #include <map>
 #include <mutex>
@@ -77,7 +78,8 @@ class PythonEval : public GenericEval
 
         // Python utility functions
         PyObject* call_user_function(const std::string& func,
-                                     Handle varargs);
+                                     Handle varargs, AtomSpace*,
+                                     bool pooled = false);
         void build_python_error_message(const char* function_name,
                                         std::string& errorMessage);
         void add_to_sys_path(std::string path);
@@ -91,30 +93,22 @@ class PythonEval : public GenericEval
         static PythonEval* singletonInstance;
 
         AtomSpace* _atomspace;
-        // Resource Acquisition is Allocation, for the current AtomSpace.
-        // If anything throws an exception, then dtor runs and restores
-        // the old atomspace.
-        struct RAII {
-            RAII(PythonEval* pev, AtomSpace* as) : _pev(pev)
-               { _save_as = pev->_atomspace; pev->_atomspace = as; }
-            ~RAII() {_pev->_atomspace = _save_as; }
-            AtomSpace* _save_as;
-            PythonEval* _pev;
-        };
-
-        // Single, global mutex for serializing access to the atomspace.
-        // The singleton-instance design of this class forces us to
-        // serialize access (the GIL is not enough), because there is
-        // no way to guarantee that python won't accidentally be called
-        // from multiple threads.  That's because the EvaluationLink
-        // is called from scheme and from the pattern matcher, and its
-        // unknown how many threads those things might be running in.
-        // The lock is recursive, because we may need to use multiple
-        // different atomspaces with the evaluator, in some nested
-        // fashion. So this lock prevents other threads from using the
-        // wrong atomspace in some other thread.  Quite unfortunate.
+
+        // Calls into python take no lock of their own; the GIL is
+        // enough.  Each call is handed the atomspace to work in, so
+        // that threads using different atomspaces don't get in each
+        // other's way, and a call can be nested inside another one,
+        // made from the same thread.  The Cython bindings release the
+        // GIL while in the atomspace, so that other threads can run
+        // python meanwhile.  This lock only serializes the starting
+        // and stopping of the worker pool.
         static std::recursive_mutex _mtx;
 
+        // Number of worker processes that "py:" predicates are
+        // evaluated in; zero, if they are evaluated in-process.
+        std::atomic<unsigned> _worker_processes;
+        PyObject* _pyPool;
+
         // Computed results are typically polled in a distinct thread.
         bool _eval_done;
         std::mutex _poll_mtx;
@@ -182,6 +176,20 @@ class PythonEval : public GenericEval
          */
         TruthValuePtr apply_tv(AtomSpace*, const std::string& func, Handle varargs);
 
+        /**
+         * Evaluate the functions given to apply_tv() in a pool of
+         * `n` worker processes, instead of in this process, so that
+         * they can run in parallel, in spite of the GIL.  Each worker
+         * has its own atomspace, which the arguments are copied into,
+         * values and all; only functions that compute a truth value
+         * from their arguments, without changing the atomspace, should
+         * be run this way.  The workers only see functions that are in
+         * a module ("py:module.function"); calling one in __main__
+         * throws.  Zero stops the pool.  See grounded_pool.py.
+         */
+        void set_worker_processes(unsigned n);
+        unsigned get_worker_processes() const { return _worker_processes; }
+
         /**
          * Calls the Python function passed in `func`, passing it
          * the AtomSpace as an argument, returning void.
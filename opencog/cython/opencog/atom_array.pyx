@@ -0,0 +1,180 @@
+from cpython cimport array
+import array
+
+# Bulk access to many atoms at once, for numpy and the like.  The
+# accessors fill flat arrays (of the standard array module, which
+# exports the buffer protocol) directly from C++; no Python object is
+# made for any atom.  numpy.asarray() or numpy.frombuffer() wrap the
+# results without copying them, and the setters take any contiguous
+# buffer of the right item type, such as a numpy array.
+
+# Templates for the result arrays; array.clone() makes new arrays of
+# the same type, without initializing them.
+cdef array.array _ids_template = array.array('L')
+cdef array.array _types_template = array.array('h')
+cdef array.array _floats_template = array.array('f')
+cdef array.array _doubles_template = array.array('d')
+cdef array.array _offsets_template = array.array('l')
+
+cdef class AtomArray:
+    """ A fixed sequence of atoms, held in C++, with bulk accessors
+    for their ids, types, truth values and FloatValues.  Get one from
+    AtomSpace.get_atom_array(), or make one from a list of Atoms.
+
+    Example:
+        atoms = atomspace.get_atom_array(types.ConceptNode)
+        tvs = numpy.frombuffer(atoms.tvs(), dtype=numpy.float32)
+        tvs = tvs.reshape(-1, 2)     # rows of (strength, confidence)
+        tvs[:, 1] *= 0.9
+        atoms.set_tvs(tvs.ravel())
+    """
+    # these are defined in atomspace.pxd:
+    #cdef vector[cHandle] handles
+    #cdef AtomSpace atomspace
+
+    def __init__(self, atoms=None, AtomSpace atomspace=None):
+        self.atomspace = atomspace
+        if atoms is None:
+            return
+        for atom in atoms:
+            if not isinstance(atom, Atom):
+                raise TypeError("AtomArray needs Atom objects")
+            self.handles.push_back(deref((<Atom>atom).handle))
+            if self.atomspace is None:
+                self.atomspace = (<Atom>atom).atomspace
+
+    def __len__(self):
+        return self.handles.size()
+
+    def __getitem__(self, long i):
+        cdef long n = self.handles.size()
+        if i < 0:
+            i += n
+        if i < 0 or i >= n:
+            raise IndexError("AtomArray index out of range")
+        return Atom(void_from_candle(self.handles[i]), self.atomspace)
+
+    def atoms(self):
+        """ The atoms, as a list of Atom objects """
+        return convert_handle_seq_to_python_list(self.handles, self.atomspace)
+
+    cdef cAtom* _atom(self, size_t i) except NULL:
+        cdef cAtom* atom_ptr = self.handles[i].atom_ptr()
+        if atom_ptr == NULL:
+            raise ValueError("AtomArray holds an invalid atom at %d" % i)
+        return atom_ptr
+
+    cdef size_t _check_size(self, size_t have, size_t per_atom, what) except? 0:
+        if have != per_atom * self.handles.size():
+            raise ValueError("%s: expecting %d items, got %d" %
+                             (what, per_atom * self.handles.size(), have))
+        return have
+
+    def ids(self):
+        """ The content hash of each atom, as unsigned longs """
+        cdef size_t i, n = self.handles.size()
+        cdef array.array result = array.clone(_ids_template, n, False)
+        cdef unsigned long* out = result.data.as_ulongs
+        for i in range(n):
+            out[i] = self.handles[i].value()
+        return result
+
+    def types(self):
+        """ The type of each atom, as shorts """
+        cdef size_t i, n = self.handles.size()
+        cdef array.array result = array.clone(_types_template, n, False)
+        cdef short* out = result.data.as_shorts
+        for i in range(n):
+            out[i] = self._atom(i).getType()
+        return result
+
+    def tvs(self):
+        """ The strength and confidence of each atom, interleaved, as
+        2 * len(self) floats """
+        cdef size_t i, n = self.handles.size()
+        cdef array.array result = array.clone(_floats_template, 2 * n, False)
+        cdef float* out = result.data.as_floats
+        cdef strength_t mean
+        cdef confidence_t conf
+        for i in range(n):
+            self._atom(i).getTruthValuePair(mean, conf)
+            out[2 * i] = mean
+            out[2 * i + 1] = conf
+        return result
+
+    def set_tvs(self, const float[::1] tvs):
+        """ Set the simple truth value of each atom, from the strength
+        and confidence pairs, interleaved, as tvs() gives them """
+        self._check_size(tvs.shape[0], 2, "set_tvs")
+        cdef size_t i, n = self.handles.size()
+        for i in range(n):
+            self._atom(i).setTruthValue(
+                tv_ptr(new cSimpleTruthValue(tvs[2 * i], tvs[2 * i + 1])))
+
+    def float_values(self, Atom key):
+        """ The FloatValue that each atom holds at the key, all in one
+        array of doubles, and the offsets of each atom's values in it,
+        as len(self) + 1 longs.  The values of atom i are
+        values[offsets[i]:offsets[i+1]]; atoms with no FloatValue at
+        the key have none. """
+        cdef size_t i, n = self.handles.size()
+        cdef array.array offsets = array.clone(_offsets_template, n + 1, False)
+        cdef long* offs = offsets.data.as_longs
+
+        # Hold on to the values while the result is sized.
+        cdef vector[fv_ptr] fvs
+        cdef size_t total = 0
+        fvs.reserve(n)
+        for i in range(n):
+            fvs.push_back(FloatValueCast(self._atom(i).getValue(deref(key.handle))))
+            offs[i] = total
+            if fvs[i].get() != NULL:
+                total += fvs[i].get().value().size()
+        offs[n] = total
+
+        cdef array.array values = array.clone(_doubles_template, total, False)
+        cdef double* out = values.data.as_doubles
+        cdef const double* src
+        cdef size_t j, m
+        for i in range(n):
+            if fvs[i].get() == NULL:
+                continue
+            m = fvs[i].get().value().size()
+            src = fvs[i].get().value().data()
+            for j in range(m):
+                out[offs[i] + j] = src[j]
+        return values, offsets
+
+    def set_float_values(self, Atom key, const double[::1] values, offsets):
+        """ Give each atom a FloatValue at the key.  offsets is either
+        as float_values() gives it, or else the number of values that
+        each atom gets. """
+        cdef size_t i, n = self.handles.size()
+        cdef long j, width
+        cdef const long[::1] offs
+        cdef vector[long] starts
+        cdef vector[double] v
+
+        # Where the values of each atom start, and, last, where they end.
+        if isinstance(offsets, (int, long)):
+            width = offsets
+            self._check_size(values.shape[0], width, "set_float_values")
+            for i in range(n + 1):
+                starts.push_back(i * width)
+        else:
+            offs = offsets
+            if <size_t> offs.shape[0] != n + 1 or offs[0] != 0 or \
+               offs[n] != values.shape[0]:
+                raise ValueError("set_float_values: the offsets do not "
+                                 "match the atoms and values")
+            for i in range(n + 1):
+                if 0 < i and offs[i] < offs[i - 1]:
+                    raise ValueError("set_float_values: the offsets must "
+                                     "not decrease")
+                starts.push_back(offs[i])
+
+        for i in range(n):
+            v.clear()
+            for j in range(starts[i], starts[i + 1]):
+                v.push_back(values[j])
+            self._atom(i).setValue(deref(key.handle), createFloatValue(v))
@@ -32,13 +32,13 @@ cdef extern from "<string>" namespace "std":
 # Basic wrapping for back_insert_iterator conversion.
 cdef extern from "<vector>" namespace "std":
     cdef cppclass output_iterator "back_insert_iterator<vector<opencog::Handle> >"
-    cdef output_iterator back_inserter(vector[cHandle])
+    cdef output_iterator back_inserter(vector[cHandle]) nogil
 
 
 ### TruthValue
 ctypedef double count_t
-ctypedef float confidence_t
-ctypedef float strength_t
+ctypedef double confidence_t
+ctypedef double strength_t
 
 cdef extern from "opencog/truthvalue/TruthValue.h" namespace "opencog":
     cdef cppclass tv_ptr "std::shared_ptr<const opencog::TruthValue>":
@@ -71,6 +71,23 @@ cdef extern from "opencog/truthvalue/SimpleTruthValue.h" namespace "opencog":
         bint operator!=(cTruthValue h)
 
 
+### Values
+cdef extern from "opencog/atoms/base/ProtoAtom.h" namespace "opencog":
+    cdef cppclass pv_ptr "opencog::ProtoAtomPtr":
+        pv_ptr()
+        pv_ptr(pv_ptr copy)
+
+cdef extern from "opencog/atoms/base/FloatValue.h" namespace "opencog":
+    cdef cppclass cFloatValue "const opencog::FloatValue":
+        const vector[double]& value()
+
+    cdef cppclass fv_ptr "opencog::FloatValuePtr":
+        cFloatValue* get()
+
+    cdef fv_ptr FloatValueCast(const pv_ptr&)
+    cdef pv_ptr createFloatValue "std::make_shared<opencog::FloatValue>" (const vector[double]&)
+
+
 # Basic OpenCog types
 # ClassServer
 ctypedef short Type
@@ -111,8 +128,12 @@ cdef extern from "opencog/atoms/base/Atom.h" namespace "opencog":
         output_iterator getIncomingSet(output_iterator)
 
         tv_ptr getTruthValue()
+        void getTruthValuePair(strength_t&, confidence_t&)
         void setTruthValue(tv_ptr tvp)
 
+        pv_ptr getValue(const cHandle& key)
+        void setValue(const cHandle& key, const pv_ptr& value)
+
         output_iterator getIncomingSetByType(output_iterator, Type type, bint subclass)
 
         # Conditionally-valid methods. Not defined for all atoms.
@@ -127,6 +148,7 @@ cdef extern from "opencog/atoms/base/Handle.h" namespace "opencog":
         cHandle(const cHandle&)
         
         cAtom* atom_ptr()
+        size_t value()
         string toString()
         string toShortString()
 
@@ -156,6 +178,12 @@ cdef class Atom:
     cdef object _name
     cdef object _outgoing
 
+cdef class AtomArray:
+    cdef vector[cHandle] handles
+    cdef AtomSpace atomspace
+    cdef cAtom* _atom(self, size_t i) except NULL
+    cdef size_t _check_size(self, size_t have, size_t per_atom, what) except? 0
+
 
 
 # AtomSpace
@@ -164,11 +192,14 @@ cdef extern from "opencog/atomspace/AtomSpace.h" namespace "opencog":
     cdef cppclass cAtomSpace "opencog::AtomSpace":
         AtomSpace()
 
-        cHandle add_node(Type t, string s) except +
+        # The methods that can take a while are nogil, so that other
+        # python threads can run while they do.
+        cHandle add_node(Type t, string s) nogil except +
         cHandle add_node(Type t, string s, tv_ptr tvn) except +
 
-        cHandle add_link(Type t, vector[cHandle]) except +
+        cHandle add_link(Type t, vector[cHandle]) nogil except +
         cHandle add_link(Type t, vector[cHandle], tv_ptr tvn) except +
+        vector[cHandle] add_atoms(vector[cHandle]) nogil except +
 
         cHandle get_handle(Type t, string s)
         cHandle get_handle(Type t, vector[cHandle])
@@ -178,10 +209,23 @@ cdef extern from "opencog/atomspace/AtomSpace.h" namespace "opencog":
 
         # ==== query methods ====
         # get by type
-        output_iterator get_handles_by_type(output_iterator, Type t, bint subclass)
+        output_iterator get_handles_by_type(output_iterator, Type t, bint subclass) nogil
+
+        void clear() nogil
+        bint remove_atom(cHandle h, bint recursive) nogil
+
+        void save_snapshot(string path) nogil except +
+        size_t load_snapshot(string path) nogil except +
+
+# The binary atom format, for copying atoms to other processes.
+cdef extern from "opencog/persist/serial/AtomEncoder.h" namespace "opencog":
+    string c_encode_atoms "opencog::AtomEncoder::encode" (vector[cHandle]) nogil except +
 
-        void clear()
-        bint remove_atom(cHandle h, bint recursive)
+cdef extern from "opencog/persist/serial/AtomDecoder.h" namespace "opencog":
+    cdef cppclass cAtomBlock "opencog::AtomDecoder::Block":
+        cAtomBlock()
+    cAtomBlock c_decode_atoms "opencog::AtomDecoder::decode" (string) nogil except +
+    vector[cHandle] c_add_atom_block "opencog::AtomDecoder::add_to" (cAtomSpace&, cAtomBlock&) nogil except +
 
 cdef AtomSpace_factory(cAtomSpace *to_wrap)
 
@@ -9,3 +9,4 @@ include "classserver.pyx"
 include "truth_value.pyx"
 include "atomspace_details.pyx"
 include "atom.pyx"
+include "atom_array.pyx"
@@ -93,7 +93,9 @@ cdef class AtomSpace:
         if self.atomspace == NULL:
             return None
         cdef string name = atom_name.encode('UTF-8')
-        cdef cHandle result = self.atomspace.add_node(t, name)
+        cdef cHandle result
+        with nogil:
+            result = self.atomspace.add_node(t, name)
 
         if result == result.UNDEFINED: return None
         atom = Atom(void_from_candle(result), self);
@@ -115,13 +117,37 @@ cdef class AtomSpace:
             if isinstance(atom, Atom):
                 handle_vector.push_back(deref((<Atom>(atom)).handle))
         cdef cHandle result
-        result = self.atomspace.add_link(t, handle_vector)
+        with nogil:
+            result = self.atomspace.add_link(t, handle_vector)
         if result == result.UNDEFINED: return None
         atom = Atom(void_from_candle(result), self);
         if tv :
             atom.tv = tv
         return atom
 
+    def add_atoms(self, atoms):
+        """ Add a batch of Atoms to the AtomSpace, in one pass.
+        This is much faster than adding them one at a time.
+        @returns list of the Atoms in this AtomSpace, in the same order
+        """
+        if self.atomspace == NULL:
+            return None
+        cdef vector[cHandle] handle_vector
+        for atom in atoms:
+            if not isinstance(atom, Atom):
+                raise TypeError("Need Atom object")
+            handle_vector.push_back(deref((<Atom>(atom)).handle))
+        cdef vector[cHandle] result
+        with nogil:
+            result = self.atomspace.add_atoms(handle_vector)
+        added = []
+        for i in range(result.size()):
+            if result[i] == result[i].UNDEFINED:
+                added.append(None)
+            else:
+                added.append(Atom(void_from_candle(result[i]), self))
+        return added
+
     def is_valid(self, atom):
         """ Check whether the passed handle refers to an actual atom
         """
@@ -149,13 +175,71 @@ cdef class AtomSpace:
         if self.atomspace == NULL:
             return None
         cdef bint recurse = recursive
-        return self.atomspace.remove_atom(deref(atom.handle),recurse)
+        cdef bint removed
+        with nogil:
+            removed = self.atomspace.remove_atom(deref(atom.handle),recurse)
+        return removed
 
     def clear(self):
         """ Remove all atoms from the AtomSpace """
         if self.atomspace == NULL:
             return None
-        self.atomspace.clear()
+        with nogil:
+            self.atomspace.clear()
+
+    def save_snapshot(self, path):
+        """ Write all of the Atoms, with their truth values and values,
+        to a snapshot file, which load_snapshot() can read back quickly.
+        """
+        if self.atomspace == NULL:
+            return None
+        cdef string cpath = path.encode('UTF-8')
+        with nogil:
+            self.atomspace.save_snapshot(cpath)
+
+    def load_snapshot(self, path):
+        """ Add the Atoms in a snapshot file to the AtomSpace.
+        @returns the number of Atoms in the snapshot
+        """
+        if self.atomspace == NULL:
+            return 0
+        cdef string cpath = path.encode('UTF-8')
+        cdef size_t natoms
+        with nogil:
+            natoms = self.atomspace.load_snapshot(cpath)
+        return natoms
+
+    def encode_atoms(self, atoms):
+        """ The Atoms, and the Atoms they hold, with all of their truth
+        values and values, in the binary atom format, as a string of
+        bytes.  add_encoded() adds them to an AtomSpace, in this
+        process or in another one.
+        """
+        cdef vector[cHandle] handle_vector
+        for atom in atoms:
+            if isinstance(atom, Atom):
+                handle_vector.push_back(deref((<Atom>(atom)).handle))
+        cdef string data
+        with nogil:
+            data = c_encode_atoms(handle_vector)
+        return data
+
+    def add_encoded(self, data):
+        """ Add the Atoms made by encode_atoms() to the AtomSpace, with
+        their truth values and values.
+        @returns list of the Atoms, in this AtomSpace.  Each comes after
+        the Atoms it holds, so that when a single Atom was encoded, it
+        is the last one.
+        """
+        if self.atomspace == NULL:
+            return None
+        cdef string cdata = data
+        cdef cAtomBlock block
+        cdef vector[cHandle] result
+        with nogil:
+            block = c_decode_atoms(cdata)
+            result = c_add_atom_block(deref(self.atomspace), block)
+        return convert_handle_seq_to_python_list(result, self)
 
     # Methods to make the atomspace act more like a standard Python container
     def __contains__(self, atom):
@@ -195,15 +279,30 @@ cdef class AtomSpace:
             return None
         cdef vector[cHandle] handle_vector
         cdef bint subt = subtype
-        self.atomspace.get_handles_by_type(back_inserter(handle_vector),t,subt)
+        with nogil:
+            self.atomspace.get_handles_by_type(back_inserter(handle_vector),t,subt)
         return convert_handle_seq_to_python_list(handle_vector,self)
 
+    def get_atom_array(self, Type t, subtype = True):
+        """ All the atoms of the type, as an AtomArray, for reading and
+        writing their truth values and values in bulk, without making
+        an Atom object for each of them.
+        """
+        if self.atomspace == NULL:
+            return None
+        cdef AtomArray result = AtomArray(None, self)
+        cdef bint subt = subtype
+        with nogil:
+            self.atomspace.get_handles_by_type(back_inserter(result.handles),t,subt)
+        return result
+
     def xget_atoms_by_type(self, Type t, subtype = True):
         if self.atomspace == NULL:
             return None
         cdef vector[cHandle] handle_vector
         cdef bint subt = subtype
-        self.atomspace.get_handles_by_type(back_inserter(handle_vector),t,subt)
+        with nogil:
+            self.atomspace.get_handles_by_type(back_inserter(handle_vector),t,subt)
 
         # This code is the same for all the x iterators but there is no
         # way in Cython to yield out of a cdef function and no way to pass a
@@ -0,0 +1,104 @@
+"""
+A pool of worker processes, for evaluating "py:" GroundedPredicateNodes
+in parallel.  The GIL lets only one thread at a time run python code,
+so that predicates that spend their time computing in python run one
+after another, no matter how many threads evaluate them.  With the
+pool running (see PythonEval::set_worker_processes()), they run in the
+worker processes instead, and the calling threads only wait.
+
+Each worker has its own AtomSpace.  The arguments are copied into it,
+with their truth values and values, and the predicate is called on the
+copies, in the worker; whatever it does to that atomspace is not seen
+by the caller.  So only predicates that compute a truth value from
+their arguments, without changing the atomspace, should be evaluated
+this way.
+
+The workers are not forked from the calling process, which has other
+threads, and the locks they hold; they are started afresh, by a fork
+server (on python 2, which has no fork server, they are forked).  So
+they see only what they import: the predicates must be in a module,
+named as "py:module.function", that the workers can import.  Calling a
+predicate that the workers can't find raises an error.
+"""
+
+import importlib
+import os
+import sys
+import multiprocessing
+
+from opencog.atomspace import AtomSpace, TruthValue
+
+_pool = None
+_atomspace = None
+
+
+def _context():
+    if not hasattr(multiprocessing, "get_context"):
+        return multiprocessing
+    context = multiprocessing.get_context("forkserver")
+    # In PythonEval, sys.executable is the program python is embedded
+    # in, and not a python that can run the fork server.
+    exe = os.path.basename(sys.executable)
+    if not exe.startswith("python"):
+        context.set_executable(os.path.join(sys.exec_prefix, "bin",
+            "python%d.%d" % sys.version_info[:2]))
+    return context
+
+
+def start(processes):
+    """ Start the pool, replacing any pool already running. """
+    global _pool
+    stop()
+    if 0 < processes:
+        _pool = _context().Pool(processes, _init_worker)
+
+
+def stop():
+    """ Stop the pool, after the calls already made have finished. """
+    global _pool
+    if _pool is not None:
+        _pool.close()
+        _pool.join()
+        _pool = None
+
+
+def apply_tv(func, args):
+    """ Evaluate func on args, which are Atoms, in a worker; return
+    the TruthValue.  The calling thread waits without the GIL. """
+    module, name = _split(func)
+    if module == "__main__":
+        raise NameError("grounded_pool: the worker processes can't see "
+                        "'%s', which is in __main__; put it in a module, "
+                        "and call it as 'py:module.%s'" % (name, name))
+    # One atom to an encoding, so that each is the last atom in its own.
+    data = [atom.atomspace.encode_atoms([atom]) for atom in args]
+    mean, confidence = _pool.apply(_evaluate, (module, name, data))
+    return TruthValue(mean, confidence)
+
+
+def _split(func):
+    """ The module and the function of "module.function", the way
+    PythonEval finds them; a plain "function" is in __main__. """
+    index = func.find('.')
+    if 0 < index:
+        return func[:index], func[index + 1:]
+    return "__main__", func
+
+
+def _init_worker():
+    global _atomspace
+    _atomspace = AtomSpace()
+
+
+def _function(module, name):
+    try:
+        return getattr(importlib.import_module(module), name)
+    except (ImportError, AttributeError) as ex:
+        raise NameError("grounded_pool: the worker processes can't find "
+                        "'%s.%s': %s" % (module, name, ex))
+
+
+def _evaluate(module, name, data):
+    args = [_atomspace.add_encoded(d)[-1] for d in data]
+    tv = _function(module, name)(*args)
+    return (tv.mean, tv.confidence)
@@ -8,6 +8,7 @@
  */
 
 #include <atomic>
+#include <clocale>
 
 #include <unistd.h>
 #include <fcntl.h>
@@ -46,7 +47,8 @@ void SchemeEval::init(void)
 #define WORK_AROUND_GUILE_UTF8_BUGS
 #ifdef WORK_AROUND_GUILE_UTF8_BUGS
 	// Arghhh!  Avoid ongoing utf8 fruitcake nutiness in guile-2.0
-	scm_c_eval_string ("(setlocale LC_ALL \"\")\n");
+	// This is (setlocale LC_ALL ""), without parsing it every time.
+	scm_setlocale(scm_from_int(LC_ALL), scm_from_utf8_string(""));
 #endif // WORK_AROUND_GUILE_UTF8_BUGS
 
 	SchemeSmob::init();
@@ -193,6 +195,10 @@ void SchemeEval::finish(void)
 	scm_gc_unprotect_object(_error_string);
 	scm_gc_unprotect_object(_captured_stack);
 
+	for (auto& pr : _procs)
+		scm_gc_unprotect_object(pr.second);
+	_procs.clear();
+
 	// Force garbage collection
 	scm_gc();
 }
@@ -301,7 +307,7 @@ void SchemeEval::per_thread_init(void)
 
 #ifdef WORK_AROUND_GUILE_UTF8_BUGS
 	// Arghhh!  Avoid ongoing utf8 fruitcake nutiness in guile-2.0
-	scm_c_eval_string ("(setlocale LC_ALL \"\")\n");
+	scm_setlocale(scm_from_int(LC_ALL), scm_from_utf8_string(""));
 #endif // WORK_AROUND_GUILE_UTF8_BUGS
 }
 
@@ -738,10 +744,14 @@ std::string SchemeEval::do_poll_result()
  * 3) No shell-friendly string and output management is performed.
  * 4) Evaluation errors are logged to the log file.
  *
+ * If capture is false, then the cogserver output port is neither
+ * logged nor drained afterwards.  Grounded schemas and predicates are
+ * called this way, as they can be called millions of times.
+ *
  * This method *must* be called in guile mode, in order for garbage
  * collection, etc. to work correctly!
  */
-SCM SchemeEval::do_scm_eval(SCM sexpr, SCM (*evo)(void *))
+SCM SchemeEval::do_scm_eval(SCM sexpr, SCM (*evo)(void *), bool capture)
 {
 	per_thread_init();
 
@@ -785,7 +795,7 @@ SCM SchemeEval::do_scm_eval(SCM sexpr, SCM (*evo)(void *))
 		set_captured_stack(SCM_BOOL_F);
 
 		// ?? Why are we discarding the output??
-		drain_output();
+		if (capture) drain_output();
 
 		// Stick the guile stack trace into a string. Anyone who called
 		// us is responsible for checking for an error, and handling
@@ -797,6 +807,8 @@ SCM SchemeEval::do_scm_eval(SCM sexpr, SCM (*evo)(void *))
 		return SCM_EOL;
 	}
 
+	if (not capture) return rc;
+
 	// Get the contents of the output port, and log it
 	if (_in_server and logger().is_info_enabled())
 	{
@@ -973,6 +985,38 @@ static SCM thunk_scm_eval(void * expr)
 	return scm_eval((SCM)expr, scm_interaction_environment());
 }
 
+// The car is the variable holding the function; the cdr is the list
+// of arguments.
+static SCM thunk_scm_apply(void * expr)
+{
+	SCM call = (SCM) expr;
+	return scm_apply_0(scm_variable_ref(SCM_CAR(call)), SCM_CDR(call));
+}
+
+/**
+ * lookup_proc -- the variable holding the named function, or #f if
+ * there is no such variable.
+ *
+ * The symbol for the name is made once, and is then remembered, so
+ * that a function applied over and over is not converted from a
+ * string over and over.  The variable itself is looked up on every
+ * call, because the function may be redefined, or shadowed by a new
+ * definition in the current module.
+ */
+SCM SchemeEval::lookup_proc(const std::string& func)
+{
+	SCM sym;
+	auto it = _procs.find(func);
+	if (it != _procs.end())
+		sym = it->second;
+	else
+	{
+		sym = scm_gc_protect_object(scm_from_utf8_symbol(func.c_str()));
+		_procs.emplace(func, sym);
+	}
+	return scm_module_variable(scm_interaction_environment(), sym);
+}
+
 /**
  * do_apply_scm -- apply named function func to arguments in ListLink
  * It is assumed that varargs is a ListLink, containing a list of
@@ -981,7 +1025,6 @@ static SCM thunk_scm_eval(void * expr)
  */
 SCM SchemeEval::do_apply_scm(const std::string& func, const Handle& varargs )
 {
-	SCM sfunc = scm_from_utf8_symbol(func.c_str());
 	SCM expr = SCM_EOL;
 
 	// If there were args, pass the args to the function.
@@ -1001,7 +1044,16 @@ SCM SchemeEval::do_apply_scm(const std::string& func, const Handle& varargs )
 			expr = scm_cons(sh, expr);
 		}
 	}
-	expr = scm_cons(sfunc, expr);
+
+	// If the name is bound to a procedure, call it directly. Anything
+	// else (a macro, or a name that is not defined yet) is evaluated
+	// the slow way, which also reports any errors the usual way.
+	SCM var = lookup_proc(func);
+	if (scm_is_true(var) and scm_is_true(scm_variable_bound_p(var)) and
+	    scm_is_true(scm_procedure_p(scm_variable_ref(var))))
+		return do_scm_eval(scm_cons(var, expr), thunk_scm_apply, false);
+
+	expr = scm_cons(scm_from_utf8_symbol(func.c_str()), expr);
 
 	// TODO: it would be nice to pass exceptions on through, but
 	// this currently breaks unit tests.
@@ -1072,13 +1124,11 @@ void * SchemeEval::c_wrap_apply_v(void * p)
 // reason this is done with a pool, instead of simply new() and
 // delete() is because calling delete() from TLS conflicts with
 // the guile garbage collector, when the thread is destroyed. See
-// the note below.
+// the note below.  The stack does its own locking.
 static concurrent_stack<SchemeEval*> pool;
-static std::mutex pool_mtx;
 
 static SchemeEval* get_from_pool(void)
 {
-	std::lock_guard<std::mutex> lock(pool_mtx);
 	SchemeEval* ev = NULL;
 	if (pool.try_pop(ev)) return ev;
 	return new SchemeEval();
@@ -1087,16 +1137,28 @@ static SchemeEval* get_from_pool(void)
 static void return_to_pool(SchemeEval* ev)
 {
 	ev->clear_pending();
-	std::lock_guard<std::mutex> lock(pool_mtx);
 	pool.push(ev);
 }
 
+/// Fill the pool with evaluators, their init() done, under the init
+/// lock that all of the constructors wait on.  What is per-thread,
+/// rather than per-evaluator, can't be done ahead of time, for threads
+/// that don't exist yet; guile's own thread setup, and
+/// per_thread_init(), still happen on first use.
+void SchemeEval::prewarm(size_t n)
+{
+	for (size_t i = 0; i < n; i++)
+		pool.push(new SchemeEval());
+}
+
 /// Return evaluator, for this thread and atomspace combination.
 /// If called with NULL, it will use the current atomspace for
 /// this thread.
 ///
 /// Use thread-local storage (TLS) in order to avoid repeatedly
-/// creating and destroying the evaluator.
+/// creating and destroying the evaluator.  The evaluator that was
+/// handed out last is pinned to the thread, so that a thread that
+/// keeps asking for the same atomspace does not even look in the map.
 ///
 /// This will throw an error if used recursively.  Viz, if the
 /// evaluator evaluates something that causes another evaluator
@@ -1129,14 +1191,23 @@ SchemeEval* SchemeEval::get_evaluator(AtomSpace* as)
 		}
 	};
 	static thread_local eval_dtor killer;
+	static thread_local AtomSpace* pinned_as = NULL;
+	static thread_local SchemeEval* pinned = NULL;
+
+	if (pinned and pinned_as == as) return pinned;
 
+	SchemeEval* evaluator;
 	auto ev = issued.find(as);
 	if (ev != issued.end())
-		return ev->second;
-
-	SchemeEval* evaluator = get_from_pool();
-	evaluator->_atomspace = as;
-	issued[as] = evaluator;
+		evaluator = ev->second;
+	else
+	{
+		evaluator = get_from_pool();
+		evaluator->_atomspace = as;
+		issued[as] = evaluator;
+	}
+	pinned_as = as;
+	pinned = evaluator;
 	return evaluator;
 
 #if 0
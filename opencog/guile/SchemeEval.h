@@ -13,6 +13,7 @@
 #include <mutex>
 #include <string>
 #include <sstream>
+#include <unordered_map>
 #include <cstddef>
 #include <libguile.h>
 #include <opencog/atoms/base/Atom.h>
@@ -107,7 +108,7 @@ class SchemeEval : public GenericEval
 		void drain_output();
 
 		// Straight-up evaluation
-		SCM do_scm_eval(SCM, SCM (*)(void *));
+		SCM do_scm_eval(SCM, SCM (*)(void *), bool capture = true);
 		static void * c_wrap_eval_v(void *);
 		static void * c_wrap_eval_as(void *);
 
@@ -118,6 +119,10 @@ class SchemeEval : public GenericEval
 		SCM do_apply_scm(const std::string& func, const Handle& varargs);
 		static void * c_wrap_apply_v(void *);
 
+		// The symbols of the functions that were applied, by name.
+		std::unordered_map<std::string, SCM> _procs;
+		SCM lookup_proc(const std::string&);
+
 		// Exception and error handling stuff
 		SCM _error_string;
 		std::string _error_msg;
@@ -150,6 +155,12 @@ class SchemeEval : public GenericEval
 		// Return per-thread, per-atomspace singleton
 		static SchemeEval* get_evaluator(AtomSpace* = NULL);
 
+		// Create evaluators ahead of time, so that threads started
+		// later do not have to pay for constructing them.  Only the
+		// construction is saved: a thread still enters guile, and
+		// runs per_thread_init(), the first time it evaluates.
+		static void prewarm(size_t);
+
 		// The async-output interface.
 		void begin_eval(void);
 		void eval_expr(const std::string&);
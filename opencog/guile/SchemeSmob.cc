@@ -261,6 +261,8 @@ void SchemeSmob::register_procs()
 	register_proc("cog-new-value",         1, 0, 1, C(ss_new_value));
 	register_proc("cog-new-node",          2, 0, 1, C(ss_new_node));
 	register_proc("cog-new-link",          1, 0, 1, C(ss_new_link));
+	register_proc("cog-new-atoms",         0, 0, 1, C(ss_new_atoms));
+	register_proc("cog-load-atomese",      1, 0, 1, C(ss_load_atomese));
 	register_proc("cog-node",              2, 0, 1, C(ss_node));
 	register_proc("cog-link",              1, 0, 1, C(ss_link));
 	register_proc("cog-delete",            1, 0, 1, C(ss_delete));
@@ -335,6 +337,8 @@ void SchemeSmob::register_procs()
 	register_proc("cog-atomspace-env",     1, 0, 0, C(ss_as_env));
 	register_proc("cog-atomspace-uuid",    1, 0, 0, C(ss_as_uuid));
 	register_proc("cog-atomspace-clear",   1, 0, 0, C(ss_as_clear));
+	register_proc("cog-save-snapshot",     1, 0, 1, C(ss_save_snapshot));
+	register_proc("cog-load-snapshot",     1, 0, 1, C(ss_load_snapshot));
 
 	// Attention values
 	register_proc("cog-new-av",            3, 0, 0, C(ss_new_av));
@@ -82,6 +82,8 @@ private:
 	static SCM ss_new_value(SCM, SCM);
 	static SCM ss_new_node(SCM, SCM, SCM);
 	static SCM ss_new_link(SCM, SCM);
+	static SCM ss_new_atoms(SCM);
+	static SCM ss_load_atomese(SCM, SCM);
 	static SCM ss_node(SCM, SCM, SCM);
 	static SCM ss_link(SCM, SCM);
 	static SCM ss_delete(SCM, SCM);
@@ -164,6 +166,8 @@ private:
 	static SCM ss_as_env(SCM);
 	static SCM ss_as_uuid(SCM);
 	static SCM ss_as_clear(SCM);
+	static SCM ss_save_snapshot(SCM, SCM);
+	static SCM ss_load_snapshot(SCM, SCM);
 	static SCM make_as(AtomSpace *);
 	static void release_as(AtomSpace *);
 	static AtomSpace* ss_to_atomspace(SCM);
@@ -207,6 +211,12 @@ private:
 	static AttentionValue* verify_av(SCM, const char *, int pos = 1);
 	static HandleSeq verify_handle_list (SCM, const char *,
 	                                               int pos = 1);
+
+	// Atom descriptions, for cog-new-atoms.
+	typedef std::vector<std::pair<Handle, TruthValuePtr>> AtomTVs;
+	static Handle scm_to_atom_desc(SCM, AtomTVs&, const char *, int);
+	static void scm_to_atom_descs(SCM, HandleSeq&, AtomTVs&,
+	                              const char *, int);
 	static std::vector<double> verify_float_list (SCM, const char *,
 	                                               int pos = 1);
 	static std::vector<ProtoAtomPtr> verify_protom_list (SCM, const char *,
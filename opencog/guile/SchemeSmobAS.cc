@@ -251,6 +251,52 @@ SCM SchemeSmob::ss_as_clear(SCM sas)
 	return SCM_BOOL_T;
 }
 
+/* ============================================================== */
+/**
+ * Write the atomspace to a snapshot file.
+ */
+SCM SchemeSmob::ss_save_snapshot(SCM sfilename, SCM kv_pairs)
+{
+	std::string filename(verify_string(sfilename, "cog-save-snapshot", 1,
+		"name of the snapshot file"));
+
+	AtomSpace* as = get_as_from_list(kv_pairs);
+	if (NULL == as) as = ss_get_env_as("cog-save-snapshot");
+
+	try
+	{
+		as->save_snapshot(filename);
+	}
+	catch (const std::exception& ex)
+	{
+		throw_exception(ex, "cog-save-snapshot", sfilename);
+	}
+	return SCM_BOOL_T;
+}
+
+/**
+ * Load a snapshot file into the atomspace. Returns the number of
+ * atoms in the snapshot.
+ */
+SCM SchemeSmob::ss_load_snapshot(SCM sfilename, SCM kv_pairs)
+{
+	std::string filename(verify_string(sfilename, "cog-load-snapshot", 1,
+		"name of the snapshot file"));
+
+	AtomSpace* as = get_as_from_list(kv_pairs);
+	if (NULL == as) as = ss_get_env_as("cog-load-snapshot");
+
+	try
+	{
+		return scm_from_size_t(as->load_snapshot(filename));
+	}
+	catch (const std::exception& ex)
+	{
+		throw_exception(ex, "cog-load-snapshot", sfilename);
+	}
+	return SCM_EOL;
+}
+
 /* ============================================================== */
 /**
  * Return the atomspace of an atom.
@@ -12,9 +12,14 @@
 #include <libguile.h>
 
 #include <opencog/atomspace/AtomSpace.h>
+#include <opencog/atomspaceutils/LoadAtomese.h>
 #include <opencog/attentionbank/AttentionBank.h>
 #include <opencog/atoms/base/ClassServer.h>
+#include <opencog/atoms/base/Link.h>
+#include <opencog/atoms/base/Node.h>
 #include <opencog/guile/SchemeSmob.h>
+#include <opencog/truthvalue/CountTruthValue.h>
+#include <opencog/truthvalue/SimpleTruthValue.h>
 
 using namespace opencog;
 
@@ -469,6 +474,186 @@ SCM SchemeSmob::ss_new_link (SCM stype, SCM satom_list)
 	return SCM_EOL;
 }
 
+/**
+ * Convert an atom description into an atom that is not in any
+ * atomspace yet.  A description is a list, such as
+ *
+ *    '(InheritanceLink (ConceptNode "cat") (ConceptNode "animal"))
+ *
+ * holding the type name, and then either the node name, or the
+ * descriptions of the outgoing atoms.  Atoms may appear in place of
+ * descriptions, and truth values may appear anywhere after the type
+ * name.  The atoms given a truth value are added to tvs.
+ */
+Handle SchemeSmob::scm_to_atom_desc(SCM sdesc, AtomTVs& tvs,
+                                    const char * subrname, int pos)
+{
+	Handle h(scm_to_handle(sdesc));
+	if (h) return h;
+
+	if (not scm_is_pair(sdesc))
+		scm_wrong_type_arg_msg(subrname, pos, sdesc, "atom or atom description");
+
+	Type t = verify_atom_type(SCM_CAR(sdesc), subrname, pos);
+	bool is_node = classserver().isA(t, NODE);
+
+	std::string name;
+	bool have_name = false;
+	HandleSeq oset;
+	TruthValuePtr tv;
+	for (SCM sl = SCM_CDR(sdesc); scm_is_pair(sl); sl = SCM_CDR(sl))
+	{
+		SCM sitem = SCM_CAR(sl);
+		if (is_node and not have_name and
+		    (scm_is_string(sitem) or scm_is_number(sitem)))
+		{
+			if (scm_is_number(sitem))
+				sitem = scm_number_to_string(sitem, _radix_ten);
+			name = verify_string(sitem, subrname, pos);
+			have_name = true;
+			continue;
+		}
+
+		ProtoAtomPtr pa(scm_to_protom(sitem));
+		TruthValuePtr itv(TruthValueCast(pa));
+		if (itv) { tv = itv; continue; }
+
+		// Inside a quoted description, the truth value is a list too.
+		if (scm_is_pair(sitem) and scm_is_symbol(SCM_CAR(sitem)))
+		{
+			std::string tvname(verify_string(
+				scm_symbol_to_string(SCM_CAR(sitem)), subrname, pos));
+			if ("stv" == tvname or "ctv" == tvname)
+			{
+				std::vector<double> v;
+				for (SCM sv = SCM_CDR(sitem); scm_is_pair(sv); sv = SCM_CDR(sv))
+					v.push_back(verify_real(SCM_CAR(sv), subrname, pos));
+				if (2 == v.size() and "stv" == tvname)
+					tv = SimpleTruthValue::createTV(v[0], v[1]);
+				else if (3 == v.size() and "ctv" == tvname)
+					tv = CountTruthValue::createTV(v[0], v[1], v[2]);
+				else
+					scm_wrong_type_arg_msg(subrname, pos, sitem, "truth value");
+				continue;
+			}
+		}
+
+		if (is_node or scm_is_null(sitem))
+			scm_wrong_type_arg_msg(subrname, pos, sdesc, "atom description");
+		oset.emplace_back(scm_to_atom_desc(sitem, tvs, subrname, pos));
+	}
+
+	if (is_node)
+	{
+		if (not have_name)
+			scm_wrong_type_arg_msg(subrname, pos, sdesc, "node description");
+		h = createNode(t, name);
+	}
+	else
+		h = createLink(oset, t);
+
+	if (tv) tvs.emplace_back(h, tv);
+	return h;
+}
+
+/**
+ * Convert the list (or vector) of atoms and atom descriptions into
+ * atoms, appending them to hseq.  Lists that are not descriptions are
+ * flattened.  Truth values and atomspaces are skipped.
+ */
+void SchemeSmob::scm_to_atom_descs(SCM slist, HandleSeq& hseq, AtomTVs& tvs,
+                                   const char * subrname, int pos)
+{
+	if (scm_is_vector(slist)) slist = scm_vector_to_list(slist);
+
+	for (SCM sl = slist; scm_is_pair(sl); sl = SCM_CDR(sl), pos++)
+	{
+		SCM sitem = SCM_CAR(sl);
+		if (scm_is_null(sitem)) continue;
+		if (SCM_SMOB_PREDICATE(SchemeSmob::cog_misc_tag, sitem))
+		{
+			Handle h(scm_to_handle(sitem));
+			if (h) hseq.emplace_back(h);
+			continue;
+		}
+
+		// A description starts with a type name.  Anything else is
+		// a list of atoms, or descriptions, or a vector of them.
+		if (scm_is_pair(sitem) and (scm_is_symbol(SCM_CAR(sitem)) or
+		                            scm_is_string(SCM_CAR(sitem))))
+			hseq.emplace_back(scm_to_atom_desc(sitem, tvs, subrname, pos));
+		else if (scm_is_pair(sitem) or scm_is_vector(sitem))
+			scm_to_atom_descs(sitem, hseq, tvs, subrname, pos);
+		else
+			scm_wrong_type_arg_msg(subrname, pos, sitem,
+			                       "atom or atom description");
+	}
+}
+
+/**
+ * Add a whole list of atoms to the atomspace, in one batch.  The
+ * atoms may also be given as atom descriptions, which are converted
+ * in C++, without making any scheme objects for the atoms in them.
+ * Nested lists (and vectors) are flattened. Returns the list of atoms
+ * that are in the atomspace, in the same order.
+ */
+SCM SchemeSmob::ss_new_atoms (SCM satom_list)
+{
+	HandleSeq hseq;
+	AtomTVs tvs;
+	scm_to_atom_descs(satom_list, hseq, tvs, "cog-new-atoms", 1);
+
+	AtomSpace* atomspace = get_as_from_list(satom_list);
+	if (NULL == atomspace) atomspace = ss_get_env_as("cog-new-atoms");
+
+	try
+	{
+		HandleSeq added(atomspace->add_atoms(hseq));
+
+		// As with cog-new-node, the truth value is set even if the
+		// atom was already in the atomspace.
+		for (const auto& pr : tvs)
+		{
+			Handle h(atomspace->get_atom(pr.first));
+			if (h) h->setTruthValue(pr.second);
+		}
+
+		SCM list = SCM_EOL;
+		for (size_t i = added.size(); 0 < i; i--)
+			list = scm_cons(handle_to_scm(added[i-1]), list);
+		return list;
+	}
+	catch (const std::exception& ex)
+	{
+		throw_exception(ex, "cog-new-atoms", satom_list);
+	}
+	scm_remember_upto_here_1(satom_list);
+	return SCM_EOL;
+}
+
+/**
+ * Load a file of atomese, parsing it in C++, without the scheme
+ * evaluator. Returns the number of top-level atoms in the file.
+ */
+SCM SchemeSmob::ss_load_atomese (SCM sfilename, SCM kv_pairs)
+{
+	std::string filename(verify_string(sfilename, "cog-load-atomese", 1,
+		"name of a file of atomese"));
+
+	AtomSpace* atomspace = get_as_from_list(kv_pairs);
+	if (NULL == atomspace) atomspace = ss_get_env_as("cog-load-atomese");
+
+	try
+	{
+		return scm_from_size_t(load_atomese_file(*atomspace, filename));
+	}
+	catch (const std::exception& ex)
+	{
+		throw_exception(ex, "cog-load-atomese", sfilename);
+	}
+	return SCM_EOL;
+}
+
 /**
  * Return the indicated link, of named type stype, holding the
  * indicated atom list, if it exists; else return nil if
@@ -0,0 +1,774 @@
+/*
+ * opencog/persist/journal/AtomJournal.cc
+ *
+ * Copyright (C) 2017 OpenCog Foundation
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License v3 as
+ * published by the Free Software Foundation and including the exceptions
+ * at http://opencog.org/wiki/Licenses
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, write to:
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <map>
+#include <unordered_map>
+
+#include <opencog/atoms/base/ClassServer.h>
+#include <opencog/persist/serial/AtomDecoder.h>
+#include <opencog/persist/serial/AtomEncoder.h>
+#include <opencog/util/Logger.h>
+#include <opencog/util/exceptions.h>
+
+#include "AtomJournal.h"
+
+using namespace opencog;
+
+/*
+ * Every file, segment or checkpoint, starts with the magic bytes, and
+ * then holds a sequence of records:
+ *
+ *    u32 length   -- of the kind and the body
+ *    u32 crc32    -- of the kind and the body
+ *    u8  kind     -- one of AtomJournal::RecordKind
+ *    body
+ *
+ * The integers are little-endian.  The body of ADD, REMOVE and SET_TV
+ * records is a block of binary atoms (see persist/serial), with its
+ * length prefix; SET_TV then has the name of the truth value type,
+ * and the truth value's numbers.  A checkpoint starts with a
+ * CHECKPOINT record, whose body is a single byte, 1 if the checkpoint
+ * is a full one.
+ */
+#define JOURNAL_MAGIC "OCJRNL01"
+#define MAGIC_LEN 8
+#define HEADER_LEN 9
+
+// Atoms per ADD record, in the journal.
+#define ADD_BATCH 4096
+
+static uint32_t crc32(const char* p, size_t len)
+{
+	static uint32_t table[256];
+	static bool ready = [] {
+		for (uint32_t i = 0; i < 256; i++)
+		{
+			uint32_t c = i;
+			for (int k = 0; k < 8; k++)
+				c = (c & 1) ? 0xedb88320 ^ (c >> 1) : c >> 1;
+			table[i] = c;
+		}
+		return true;
+	}();
+	(void) ready;
+
+	uint32_t crc = 0xffffffff;
+	for (size_t i = 0; i < len; i++)
+		crc = table[(crc ^ (unsigned char) p[i]) & 0xff] ^ (crc >> 8);
+	return crc ^ 0xffffffff;
+}
+
+static void put_u32(std::string& out, uint32_t v)
+{
+	for (int i = 0; i < 4; i++)
+		out.push_back((char) (v >> (8 * i)));
+}
+
+static uint32_t get_u32(const char* p)
+{
+	uint32_t v = 0;
+	for (int i = 0; i < 4; i++)
+		v |= ((uint32_t) (unsigned char) p[i]) << (8 * i);
+	return v;
+}
+
+static void put_record(std::string& out, AtomJournal::RecordKind kind,
+                       const std::string& body)
+{
+	std::string kb(1, (char) kind);
+	kb.append(body);
+	put_u32(out, kb.size());
+	put_u32(out, crc32(kb.data(), kb.size()));
+	out.append(kb);
+}
+
+static std::string read_file(const std::string& path)
+{
+	int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+		throw IOException(TRACE_INFO, "Journal: can't open %s: %s",
+			path.c_str(), strerror(errno));
+
+	std::string bytes;
+	char buf[64 * 1024];
+	ssize_t n;
+	while (0 < (n = read(fd, buf, sizeof(buf))))
+		bytes.append(buf, n);
+	int err = errno;
+	close(fd);
+	if (n < 0)
+		throw IOException(TRACE_INFO, "Journal: can't read %s: %s",
+			path.c_str(), strerror(err));
+	return bytes;
+}
+
+static void sync_dir(const std::string& dir)
+{
+	int fd = open(dir.c_str(), O_RDONLY | O_DIRECTORY);
+	if (fd < 0) return;
+	fsync(fd);
+	close(fd);
+}
+
+static size_t height(const Handle& h,
+                     std::unordered_map<Handle, size_t>& heights)
+{
+	if (h->isNode()) return 0;
+	auto it = heights.find(h);
+	if (heights.end() != it) return it->second;
+
+	size_t hi = 0;
+	for (const Handle& ho : h->getOutgoingSet())
+		hi = std::max(hi, height(ho, heights));
+	heights.emplace(h, hi + 1);
+	return hi + 1;
+}
+
+static void mark_written(const Handle& h, std::unordered_set<Handle>& written)
+{
+	if (not written.insert(h).second or h->isNode()) return;
+	for (const Handle& ho : h->getOutgoingSet())
+		mark_written(ho, written);
+}
+
+// ==========================================================
+
+AtomJournal::AtomJournal(AtomSpace* as, const std::string& directory)
+	: _as(as), _dir(directory),
+	  _queued_seq(0), _durable_seq(0), _max_queue(1024 * 1024),
+	  _want_sync(false), _want_full(false),
+	  _checkpoints_wanted(0), _checkpoints_done(0), _stopping(false),
+	  _commit_interval(10), _checkpoint_interval(300), _fsync(true),
+	  _fd(-1), _segment(0), _bytes_written(0), _recovered(0)
+{
+	if (mkdir(_dir.c_str(), 0777) < 0 and EEXIST != errno)
+		throw IOException(TRACE_INFO, "Journal: can't make %s: %s",
+			_dir.c_str(), strerror(errno));
+
+	size_t before = _as->get_size();
+	recover();
+	_recovered = _as->get_size() - before;
+
+	open_segment(_segment + 1);
+
+	// Atoms that were in the atomspace before it was journaled are not
+	// in any segment; start with a checkpoint of everything.
+	if (0 < before)
+	{
+		HandleSeq all;
+		_as->get_handles_by_type(all, ATOM, true);
+		write_checkpoint(std::unordered_set<Handle>(all.begin(), all.end()),
+		                 std::unordered_set<Handle>(), true);
+	}
+
+	_connections.push_back(_as->addAtomSignal(
+		[this](const Handle& h) { enqueue(ADD, h, nullptr); }));
+	_connections.push_back(_as->removeAtomSignal(
+		[this](const AtomPtr& atom) { enqueue(REMOVE, Handle(atom), nullptr); }));
+	_connections.push_back(_as->TVChangedSignal(
+		[this](const Handle& h, const TruthValuePtr&, const TruthValuePtr& tv) {
+			enqueue(SET_TV, h, tv); }));
+
+	_writer = std::thread(&AtomJournal::writer_loop, this);
+}
+
+AtomJournal::~AtomJournal()
+{
+	for (ObserverConnection& c : _connections) c.disconnect();
+
+	{
+		std::lock_guard<std::mutex> lck(_mtx);
+		_stopping = true;
+		_work_cv.notify_one();
+	}
+	_writer.join();
+	if (0 <= _fd) close(_fd);
+
+	if (_error)
+		logger().error("AtomJournal: the journal in %s is incomplete",
+			_dir.c_str());
+}
+
+std::string AtomJournal::path(const char* prefix, uint64_t n) const
+{
+	char name[64];
+	snprintf(name, sizeof(name), "/%s-%010llu", prefix,
+	         (unsigned long long) n);
+	return _dir + name;
+}
+
+// ==========================================================
+// The threads making changes.
+
+void AtomJournal::enqueue(RecordKind kind, const Handle& h,
+                          const TruthValuePtr& tv)
+{
+	std::unique_lock<std::mutex> lck(_mtx);
+	if (_error) return;
+
+	// Don't let the queue grow without bound, if the disk can't keep up.
+	while (_max_queue <= _queue.size() and not _error)
+		_done_cv.wait(lck);
+
+	_queue.push_back({kind, h, tv});
+	_queued_seq++;
+
+	switch (kind)
+	{
+		case ADD:
+			_removed.erase(h);
+			_dirty.insert(h);
+			break;
+		case REMOVE:
+			_dirty.erase(h);
+			_removed.insert(h);
+			break;
+		default:
+			_dirty.insert(h);
+	}
+
+	if (1 == _queue.size() or _max_queue / 2 == _queue.size())
+		_work_cv.notify_one();
+}
+
+void AtomJournal::sync(void)
+{
+	std::unique_lock<std::mutex> lck(_mtx);
+	uint64_t target = _queued_seq;
+	_want_sync = true;
+	_work_cv.notify_one();
+	while (_durable_seq < target and not _error)
+		_done_cv.wait(lck);
+	if (_error) std::rethrow_exception(_error);
+}
+
+void AtomJournal::request_checkpoint(bool full)
+{
+	std::unique_lock<std::mutex> lck(_mtx);
+	uint64_t ticket = ++_checkpoints_wanted;
+	if (full) _want_full = true;
+	_work_cv.notify_one();
+	while (_checkpoints_done < ticket and not _error)
+		_done_cv.wait(lck);
+	if (_error) std::rethrow_exception(_error);
+}
+
+void AtomJournal::checkpoint(void)
+{
+	request_checkpoint(false);
+}
+
+void AtomJournal::compact(void)
+{
+	request_checkpoint(true);
+}
+
+void AtomJournal::set_commit_interval(std::chrono::milliseconds ms)
+{
+	std::lock_guard<std::mutex> lck(_mtx);
+	_commit_interval = ms;
+}
+
+void AtomJournal::set_checkpoint_interval(std::chrono::seconds s)
+{
+	std::lock_guard<std::mutex> lck(_mtx);
+	_checkpoint_interval = s;
+	_work_cv.notify_one();
+}
+
+void AtomJournal::set_fsync(bool on)
+{
+	std::lock_guard<std::mutex> lck(_mtx);
+	_fsync = on;
+}
+
+// ==========================================================
+// The writer thread.
+
+void AtomJournal::writer_loop(void)
+{
+	typedef std::chrono::steady_clock clock;
+	clock::time_point last_checkpoint = clock::now();
+
+	std::unique_lock<std::mutex> lck(_mtx);
+	while (true)
+	{
+		auto checkpoint_due = [&]() {
+			return _checkpoints_done != _checkpoints_wanted or
+				(0 < _checkpoint_interval.count() and
+				 last_checkpoint + _checkpoint_interval <= clock::now());
+		};
+
+		// Wait for the first change of a group, or for a checkpoint.
+		while (_queue.empty() and not _stopping and not checkpoint_due())
+		{
+			if (0 < _checkpoint_interval.count())
+				_work_cv.wait_until(lck, last_checkpoint + _checkpoint_interval);
+			else
+				_work_cv.wait(lck);
+		}
+
+		// Give the group a moment to fill up, unless someone is
+		// waiting on it.
+		if (not _queue.empty() and 0 < _commit_interval.count())
+			_work_cv.wait_for(lck, _commit_interval, [&]() {
+				return _stopping or _want_sync or
+					_checkpoints_done != _checkpoints_wanted or
+					_max_queue / 2 <= _queue.size(); });
+
+		std::vector<Change> group;
+		group.swap(_queue);
+		uint64_t seq = _queued_seq;
+		_want_sync = false;
+
+		// A checkpoint covers everything up to the end of this group.
+		bool ckpt = checkpoint_due();
+		uint64_t ticket = _checkpoints_wanted;
+		bool full = false;
+		std::unordered_set<Handle> dirty, removed;
+		if (ckpt)
+		{
+			dirty.swap(_dirty);
+			removed.swap(_removed);
+			full = _want_full;
+			_want_full = false;
+		}
+		bool stopping = _stopping;
+
+		// There is room in the queue again.
+		_done_cv.notify_all();
+		lck.unlock();
+
+		try
+		{
+			write_changes(group);
+			if (ckpt)
+			{
+				if (full)
+				{
+					HandleSeq all;
+					_as->get_handles_by_type(all, ATOM, true);
+					dirty = std::unordered_set<Handle>(all.begin(), all.end());
+					removed.clear();
+				}
+				if (full or not dirty.empty() or not removed.empty())
+					write_checkpoint(dirty, removed, full);
+				last_checkpoint = clock::now();
+			}
+		}
+		catch (const std::exception& ex)
+		{
+			logger().error("AtomJournal: can't write to %s: %s",
+				_dir.c_str(), ex.what());
+			lck.lock();
+			_error = std::current_exception();
+			_queue.clear();
+			_done_cv.notify_all();
+			return;
+		}
+
+		lck.lock();
+		_durable_seq = seq;
+		if (ckpt) _checkpoints_done = ticket;
+		_done_cv.notify_all();
+
+		if (stopping and _queue.empty()) return;
+	}
+}
+
+void AtomJournal::write_out(int fd, const std::string& bytes)
+{
+	const char* p = bytes.data();
+	size_t left = bytes.size();
+	while (0 < left)
+	{
+		ssize_t n = write(fd, p, left);
+		if (n < 0)
+		{
+			if (EINTR == errno) continue;
+			throw IOException(TRACE_INFO, "Journal: write failed: %s",
+				strerror(errno));
+		}
+		p += n;
+		left -= n;
+	}
+}
+
+void AtomJournal::write_changes(const std::vector<Change>& group)
+{
+	if (group.empty()) return;
+
+	std::string out;
+	HandleSeq adds;
+	auto flush_adds = [&]() {
+		if (adds.empty()) return;
+		put_record(out, ADD, AtomEncoder::encode(adds));
+		adds.clear();
+	};
+
+	// A truth value change needs no record of its own if the atom was
+	// added earlier in the group (the add is written with the truth
+	// value the atom has now), or if its truth value is changed again
+	// later in the group.
+	std::vector<bool> skip(group.size(), false);
+	std::unordered_set<Handle> seen;
+	for (size_t i = group.size(); 0 < i; i--)
+		if (SET_TV == group[i-1].kind and
+		    not seen.insert(group[i-1].atom).second)
+			skip[i-1] = true;
+	seen.clear();
+	for (size_t i = 0; i < group.size(); i++)
+	{
+		if (ADD == group[i].kind)
+			seen.insert(group[i].atom);
+		else if (SET_TV == group[i].kind and 0 < seen.count(group[i].atom))
+			skip[i] = true;
+	}
+
+	// Runs of adds go into one block, so that the atoms they share
+	// are written once.
+	for (size_t i = 0; i < group.size(); i++)
+	{
+		if (skip[i]) continue;
+		const Change& c = group[i];
+		if (ADD == c.kind)
+		{
+			adds.push_back(c.atom);
+			if (ADD_BATCH <= adds.size()) flush_adds();
+			continue;
+		}
+		flush_adds();
+
+		std::string body(AtomEncoder::encode({c.atom}, false));
+		if (SET_TV == c.kind)
+		{
+			BinaryFormat::put_string(body,
+				classserver().getTypeName(c.tv->getType()));
+			BinaryFormat::put_varint(body, c.tv->value().size());
+			for (double d : c.tv->value())
+				BinaryFormat::put_double(body, d);
+		}
+		put_record(out, c.kind, body);
+	}
+	flush_adds();
+
+	write_out(_fd, out);
+	if (_fsync and 0 != fdatasync(_fd))
+		throw IOException(TRACE_INFO, "Journal: fdatasync failed: %s",
+			strerror(errno));
+	_bytes_written += out.size();
+}
+
+void AtomJournal::open_segment(uint64_t n)
+{
+	if (0 <= _fd) close(_fd);
+
+	std::string seg(path("journal", n));
+	_fd = open(seg.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0666);
+	if (_fd < 0)
+		throw IOException(TRACE_INFO, "Journal: can't create %s: %s",
+			seg.c_str(), strerror(errno));
+	_segment = n;
+	write_out(_fd, JOURNAL_MAGIC);
+	if (0 != fsync(_fd))
+		throw IOException(TRACE_INFO, "Journal: fsync failed: %s",
+			strerror(errno));
+	sync_dir(_dir);
+}
+
+/// Write the atoms as they are now, and the removals, as the checkpoint
+/// of the current segment; then start the next segment, and delete the
+/// ones the checkpoint covers.
+void AtomJournal::write_checkpoint(const std::unordered_set<Handle>& dirty,
+                                   const std::unordered_set<Handle>& removed,
+                                   bool full)
+{
+	uint64_t n = _segment;
+	open_segment(n + 1);
+
+	std::string final_path(path("checkpoint", n));
+	std::string tmp_path(final_path + ".tmp");
+	int fd = open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+	if (fd < 0)
+		throw IOException(TRACE_INFO, "Journal: can't create %s: %s",
+			tmp_path.c_str(), strerror(errno));
+
+	try
+	{
+		std::string out(JOURNAL_MAGIC);
+		put_record(out, CHECKPOINT, std::string(1, full ? 1 : 0));
+
+		// Removals first: an atom that was removed and then made again
+		// is in both sets.
+		for (const Handle& h : removed)
+		{
+			put_record(out, REMOVE, AtomEncoder::encode({h}, false));
+			if (1024 * 1024 < out.size()) { write_out(fd, out); out.clear(); }
+		}
+
+		// Highest first: a link is written along with the atoms it
+		// holds, and those are then skipped, so that each atom is in
+		// the checkpoint about once.
+		std::unordered_map<Handle, size_t> heights;
+		std::vector<std::pair<size_t, Handle>> by_height;
+		by_height.reserve(dirty.size());
+		for (const Handle& h : dirty)
+			by_height.push_back({height(h, heights), h});
+		heights.clear();
+		std::stable_sort(by_height.begin(), by_height.end(),
+			[](const std::pair<size_t, Handle>& a,
+			   const std::pair<size_t, Handle>& b) {
+				return a.first > b.first; });
+
+		AtomEncoder enc([&](const std::string& block) {
+			put_record(out, ADD, block);
+			if (1024 * 1024 < out.size()) { write_out(fd, out); out.clear(); }
+		});
+		std::unordered_set<Handle> written;
+		for (const auto& hp : by_height)
+		{
+			if (0 < written.count(hp.second)) continue;
+			mark_written(hp.second, written);
+			enc.add(hp.second);
+		}
+		enc.flush();
+		write_out(fd, out);
+
+		if (0 != fsync(fd))
+			throw IOException(TRACE_INFO, "Journal: fsync failed: %s",
+				strerror(errno));
+	}
+	catch (...)
+	{
+		close(fd);
+		unlink(tmp_path.c_str());
+		throw;
+	}
+	close(fd);
+
+	if (0 != rename(tmp_path.c_str(), final_path.c_str()))
+		throw IOException(TRACE_INFO, "Journal: can't rename %s: %s",
+			tmp_path.c_str(), strerror(errno));
+	sync_dir(_dir);
+
+	// The checkpoint has everything that was in these.
+	for (uint64_t k = n; 0 < k; k--)
+	{
+		if (0 != unlink(path("journal", k).c_str()) and not full) break;
+		if (full) unlink(path("checkpoint", k - 1).c_str());
+	}
+}
+
+// ==========================================================
+// Recovery.
+
+/// Cut the file short, durably, at 'len' bytes.
+static void truncate_file(const std::string& file, size_t len)
+{
+	int fd = open(file.c_str(), O_WRONLY);
+	if (fd < 0 or 0 != ftruncate(fd, len) or 0 != fsync(fd))
+	{
+		int err = errno;
+		if (0 <= fd) close(fd);
+		throw IOException(TRACE_INFO, "Journal: can't truncate %s: %s",
+			file.c_str(), strerror(err));
+	}
+	close(fd);
+}
+
+/// Apply the records in the file.  Records cut short, or damaged, at
+/// the end of the last segment were being written when the journal
+/// stopped; they were never synced, and are dropped, and cut off the
+/// file, so that it reads clean once it is no longer the last one.
+/// Anywhere else, they are an error.
+void AtomJournal::replay(const std::string& file, bool last_segment)
+{
+	std::string bytes(read_file(file));
+	const char* p = bytes.data() + MAGIC_LEN;
+	const char* end = bytes.data() + bytes.size();
+
+	auto damaged = [&](const char* what) {
+		if (last_segment)
+		{
+			logger().warn("AtomJournal: dropping %s at the end of %s",
+				what, file.c_str());
+			truncate_file(file, p - bytes.data());
+			return;
+		}
+		throw RuntimeException(TRACE_INFO, "Journal: %s in %s",
+			what, file.c_str());
+	};
+
+	if (bytes.size() < MAGIC_LEN or
+	    0 != bytes.compare(0, MAGIC_LEN, JOURNAL_MAGIC))
+	{
+		// A segment that was created, but not yet written to; it
+		// holds nothing.
+		if (last_segment and bytes.size() < MAGIC_LEN)
+		{
+			unlink(file.c_str());
+			sync_dir(_dir);
+			return;
+		}
+		throw RuntimeException(TRACE_INFO, "Journal: %s is not a journal file",
+			file.c_str());
+	}
+
+	while (p < end)
+	{
+		if (end - p < HEADER_LEN) return damaged("a partial record");
+		uint32_t len = get_u32(p);
+		uint32_t crc = get_u32(p + 4);
+		if (0 == len or (uint64_t) (end - p - 8) < len)
+			return damaged("a partial record");
+		const char* rec = p + 8;
+		if (crc32(rec, len) != crc)
+			return damaged("a damaged record");
+		p = rec + len;
+
+		RecordKind kind = (RecordKind) (unsigned char) rec[0];
+		const char* body = rec + 1;
+		const char* body_end = rec + len;
+
+		if (CHECKPOINT == kind) continue;
+
+		// The block, and then whatever else the record holds.
+		const char* q = body;
+		uint64_t blen = BinaryFormat::get_varint(q, body_end);
+		if ((uint64_t) (body_end - q) < blen) BinaryFormat::truncated();
+		AtomDecoder::Block block(AtomDecoder::decode(
+			std::string(body, q + blen - body)));
+		q += blen;
+
+		switch (kind)
+		{
+			case ADD:
+			{
+				// Set the truth values exactly; a default truth value in
+				// the record means the atom has the default now.  Atoms
+				// that were not there before have it already.
+				HandleSeq added(AtomDecoder::add_to(*_as, block));
+				for (size_t i = 0; i < added.size(); i++)
+				{
+					TruthValuePtr tv(block.atoms[i]->getTruthValue());
+					if (added[i] != block.atoms[i] and
+					    added[i]->getTruthValue() != tv)
+						added[i]->setTruthValue(tv);
+				}
+				break;
+			}
+			case REMOVE:
+			{
+				Handle h(_as->get_atom(block.atoms.back()));
+				if (h) _as->extract_atom(h, true);
+				break;
+			}
+			case SET_TV:
+			{
+				Type t = classserver().getType(
+					BinaryFormat::get_string(q, body_end));
+				uint64_t n = BinaryFormat::get_varint(q, body_end);
+				std::vector<double> v;
+				for (uint64_t i = 0; i < n; i++)
+					v.push_back(BinaryFormat::get_double(q, body_end));
+
+				Handle h(_as->get_atom(block.atoms.back()));
+				if (h) h->setTruthValue(TruthValue::factory(t, v));
+				break;
+			}
+			default:
+				throw RuntimeException(TRACE_INFO,
+					"Journal: unknown record kind %d in %s",
+					(int) kind, file.c_str());
+		}
+	}
+}
+
+void AtomJournal::recover(void)
+{
+	std::map<uint64_t, std::string> segments, checkpoints;
+
+	DIR* d = opendir(_dir.c_str());
+	if (nullptr == d)
+		throw IOException(TRACE_INFO, "Journal: can't read %s: %s",
+			_dir.c_str(), strerror(errno));
+	struct dirent* de;
+	while (nullptr != (de = readdir(d)))
+	{
+		std::string name(de->d_name);
+		unsigned long long n;
+		char rest;
+		if (1 == sscanf(name.c_str(), "journal-%llu%c", &n, &rest))
+			segments[n] = _dir + "/" + name;
+		else if (1 == sscanf(name.c_str(), "checkpoint-%llu%c", &n, &rest))
+			checkpoints[n] = _dir + "/" + name;
+		else if (0 == name.compare(0, 11, "checkpoint-"))
+			// A checkpoint that was being written; it never counted.
+			unlink((_dir + "/" + name).c_str());
+	}
+	closedir(d);
+
+	// Start from the last full checkpoint; the ones before it are
+	// left over from a compaction that was cut short.
+	auto first = checkpoints.begin();
+	for (auto it = checkpoints.begin(); it != checkpoints.end(); it++)
+	{
+		char head[MAGIC_LEN + HEADER_LEN + 1];
+		int fd = open(it->second.c_str(), O_RDONLY);
+		if (fd < 0) continue;
+		ssize_t n = read(fd, head, sizeof(head));
+		close(fd);
+		if ((ssize_t) sizeof(head) == n and
+		    CHECKPOINT == head[MAGIC_LEN + 8] and
+		    1 == head[MAGIC_LEN + HEADER_LEN])
+			first = it;
+	}
+	uint64_t covered = 0;
+	for (auto it = first; it != checkpoints.end(); it++)
+	{
+		replay(it->second, false);
+		covered = it->first;
+	}
+	_segment = covered;
+
+	for (auto it = segments.begin(); it != segments.end(); it++)
+	{
+		_segment = std::max(_segment, it->first);
+		if (it->first <= covered)
+		{
+			unlink(it->second.c_str());
+			continue;
+		}
+		replay(it->second, std::next(it) == segments.end());
+	}
+	for (auto it = checkpoints.begin(); it != first; it++)
+		unlink(it->second.c_str());
+}
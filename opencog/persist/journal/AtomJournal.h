@@ -0,0 +1,193 @@
+/*
+ * opencog/persist/journal/AtomJournal.h
+ *
+ * Copyright (C) 2017 OpenCog Foundation
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License v3 as
+ * published by the Free Software Foundation and including the exceptions
+ * at http://opencog.org/wiki/Licenses
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, write to:
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _OPENCOG_ATOM_JOURNAL_H
+#define _OPENCOG_ATOM_JOURNAL_H
+
+#include <atomic>
+#include <exception>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include <opencog/atomspace/AtomSpace.h>
+#include <opencog/atomspace/ObserverBus.h>
+#include <opencog/truthvalue/TruthValue.h>
+
+namespace opencog
+{
+/** \addtogroup grp_persist
+ *  @{
+ */
+
+/**
+ * A write-ahead journal of the changes made to an atomspace, kept in
+ * a directory of local files.
+ *
+ * Every atom added, every atom removed and every truth value changed
+ * is appended to the current journal segment.  The records are queued
+ * by the thread making the change, and written by a background thread,
+ * which writes all of the records that have queued up since its last
+ * write at once, and then syncs the file once for all of them.  So the
+ * cost of the fsync is shared among all of the changes made in the
+ * meantime, and the threads making changes never wait for the disk.
+ * A change is durable once the next group commit is done, which is
+ * within the commit interval; sync() waits for that.
+ *
+ * Every so often (or when asked, with checkpoint()), the journal
+ * writes a checkpoint: the atoms that have changed since the last
+ * checkpoint, as they are now, and the atoms that have been removed.
+ * The segments that the checkpoint covers are then deleted.  compact()
+ * writes a full checkpoint, of all atoms, and deletes the earlier
+ * checkpoints too.
+ *
+ * Opening a journal on a directory first recovers the atomspace from
+ * it: the checkpoints are applied, starting from the last full one,
+ * and then the segments written after the last checkpoint are
+ * replayed.  A record cut short by a crash, at the end of the last
+ * segment, is ignored.
+ *
+ * Values other than truth values are written with the atoms, in adds
+ * and checkpoints, but changing a value does not make a record; only
+ * the next checkpoint that includes the atom will have the change.
+ */
+class AtomJournal
+{
+	public:
+		/// The kinds of record, in journal segments and checkpoints.
+		enum RecordKind
+		{
+			ADD = 1,        // atoms, with their truth values and values
+			REMOVE = 2,     // one atom, last in the block
+			SET_TV = 3,     // one atom, and its new truth value
+			CHECKPOINT = 4, // starts a checkpoint; full or incremental
+		};
+
+	private:
+		struct Change
+		{
+			RecordKind kind;
+			Handle atom;
+			TruthValuePtr tv;
+		};
+
+		AtomSpace* _as;
+		std::string _dir;
+
+		// Guards everything below, up to the writer thread.
+		std::mutex _mtx;
+		std::condition_variable _work_cv;
+		std::condition_variable _done_cv;
+
+		std::vector<Change> _queue;
+		uint64_t _queued_seq;     // changes queued, ever
+		uint64_t _durable_seq;    // changes written and synced
+		size_t _max_queue;
+
+		// What has changed since the last checkpoint.
+		std::unordered_set<Handle> _dirty;
+		std::unordered_set<Handle> _removed;
+
+		bool _want_sync;
+		bool _want_full;
+		uint64_t _checkpoints_wanted;
+		uint64_t _checkpoints_done;
+		bool _stopping;
+		std::exception_ptr _error;
+
+		std::chrono::milliseconds _commit_interval;
+		std::chrono::seconds _checkpoint_interval;
+		bool _fsync;
+
+		// Owned by the writer thread, once it is started.
+		int _fd;
+		uint64_t _segment;
+		std::atomic<size_t> _bytes_written;
+
+		std::vector<ObserverConnection> _connections;
+		std::thread _writer;
+
+		size_t _recovered;
+
+		void enqueue(RecordKind, const Handle&, const TruthValuePtr&);
+
+		void writer_loop(void);
+		void write_changes(const std::vector<Change>&);
+		void write_checkpoint(const std::unordered_set<Handle>&,
+		                      const std::unordered_set<Handle>&, bool full);
+		void write_out(int, const std::string&);
+		void open_segment(uint64_t);
+		void recover(void);
+		void replay(const std::string&, bool last_segment);
+		std::string path(const char* prefix, uint64_t) const;
+		void request_checkpoint(bool full);
+
+	public:
+		/// Open the journal in the directory, creating the directory if
+		/// need be.  The atoms already journaled there are put into the
+		/// atomspace before journaling starts.
+		AtomJournal(AtomSpace*, const std::string& directory);
+
+		/// Write out everything queued, and stop journaling.
+		~AtomJournal();
+
+		/// Return once every change made before the call is on disk.
+		void sync(void);
+
+		/// Write an incremental checkpoint, and delete the segments it
+		/// covers.  Returns once the checkpoint is on disk.
+		void checkpoint(void);
+
+		/// Write a checkpoint of the whole atomspace, and delete all of
+		/// the earlier checkpoints and segments.
+		void compact(void);
+
+		/// How long the writer waits, after the first change of a group,
+		/// for more changes to join it.  The default is 10 milliseconds.
+		void set_commit_interval(std::chrono::milliseconds);
+
+		/// Write a checkpoint this often.  The default is five minutes;
+		/// zero writes them only when asked.
+		void set_checkpoint_interval(std::chrono::seconds);
+
+		/// Without fsync, a record is on disk only once the kernel gets
+		/// around to it; this survives the process crashing, but not
+		/// the machine.  On by default.
+		void set_fsync(bool);
+
+		/// The number of atoms put into the atomspace when the journal
+		/// was opened.
+		size_t atoms_recovered(void) const { return _recovered; }
+
+		/// The number of bytes of records written to the journal
+		/// segments (not counting checkpoints).
+		size_t bytes_written(void) const { return _bytes_written; }
+};
+
+/** @}*/
+} // namespace opencog
+
+#endif // _OPENCOG_ATOM_JOURNAL_H
@@ -1,329 +1,830 @@
-/**
- * AtomCache.cc
+/*
+ * opencog/persist/memcache/AtomCache.cc
  *
- * Persistant Atom storage, backed by memcachedb
- *
- * Atoms are saved to, and restored from one, or more, memcachdb 
- * servers.
+ * Atom storage in memcached, as a cache in front of another backing
+ * store, or on its own.
  *
  * HISTORY:
  * Copyright (c) 2008 Linas Vepstas <linas@linas.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License v3 as
+ * published by the Free Software Foundation and including the exceptions
+ * at http://opencog.org/wiki/Licenses
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, write to:
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
  */
 
-#ifdef HAVE_LIBMEMCACHED
+#include <stdio.h>
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <random>
+
+#include <opencog/atoms/base/ClassServer.h>
+#include <opencog/atoms/base/Link.h>
+#include <opencog/atoms/base/Node.h>
+#include <opencog/persist/serial/AtomEncoder.h>
+#include <opencog/truthvalue/TruthValue.h>
+#include <opencog/util/Logger.h>
+#include <opencog/util/exceptions.h>
 
 #include "AtomCache.h"
 
-#include <string>
+using namespace opencog;
 
-#include <memcached.h>
+// Entries prefetched, at most; and keys fetched per prefetch multiget.
+#define PREFETCH_LIMIT 16384
+#define PREFETCH_BATCH 512
 
-#include <opencog/util/platform.h>
-#include <opencog/atomspace/Atom.h>
-#include <opencog/atomspace/AtomTable.h>
-#include <opencog/atomspace/ClassServer.h>
-#include <opencog/atomspace/Node.h>
-#include <opencog/atomspace/Link.h>
-#include <opencog/truthvalue/SimpleTruthValue.h>
-#include <opencog/atomspace/TLB.h>
-#include <opencog/truthvalue/TruthValue.h>
+// Atoms fetched per multiget, when loading a whole type.
+#define LOAD_BATCH 4096
 
-using namespace opencog;
+// An incoming set is a list of items: the hash of the link, then the
+// hash of its type name.  A type index is a list of atom hashes.
+#define INCOMING_ITEM 12
+#define TYPE_ITEM 8
+
+// A reader that fills in an incoming set from the backend first puts a
+// lease in its place: an 'L', a random token, and the time, in msecs.
+// Its length is not a multiple of INCOMING_ITEM, and stays that way as
+// links are appended to it.
+#define LEASE_SIZE 17
+#define LEASE_MSECS 10000
 
-AtomCache::AtomCache(const std::string server, int portno)
+/* ================================================================== */
+// Keys and list items.
+
+static uint64_t fnv(uint64_t h, const char* p, size_t n)
 {
-	memcached_return rc;
-	mc = memcached_create(NULL);
+	for (size_t i = 0; i < n; i++)
+	{
+		h ^= (unsigned char) p[i];
+		h *= 0x100000001b3ULL;
+	}
+	return h;
+}
 
-	memcached_server_st *servers;
-	const char *servername = server.c_str();
-	servers = memcached_server_list_append(NULL, (char *) servername, portno, &rc);
-	
-	connect_status = memcached_server_push(mc, servers);
+static const uint64_t FNV_BASIS = 0xcbf29ce484222325ULL;
 
-	memcached_server_list_free(servers);
+static uint32_t type_hash(Type t)
+{
+	const std::string& name = classserver().getTypeName(t);
+	return (uint32_t) fnv(FNV_BASIS, name.data(), name.size());
+}
 
-	store_count = 0;
+/// Types go in by name, and nodes by name, so that the hash is the same
+/// in every process, whatever order its types were loaded in.
+static uint64_t hash_atom(const Handle& h,
+                          std::unordered_map<Handle, uint64_t>& memo)
+{
+	auto it = memo.find(h);
+	if (memo.end() != it) return it->second;
+
+	const std::string& tname = classserver().getTypeName(h->getType());
+	uint64_t x;
+	if (h->isNode())
+	{
+		x = fnv(FNV_BASIS, "N", 1);
+		x = fnv(x, tname.c_str(), tname.size() + 1);
+		x = fnv(x, h->getName().data(), h->getName().size());
+	}
+	else
+	{
+		x = fnv(FNV_BASIS, "L", 1);
+		x = fnv(x, tname.c_str(), tname.size() + 1);
+		for (const Handle& ho : h->getOutgoingSet())
+		{
+			uint64_t xo = hash_atom(ho, memo);
+			char b[8];
+			for (int i = 0; i < 8; i++) b[i] = (char) (xo >> (8 * i));
+			x = fnv(x, b, 8);
+		}
+	}
+	memo.emplace(h, x);
+	return x;
 }
 
-AtomCache::~AtomCache()
+static std::string hex_key(const char* prefix, uint64_t x)
 {
-	memcached_free(mc);
+	char key[32];
+	snprintf(key, sizeof(key), "%s%016llx", prefix, (unsigned long long) x);
+	return key;
 }
 
-/* ================================================================== */
+static std::string atom_key(uint64_t x) { return hex_key("oc:a:", x); }
+static std::string incoming_key(uint64_t x) { return hex_key("oc:i:", x); }
 
-#define CHECK_RC(rc) \
-	if(MEMCACHED_SUCCESS != rc) \
-	{ \
-		fprintf(stderr, "Error: memcachedb: %s\n", memcached_strerror(mc, rc)); \
-		return; \
-	}
+static std::string type_key(Type t)
+{
+	return "oc:t:" + classserver().getTypeName(t);
+}
 
-void AtomCache::storeAtom(Atom *atom)
+static void put_le(std::string& out, uint64_t v, int nbytes)
 {
-	memcached_return rc;
+	for (int i = 0; i < nbytes; i++)
+		out.push_back((char) (v >> (8 * i)));
+}
 
-	Handle h = atom->getHandle();
+static uint64_t get_le(const char* p, int nbytes)
+{
+	uint64_t v = 0;
+	for (int i = 0; i < nbytes; i++)
+		v |= ((uint64_t) (unsigned char) p[i]) << (8 * i);
+	return v;
+}
 
-	// Set up the basic root of the key
-#define KBSIZE 50
-	char keybuff[KBSIZE];
-	int rootlen = snprintf(keybuff, KBSIZE, "%lu/", h);
-	char *p = &keybuff[rootlen];
+static uint64_t now_msecs(void)
+{
+	using namespace std::chrono;
+	return duration_cast<milliseconds>(
+		system_clock::now().time_since_epoch()).count();
+}
 
-	// The buffer for values.
-#define VBSIZE 1050
-	char valbuff[VBSIZE];
+static std::string make_lease(void)
+{
+	static thread_local std::mt19937_64 rng(std::random_device{}());
+	std::string lease("L");
+	put_le(lease, rng(), 8);
+	put_le(lease, now_msecs(), 8);
+	return lease;
+}
 
-	// Get the atom type.
-	Type t = atom->getType();
-	strcpy(p, "type");
-	int vlen = snprintf(valbuff, VBSIZE, "%d", t);
+static bool is_lease(const std::string& list)
+{
+	return LEASE_SIZE % INCOMING_ITEM == list.size() % INCOMING_ITEM;
+}
 
-	rc = memcached_set (mc, keybuff, rootlen+4, valbuff, vlen, 0, 0);
-	CHECK_RC(rc);
+/// A reader that has held the lease this long has given up.
+static bool lease_expired(const std::string& lease)
+{
+	return get_le(lease.data() + 9, 8) + LEASE_MSECS < now_msecs();
+}
 
-	// If a node, store the name
-	Node *n = dynamic_cast<Node *>(atom);
-	if (n)
+/// The atom hashes in the list, without repeats, keeping only those
+/// of the given type if there is one.  An atom stored again after
+/// being evicted is appended again, so a list can have repeats.  A
+/// lease has none.
+static std::vector<uint64_t> list_items(const std::string& list,
+                                        size_t item_size, Type t = NOTYPE)
+{
+	uint32_t th = (NOTYPE == t) ? 0 : type_hash(t);
+	std::vector<uint64_t> items;
+	if (0 != list.size() % item_size) return items;
+	std::unordered_set<uint64_t> seen;
+	for (size_t off = 0; off + item_size <= list.size(); off += item_size)
 	{
-		strcpy(p, "name");
-		const char *name = n->getName().c_str();
-		vlen = n->getName().size();
-		rc = memcached_set (mc, keybuff, rootlen+4, name, vlen, 0, 0);
-		CHECK_RC(rc);
+		const char* p = list.data() + off;
+		if (NOTYPE != t and th != get_le(p + 8, 4)) continue;
+		uint64_t x = get_le(p, 8);
+		if (seen.insert(x).second) items.push_back(x);
 	}
-	else
-	{
-		// Store the outgoing set
-		Link *l = dynamic_cast<Link *>(atom);
-		int arity = l->getArity();
-		vlen = snprintf(valbuff, VBSIZE, "(%d", arity);
+	return items;
+}
 
-		HandleSeq out = l->getOutgoingSet();
-		for (int i=0; i<arity; i++)
-		{
-			vlen += snprintf(valbuff+vlen, VBSIZE-vlen, ", %lu", out[i]);
-		}
+/// An atom's entry has the atoms it holds, for their structure, but
+/// the values of the atom alone.
+static std::string encode_entry(const Handle& h)
+{
+	std::string entry;
+	AtomEncoder enc([&entry](const std::string& block) {
+			entry.append(block); },
+		std::numeric_limits<size_t>::max());
+	enc.set_held_values(false);
+	enc.add(h);
+	enc.flush();
+	return entry;
+}
 
-		vlen += snprintf(valbuff+vlen, VBSIZE-vlen, ")");
-		strcpy(p, "edges");
-		rc = memcached_set (mc, keybuff, rootlen+5, valbuff, vlen, 0, 0);
-		CHECK_RC(rc);
+/// The atom of an entry comes before the atoms its values refer to;
+/// move it to the end of the block, where it would be without them.
+static bool move_top(AtomDecoder::Block& b, uint64_t x,
+                     std::unordered_map<Handle, uint64_t>& memo)
+{
+	size_t last = b.atoms.size();
+	size_t top = last;
+	while (0 < top and hash_atom(b.atoms[top - 1], memo) != x) top--;
+	if (0 == top) return false;
+	top--; last--;
+	if (top == last) return true;
+
+	std::swap(b.atoms[top], b.atoms[last]);
+	auto swapped = [top, last](size_t i) {
+		return i == top ? last : (i == last ? top : i); };
+	for (AtomDecoder::Valuation& vn : b.values)
+	{
+		vn.atom = swapped(vn.atom);
+		vn.key = swapped(vn.key);
 	}
+	return true;
+}
+
+/// The truth values of the atoms held by the entry's atom are whatever
+/// they were when the entry was written; the atoms' own entries have
+/// them as they are now.
+static void strip_held(AtomDecoder::Block& b)
+{
+	size_t top = b.atoms.size() - 1;
+	for (size_t i = 0; i < top; i++)
+		b.atoms[i]->setTruthValue(TruthValue::DEFAULT_TV());
+	b.values.erase(std::remove_if(b.values.begin(), b.values.end(),
+		[top](const AtomDecoder::Valuation& vn) { return vn.atom != top; }),
+		b.values.end());
+}
 
-	// Store the truth value
-	const TruthValue &tv = atom->getTruthValue();
-	const SimpleTruthValue *stv = dynamic_cast<const SimpleTruthValue *>(&tv);
-	if (NULL == stv)
+/* ================================================================== */
+
+AtomCache::AtomCache(CacheClient* client, BackingStore* backend)
+	: _client(client), _backend(backend),
+	  _pf_limit(PREFETCH_LIMIT), _pf_generation(0),
+	  _pf_busy(false), _pf_stop(false), _prefetch(true), _pf_hits(0)
+{
+	_pf_conn = _client->connect();
+	_pf_client = _pf_conn ? _pf_conn.get() : _client;
+	_prefetcher = std::thread(&AtomCache::prefetch_loop, this);
+}
+
+AtomCache::~AtomCache()
+{
 	{
-		fprintf(stderr, "Error: non-simple truth values are not handled\n");
-		return;
+		std::lock_guard<std::mutex> lck(_pf_mtx);
+		_pf_stop = true;
+		_pf_cv.notify_one();
 	}
+	_prefetcher.join();
+}
 
-	vlen = snprintf(valbuff, VBSIZE, "(%20.16g, %20.16g)", tv.getMean(), tv.getCount());
-	strcpy(p, "stv");
-	rc = memcached_set (mc, keybuff, rootlen+3, valbuff, vlen, 0, 0);
-	CHECK_RC(rc);
+uint64_t AtomCache::atom_hash(const Handle& h)
+{
+	HashMemo memo;
+	return hash_atom(h, memo);
 }
 
 /* ================================================================== */
+// Prefetching.
 
-#define NCHECK_RC(rc, val) \
-	if(MEMCACHED_SUCCESS != rc) \
-	{ \
-		fprintf(stderr, "Error: memcachedb: %s\n", memcached_strerror(mc, rc)); \
-		if (val) free(val); \
-		return atom; \
-	}
+void AtomCache::set_prefetch(bool on)
+{
+	std::lock_guard<std::mutex> lck(_pf_mtx);
+	_prefetch = on;
+	if (not on) _pf_queue.clear();
+}
 
-Atom * AtomCache::getAtom(Handle h)
+void AtomCache::prefetch(const std::vector<std::string>& keys)
 {
-	size_t vlen;
-	uint32_t flags;
-	memcached_return rc;
-	char * val;
+	std::lock_guard<std::mutex> lck(_pf_mtx);
+	if (not _prefetch or _pf_stop) return;
+	for (const std::string& k : keys)
+		if (_prefetched.end() == _prefetched.find(k) and
+		    0 == _pf_inflight.count(k))
+			_pf_queue.push_back(k);
+
+	// A walk that runs ahead of the prefetcher wants the newest keys.
+	while (_pf_limit < _pf_queue.size()) _pf_queue.pop_front();
+	_pf_cv.notify_one();
+}
 
-	char keybuff[KBSIZE];
-	int rootlen = snprintf(keybuff, KBSIZE, "%lu/", h);
-	char *p = &keybuff[rootlen];
+void AtomCache::wait_for_prefetch(void)
+{
+	std::unique_lock<std::mutex> lck(_pf_mtx);
+	while (_pf_busy or not _pf_queue.empty())
+		_pf_idle_cv.wait(lck);
+}
 
-	// Does the atom exist already ?
-	Atom *atom = TLB::getAtom(h);
+/// Prefetched entries that a store has made out of date.
+void AtomCache::forget(const std::vector<std::string>& keys)
+{
+	std::lock_guard<std::mutex> lck(_pf_mtx);
+	_pf_generation++;
+	for (const std::string& k : keys) _prefetched.erase(k);
+}
 
-	if (NULL == atom)
+/// Keep what was fetched, unless something was stored in the meantime,
+/// which might have made it out of date.  The keys that are in flight
+/// become the next ones; whoever is waiting for the last ones is told.
+void AtomCache::stash(CacheClient::Entries& got, uint64_t generation,
+                      const std::vector<std::string>& next)
+{
+	if (generation == _pf_generation)
 	{
-		// Get the atom type.
-		strcpy(p, "type");
-		val = memcached_get(mc, keybuff, rootlen+4, &vlen, &flags, &rc);
-		NCHECK_RC(rc, val);
-		int atype = atoi(val);
-		free(val);
-	
-		if (classserver().isAssignableFrom(NODE, atype))
+		for (auto& kv : got)
 		{
-			// Get the atom name
-			strcpy(p, "name");
-			val = memcached_get(mc, keybuff, rootlen+4, &vlen, &flags, &rc);
-			NCHECK_RC(rc, val);
-			atom = new Node(atype, val);
-			free(val);
+			_pf_order.push_back(kv.first);
+			_prefetched[kv.first] = std::move(kv.second);
 		}
-		else
+		while (_pf_limit < _pf_order.size())
 		{
-			// Get the outvec.
-			strcpy(p, "edges");
-			val = memcached_get(mc, keybuff, rootlen+5, &vlen, &flags, &rc);
-			NCHECK_RC(rc, val);
+			_prefetched.erase(_pf_order.front());
+			_pf_order.pop_front();
+		}
+	}
+	_pf_inflight.clear();
+	_pf_inflight.insert(next.begin(), next.end());
+	_pf_idle_cv.notify_all();
+}
 
-			int arity = atoi(val+1);
-			HandleSeq outvec;
-			outvec.resize(arity);
+void AtomCache::prefetch_loop(void)
+{
+	std::unique_lock<std::mutex> lck(_pf_mtx);
+	while (true)
+	{
+		_pf_busy = false;
+		_pf_idle_cv.notify_all();
+		while (_pf_queue.empty() and not _pf_stop) _pf_cv.wait(lck);
+		if (_pf_stop) return;
 
-			char *comma = strchr(val+2, ',');
-			for (int i=0; i<arity; i++)
-			{
-				Handle ho = (Handle) strtoul(comma+1, &comma, 10);
-				outvec.at(i) = ho;
-			}
-			atom = new Link(atype, outvec);
+		std::vector<std::string> keys;
+		while (not _pf_queue.empty() and keys.size() < PREFETCH_BATCH)
+		{
+			std::string k(std::move(_pf_queue.back()));
+			_pf_queue.pop_back();
+			if (_prefetched.end() == _prefetched.find(k) and
+			    _pf_inflight.insert(k).second)
+				keys.push_back(std::move(k));
+		}
+		_pf_busy = true;
+		uint64_t generation = _pf_generation;
+		lck.unlock();
+
+		CacheClient::Entries got;
+		std::vector<std::string> links;
+		try
+		{
+			got = _pf_client->get_multi(keys);
+		}
+		catch (const std::exception& ex)
+		{
+			logger().warn("AtomCache: prefetch failed: %s", ex.what());
+		}
+
+		// And then the links in the incoming sets.
+		for (const auto& kv : got)
+		{
+			if (0 != kv.first.compare(0, 5, "oc:i:")) continue;
+			for (uint64_t x : list_items(kv.second, INCOMING_ITEM))
+				links.push_back(atom_key(x));
 		}
+		if (_pf_limit / 2 < links.size()) links.resize(_pf_limit / 2);
+
+		// The incoming sets can be used while the links are fetched.
+		lck.lock();
+		stash(got, generation, links);
+		if (links.empty()) continue;
+		lck.unlock();
+
+		got.clear();
+		try
+		{
+			got = _pf_client->get_multi(links);
+		}
+		catch (const std::exception& ex)
+		{
+			logger().warn("AtomCache: prefetch failed: %s", ex.what());
+		}
+
+		lck.lock();
+		stash(got, generation, {});
 	}
+}
+
+/// After fetching the incoming set of h, prefetch the incoming sets of
+/// the links in it, and of the other atoms those links hold.
+void AtomCache::prefetch_neighbors(const Handle& h,
+                                   const std::vector<Block>& links,
+                                   HashMemo& memo)
+{
+	if (not _prefetch) return;
 
-	// Fetch the truth value
-	const TruthValue &tv = atom->getTruthValue();
-	const SimpleTruthValue *stv = dynamic_cast<const SimpleTruthValue *>(&tv);
-	if (NULL == stv)
+	std::vector<std::string> keys;
+	for (const Block& b : links)
 	{
-		fprintf(stderr, "Error: non-simple truth values are not handled\n");
-		return atom;
+		const Handle& l = b.atoms.back();
+		keys.push_back(incoming_key(hash_atom(l, memo)));
+		for (const Handle& ho : l->getOutgoingSet())
+			if (*ho != *h)
+				keys.push_back(incoming_key(hash_atom(ho, memo)));
+		if (PREFETCH_BATCH <= keys.size()) break;
 	}
+	prefetch(keys);
+}
 
-	strcpy(p, "stv");
-	val = memcached_get(mc, keybuff, rootlen+3, &vlen, &flags, &rc);
-	NCHECK_RC(rc, val);
+/* ================================================================== */
+// Reading.
 
-	double mean = atof(val+1);
-	char *comma = strchr(val+2, ',');
-	double count = atof(comma+1);
-	SimpleTruthValue nstv(mean,count);
-	atom->setTruthValue(nstv);
+/// The entries for the keys; those that were prefetched, or are being
+/// prefetched right now, and the rest with one multiget.
+CacheClient::Entries AtomCache::fetch(const std::vector<std::string>& keys) const
+{
+	CacheClient::Entries got;
+	std::vector<std::string> rest;
+	{
+		std::unique_lock<std::mutex> lck(_pf_mtx);
+		std::vector<std::string> pending(keys);
+		while (true)
+		{
+			std::vector<std::string> inflight;
+			for (std::string& k : pending)
+			{
+				auto it = _prefetched.find(k);
+				if (_prefetched.end() != it)
+				{
+					got.emplace(k, std::move(it->second));
+					_prefetched.erase(it);
+					_pf_hits++;
+				}
+				else if (_pf_inflight.count(k))
+					inflight.push_back(std::move(k));
+				else
+					rest.push_back(std::move(k));
+			}
+			if (inflight.empty()) break;
 
-	return atom;
+			// On its way already; that is sooner than another round trip.
+			pending.swap(inflight);
+			_pf_idle_cv.wait(lck);
+		}
+	}
+	if (rest.empty()) return got;
+
+	CacheClient::Entries more(_client->get_multi(rest));
+	got.insert(more.begin(), more.end());
+	return got;
 }
 
-/* ================================================================== */
+/// Decode the entry, and check that it is the atom that was asked for.
+/// A damaged entry is dropped from the cache.
+bool AtomCache::decode_entry(const std::string& key, const std::string& entry,
+                             uint64_t x, Block& b, HashMemo& memo) const
+{
+	try
+	{
+		b = AtomDecoder::decode(entry);
+	}
+	catch (const RuntimeException& ex)
+	{
+		logger().warn("AtomCache: dropping bad entry %s: %s",
+			key.c_str(), ex.what());
+		_client->remove(key);
+		return false;
+	}
+	if (not move_top(b, x, memo)) return false;
+	strip_held(b);
+	return true;
+}
+
+Handle AtomCache::get_from_backend(const Handle& h) const
+{
+	if (nullptr == _backend) return Handle::UNDEFINED;
+	if (h->isNode())
+		return _backend->getNode(h->getType(), h->getName().c_str());
+	return _backend->getLink(h->getType(), h->getOutgoingSet());
+}
 
-void AtomCache::load_list(AtomTable &table, int depth)
+/// The atom like h (which need not be in any atomspace), with its
+/// truth value, from the cache, or else from the backend.
+Handle AtomCache::get_atom(const Handle& h) const
 {
-	size_t vlen;
-	uint32_t flags;
-	memcached_return rc;
-	char * val;
+	HashMemo memo;
+	uint64_t x = hash_atom(h, memo);
+	std::string key(atom_key(x));
+
+	CacheClient::Entries got(fetch({key}));
+	auto it = got.find(key);
+	Block b;
+	if (got.end() != it and decode_entry(key, it->second, x, b, memo))
+		return b.atoms.back();
+
+	Handle found(get_from_backend(h));
+	if (found) _client->add(key, encode_entry(found));
+	return found;
+}
 
-	char keybuff[KBSIZE];
-	size_t klen = snprintf(keybuff, KBSIZE, "depth-list-%d", depth);
-	val = memcached_get(mc, keybuff, klen, &vlen, &flags, &rc);
+Handle AtomCache::getNode(Type t, const char * name) const
+{
+	return get_atom(Handle(createNode(t, name)));
+}
 
-printf("duude depth=%d nodelist len=%d\n", depth, vlen);
-	if ((vlen == 0) || (NULL == val)) return;
+Handle AtomCache::getLink(Type t, const HandleSeq& hs) const
+{
+	return get_atom(Handle(createLink(hs, t)));
+}
 
-	unsigned long ilc = load_count;
-	char *comma = val;
-	while (comma)
+/// Put the atoms of the entries into the table.  The atoms held by
+/// the links are in each entry, but only for their structure; their
+/// truth values and values come from their own entries, which are
+/// fetched, for those atoms not in the table yet, one level at a time,
+/// with one multiget per level.
+void AtomCache::add_entries(AtomTable& table, std::vector<Block>& blocks,
+                            bool only_new) const
+{
+	HashMemo memo;
+	std::unordered_set<uint64_t> asked;
+	for (const Block& b : blocks)
+		asked.insert(hash_atom(b.atoms.back(), memo));
+
+	std::vector<Block> all;
+	std::vector<Block> level;
+	level.swap(blocks);
+	while (not level.empty())
 	{
-		Handle h = (Handle) strtoul(comma+1, &comma, 10);
-		getAtom(h);
-		load_count ++;
-		if (load_count%1000 == 0)
+		std::vector<std::string> keys;
+		std::vector<uint64_t> hashes;
+		HandleSeq wanted;
+		for (Block& b : level)
 		{
-			fprintf(stderr, "\tLoaded %lu atoms.\n", load_count);
+			const Handle& top = b.atoms.back();
+			if (top->isLink())
+				for (const Handle& ho : top->getOutgoingSet())
+				{
+					if (table.getHandle(ho)) continue;
+					uint64_t x = hash_atom(ho, memo);
+					if (not asked.insert(x).second) continue;
+					keys.push_back(atom_key(x));
+					hashes.push_back(x);
+					wanted.push_back(ho);
+				}
+			all.push_back(std::move(b));
+		}
+		level.clear();
+		if (keys.empty()) break;
+
+		CacheClient::Entries got(fetch(keys));
+		for (size_t i = 0; i < keys.size(); i++)
+		{
+			Block b;
+			auto it = got.find(keys[i]);
+			if (got.end() != it and
+			    decode_entry(keys[i], it->second, hashes[i], b, memo))
+			{
+				level.push_back(std::move(b));
+				continue;
+			}
+
+			// Not cached; the structural copy will do, unless the
+			// backend has the atom.
+			Handle found(get_from_backend(wanted[i]));
+			if (nullptr == found) continue;
+			std::string entry(encode_entry(found));
+			_client->add(keys[i], entry);
+			if (decode_entry(keys[i], entry, hashes[i], b, memo))
+				level.push_back(std::move(b));
 		}
 	}
-	free(val);
 
-	fprintf(stderr, "\tLoaded %lu atoms of depth %d.\n", load_count- ilc, depth);
+	// Deepest first, so that the atoms the links hold are in the table,
+	// with their own truth values, before the links are.
+	for (auto it = all.rbegin(); it != all.rend(); it++)
+	{
+		if (only_new and table.getHandle(it->atoms.back())) continue;
+		AtomDecoder::add_to(table, *it);
+	}
 }
 
-void AtomCache::load(AtomTable &table)
+/// Fetch the links, with one multiget, and put them into the table;
+/// return false if any of them are not in the cache.
+bool AtomCache::get_links(AtomTable& table, const Handle& h,
+                          const std::vector<uint64_t>& hashes, Type t,
+                          HashMemo& memo)
 {
-	load_count = 0;
-	for (int i=0; i<MAX_LATTICE_DEPTH; i++)
+	std::vector<std::string> keys;
+	for (uint64_t x : hashes) keys.push_back(atom_key(x));
+	CacheClient::Entries got(fetch(keys));
+
+	bool complete = true;
+	std::vector<Block> blocks;
+	for (size_t i = 0; i < keys.size(); i++)
 	{
-		load_list(table, i);
+		auto it = got.find(keys[i]);
+		Block b;
+		if (got.end() == it or
+		    not decode_entry(keys[i], it->second, hashes[i], b, memo))
+		{
+			complete = false;
+			continue;
+		}
+		if (NOTYPE != t and b.atoms.back()->getType() != t) continue;
+		blocks.push_back(std::move(b));
 	}
-}
 
-/* ================================================================== */
+	prefetch_neighbors(h, blocks, memo);
+	add_entries(table, blocks, false);
+	return complete;
+}
 
-int AtomCache::depth(Atom *atom)
+/// Put a lease in place of the incoming set, if it is still what was
+/// seen, or still missing if nothing was; return it, or an empty
+/// string if another reader got there first.
+std::string AtomCache::take_lease(const std::string& ikey,
+                                  const std::string* seen)
 {
-	Link *l = dynamic_cast<Link *>(atom);
-	if (NULL == l) return 0;
+	std::string lease(make_lease());
+	bool taken = seen ? _client->cas(ikey, *seen, lease)
+	                  : _client->add(ikey, lease);
+	return taken ? lease : "";
+}
 
-	int maxd = 0;
-	int arity = l->getArity();
+/// Get the incoming set from the backend, and cache it, if the lease
+/// was taken, before the backend was read.  A link stored in the
+/// meantime was appended to the lease, and might not be in what was
+/// read; then the lease is left to run out, and reads go around it.
+void AtomCache::incoming_from_backend(AtomTable& table, const Handle& h,
+                                      const std::string& ikey,
+                                      const std::string& lease, HashMemo& memo)
+{
+	AtomTable scratch;
+	_backend->getIncomingSet(scratch, h);
 
-	HandleSeq out = l->getOutgoingSet();
-	for (int i=0; i<arity; i++)
+	std::string list;
+	std::vector<Block> blocks;
+	Handle hs(scratch.getHandle(h));
+	if (hs)
 	{
-		Handle h = out[i];
-		int d = depth(TLB::getAtom(h));
-		if (maxd < d) maxd = d;
+		for (const LinkPtr& lp : hs->getIncomingSet())
+		{
+			Handle l(lp);
+			uint64_t x = hash_atom(l, memo);
+			_client->add(atom_key(x), encode_entry(l));
+			put_le(list, x, 8);
+			put_le(list, type_hash(l->getType()), 4);
+			blocks.push_back(AtomDecoder::decode(AtomEncoder::encode({l})));
+			move_top(blocks.back(), x, memo);
+		}
 	}
-	return maxd +1;
+	if (not lease.empty()) _client->cas(ikey, lease, list);
+
+	for (Block& b : blocks)
+		AtomDecoder::add_to(table, b);
 }
 
-/* ================================================================== */
+void AtomCache::getIncomingSet(AtomTable& table, const Handle& h)
+{
+	HashMemo memo;
+	std::string ikey(incoming_key(hash_atom(h, memo)));
+	CacheClient::Entries got(fetch({ikey}));
+	auto it = got.find(ikey);
+	if (got.end() == it)
+	{
+		if (_backend)
+			incoming_from_backend(table, h, ikey,
+				take_lease(ikey, nullptr), memo);
+		return;
+	}
+
+	// Another reader is filling it in; go around it, unless it has
+	// given up.
+	if (_backend and is_lease(it->second))
+	{
+		std::string lease;
+		if (lease_expired(it->second)) lease = take_lease(ikey, &it->second);
+		incoming_from_backend(table, h, ikey, lease, memo);
+		return;
+	}
 
-bool AtomCache::store_cb(Atom *atom)
+	bool complete = get_links(table, h,
+		list_items(it->second, INCOMING_ITEM), NOTYPE, memo);
+
+	// Some of the links have been evicted; the backend has them all.
+	if (not complete and _backend)
+		incoming_from_backend(table, h, ikey,
+			take_lease(ikey, &it->second), memo);
+}
+
+void AtomCache::getIncomingByType(AtomTable& table, const Handle& h, Type t)
 {
-	Handle h = atom->getHandle();
+	HashMemo memo;
+	std::string ikey(incoming_key(hash_atom(h, memo)));
+	CacheClient::Entries got(fetch({ikey}));
+	auto it = got.find(ikey);
+	if (got.end() != it and not is_lease(it->second) and
+	    get_links(table, h, list_items(it->second, INCOMING_ITEM, t), t, memo))
+		return;
 
-	// Build an index of atoms of a given depth
-	char hbuff[KBSIZE];
-	snprintf(hbuff, KBSIZE, "%lu, ", h);
+	if (_backend) _backend->getIncomingByType(table, h, t);
+}
 
-	int d = depth(atom);
-	depth_list[d] += hbuff;
-	if (maxdepth < d) maxdepth = d;
+/// With a backend, that is where whole types are loaded from; the
+/// cache keeps an index of the atoms of each type only when it is the
+/// only store.
+void AtomCache::loadType(AtomTable& table, Type t)
+{
+	if (_backend)
+	{
+		_backend->loadType(table, t);
+		return;
+	}
+
+	std::string tkey(type_key(t));
+	CacheClient::Entries got(_client->get_multi({tkey}));
+	auto it = got.find(tkey);
+	if (got.end() == it) return;
 
-	// store the acctual atom.
-	storeAtom(atom);
-	store_count ++;
-	if (store_count%1000 == 0)
+	std::vector<uint64_t> hashes(list_items(it->second, TYPE_ITEM));
+	HashMemo memo;
+	for (size_t start = 0; start < hashes.size(); start += LOAD_BATCH)
 	{
-		fprintf(stderr, "\tStored %lu atoms.\n", store_count);
+		size_t end = std::min(hashes.size(), start + LOAD_BATCH);
+		std::vector<std::string> keys;
+		for (size_t i = start; i < end; i++)
+			keys.push_back(atom_key(hashes[i]));
+
+		CacheClient::Entries atoms(_client->get_multi(keys));
+		std::vector<Block> blocks;
+		for (size_t i = start; i < end; i++)
+		{
+			auto at = atoms.find(keys[i - start]);
+			Block b;
+			if (atoms.end() != at and
+			    decode_entry(keys[i - start], at->second, hashes[i], b, memo) and
+			    b.atoms.back()->getType() == t)
+				blocks.push_back(std::move(b));
+		}
+		add_entries(table, blocks, true);
 	}
-	return false;
 }
 
-void AtomCache::store(const AtomTable &table)
+/* ================================================================== */
+// Writing.
+
+/// Append to a list.  With a backend, a list that is not in the cache
+/// is fetched from the backend when it is wanted, so there is nothing
+/// to append to; one that is being fetched is a lease, and appending
+/// to that keeps the reader from caching what it read.  Without a
+/// backend, the list starts here.
+void AtomCache::append_item(const std::string& key, const std::string& item)
 {
-	memcached_return rc;
-	int i;
-	maxdepth = 0;
+	if (_client->append(key, item)) return;
+	if (_backend) return;
+	if (_client->add(key, item)) return;
 
-	for (i=0; i<MAX_LATTICE_DEPTH; i++)
+	// Someone else started it in the meantime.
+	_client->append(key, item);
+}
+
+void AtomCache::store_recursive(const Handle& h, HashMemo& memo,
+                                std::unordered_set<Handle>& done)
+{
+	if (not done.insert(h).second) return;
+	if (h->isLink())
+		for (const Handle& ho : h->getOutgoingSet())
+			store_recursive(ho, memo, done);
+
+	uint64_t x = hash_atom(h, memo);
+	std::string key(atom_key(x));
+	std::string entry(encode_entry(h));
+
+	std::vector<std::string> stale({key});
+	if (h->isLink())
+		for (const Handle& ho : h->getOutgoingSet())
+			stale.push_back(incoming_key(hash_atom(ho, memo)));
+	if (nullptr == _backend) stale.push_back(type_key(h->getType()));
+	forget(stale);
+
+	if (not _client->add(key, entry))
 	{
-		depth_list[i] = "(";
+		_client->set(key, entry);
+		return;
 	}
 
-	table.foreach_atom(&AtomCache::store_cb, this);
-
-	// store the index lists too
-	for (i=0; i<maxdepth; i++)
+	// A new atom joins the incoming sets of the atoms it holds.
+	std::string item;
+	put_le(item, x, 8);
+	put_le(item, type_hash(h->getType()), 4);
+	if (h->isLink())
 	{
-		depth_list[i] += ")";
-
-		char keybuff[KBSIZE];
-		size_t klen = snprintf(keybuff, KBSIZE, "depth-list-%d", i);
-		rc = memcached_set (mc, keybuff, klen, depth_list[i].c_str(), depth_list[i].size(), 0, 0);
-		CHECK_RC(rc);
+		std::unordered_set<uint64_t> seen;
+		for (const Handle& ho : h->getOutgoingSet())
+		{
+			uint64_t xo = hash_atom(ho, memo);
+			if (seen.insert(xo).second)
+				append_item(incoming_key(xo), item);
+		}
 	}
+	if (nullptr == _backend)
+		append_item(type_key(h->getType()), item.substr(0, TYPE_ITEM));
 }
 
-#endif /* HAVE_LIBMEMCACHED */
+void AtomCache::storeAtom(const Handle& h)
+{
+	if (_backend) _backend->storeAtom(h);
+
+	HashMemo memo;
+	std::unordered_set<Handle> done;
+	store_recursive(h, memo, done);
+}
+
+void AtomCache::barrier()
+{
+	if (_backend) _backend->barrier();
+	_client->flush();
+}
 
 /* ======================= END OF FILE ============================== */
@@ -1,25 +1,47 @@
-/**
- * AtomCache.h
- *
- * Persistant Atom storage, backed by memcachedb
+/*
+ * opencog/persist/memcache/AtomCache.h
  *
- * Atoms are saved to, and restored from one, or more, memcachdb 
- * servers.
+ * Atom storage in memcached, as a cache in front of another backing
+ * store, or on its own.
  *
  * HISTORY:
  * Copyright (c) 2008 Linas Vepstas <linas@linas.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License v3 as
+ * published by the Free Software Foundation and including the exceptions
+ * at http://opencog.org/wiki/Licenses
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, write to:
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
  */
 
-#ifndef _OPENCOG_ATOM_STORAGE_H
-#define _OPENCOG_ATOM_STORAGE_H
-
-#ifdef HAVE_LIBMEMCACHED
+#ifndef _OPENCOG_ATOM_CACHE_H
+#define _OPENCOG_ATOM_CACHE_H
 
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
 #include <string>
-#include <memcached.h>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
-#include <opencog/atomspace/Atom.h>
+#include <opencog/atoms/base/Handle.h>
 #include <opencog/atomspace/AtomTable.h>
+#include <opencog/atomspace/BackingStore.h>
+#include <opencog/persist/memcache/CacheClient.h>
+#include <opencog/persist/serial/AtomDecoder.h>
 
 namespace opencog
 {
@@ -27,37 +49,114 @@ namespace opencog
  *  @{
  */
 
-class AtomCache
+/**
+ * A BackingStore that keeps atoms in memcached (or anything else that
+ * speaks CacheClient).
+ *
+ * Given another backing store, such as the SQL one, it is a read-
+ * through cache in front of it: reads are answered from the cache when
+ * they can be, and from the backend when they can't, filling in the
+ * cache as they go; stores go to the backend, and update the cache.
+ * Without one, the cache is the only store, and whatever memcached
+ * evicts is gone.
+ *
+ * Each atom is an entry, in the binary atom format, keyed by a hash of
+ * the atom's type names and node names, so that the keys are the same
+ * in every process.  The incoming set of each atom is an entry too, a
+ * list of the hashes of the links, appended to as links are stored.
+ * Fetching an incoming set takes one get for the list, and one
+ * multiget for all of the links in it; the atoms the links hold that
+ * are not in the atom table yet are then fetched with one multiget per
+ * level.  After each incoming set, a background thread prefetches the
+ * incoming sets of the neighbouring atoms, and the links in them, so
+ * that a walk over the graph mostly finds what it needs already here.
+ *
+ * See the README in this directory for the layout of the entries.
+ */
+class AtomCache : public BackingStore
 {
 	private:
-		memcached_st *mc;
-		memcached_return connect_status;
+		typedef std::unordered_map<Handle, uint64_t> HashMemo;
+		typedef AtomDecoder::Block Block;
+
+		CacheClient* _client;
+		BackingStore* _backend;
+
+		// The prefetcher's own connection, if the client can make one,
+		// so that the reads asked for don't queue up behind prefetches.
+		std::unique_ptr<CacheClient> _pf_conn;
+		CacheClient* _pf_client;
 
-		unsigned long store_count;
-		bool store_cb(Atom *);
+		// Prefetched entries, each used at most once; all of this
+		// is guarded by _pf_mtx.
+		mutable std::mutex _pf_mtx;
+		mutable std::condition_variable _pf_cv;
+		mutable std::condition_variable _pf_idle_cv;
+		mutable CacheClient::Entries _prefetched;
+		std::deque<std::string> _pf_order;
+		std::deque<std::string> _pf_queue;
+		std::unordered_set<std::string> _pf_inflight;
+		size_t _pf_limit;
+		uint64_t _pf_generation;
+		bool _pf_busy;
+		bool _pf_stop;
+		bool _prefetch;
+		mutable std::atomic<size_t> _pf_hits;
+		std::thread _prefetcher;
 
-		int depth(Atom *);
-		int maxdepth;
-#define MAX_LATTICE_DEPTH 20
-		std::string depth_list[MAX_LATTICE_DEPTH];
+		void prefetch_loop(void);
+		void stash(CacheClient::Entries&, uint64_t,
+		           const std::vector<std::string>&);
+		void prefetch(const std::vector<std::string>&);
+		void prefetch_neighbors(const Handle&, const std::vector<Block>&,
+		                        HashMemo&);
+		void forget(const std::vector<std::string>&);
 
-		unsigned long load_count;
-		void load_list(AtomTable &, int);
+		CacheClient::Entries fetch(const std::vector<std::string>&) const;
+		bool decode_entry(const std::string& key, const std::string& entry,
+		                  uint64_t, Block&, HashMemo&) const;
+		Handle get_atom(const Handle&) const;
+		Handle get_from_backend(const Handle&) const;
+		void add_entries(AtomTable&, std::vector<Block>&, bool only_new) const;
+		bool get_links(AtomTable&, const Handle&, const std::vector<uint64_t>&,
+		               Type, HashMemo&);
+		std::string take_lease(const std::string&, const std::string*);
+		void incoming_from_backend(AtomTable&, const Handle&,
+		                           const std::string& ikey,
+		                           const std::string& lease, HashMemo&);
+		void store_recursive(const Handle&, HashMemo&,
+		                     std::unordered_set<Handle>&);
+		void append_item(const std::string&, const std::string&);
 
 	public:
-		AtomCache(const std::string server, int portno);
+		/// The cache client, and the backing store behind the cache, if
+		/// any, must outlive the AtomCache.
+		AtomCache(CacheClient*, BackingStore* backend = nullptr);
 		~AtomCache();
 
+		virtual Handle getNode(Type, const char *) const;
+		virtual Handle getLink(Type, const HandleSeq&) const;
+		virtual void getIncomingSet(AtomTable&, const Handle&);
+		virtual void getIncomingByType(AtomTable&, const Handle&, Type);
+		virtual void storeAtom(const Handle&);
+		virtual void loadType(AtomTable&, Type);
+		virtual void barrier();
 
-		void storeAtom(Atom *);
-		Atom * getAtom(Handle);
-		void load(AtomTable &);
-		void store(const AtomTable &);
+		/// Prefetching is on by default.
+		void set_prefetch(bool);
+
+		/// The number of entries that were prefetched before they were
+		/// asked for.
+		size_t prefetch_hits(void) const { return _pf_hits; }
+
+		/// Return once the prefetches asked for so far are done.
+		void wait_for_prefetch(void);
+
+		/// The hash that an atom is stored under.
+		static uint64_t atom_hash(const Handle&);
 };
 
 /** @}*/
-}
-
-#endif // HAVE_LIBMEMCACHED
+} // namespace opencog
 
-#endif // _OPENCOG_ATOM_STORAGE_H
+#endif // _OPENCOG_ATOM_CACHE_H
@@ -0,0 +1,91 @@
+/*
+ * opencog/persist/memcache/CacheClient.h
+ *
+ * Copyright (C) 2017 OpenCog Foundation
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License v3 as
+ * published by the Free Software Foundation and including the exceptions
+ * at http://opencog.org/wiki/Licenses
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, write to:
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _OPENCOG_CACHE_CLIENT_H
+#define _OPENCOG_CACHE_CLIENT_H
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace opencog
+{
+/** \addtogroup grp_persist
+ *  @{
+ */
+
+/**
+ * The handful of memcached commands that the AtomCache uses.  The
+ * MemcachedClient sends them to memcached servers; the InProcessCache
+ * keeps the entries in a hash table, for the unit tests and for
+ * running without a server.
+ *
+ * Implementations must be safe to call from several threads at once.
+ * Errors talking to the cache are thrown as IOExceptions; a key that
+ * is missing is not an error.
+ */
+class CacheClient
+{
+	public:
+		typedef std::unordered_map<std::string, std::string> Entries;
+
+		virtual ~CacheClient() {}
+
+		/// Fetch all of the keys, in one round trip.  Keys that are not
+		/// in the cache are not in the result.
+		virtual Entries get_multi(const std::vector<std::string>&) = 0;
+
+		/// Store the value, whether or not the key is there already.
+		virtual void set(const std::string& key, const std::string&) = 0;
+
+		/// Store the value only if the key is not there yet; return
+		/// false if it was.
+		virtual bool add(const std::string& key, const std::string&) = 0;
+
+		/// Append to the value of a key that is there; return false,
+		/// and store nothing, if it is not.
+		virtual bool append(const std::string& key, const std::string&) = 0;
+
+		/// Replace the value of a key only if it is still the expected
+		/// one; return false, and store nothing, if it is not, or if
+		/// the key is not there.
+		virtual bool cas(const std::string& key, const std::string& expected,
+		                 const std::string&) = 0;
+
+		virtual void remove(const std::string& key) = 0;
+
+		/// Return once every command sent so far has been carried out.
+		virtual void flush(void) {}
+
+		/// Another client of the same cache, over a connection of its
+		/// own, so that a thread using it need not wait for this one's
+		/// round trips.  A null pointer, the default, means that there
+		/// is only the one connection.
+		virtual std::unique_ptr<CacheClient> connect(void)
+		{ return nullptr; }
+};
+
+/** @}*/
+} // namespace opencog
+
+#endif // _OPENCOG_CACHE_CLIENT_H
@@ -0,0 +1,128 @@
+/*
+ * opencog/persist/memcache/InProcessCache.cc
+ *
+ * Copyright (C) 2017 OpenCog Foundation
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License v3 as
+ * published by the Free Software Foundation and including the exceptions
+ * at http://opencog.org/wiki/Licenses
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, write to:
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <thread>
+
+#include "InProcessCache.h"
+
+using namespace opencog;
+
+InProcessCache::InProcessCache()
+	: _server(std::make_shared<Server>())
+{
+}
+
+InProcessCache::InProcessCache(const std::shared_ptr<Server>& server)
+	: _server(server)
+{
+}
+
+std::unique_ptr<CacheClient> InProcessCache::connect(void)
+{
+	return std::unique_ptr<CacheClient>(new InProcessCache(_server));
+}
+
+/// Called with _conn_mtx held, so that the commands on one connection
+/// take their turns, as they do on a socket.
+void InProcessCache::round_trip(void)
+{
+	_server->round_trips++;
+	std::chrono::microseconds delay(_server->delay);
+	if (0 < delay.count())
+		std::this_thread::sleep_for(delay);
+}
+
+CacheClient::Entries
+InProcessCache::get_multi(const std::vector<std::string>& keys)
+{
+	std::lock_guard<std::mutex> conn(_conn_mtx);
+	round_trip();
+	_server->keys_fetched += keys.size();
+
+	Entries found;
+	std::lock_guard<std::mutex> lck(_server->mtx);
+	for (const std::string& k : keys)
+	{
+		auto it = _server->entries.find(k);
+		if (_server->entries.end() != it) found.emplace(k, it->second);
+	}
+	return found;
+}
+
+void InProcessCache::set(const std::string& key, const std::string& value)
+{
+	std::lock_guard<std::mutex> conn(_conn_mtx);
+	round_trip();
+	std::lock_guard<std::mutex> lck(_server->mtx);
+	_server->entries[key] = value;
+}
+
+bool InProcessCache::add(const std::string& key, const std::string& value)
+{
+	std::lock_guard<std::mutex> conn(_conn_mtx);
+	round_trip();
+	std::lock_guard<std::mutex> lck(_server->mtx);
+	return _server->entries.emplace(key, value).second;
+}
+
+bool InProcessCache::append(const std::string& key, const std::string& value)
+{
+	std::lock_guard<std::mutex> conn(_conn_mtx);
+	round_trip();
+	std::lock_guard<std::mutex> lck(_server->mtx);
+	auto it = _server->entries.find(key);
+	if (_server->entries.end() == it) return false;
+	it->second.append(value);
+	return true;
+}
+
+bool InProcessCache::cas(const std::string& key, const std::string& expected,
+                         const std::string& value)
+{
+	std::lock_guard<std::mutex> conn(_conn_mtx);
+	round_trip();
+	std::lock_guard<std::mutex> lck(_server->mtx);
+	auto it = _server->entries.find(key);
+	if (_server->entries.end() == it or it->second != expected) return false;
+	it->second = value;
+	return true;
+}
+
+void InProcessCache::remove(const std::string& key)
+{
+	std::lock_guard<std::mutex> conn(_conn_mtx);
+	round_trip();
+	std::lock_guard<std::mutex> lck(_server->mtx);
+	_server->entries.erase(key);
+}
+
+size_t InProcessCache::size(void)
+{
+	std::lock_guard<std::mutex> lck(_server->mtx);
+	return _server->entries.size();
+}
+
+void InProcessCache::clear(void)
+{
+	std::lock_guard<std::mutex> lck(_server->mtx);
+	_server->entries.clear();
+}
@@ -0,0 +1,100 @@
+/*
+ * opencog/persist/memcache/InProcessCache.h
+ *
+ * Copyright (C) 2017 OpenCog Foundation
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License v3 as
+ * published by the Free Software Foundation and including the exceptions
+ * at http://opencog.org/wiki/Licenses
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, write to:
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _OPENCOG_IN_PROCESS_CACHE_H
+#define _OPENCOG_IN_PROCESS_CACHE_H
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+
+#include <opencog/persist/memcache/CacheClient.h>
+
+namespace opencog
+{
+/** \addtogroup grp_persist
+ *  @{
+ */
+
+/**
+ * A stand-in for memcached, in the same process: the entries are kept
+ * in a hash table.  It counts the round trips made to it, and can be
+ * told to take a while over each one, as a server on the network
+ * would, so that tests and benchmarks can see what batching saves.
+ *
+ * Like a MemcachedClient, each client is one connection, that carries
+ * one command at a time; a client made with connect() shares the
+ * entries, the delay and the counts, but not the connection.
+ */
+class InProcessCache : public CacheClient
+{
+	private:
+		struct Server
+		{
+			std::mutex mtx;
+			Entries entries;
+			std::atomic<std::chrono::microseconds::rep> delay;
+			std::atomic<size_t> round_trips;
+			std::atomic<size_t> keys_fetched;
+			Server() : delay(0), round_trips(0), keys_fetched(0) {}
+		};
+		std::shared_ptr<Server> _server;
+
+		// Held for the whole of each command, delay and all.
+		std::mutex _conn_mtx;
+
+		void round_trip(void);
+		InProcessCache(const std::shared_ptr<Server>&);
+
+	public:
+		InProcessCache();
+
+		virtual Entries get_multi(const std::vector<std::string>&);
+		virtual void set(const std::string&, const std::string&);
+		virtual bool add(const std::string&, const std::string&);
+		virtual bool append(const std::string&, const std::string&);
+		virtual bool cas(const std::string&, const std::string&,
+		                 const std::string&);
+		virtual void remove(const std::string&);
+		virtual std::unique_ptr<CacheClient> connect(void);
+
+		/// Sleep this long on every command.  Other connections carry
+		/// on meanwhile; this one does not.
+		void set_delay(std::chrono::microseconds d)
+		{ _server->delay = d.count(); }
+
+		/// The number of commands, and the number of keys asked for,
+		/// over all of the connections.
+		size_t round_trips(void) const { return _server->round_trips; }
+		size_t keys_fetched(void) const { return _server->keys_fetched; }
+		void reset_counts(void)
+		{ _server->round_trips = 0; _server->keys_fetched = 0; }
+
+		size_t size(void);
+		void clear(void);
+};
+
+/** @}*/
+} // namespace opencog
+
+#endif // _OPENCOG_IN_PROCESS_CACHE_H
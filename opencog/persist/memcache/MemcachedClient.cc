@@ -0,0 +1,206 @@
+/*
+ * opencog/persist/memcache/MemcachedClient.cc
+ *
+ * Copyright (C) 2017 OpenCog Foundation
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License v3 as
+ * published by the Free Software Foundation and including the exceptions
+ * at http://opencog.org/wiki/Licenses
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, write to:
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <string.h>
+
+#include <libmemcached/memcached.h>
+
+#include <opencog/util/exceptions.h>
+
+#include "MemcachedClient.h"
+
+using namespace opencog;
+
+MemcachedClient::MemcachedClient(const std::string& servers)
+	: _expiration(0)
+{
+	_mc = memcached_create(nullptr);
+	if (nullptr == _mc)
+		throw IOException(TRACE_INFO, "memcached: can't create a client");
+
+	memcached_server_st* list = memcached_servers_parse(servers.c_str());
+	if (nullptr == list)
+	{
+		memcached_free(_mc);
+		throw IOException(TRACE_INFO, "memcached: bad server list \"%s\"",
+			servers.c_str());
+	}
+	memcached_return_t rc = memcached_server_push(_mc, list);
+	memcached_server_list_free(list);
+
+	if (MEMCACHED_SUCCESS == rc)
+		rc = memcached_behavior_set(_mc,
+			MEMCACHED_BEHAVIOR_BINARY_PROTOCOL, 1);
+	if (MEMCACHED_SUCCESS == rc)
+		rc = memcached_behavior_set(_mc, MEMCACHED_BEHAVIOR_TCP_NODELAY, 1);
+	if (MEMCACHED_SUCCESS == rc)
+		rc = memcached_behavior_set(_mc, MEMCACHED_BEHAVIOR_SUPPORT_CAS, 1);
+	if (MEMCACHED_SUCCESS != rc)
+	{
+		std::string err(memcached_strerror(_mc, rc));
+		memcached_free(_mc);
+		throw IOException(TRACE_INFO, "memcached: %s", err.c_str());
+	}
+}
+
+MemcachedClient::MemcachedClient(memcached_st* mc, time_t expiration)
+	: _mc(mc), _expiration(expiration)
+{
+}
+
+MemcachedClient::~MemcachedClient()
+{
+	memcached_free(_mc);
+}
+
+void MemcachedClient::check(int rc, const char* what)
+{
+	if (MEMCACHED_SUCCESS == rc) return;
+	throw IOException(TRACE_INFO, "memcached: %s failed: %s", what,
+		memcached_strerror(_mc, (memcached_return_t) rc));
+}
+
+CacheClient::Entries
+MemcachedClient::get_multi(const std::vector<std::string>& keys)
+{
+	Entries found;
+	if (keys.empty()) return found;
+
+	std::vector<const char*> kp;
+	std::vector<size_t> kl;
+	kp.reserve(keys.size());
+	kl.reserve(keys.size());
+	for (const std::string& k : keys)
+	{
+		kp.push_back(k.data());
+		kl.push_back(k.size());
+	}
+
+	std::lock_guard<std::mutex> lck(_mtx);
+	check(memcached_mget(_mc, kp.data(), kl.data(), keys.size()), "mget");
+
+	memcached_return_t rc;
+	memcached_result_st* res;
+	while (nullptr != (res = memcached_fetch_result(_mc, nullptr, &rc)))
+	{
+		found.emplace(
+			std::string(memcached_result_key_value(res),
+			            memcached_result_key_length(res)),
+			std::string(memcached_result_value(res),
+			            memcached_result_length(res)));
+		memcached_result_free(res);
+	}
+	if (MEMCACHED_END != rc and MEMCACHED_NOTFOUND != rc)
+		check(rc, "fetch");
+	return found;
+}
+
+void MemcachedClient::set(const std::string& key, const std::string& value)
+{
+	std::lock_guard<std::mutex> lck(_mtx);
+	check(memcached_set(_mc, key.data(), key.size(),
+	                    value.data(), value.size(), _expiration, 0), "set");
+}
+
+bool MemcachedClient::add(const std::string& key, const std::string& value)
+{
+	std::lock_guard<std::mutex> lck(_mtx);
+	memcached_return_t rc = memcached_add(_mc, key.data(), key.size(),
+		value.data(), value.size(), _expiration, 0);
+	if (MEMCACHED_NOTSTORED == rc or MEMCACHED_DATA_EXISTS == rc)
+		return false;
+	check(rc, "add");
+	return true;
+}
+
+bool MemcachedClient::append(const std::string& key, const std::string& value)
+{
+	std::lock_guard<std::mutex> lck(_mtx);
+	memcached_return_t rc = memcached_append(_mc, key.data(), key.size(),
+		value.data(), value.size(), 0, 0);
+	if (MEMCACHED_NOTSTORED == rc or MEMCACHED_NOTFOUND == rc)
+		return false;
+	check(rc, "append");
+	return true;
+}
+
+/// A gets, for the value and its cas version, and then a cas with
+/// that version, which fails if anyone has stored to the key since.
+bool MemcachedClient::cas(const std::string& key, const std::string& expected,
+                          const std::string& value)
+{
+	const char* kp = key.data();
+	size_t kl = key.size();
+
+	std::lock_guard<std::mutex> lck(_mtx);
+	check(memcached_mget(_mc, &kp, &kl, 1), "mget");
+
+	memcached_return_t rc;
+	memcached_result_st* res = memcached_fetch_result(_mc, nullptr, &rc);
+	if (nullptr == res)
+	{
+		if (MEMCACHED_END != rc and MEMCACHED_NOTFOUND != rc)
+			check(rc, "fetch");
+		return false;
+	}
+	bool same = memcached_result_length(res) == expected.size() and
+		0 == memcmp(memcached_result_value(res), expected.data(),
+		            expected.size());
+	uint64_t version = memcached_result_cas(res);
+	memcached_result_free(res);
+
+	// The end of the reply.
+	while (nullptr != (res = memcached_fetch_result(_mc, nullptr, &rc)))
+		memcached_result_free(res);
+	if (not same) return false;
+
+	rc = memcached_cas(_mc, kp, kl, value.data(), value.size(),
+		_expiration, 0, version);
+	if (MEMCACHED_DATA_EXISTS == rc or MEMCACHED_NOTFOUND == rc or
+	    MEMCACHED_NOTSTORED == rc)
+		return false;
+	check(rc, "cas");
+	return true;
+}
+
+void MemcachedClient::remove(const std::string& key)
+{
+	std::lock_guard<std::mutex> lck(_mtx);
+	memcached_return_t rc = memcached_delete(_mc, key.data(), key.size(), 0);
+	if (MEMCACHED_NOTFOUND == rc) return;
+	check(rc, "delete");
+}
+
+void MemcachedClient::flush(void)
+{
+	std::lock_guard<std::mutex> lck(_mtx);
+	check(memcached_flush_buffers(_mc), "flush");
+}
+
+std::unique_ptr<CacheClient> MemcachedClient::connect(void)
+{
+	std::lock_guard<std::mutex> lck(_mtx);
+	memcached_st* mc = memcached_clone(nullptr, _mc);
+	if (nullptr == mc)
+		throw IOException(TRACE_INFO, "memcached: can't clone the client");
+	return std::unique_ptr<CacheClient>(new MemcachedClient(mc, _expiration));
+}
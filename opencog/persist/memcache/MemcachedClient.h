@@ -0,0 +1,82 @@
+/*
+ * opencog/persist/memcache/MemcachedClient.h
+ *
+ * Copyright (C) 2017 OpenCog Foundation
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License v3 as
+ * published by the Free Software Foundation and including the exceptions
+ * at http://opencog.org/wiki/Licenses
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, write to:
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _OPENCOG_MEMCACHED_CLIENT_H
+#define _OPENCOG_MEMCACHED_CLIENT_H
+
+#include <mutex>
+#include <string>
+
+#include <opencog/persist/memcache/CacheClient.h>
+
+struct memcached_st;
+
+namespace opencog
+{
+/** \addtogroup grp_persist
+ *  @{
+ */
+
+/**
+ * A CacheClient that talks to memcached servers, with libmemcached,
+ * over the binary protocol.  Keys are spread over the servers by
+ * libmemcached's consistent hashing.  A multiget goes out to all of
+ * the servers that hold any of the keys at once.
+ */
+class MemcachedClient : public CacheClient
+{
+	private:
+		// A memcached_st can be used by only one thread at a time.
+		std::mutex _mtx;
+		memcached_st* _mc;
+		time_t _expiration;
+
+		void check(int rc, const char* what);
+		MemcachedClient(memcached_st*, time_t);
+
+	public:
+		/// The servers are a comma-separated list of host:port.
+		MemcachedClient(const std::string& servers = "localhost:11211");
+		~MemcachedClient();
+
+		virtual Entries get_multi(const std::vector<std::string>&);
+		virtual void set(const std::string&, const std::string&);
+		virtual bool add(const std::string&, const std::string&);
+		virtual bool append(const std::string&, const std::string&);
+		virtual bool cas(const std::string&, const std::string&,
+		                 const std::string&);
+		virtual void remove(const std::string&);
+		virtual void flush(void);
+
+		/// A clone of this client's connection, servers, settings and
+		/// all, but not its later expiration changes.
+		virtual std::unique_ptr<CacheClient> connect(void);
+
+		/// Entries stored from now on expire after this many seconds;
+		/// zero, the default, keeps them until they are evicted.
+		void set_expiration(time_t secs) { _expiration = secs; }
+};
+
+/** @}*/
+} // namespace opencog
+
+#endif // _OPENCOG_MEMCACHED_CLIENT_H
@@ -0,0 +1,306 @@
+/*
+ * opencog/persist/serial/AtomDecoder.cc
+ *
+ * Copyright (C) 2017 OpenCog Foundation
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License v3 as
+ * published by the Free Software Foundation and including the exceptions
+ * at http://opencog.org/wiki/Licenses
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, write to:
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <unordered_map>
+
+#include <opencog/atoms/base/ClassServer.h>
+#include <opencog/atoms/base/FloatValue.h>
+#include <opencog/atoms/base/Link.h>
+#include <opencog/atoms/base/LinkValue.h>
+#include <opencog/atoms/base/Node.h>
+#include <opencog/atoms/base/StringValue.h>
+#include <opencog/atomspace/AtomSpace.h>
+#include <opencog/atomspace/AtomTable.h>
+#include <opencog/truthvalue/TruthValue.h>
+
+#include "AtomDecoder.h"
+
+using namespace opencog;
+
+AtomDecoder::AtomDecoder(Receiver receiver)
+	: _receiver(receiver), _started(false), _atom_count(0)
+{
+}
+
+void AtomDecoder::feed(const char* data, size_t len)
+{
+	_pending.append(data, len);
+
+	const char* p = _pending.data();
+	const char* end = p + _pending.size();
+
+	if (not _started)
+	{
+		// Wait for enough bytes to tell whether the magic is there.
+		if (end - p < 4 and
+		    0 == _pending.compare(0, _pending.size(),
+		                          ATOM_BINARY_MAGIC, _pending.size()))
+			return;
+		if (0 == _pending.compare(0, 4, ATOM_BINARY_MAGIC)) p += 4;
+		_started = true;
+	}
+
+	while (p < end)
+	{
+		// The length prefix itself may be incomplete.
+		const char* q = p;
+		uint64_t len;
+		try { len = BinaryFormat::get_varint(q, end); }
+		catch (const RuntimeException&) { break; }
+		if ((uint64_t) (end - q) < len) break;
+
+		Block block;
+		decode_payload(q, q + len, block);
+		p = q + len;
+		_atom_count += block.atoms.size();
+		_receiver(block);
+	}
+
+	_pending.erase(0, p - _pending.data());
+}
+
+void AtomDecoder::finish(void)
+{
+	if (not _pending.empty())
+		BinaryFormat::truncated();
+}
+
+AtomDecoder::Block AtomDecoder::decode(const std::string& framed)
+{
+	const char* p = framed.data();
+	const char* end = p + framed.size();
+	uint64_t len = BinaryFormat::get_varint(p, end);
+	if ((uint64_t) (end - p) != len)
+		BinaryFormat::truncated();
+
+	Block block;
+	decode_payload(p, end, block);
+	return block;
+}
+
+/// Turn a varint back-reference into the atom's position in the block.
+static size_t get_ref(const char*& p, const char* end, size_t from)
+{
+	uint64_t d = BinaryFormat::get_varint(p, end);
+	if (0 == d or from < d)
+		throw RuntimeException(TRACE_INFO,
+			"Binary atoms: reference to an atom not in the block");
+	return from - d;
+}
+
+static Type get_type(const char*& p, const char* end,
+                     const std::vector<Type>& types)
+{
+	uint64_t i = BinaryFormat::get_varint(p, end);
+	if (types.size() <= i)
+		throw RuntimeException(TRACE_INFO,
+			"Binary atoms: type not named in the block");
+	return types[i];
+}
+
+static std::vector<double> get_doubles(const char*& p, const char* end)
+{
+	uint64_t n = BinaryFormat::get_varint(p, end);
+	if ((uint64_t) (end - p) / 8 < n) BinaryFormat::truncated();
+	std::vector<double> v;
+	v.reserve(n);
+	for (uint64_t i = 0; i < n; i++)
+		v.push_back(BinaryFormat::get_double(p, end));
+	return v;
+}
+
+static ProtoAtomPtr get_value(const char*& p, const char* end,
+                              const std::vector<Type>& types,
+                              const HandleSeq& atoms)
+{
+	Type t = get_type(p, end, types);
+	ClassServer& cs = classserver();
+
+	if (cs.isA(t, ATOM))
+	{
+		size_t i = get_ref(p, end, atoms.size());
+		if (atoms[i]->getType() != t)
+			throw RuntimeException(TRACE_INFO,
+				"Binary atoms: value does not match its type");
+		return atoms[i];
+	}
+
+	if (cs.isA(t, TRUTH_VALUE))
+		return std::const_pointer_cast<TruthValue>(
+			TruthValue::factory(t, get_doubles(p, end)));
+
+	if (cs.isA(t, FLOAT_VALUE))
+		return createFloatValue(t, get_doubles(p, end));
+
+	if (cs.isA(t, STRING_VALUE))
+	{
+		uint64_t n = BinaryFormat::get_varint(p, end);
+		std::vector<std::string> v;
+		for (uint64_t i = 0; i < n; i++)
+			v.push_back(BinaryFormat::get_string(p, end));
+		return createStringValue(v);
+	}
+
+	if (cs.isA(t, LINK_VALUE))
+	{
+		uint64_t n = BinaryFormat::get_varint(p, end);
+		std::vector<ProtoAtomPtr> v;
+		for (uint64_t i = 0; i < n; i++)
+			v.push_back(get_value(p, end, types, atoms));
+		return createLinkValue(v);
+	}
+
+	throw RuntimeException(TRACE_INFO,
+		"Binary atoms: cannot read a value of type %s",
+		cs.getTypeName(t).c_str());
+}
+
+void AtomDecoder::decode_payload(const char* p, const char* end, Block& block)
+{
+	if (end <= p) BinaryFormat::truncated();
+	int version = (unsigned char) *p++;
+	if (ATOM_BINARY_VERSION != version)
+		throw RuntimeException(TRACE_INFO,
+			"Binary atoms: block is version %d, expecting version %d",
+			version, ATOM_BINARY_VERSION);
+
+	ClassServer& cs = classserver();
+	std::vector<Type> types;
+	HandleSeq& atoms = block.atoms;
+
+	while (p < end)
+	{
+		int tag = (unsigned char) *p++;
+		switch (tag)
+		{
+			case TYPE_RECORD:
+			{
+				std::string name(BinaryFormat::get_string(p, end));
+				Type t = cs.getType(name);
+				if (NOTYPE == t)
+					throw RuntimeException(TRACE_INFO,
+						"Binary atoms: unknown type %s", name.c_str());
+				types.push_back(t);
+				break;
+			}
+			case NODE_RECORD:
+			case LINK_RECORD:
+			{
+				Type t = get_type(p, end, types);
+				Handle h;
+				if (NODE_RECORD == tag)
+				{
+					std::string name(BinaryFormat::get_string(p, end));
+					h = Handle(createNode(t, name));
+				}
+				else
+				{
+					size_t pos = atoms.size();
+					uint64_t arity = BinaryFormat::get_varint(p, end);
+					HandleSeq oset;
+					for (uint64_t i = 0; i < arity; i++)
+						oset.push_back(atoms[get_ref(p, end, pos)]);
+					h = Handle(createLink(oset, t));
+				}
+
+				if (end <= p) BinaryFormat::truncated();
+				int flags = (unsigned char) *p++;
+				if (flags & HAS_TV)
+				{
+					Type tvt = get_type(p, end, types);
+					h->setTruthValue(TruthValue::factory(tvt,
+						get_doubles(p, end)));
+				}
+				atoms.push_back(h);
+				break;
+			}
+			case VALUES_RECORD:
+			{
+				size_t from = atoms.size();
+				size_t atom = get_ref(p, end, from);
+				uint64_t n = BinaryFormat::get_varint(p, end);
+				for (uint64_t i = 0; i < n; i++)
+				{
+					size_t key = get_ref(p, end, from);
+					ProtoAtomPtr v(get_value(p, end, types, atoms));
+					block.values.push_back({atom, key, v});
+				}
+				break;
+			}
+			default:
+				throw RuntimeException(TRACE_INFO,
+					"Binary atoms: unknown record %d", tag);
+		}
+	}
+}
+
+/// Values that hold atoms of the block must hold them as they are
+/// in the table.
+static ProtoAtomPtr to_table(const ProtoAtomPtr& v,
+                             const std::unordered_map<Handle, Handle>& added)
+{
+	if (v->isAtom())
+		return added.at(HandleCast(v));
+
+	LinkValuePtr lv(LinkValueCast(v));
+	if (nullptr == lv) return v;
+
+	std::vector<ProtoAtomPtr> vs;
+	for (const ProtoAtomPtr& vi : lv->value())
+		vs.push_back(to_table(vi, added));
+	return createLinkValue(vs);
+}
+
+HandleSeq AtomDecoder::add_to(AtomTable& table, Block& block)
+{
+	return added_to(table.add_atoms(block.atoms), block);
+}
+
+HandleSeq AtomDecoder::add_to(AtomSpace& as, Block& block)
+{
+	return added_to(as.add_atoms(block.atoms), block);
+}
+
+HandleSeq AtomDecoder::added_to(HandleSeq added, Block& block)
+{
+	// Atoms that were in the table already keep their own truth value,
+	// unless the block has one for them.
+	for (size_t i = 0; i < added.size(); i++)
+	{
+		const Handle& h = block.atoms[i];
+		if (added[i] == h) continue;
+		TruthValuePtr tv(h->getTruthValue());
+		if (not tv->isDefaultTV())
+			added[i]->setTruthValue(tv);
+	}
+
+	if (block.values.empty()) return added;
+
+	std::unordered_map<Handle, Handle> in_table;
+	for (size_t i = 0; i < added.size(); i++)
+		in_table.emplace(block.atoms[i], added[i]);
+
+	for (const Valuation& vn : block.values)
+		added[vn.atom]->setValue(added[vn.key],
+		                         to_table(vn.value, in_table));
+	return added;
+}
@@ -0,0 +1,113 @@
+/*
+ * opencog/persist/serial/AtomDecoder.h
+ *
+ * Copyright (C) 2017 OpenCog Foundation
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License v3 as
+ * published by the Free Software Foundation and including the exceptions
+ * at http://opencog.org/wiki/Licenses
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, write to:
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _OPENCOG_ATOM_DECODER_H
+#define _OPENCOG_ATOM_DECODER_H
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <opencog/atoms/base/Handle.h>
+#include <opencog/atoms/base/ProtoAtom.h>
+#include <opencog/persist/serial/BinaryFormat.h>
+
+namespace opencog
+{
+/** \addtogroup grp_persist
+ *  @{
+ */
+
+class AtomSpace;
+class AtomTable;
+
+/**
+ * Reads atoms written by the AtomEncoder, a block at a time.
+ *
+ * The atoms of a block are made in the order in which they were
+ * written, and so each one can be built from the ones before it.  They
+ * are not in any atomspace; values cannot be set on atoms that are not
+ * in an atomspace, and so the values are handed back alongside the
+ * atoms, by their position in the block.  add_to() puts a block into
+ * an atom table, and then sets the values.
+ */
+class AtomDecoder
+{
+	public:
+		/// The value held by atoms[atom] at the key atoms[key].
+		struct Valuation
+		{
+			size_t atom;
+			size_t key;
+			ProtoAtomPtr value;
+		};
+
+		struct Block
+		{
+			HandleSeq atoms;
+			std::vector<Valuation> values;
+		};
+
+		typedef std::function<void(Block&)> Receiver;
+
+	private:
+		Receiver _receiver;
+		std::string _pending;
+		bool _started;
+
+		size_t _atom_count;
+
+		static void decode_payload(const char*, const char*, Block&);
+		static HandleSeq added_to(HandleSeq, Block&);
+
+	public:
+		AtomDecoder(Receiver);
+
+		/// Hand over the next bytes of the stream, in pieces of any size.
+		/// Every block that is complete is decoded and passed to the
+		/// receiver; what is left over is kept until the next call.
+		/// The magic bytes, if the stream starts with them, are skipped.
+		void feed(const char*, size_t);
+		void feed(const std::string& s) { feed(s.data(), s.size()); }
+
+		/// Complain if the stream ended part way through a block.
+		void finish(void);
+
+		size_t atoms_read(void) const { return _atom_count; }
+
+		/// Decode a single block (with its length prefix), as made by
+		/// AtomEncoder::encode().
+		static Block decode(const std::string&);
+
+		/// Add the atoms of the block to the table, and then set their
+		/// values.  Atoms that were in the table already get the truth
+		/// value from the block, if it has one for them.  Returns the
+		/// atoms, as they are in the table.  The values are kept only
+		/// if the table belongs to an atomspace.
+		static HandleSeq add_to(AtomTable&, Block&);
+		static HandleSeq add_to(AtomSpace&, Block&);
+};
+
+/** @}*/
+} // namespace opencog
+
+#endif // _OPENCOG_ATOM_DECODER_H
@@ -0,0 +1,262 @@
+/*
+ * opencog/persist/serial/AtomEncoder.cc
+ *
+ * Copyright (C) 2017 OpenCog Foundation
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License v3 as
+ * published by the Free Software Foundation and including the exceptions
+ * at http://opencog.org/wiki/Licenses
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, write to:
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include <opencog/atoms/base/Atom.h>
+#include <opencog/atoms/base/ClassServer.h>
+#include <opencog/atoms/base/FloatValue.h>
+#include <opencog/atoms/base/LinkValue.h>
+#include <opencog/atoms/base/StringValue.h>
+#include <opencog/truthvalue/TruthValue.h>
+
+#include "AtomEncoder.h"
+
+using namespace opencog;
+
+AtomEncoder::AtomEncoder(Sink sink, size_t block_size, bool with_values)
+	: _sink(sink), _block_size(block_size), _with_values(with_values),
+	  _held_values(true), _atom_count(0), _byte_count(0)
+{
+}
+
+AtomEncoder::AtomEncoder(std::ostream& out, size_t block_size,
+                         bool with_values)
+	: AtomEncoder([&out](const std::string& block) {
+			out.write(block.data(), block.size()); },
+		block_size, with_values)
+{
+	out.write(ATOM_BINARY_MAGIC, 4);
+	_byte_count = 4;
+}
+
+AtomEncoder::~AtomEncoder()
+{
+	flush();
+}
+
+void AtomEncoder::flush(void)
+{
+	if (_payload.empty()) return;
+
+	std::string block;
+	block.reserve(_payload.size() + 10);
+	BinaryFormat::put_varint(block, _payload.size());
+	block.append(_payload);
+	_byte_count += block.size();
+
+	_payload.clear();
+	_atoms.clear();
+	_types.clear();
+	_unvalued.clear();
+
+	_sink(block);
+}
+
+/// Name the type, if the block has not used it yet.
+void AtomEncoder::put_type(Type t)
+{
+	if (_types.end() != _types.find(t)) return;
+
+	_types.emplace(t, _types.size());
+	_payload.push_back((char) TYPE_RECORD);
+	BinaryFormat::put_string(_payload, classserver().getTypeName(t));
+}
+
+/// Atoms are referred to by how far back in the block they are, from
+/// the atom at position `from`; nearby atoms get small numbers.
+void AtomEncoder::put_ref(const Handle& h, size_t from)
+{
+	BinaryFormat::put_varint(_payload, from - _atoms.at(h));
+}
+
+/// Make sure that the atoms held in the value, and the types of the
+/// value and of what it holds, are in the block already.
+void AtomEncoder::add_value_atoms(const ProtoAtomPtr& v)
+{
+	if (v->isAtom())
+	{
+		write_atom(HandleCast(v));
+		return;
+	}
+	put_type(v->getType());
+	LinkValuePtr lv(LinkValueCast(v));
+	if (lv)
+		for (const ProtoAtomPtr& vi : lv->value())
+			add_value_atoms(vi);
+}
+
+void AtomEncoder::put_value(const ProtoAtomPtr& v, size_t from)
+{
+	Type t = v->getType();
+	BinaryFormat::put_varint(_payload, _types.at(t));
+
+	if (v->isAtom())
+	{
+		put_ref(HandleCast(v), from);
+		return;
+	}
+
+	FloatValuePtr fv(FloatValueCast(v));
+	if (fv)
+	{
+		BinaryFormat::put_varint(_payload, fv->value().size());
+		for (double d : fv->value())
+			BinaryFormat::put_double(_payload, d);
+		return;
+	}
+
+	StringValuePtr sv(StringValueCast(v));
+	if (sv)
+	{
+		BinaryFormat::put_varint(_payload, sv->value().size());
+		for (const std::string& s : sv->value())
+			BinaryFormat::put_string(_payload, s);
+		return;
+	}
+
+	LinkValuePtr lv(LinkValueCast(v));
+	if (lv)
+	{
+		BinaryFormat::put_varint(_payload, lv->value().size());
+		for (const ProtoAtomPtr& vi : lv->value())
+			put_value(vi, from);
+		return;
+	}
+
+	throw RuntimeException(TRACE_INFO,
+		"AtomEncoder: cannot write a value of type %s",
+		classserver().getTypeName(t).c_str());
+}
+
+/// Write the atom into the current block, after everything it refers
+/// to; returns its position in the block.  The values go in a record
+/// of their own, after the atom, so that atoms may hold values that
+/// refer back to them.
+size_t AtomEncoder::write_atom(const Handle& h)
+{
+	auto it = _atoms.find(h);
+	if (_atoms.end() != it) return it->second;
+
+	if (h->isLink())
+		for (const Handle& ho : h->getOutgoingSet())
+			write_atom(ho);
+
+	TruthValuePtr tv(h->getTruthValue());
+	bool has_tv = not tv->isDefaultTV();
+	if (has_tv) put_type(tv->getType());
+	put_type(h->getType());
+
+	size_t pos = _atoms.size();
+	_atoms.emplace(h, pos);
+	_atom_count++;
+
+	if (h->isNode())
+	{
+		_payload.push_back((char) NODE_RECORD);
+		BinaryFormat::put_varint(_payload, _types.at(h->getType()));
+		BinaryFormat::put_string(_payload, h->getName());
+	}
+	else
+	{
+		_payload.push_back((char) LINK_RECORD);
+		BinaryFormat::put_varint(_payload, _types.at(h->getType()));
+		BinaryFormat::put_varint(_payload, h->getArity());
+		for (const Handle& ho : h->getOutgoingSet())
+			put_ref(ho, pos);
+	}
+
+	_payload.push_back((char) (has_tv ? HAS_TV : 0));
+	if (has_tv)
+	{
+		BinaryFormat::put_varint(_payload, _types.at(tv->getType()));
+		BinaryFormat::put_varint(_payload, tv->value().size());
+		for (double d : tv->value())
+			BinaryFormat::put_double(_payload, d);
+	}
+
+	if (not _with_values) return pos;
+	if (_held_values or h == _top)
+		write_values(h);
+	else
+		_unvalued.insert(h);
+	return pos;
+}
+
+/// The values on an atom already in the block, in a record of their own.
+void AtomEncoder::write_values(const Handle& h)
+{
+	std::vector<std::pair<Handle, ProtoAtomPtr>> values;
+	for (const Handle& key : h->getKeys())
+	{
+		ProtoAtomPtr v(h->getValue(key));
+		if (nullptr == v) continue;
+		write_atom(key);
+		add_value_atoms(v);
+		values.emplace_back(key, v);
+	}
+	if (values.empty()) return;
+
+	size_t from = _atoms.size();
+	_payload.push_back((char) VALUES_RECORD);
+	put_ref(h, from);
+	BinaryFormat::put_varint(_payload, values.size());
+	for (const auto& kv : values)
+	{
+		put_ref(kv.first, from);
+		put_value(kv.second, from);
+	}
+}
+
+void AtomEncoder::add(const Handle& h)
+{
+	if (_payload.empty()) _payload.push_back((char) ATOM_BINARY_VERSION);
+
+	// An atom written earlier, as one held by a link, without its
+	// values, gets them now.
+	_top = h;
+	if (0 < _unvalued.erase(h))
+		write_values(h);
+	else
+		write_atom(h);
+
+	// Only between atoms: a block must hold all that its atoms refer to.
+	if (_block_size <= _payload.size()) flush();
+}
+
+void AtomEncoder::add(const HandleSeq& hs)
+{
+	for (const Handle& h : hs) add(h);
+}
+
+std::string AtomEncoder::encode(const HandleSeq& hs, bool with_values)
+{
+	std::string result;
+	AtomEncoder enc([&result](const std::string& block) {
+			result.append(block); },
+		std::numeric_limits<size_t>::max(), with_values);
+	enc.add(hs);
+	enc.flush();
+	return result;
+}
@@ -0,0 +1,120 @@
+/*
+ * opencog/persist/serial/AtomEncoder.h
+ *
+ * Copyright (C) 2017 OpenCog Foundation
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License v3 as
+ * published by the Free Software Foundation and including the exceptions
+ * at http://opencog.org/wiki/Licenses
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, write to:
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _OPENCOG_ATOM_ENCODER_H
+#define _OPENCOG_ATOM_ENCODER_H
+
+#include <functional>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+#include <opencog/atoms/base/Handle.h>
+#include <opencog/atoms/base/ProtoAtom.h>
+#include <opencog/persist/serial/BinaryFormat.h>
+
+namespace opencog
+{
+/** \addtogroup grp_persist
+ *  @{
+ */
+
+/**
+ * Writes atoms, with their truth values and values, in the binary
+ * atom format, a block at a time.
+ *
+ * Atoms are gathered into a block until it reaches the block size;
+ * the block is then handed to the sink, with its length in front.
+ * Each block is complete on its own: the atoms in it, and the types
+ * it uses, are numbered from zero within the block, and every atom in
+ * the outgoing set of a link (or used as a key, or held in a value) is
+ * written into the block before anything that refers to it.  So a
+ * single block can be sent as a message, or kept as a cache entry,
+ * and many blocks can follow one another in a file.
+ */
+class AtomEncoder
+{
+	public:
+		typedef std::function<void(const std::string&)> Sink;
+
+	private:
+		Sink _sink;
+		size_t _block_size;
+		bool _with_values;
+		bool _held_values;
+
+		std::string _payload;
+		std::unordered_map<Handle, size_t> _atoms;
+		std::unordered_map<Type, size_t> _types;
+
+		// The atom being added, and the atoms in the block that were
+		// written without their values.
+		Handle _top;
+		std::unordered_set<Handle> _unvalued;
+
+		size_t _atom_count;
+		size_t _byte_count;
+
+		void put_type(Type);
+		void put_ref(const Handle&, size_t);
+		void put_value(const ProtoAtomPtr&, size_t);
+		void add_value_atoms(const ProtoAtomPtr&);
+		size_t write_atom(const Handle&);
+		void write_values(const Handle&);
+
+	public:
+		/// Blocks go to the sink; the sink gets the length prefix too.
+		AtomEncoder(Sink, size_t block_size = 64 * 1024,
+		            bool with_values = true);
+
+		/// Blocks go to the stream, after the magic bytes.
+		AtomEncoder(std::ostream&, size_t block_size = 64 * 1024,
+		            bool with_values = true);
+
+		~AtomEncoder();
+
+		/// Write the atom, and everything it refers to.  Atoms that are
+		/// already in the current block are not written again.
+		void add(const Handle&);
+		void add(const HandleSeq&);
+
+		/// Hand the current block to the sink, and start a new one.
+		void flush(void);
+
+		/// Whether the atoms that are only in the block because a link
+		/// holds them (or a value refers to them) get their values
+		/// written too.  They do, by default; without, only the atoms
+		/// passed to add() have their values in the block.
+		void set_held_values(bool held) { _held_values = held; }
+
+		size_t atoms_written(void) const { return _atom_count; }
+		size_t bytes_written(void) const { return _byte_count; }
+
+		/// All of the atoms, in a single block (with its length prefix).
+		static std::string encode(const HandleSeq&, bool with_values = true);
+};
+
+/** @}*/
+} // namespace opencog
+
+#endif // _OPENCOG_ATOM_ENCODER_H
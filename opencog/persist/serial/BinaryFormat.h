@@ -0,0 +1,136 @@
+/*
+ * opencog/persist/serial/BinaryFormat.h
+ *
+ * Copyright (C) 2017 OpenCog Foundation
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License v3 as
+ * published by the Free Software Foundation and including the exceptions
+ * at http://opencog.org/wiki/Licenses
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, write to:
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _OPENCOG_BINARY_FORMAT_H
+#define _OPENCOG_BINARY_FORMAT_H
+
+#include <stdint.h>
+#include <string.h>
+#include <string>
+
+#include <opencog/util/exceptions.h>
+
+namespace opencog
+{
+/** \addtogroup grp_persist
+ *  @{
+ */
+
+/**
+ * The binary atom format, shared by the persistence backends.  See
+ * the README.md in this directory for the layout.  Every block starts
+ * with the version; a decoder refuses blocks of any other version.
+ */
+#define ATOM_BINARY_VERSION 1
+
+/// Files (and other streams) start with these four bytes; blocks sent
+/// on their own (in a message, or a cache entry) do not.
+#define ATOM_BINARY_MAGIC "OCAB"
+
+/// The kinds of record in a block.
+enum BinaryRecord
+{
+	TYPE_RECORD = 0,   // names the next block-local type id
+	NODE_RECORD = 1,
+	LINK_RECORD = 2,
+	VALUES_RECORD = 3, // the values on an atom written earlier
+};
+
+/// What follows an atom record.
+enum BinaryAttrs
+{
+	HAS_TV = 1,
+};
+
+/// Little helpers for reading and writing the primitive fields.
+struct BinaryFormat
+{
+	static void put_varint(std::string& out, uint64_t v)
+	{
+		while (0x80 <= v)
+		{
+			out.push_back((char) (v | 0x80));
+			v >>= 7;
+		}
+		out.push_back((char) v);
+	}
+
+	static void put_string(std::string& out, const std::string& s)
+	{
+		put_varint(out, s.size());
+		out.append(s);
+	}
+
+	/// Doubles are written as their eight IEEE bytes, least
+	/// significant first, whatever the byte order of the host.
+	static void put_double(std::string& out, double d)
+	{
+		uint64_t bits;
+		memcpy(&bits, &d, sizeof(bits));
+		for (int i = 0; i < 8; i++)
+			out.push_back((char) (bits >> (8 * i)));
+	}
+
+	static uint64_t get_varint(const char*& p, const char* end)
+	{
+		uint64_t v = 0;
+		for (int shift = 0; shift < 64; shift += 7)
+		{
+			if (end <= p) truncated();
+			unsigned char c = *p++;
+			v |= ((uint64_t) (c & 0x7f)) << shift;
+			if (0 == (c & 0x80)) return v;
+		}
+		throw RuntimeException(TRACE_INFO, "Binary atoms: bad varint");
+	}
+
+	static std::string get_string(const char*& p, const char* end)
+	{
+		uint64_t len = get_varint(p, end);
+		if ((uint64_t) (end - p) < len) truncated();
+		std::string s(p, len);
+		p += len;
+		return s;
+	}
+
+	static double get_double(const char*& p, const char* end)
+	{
+		if (end - p < 8) truncated();
+		uint64_t bits = 0;
+		for (int i = 0; i < 8; i++)
+			bits |= ((uint64_t) (unsigned char) p[i]) << (8 * i);
+		p += 8;
+		double d;
+		memcpy(&d, &bits, sizeof(d));
+		return d;
+	}
+
+	static void truncated(void)
+	{
+		throw RuntimeException(TRACE_INFO, "Binary atoms: truncated block");
+	}
+};
+
+/** @}*/
+} // namespace opencog
+
+#endif // _OPENCOG_BINARY_FORMAT_H
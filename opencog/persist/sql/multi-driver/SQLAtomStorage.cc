@@ -34,9 +34,14 @@
 #include <time.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
 #include <memory>
 #include <thread>
+#include <unordered_map>
 
 #include <opencog/util/oc_assert.h>
 #include <opencog/util/oc_omp.h>
@@ -156,35 +161,6 @@ class SQLAtomStorage::Response
 
 		AtomTable *table;
 		SQLAtomStorage *store;
-		bool load_all_atoms_cb(void)
-		{
-			// printf ("---- New atom found ----\n");
-			rs->foreach_column(&Response::create_atom_column_cb, this);
-
-			// Two different throws mighht be caught here:
-			// 1) DB has an atom type that is not defined in the atomspace.
-			//    In this case, makeAtom throws IOException.
-			// 2) Corrupted databases can cause get_recursive_if_not_exists
-			//    to throw, because a uuid does not exist. Yes, this can
-			//    happen.
-			// Either way, skip the offending atom, and carry on.
-			try
-			{
-				PseudoPtr p(store->makeAtom(*this, uuid));
-
-				Handle atom(store->get_recursive_if_not_exists(p));
-				Handle h(table->add(atom, false));
-
-				// Force resolution in TLB, so that later removes work.
-				store->_tlbuf.addAtom(h, uuid);
-
-				// Get the values only after TLB insertion!!
-				store->get_atom_values(h);
-			}
-			catch (const IOException& ex) {}
-
-			return false;
-		}
 
 		// Load an atom into the atom table. Fetch all values on the
 		// atom, but NOT on its outgoing set!
@@ -211,6 +187,31 @@ class SQLAtomStorage::Response
 			return false;
 		}
 
+		// Decode one row of a bulk-load block. The DB might have an
+		// atom type that is not defined in the atomspace, in which
+		// case makeAtom throws. Skip the offending atom, and carry on.
+		bool load_block_cb(void)
+		{
+			rs->foreach_column(&Response::create_atom_column_cb, this);
+			try
+			{
+				pvec->emplace_back(store->makeAtom(*this, uuid));
+			}
+			catch (const IOException& ex) {}
+			return false;
+		}
+
+		// Collect the linkvalue column, so that the Values that it
+		// points at can be deleted along with the valuation.
+		std::vector<std::string> *svec;
+		bool collect_linkvalue_cb(void)
+		{
+			lnkval = nullptr;
+			rs->foreach_column(&Response::get_value_column_cb, this);
+			if (lnkval) svec->emplace_back(lnkval);
+			return false;
+		}
+
 		std::vector<PseudoPtr> *pvec;
 		bool fetch_incoming_set_cb(void)
 		{
@@ -256,6 +257,7 @@ class SQLAtomStorage::Response
 		const char * strval;
 		const char * lnkval;
 		UUID key;
+		UUID vatom;
 		bool get_value_cb(void)
 		{
 			rs->foreach_column(&Response::get_value_column_cb, this);
@@ -286,13 +288,21 @@ class SQLAtomStorage::Response
 			{
 				key = atol(colvalue);
 			}
+			else if (!strcmp(colname, "atom"))
+			{
+				vatom = atol(colvalue);
+			}
 			return false;
 		}
 		Handle atom;
 		bool get_all_values_cb(void)
 		{
 			rs->foreach_column(&Response::get_value_column_cb, this);
-
+			attach_value();
+			return false;
+		}
+		void attach_value(void)
+		{
 			Handle hkey(store->_tlbuf.getAtom(key));
 			if (nullptr == hkey)
 			{
@@ -309,6 +319,22 @@ class SQLAtomStorage::Response
 				TruthValuePtr tv(std::dynamic_pointer_cast<TruthValue>(pap));
 				atom->setTruthValue(tv);
 			}
+		}
+
+		// Attach a valuation to the atom that it belongs to, during a
+		// bulk load. Valuations on atoms that did not get loaded are
+		// skipped.
+		bool load_all_values_cb(void)
+		{
+			rs->foreach_column(&Response::get_value_column_cb, this);
+			atom = store->_tlbuf.getAtom(vatom);
+			if (nullptr == atom) return false;
+			try
+			{
+				attach_value();
+			}
+			catch (const IOException& ex) {}
+			atom = nullptr;
 			return false;
 		}
 
@@ -408,10 +434,22 @@ SQLAtomStorage::SQLAtomStorage(std::string uri)
 	// backlog of unwritten stuff, which seems like an OK situation,
 	// to me.
 	_write_queue.set_watermarks(300, 50);
+
+	_batch_stop = false;
+	_batch_flusher = std::thread(&SQLAtomStorage::batch_flusher_loop, this);
 }
 
 SQLAtomStorage::~SQLAtomStorage()
 {
+	// Don't lose whatever is still waiting to be written.
+	if (connected()) flushStoreQueue();
+	{
+		std::lock_guard<std::mutex> lck(_batch_mutex);
+		_batch_stop = true;
+		_batch_cv.notify_all();
+	}
+	_batch_flusher.join();
+
 	while (not conn_pool.is_empty())
 	{
 		LLConnection* db_conn = conn_pool.pop();
@@ -479,6 +517,11 @@ void SQLAtomStorage::extract_callback(const AtomPtr& atom)
 /* AtomTable UUID stuff */
 #define BUFSZ 250
 
+// Atoms per batch, gathered from the write-back queue, and rows per
+// multi-row INSERT.
+#define STORE_BATCH_SIZE 1000
+#define INSERT_ROWS 1000
+
 void SQLAtomStorage::store_atomtable_id(const AtomTable& at)
 {
 	UUID tab_id = at.get_uuid();
@@ -1035,6 +1078,8 @@ std::string SQLAtomStorage::link_to_string(const LinkValuePtr& lvle)
 void SQLAtomStorage::flushStoreQueue()
 {
 	_write_queue.barrier();
+	flush_write_batch();
+	rethrow_batch_error();
 }
 
 /* ================================================================ */
@@ -1092,10 +1137,32 @@ int SQLAtomStorage::do_store_atom(const Handle& h)
 	return lheight;
 }
 
+/// Called by the write-back queue. Rather than writing each atom as
+/// it comes, gather them up into batches, and write a whole batch at
+/// a time. See store_batch() for how a batch is written.
 void SQLAtomStorage::vdo_store_atom(const Handle& h)
 {
-	do_store_atom(h);
-	store_atom_values(h);
+	HandleSeq batch;
+	{
+		std::lock_guard<std::mutex> lck(_batch_mutex);
+		_write_batch.push_back(h);
+		if (_write_batch.size() < STORE_BATCH_SIZE)
+		{
+			if (1 == _write_batch.size()) _batch_cv.notify_all();
+			return;
+		}
+		batch.swap(_write_batch);
+	}
+
+	// This runs in a write-back thread; the failure is reported by
+	// the next flushStoreQueue().
+	try { store_batch(batch); }
+	catch (const std::exception& ex)
+	{
+		logger().warn("SQLAtomStorage: failed to write batch: %s",
+		              ex.what());
+		keep_batch_error();
+	}
 }
 
 /* ================================================================ */
@@ -1240,6 +1307,356 @@ void SQLAtomStorage::do_store_single_atom(const Handle& h, int aheight)
 	}
 }
 
+/* ================================================================ */
+// Batched stores.
+
+/// How long a partial batch may sit, before it is written anyway.
+#define BATCH_LINGER_MSEC 100
+
+/// Write the partial batch, once it has waited long enough for more
+/// atoms to show up.
+void SQLAtomStorage::batch_flusher_loop(void)
+{
+	std::unique_lock<std::mutex> lck(_batch_mutex);
+	while (not _batch_stop)
+	{
+		if (_write_batch.empty())
+		{
+			_batch_cv.wait(lck);
+			continue;
+		}
+		_batch_cv.wait_for(lck, std::chrono::milliseconds(BATCH_LINGER_MSEC));
+		if (_batch_stop) break;
+
+		lck.unlock();
+		try { flush_write_batch(); }
+		catch (const std::exception& ex)
+		{
+			logger().warn("SQLAtomStorage: failed to write batch: %s",
+			              ex.what());
+			keep_batch_error();
+		}
+		lck.lock();
+	}
+}
+
+/// A batch written in some other thread failed; remember why, so that
+/// the next flushStoreQueue() can tell whoever is waiting on it.
+void SQLAtomStorage::keep_batch_error(void)
+{
+	std::lock_guard<std::mutex> lck(_batch_mutex);
+	if (nullptr == _batch_error) _batch_error = std::current_exception();
+}
+
+/// Throw the first batch failure since the last time this was called.
+void SQLAtomStorage::rethrow_batch_error(void)
+{
+	std::exception_ptr err;
+	{
+		std::lock_guard<std::mutex> lck(_batch_mutex);
+		err.swap(_batch_error);
+	}
+	if (err) std::rethrow_exception(err);
+}
+
+/// Write whatever is in the partial batch, right now.
+void SQLAtomStorage::flush_write_batch(void)
+{
+	// Hold the flush lock until the batch is in the database, so that
+	// flushStoreQueue() can't return while the flusher thread is still
+	// busy writing.
+	std::lock_guard<std::mutex> flck(_flush_mutex);
+	HandleSeq batch;
+	{
+		std::lock_guard<std::mutex> lck(_batch_mutex);
+		batch.swap(_write_batch);
+	}
+	if (not batch.empty()) store_batch(batch);
+}
+
+/**
+ * Store a batch of atoms, and all of the values on them, in a handful
+ * of round-trips to the database, instead of several per atom.
+ *
+ * The outgoing sets are stored too, just as in do_store_atom(); the
+ * whole lot is sorted by height, so that links come after the atoms
+ * that they hold. The atoms that the database doesn't have yet are
+ * issued UUIDs by the TLB, exactly as they would be one at a time,
+ * and are written with multi-row INSERTs. Then the values are written
+ * the same way; see store_batch_values().
+ */
+void SQLAtomStorage::store_batch(const HandleSeq& batch)
+{
+	setup_typemap();
+
+	std::unordered_map<Handle, int> heights;
+	HandleSeq todo;
+	std::function<int(const Handle&)> walk = [&](const Handle& h) -> int
+	{
+		auto hit = heights.find(h);
+		if (heights.end() != hit) return hit->second;
+
+		// Height of a link is, by definition, one more than the
+		// tallest atom in its outgoing set.
+		int hei = 0;
+		if (h->isLink())
+		{
+			hei = 1;
+			for (const Handle& ho : h->getOutgoingSet())
+				hei = std::max(hei, walk(ho) + 1);
+		}
+		heights.emplace(h, hei);
+		todo.push_back(h);
+		return hei;
+	};
+
+	HandleSeq atoms;
+	UnorderedHandleSet seen;
+	for (const Handle& h : batch)
+	{
+		if (not seen.insert(h).second) continue;
+		walk(h);
+		atoms.push_back(h);
+	}
+
+	std::stable_sort(todo.begin(), todo.end(),
+		[&](const Handle& a, const Handle& b)
+		{ return heights.at(a) < heights.at(b); });
+
+	UnorderedHandleSet fresh;
+	{
+		// Hold the lock until the rows are in the database, so that
+		// no other thread can hand out a UUID for a row that isn't
+		// there yet.
+		std::lock_guard<std::mutex> create_lock(_store_mutex);
+
+		// The same limits as in do_store_single_atom(). They are all
+		// checked before any UUID is issued, so that a bad atom can't
+		// leave the atoms before it with UUIDs, but no rows.
+		HandleSeq missing;
+		for (const Handle& h : todo)
+		{
+			if (TLB::INVALID_UUID != check_uuid(h)) continue;
+			if (h->isNode() and 2700 < h->getName().size() + 12)
+				throw IOException(TRACE_INFO,
+					"Error: store_batch: Maxiumum Node name size is 2700.\n");
+			if (h->isLink() and 330 < h->getArity())
+				throw IOException(TRACE_INFO,
+					"Error: store_batch: Maxiumum Link size is 330.\n");
+			missing.push_back(h);
+		}
+
+		const std::string cols =
+			"INSERT INTO Atoms (uuid, space, type, height, name, outgoing) "
+			"VALUES ";
+		std::string rows;
+		HandleSeq chunk;
+		auto send = [&](void)
+		{
+			if (chunk.empty()) return;
+			std::string qry = cols + rows + ";";
+			try
+			{
+				Response rp(conn_pool);
+				rp.exec(qry.c_str());
+			}
+			catch (...)
+			{
+				// The rows aren't there, so neither can the UUIDs be;
+				// a later store will issue new ones.
+				for (const Handle& h : chunk)
+					_tlbuf.removeAtom(h);
+				throw;
+			}
+			rows.clear();
+			chunk.clear();
+		};
+
+		for (const Handle& h : missing)
+		{
+			int aheight = heights.at(h);
+
+			// XXX FIXME -- right now, multiple space support is
+			// incomplete; see do_store_single_atom().
+			AtomTable * at = getAtomTable(h);
+			if (at) store_atomtable_id(*at);
+
+			UUID uuid = _tlbuf.addAtom(h, TLB::INVALID_UUID);
+			fresh.insert(h);
+
+			if (not chunk.empty()) rows += ", ";
+			chunk.push_back(h);
+			rows += "(" + std::to_string(uuid);
+			rows += at ? ", 1, " : ", 0, ";
+			rows += std::to_string(storing_typemap[h->getType()]) + ", ";
+			rows += std::to_string(aheight) + ", ";
+			if (0 == aheight)
+			{
+				rows += " $ocp$";
+				rows += h->getName();
+				rows += "$ocp$ , NULL)";
+			}
+			else
+			{
+				rows += "NULL, ";
+				rows += h->isLink() ?
+					oset_to_string(h->getOutgoingSet()) : "NULL";
+				rows += ")";
+			}
+
+#ifdef STORAGE_DEBUG
+			if (0 == aheight) {
+				_num_node_inserts++;
+			} else {
+				_num_link_inserts++;
+			}
+#endif // STORAGE_DEBUG
+			if (max_height < aheight) max_height = aheight;
+
+			_store_count ++;
+			if (bulk_store and _store_count%100000 == 0)
+			{
+				time_t secs = time(0) - bulk_start;
+				double rate = ((double) _store_count) / secs;
+				unsigned long kays = ((unsigned long) _store_count) / 1000;
+				printf("\tStored %luK atoms in %d seconds (%d per second)\n",
+					kays, (int) secs, (int) rate);
+			}
+
+			if (INSERT_ROWS <= chunk.size()) send();
+		}
+		send();
+	}
+
+	store_batch_values(atoms, fresh);
+}
+
+/**
+ * Store all of the values on a batch of atoms, replacing what was
+ * there before, in one transaction. Just like store_atom_values(),
+ * a default truth value is not stored, but deleted.
+ *
+ * The fresh atoms were only just written, and so can't have any old
+ * valuations to delete; that saves a query on clean stores.
+ */
+void SQLAtomStorage::store_batch_values(const HandleSeq& atoms,
+                                        const UnorderedHandleSet& fresh)
+{
+	std::string rows;
+	size_t nrows = 0;
+	std::string stale;
+	std::set<size_t> stripes;
+
+	auto vrow = [&](const Handle& key, UUID auid, bool replace,
+	                const ProtoAtomPtr& pap)
+	{
+		UUID kuid = check_uuid(key);
+		if (TLB::INVALID_UUID == kuid)
+		{
+			do_store_atom(key);
+			kuid = get_uuid(key);
+		}
+		std::string kpair = std::to_string(kuid) + ", " + std::to_string(auid);
+
+		if (replace)
+		{
+			if (not stale.empty()) stale += ", ";
+			stale += "(" + kpair + ")";
+		}
+		if (nullptr == pap) return;
+
+		Type vtype = pap->getType();
+		std::string fstr("NULL"), sstr("NULL"), lstr("NULL");
+		if (classserver().isA(vtype, FLOAT_VALUE))
+			fstr = float_to_string(FloatValueCast(pap));
+		else if (classserver().isA(vtype, STRING_VALUE))
+			sstr = string_to_string(StringValueCast(pap));
+		else if (classserver().isA(vtype, LINK_VALUE))
+			lstr = link_to_string(LinkValueCast(pap));
+
+		if (nrows) rows += ", ";
+		rows += "(" + kpair + ", " +
+			std::to_string(storing_typemap[vtype]) + ", " +
+			fstr + ", " + sstr + ", " + lstr + ")";
+		nrows++;
+	};
+
+	for (const Handle& h : atoms)
+	{
+		UUID auid = get_uuid(h);
+		stripes.insert(auid%NUMVMUT);
+		bool replace = 0 == fresh.count(h);
+
+		for (const Handle& key : h->getKeys())
+		{
+			// Skip the truth-value; it's special-cased below.
+			if (key == tvpred) continue;
+			vrow(key, auid, replace, h->getValue(key));
+		}
+
+		// Don't clog storage with default TV's
+		TruthValuePtr tv(h->getTruthValue());
+		if (tv->isDefaultTV()) vrow(tvpred, auid, replace, nullptr);
+		else vrow(tvpred, auid, replace, ProtoAtomCast(tv));
+	}
+	if (0 == nrows and stale.empty()) return;
+
+	// Lock the stripes in order, so as not to deadlock with other
+	// batches; see storeValuation() for what these are for.
+	std::vector<std::unique_lock<std::mutex>> locks;
+	for (size_t i : stripes)
+		locks.emplace_back(_value_mutex[i]);
+
+	Response rp(conn_pool);
+	rp.exec("BEGIN;");
+	try
+	{
+		if (not stale.empty())
+		{
+			std::string where = " FROM Valuations WHERE (key, atom) IN "
+				"(VALUES " + stale + ")";
+
+			// Link values point at rows in the Values table, which
+			// have to go too.
+			std::vector<std::string> lnkvals;
+			rp.svec = &lnkvals;
+			std::string qry = "SELECT *" + where + " AND linkvalue IS NOT NULL;";
+			rp.exec(qry.c_str());
+			rp.rs->foreach_row(&Response::collect_linkvalue_cb, &rp);
+			for (const std::string& lv : lnkvals)
+			{
+				const char *p = lv.c_str();
+				if (p and *p == '{') p++;
+				while (p)
+				{
+					if (*p == '}' or *p == '\0') break;
+					deleteValue(atol(p));
+					p = strchr(p, ',');
+					if (p) p++;
+				}
+			}
+
+			qry = "DELETE" + where + ";";
+			rp.exec(qry.c_str());
+		}
+
+		if (nrows)
+		{
+			std::string insert = "INSERT INTO Valuations "
+				"(key, atom, type, floatvalue, stringvalue, linkvalue) "
+				"VALUES " + rows + ";";
+			rp.exec(insert.c_str());
+		}
+		rp.exec("COMMIT;");
+	}
+	catch (...)
+	{
+		try { rp.exec("ROLLBACK;"); } catch (...) {}
+		throw;
+	}
+	_valuation_stores += nrows;
+}
+
 /* ================================================================ */
 /**
  * Store the concordance of type names to type values.
@@ -1676,6 +2093,142 @@ SQLAtomStorage::PseudoPtr SQLAtomStorage::makeAtom(Response &rp, UUID uuid)
 
 /* ================================================================ */
 
+/**
+ * A short blocking queue, connecting the stages of the bulk loader.
+ * A full queue stalls the stage that feeds it, so that no stage can
+ * run far ahead of the ones after it, and memory use stays bounded.
+ *
+ * close() lets the consumer drain what is left; cancel() throws it
+ * all away, and makes both push() and pop() fail from then on.
+ */
+template<typename T>
+class BoundedQueue
+{
+	private:
+		std::mutex _mtx;
+		std::condition_variable _not_empty;
+		std::condition_variable _not_full;
+		std::deque<T> _items;
+		size_t _capacity;
+		bool _closed;
+		bool _cancelled;
+
+	public:
+		BoundedQueue(size_t capacity) :
+			_capacity(capacity), _closed(false), _cancelled(false) {}
+
+		/// Returns false, without taking the item, if cancelled.
+		bool push(T&& item)
+		{
+			std::unique_lock<std::mutex> lck(_mtx);
+			_not_full.wait(lck, [&]() {
+				return _items.size() < _capacity or _cancelled; });
+			if (_cancelled) return false;
+			_items.push_back(std::move(item));
+			_not_empty.notify_one();
+			return true;
+		}
+
+		/// Returns false once the queue is closed and empty.
+		bool pop(T& item)
+		{
+			std::unique_lock<std::mutex> lck(_mtx);
+			_not_empty.wait(lck, [&]() {
+				return not _items.empty() or _closed or _cancelled; });
+			if (_cancelled or _items.empty()) return false;
+			item = std::move(_items.front());
+			_items.pop_front();
+			_not_full.notify_one();
+			return true;
+		}
+
+		void close(void)
+		{
+			std::lock_guard<std::mutex> lck(_mtx);
+			_closed = true;
+			_not_empty.notify_all();
+		}
+
+		void cancel(void)
+		{
+			std::deque<T> dead;
+			{
+				std::lock_guard<std::mutex> lck(_mtx);
+				_cancelled = true;
+				dead.swap(_items);
+				_not_empty.notify_all();
+				_not_full.notify_all();
+			}
+		}
+};
+
+// Rows per cursor fetch, and blocks per queue, for the bulk loader.
+#define STREAM_BLOCK_ROWS 5000
+#define LOAD_QUEUE_DEPTH 8
+
+/**
+ * Run the query through a server-side cursor, and hand the results
+ * to the sink a block of rows at a time, as they arrive, instead of
+ * waiting for, and holding on to, the entire result set.
+ *
+ * The first row of each block has already been fetched, when the sink
+ * gets it. The sink owns the record set, and must release it. If the
+ * sink returns false, the query is stopped early.
+ */
+void SQLAtomStorage::stream_rows(const char * select,
+                                 const std::function<bool(LLRecordSet*)>& sink)
+{
+	Response rp(conn_pool);
+
+	// Cursors only live as long as the transaction they are in.
+	rp.exec("BEGIN;");
+	try
+	{
+		std::string decl("DECLARE bulk_cursor NO SCROLL CURSOR FOR ");
+		decl += select;
+		decl += ";";
+		rp.exec(decl.c_str());
+
+		char buff[BUFSZ];
+		snprintf(buff, BUFSZ, "FETCH FORWARD %d FROM bulk_cursor;",
+		         STREAM_BLOCK_ROWS);
+		while (true)
+		{
+			rp.exec(buff);
+			if (not rp.rs->fetch_row()) break;
+			LLRecordSet* rs = rp.rs;
+			rp.rs = nullptr;
+			if (not sink(rs)) break;
+		}
+		rp.exec("CLOSE bulk_cursor;");
+		rp.exec("COMMIT;");
+	}
+	catch (...)
+	{
+		// Don't hand a connection with an open transaction back to
+		// the pool.
+		try { rp.exec("ROLLBACK;"); } catch (...) {}
+		throw;
+	}
+}
+
+/**
+ * Load the entire contents of the database.
+ *
+ * This runs as a pipeline of four stages, each in its own thread, and
+ * connected by short queues:
+ *  1) fetch the rows, height by height, through a cursor;
+ *  2) decode each block of rows into PseudoAtoms;
+ *  3) resolve the PseudoAtoms into Atoms;
+ *  4) add the Atoms to the AtomTable (in this thread).
+ * A link can only be resolved once everything under it is in the
+ * table, so stage 3 waits for stage 4 to finish one height before it
+ * starts on the next. The other stages don't wait: the next height is
+ * fetched and decoded while the current one is being added.
+ *
+ * Once all of the atoms are in, the values are streamed in the same
+ * way, with one query for all of them, instead of one per atom.
+ */
 void SQLAtomStorage::load(AtomTable &table)
 {
 	unsigned long max_nrec = getMaxObservedUUID();
@@ -1689,49 +2242,206 @@ void SQLAtomStorage::load(AtomTable &table)
 
 	setup_typemap();
 
-#define NCHUNKS 300
-#define MINSTEP 10123
-	std::vector<unsigned long> steps;
-	unsigned long stepsize = MINSTEP + max_nrec/NCHUNKS;
-	for (unsigned long rec = 0; rec <= max_nrec; rec += stepsize)
-		steps.push_back(rec);
+	struct Block
+	{
+		int height;
+		bool end;         // Marks the end of a height, or of the values.
+		LLRecordSet* rs;  // Raw rows, until decoded.
+		std::vector<PseudoPtr> pseudos;
+		HandleSeq atoms;
+
+		Block(int h, bool e, LLRecordSet* r) : height(h), end(e), rs(r) {}
+		~Block() { if (rs) rs->release(); }
+	};
+	typedef std::unique_ptr<Block> BlockPtr;
+
+	BoundedQueue<BlockPtr> fetched(LOAD_QUEUE_DEPTH);
+	BoundedQueue<BlockPtr> decoded(LOAD_QUEUE_DEPTH);
+	BoundedQueue<BlockPtr> resolved(LOAD_QUEUE_DEPTH);
+
+	// The height that is all in the table, so far.
+	std::mutex done_mtx;
+	std::condition_variable done_cv;
+	int done_height = -1;
+	bool stop = false;
+
+	// The first stage to fail stops all of the others.
+	std::exception_ptr failure;
+	auto fail = [&](void)
+	{
+		{
+			std::lock_guard<std::mutex> lck(done_mtx);
+			if (not failure) failure = std::current_exception();
+			stop = true;
+			done_cv.notify_all();
+		}
+		fetched.cancel();
+		decoded.cancel();
+		resolved.cancel();
+	};
 
-	printf("Loading all atoms: "
-		"Max Height is %d stepsize=%lu chunks=%lu\n",
-		 max_height, stepsize, steps.size());
+	auto fetch = [&](const char * select, int hei)
+	{
+		stream_rows(select, [&](LLRecordSet* rs)
+		{
+			return fetched.push(BlockPtr(new Block(hei, false, rs)));
+		});
+		return fetched.push(BlockPtr(new Block(hei, true, nullptr)));
+	};
 
-	// Parallelize always.
-	opencog::setting_omp(opencog::num_threads(), 1);
+	std::thread fetcher([&](void)
+	{
+		try
+		{
+			char buff[BUFSZ];
+			for (int hei=0; hei<=max_height; hei++)
+			{
+				snprintf(buff, BUFSZ,
+				         "SELECT * FROM Atoms WHERE height = %d", hei);
+				if (not fetch(buff, hei)) break;
+			}
+		}
+		catch (...) { fail(); }
+		fetched.close();
+	});
 
-	for (int hei=0; hei<=max_height; hei++)
+	std::thread decoder([&](void)
 	{
-		unsigned long cur = _load_count;
+		try
+		{
+			BlockPtr blk;
+			while (fetched.pop(blk))
+			{
+				if (not blk->end)
+				{
+					Response rp(conn_pool);
+					rp.store = this;
+					rp.height = blk->height;
+					rp.pvec = &blk->pseudos;
+					rp.rs = blk->rs;
+					blk->rs = nullptr;
+
+					// The cursor already stepped onto the first row.
+					rp.load_block_cb();
+					rp.rs->foreach_row(&Response::load_block_cb, &rp);
+				}
+				if (not decoded.push(std::move(blk))) break;
+			}
+		}
+		catch (...) { fail(); }
+		decoded.close();
+	});
 
-		OMP_ALGO::for_each(steps.begin(), steps.end(),
-			[&](unsigned long rec)
+	std::thread resolver([&](void)
+	{
+		try
 		{
-			Response rp(conn_pool);
-			rp.table = &table;
-			rp.store = this;
-			char buff[BUFSZ];
-			snprintf(buff, BUFSZ, "SELECT * FROM Atoms WHERE "
-			         "height = %d AND uuid > %lu AND uuid <= %lu;",
-			         hei, rec, rec+stepsize);
-			rp.height = hei;
-			rp.exec(buff);
-			rp.rs->foreach_row(&Response::load_all_atoms_cb, &rp);
+			BlockPtr blk;
+			while (decoded.pop(blk))
+			{
+				if (not blk->end)
+				{
+					{
+						std::unique_lock<std::mutex> lck(done_mtx);
+						done_cv.wait(lck, [&]() {
+							return stop or blk->height <= done_height + 1; });
+						if (stop) break;
+					}
+
+					// Corrupted databases can have links to atoms that
+					// don't exist. Skip those, just like the rows with
+					// unknown types were skipped by the decoder.
+					blk->atoms.reserve(blk->pseudos.size());
+					for (const PseudoPtr& p : blk->pseudos)
+					{
+						Handle h;
+						try { h = get_recursive_if_not_exists(p); }
+						catch (const IOException& ex) {}
+						blk->atoms.emplace_back(h);
+					}
+				}
+				if (not resolved.push(std::move(blk))) break;
+			}
+		}
+		catch (...) { fail(); }
+		resolved.close();
+	});
+
+	try
+	{
+		unsigned long nloaded = 0;
+		BlockPtr blk;
+		while (resolved.pop(blk))
+		{
+			if (blk->end)
+			{
+				printf("Loaded %lu atoms at height %d\n", nloaded, blk->height);
+				nloaded = 0;
+				std::lock_guard<std::mutex> lck(done_mtx);
+				done_height = blk->height;
+				done_cv.notify_all();
+				continue;
+			}
+
+			HandleSeq added(table.add_atoms(blk->atoms));
+			for (size_t i = 0; i < added.size(); i++)
+			{
+				if (nullptr == added[i]) continue;
+
+				// Force resolution in TLB, so that later removes work.
+				_tlbuf.addAtom(added[i], blk->pseudos[i]->uuid);
+				nloaded++;
+			}
+		}
+	}
+	catch (...) { fail(); }
+
+	fetcher.join();
+	decoder.join();
+	resolver.join();
+
+	// Get the values only after TLB insertion!! They are decoded in
+	// this thread, while the next block is being fetched.
+	if (not failure)
+	{
+		BoundedQueue<BlockPtr> vfetched(LOAD_QUEUE_DEPTH);
+		std::thread vfetcher([&](void)
+		{
+			try
+			{
+				stream_rows("SELECT * FROM Valuations", [&](LLRecordSet* rs)
+				{
+					return vfetched.push(BlockPtr(new Block(0, false, rs)));
+				});
+			}
+			catch (...) { fail(); vfetched.cancel(); }
+			vfetched.close();
 		});
-		printf("Loaded %lu atoms at height %d\n", _load_count - cur, hei);
+
+		try
+		{
+			BlockPtr blk;
+			while (vfetched.pop(blk))
+			{
+				Response rp(conn_pool);
+				rp.store = this;
+				rp.rs = blk->rs;
+				blk->rs = nullptr;
+				rp.load_all_values_cb();
+				rp.rs->foreach_row(&Response::load_all_values_cb, &rp);
+			}
+		}
+		catch (...) { fail(); vfetched.cancel(); }
+		vfetcher.join();
 	}
 
+	bulk_load = false;
+	if (failure) std::rethrow_exception(failure);
+
 	time_t secs = time(0) - bulk_start;
 	double rate = ((double) _load_count) / secs;
 	printf("Finished loading %lu atoms in total in %d seconds (%d per second)\n",
 		(unsigned long) _load_count, (int) secs, (int) rate);
-	bulk_load = false;
-
-	// Put it back as it was.
-	opencog::setting_omp(opencog::num_threads());
 
 	// synchrnonize!
 	table.barrier();
@@ -1827,17 +2537,39 @@ void SQLAtomStorage::store(const AtomTable &table)
 
 	bulk_start = time(0);
 
-	// Try to knock out the nodes first, then the links.
-	table.foreachHandleByType(
-		[&](const Handle& h)->void { storeAtom(h); },
-		NODE, true);
+	// Anything already queued goes first.
+	flushStoreQueue();
 
+	// Write the whole table in batches, lowest atoms first. Each batch
+	// drags in the outgoing sets of its links anyway, so the batches
+	// can be written in parallel.
+	std::vector<std::pair<int, Handle>> all;
 	table.foreachHandleByType(
-		[&](const Handle& h)->void { storeAtom(h); },
-		LINK, true);
+		[&](const Handle& h)->void { all.emplace_back(get_height(h), h); },
+		ATOM, true);
+	std::stable_sort(all.begin(), all.end(),
+		[](const std::pair<int, Handle>& a, const std::pair<int, Handle>& b)
+		{ return a.first < b.first; });
+
+	std::vector<HandleSeq> batches;
+	for (size_t i = 0; i < all.size(); i++)
+	{
+		if (0 == i%STORE_BATCH_SIZE) batches.emplace_back();
+		batches.back().push_back(all[i].second);
+	}
+	all.clear();
 
-	flushStoreQueue();
+	// An exception can't leave a parallel loop; keep the first one,
+	// and throw it once the loop is done.
+	opencog::setting_omp(opencog::num_threads(), 1);
+	OMP_ALGO::for_each(batches.begin(), batches.end(),
+		[&](const HandleSeq& batch) {
+			try { store_batch(batch); }
+			catch (const std::exception&) { keep_batch_error(); }
+		});
+	opencog::setting_omp(opencog::num_threads());
 	bulk_store = false;
+	rethrow_batch_error();
 
 	time_t secs = time(0) - bulk_start;
 	double rate = ((double) _store_count) / secs;
@@ -26,6 +26,8 @@
 #define _OPENCOG_SQL_ATOM_STORAGE_H
 
 #include <atomic>
+#include <condition_variable>
+#include <functional>
 #include <mutex>
 #include <set>
 #include <thread>
@@ -94,6 +96,10 @@ class SQLAtomStorage : public AtomStorage
 
 		Handle get_recursive_if_not_exists(PseudoPtr);
 
+		// Bulk loading.
+		void stream_rows(const char *,
+		                 const std::function<bool(LLRecordSet*)>&);
+
 		Handle doGetNode(Type, const char *);
 		Handle doGetLink(Type, const HandleSeq&);
 
@@ -109,6 +115,24 @@ class SQLAtomStorage : public AtomStorage
 		void vdo_store_atom(const Handle&);
 		void do_store_single_atom(const Handle&, int);
 
+		// Batched stores. Atoms coming off the write-back queue are
+		// gathered into batches, which are written with multi-row
+		// INSERTs. A partial batch is written once it has lingered
+		// for a little while.
+		std::mutex _batch_mutex;
+		std::mutex _flush_mutex;
+		std::condition_variable _batch_cv;
+		HandleSeq _write_batch;
+		bool _batch_stop;
+		std::exception_ptr _batch_error;
+		std::thread _batch_flusher;
+		void batch_flusher_loop(void);
+		void flush_write_batch(void);
+		void keep_batch_error(void);
+		void rethrow_batch_error(void);
+		void store_batch(const HandleSeq&);
+		void store_batch_values(const HandleSeq&, const UnorderedHandleSet&);
+
 		UUID check_uuid(const Handle&);
 		UUID get_uuid(const Handle&);
 		std::string oset_to_string(const HandleSeq&);
@@ -213,7 +237,7 @@ class SQLAtomStorage : public AtomStorage
 		void registerWith(AtomSpace*);
 		void unregisterWith(AtomSpace*);
 		void extract_callback(const AtomPtr&);
-		boost::signals2::connection _extract_sig;
+		ObserverConnection _extract_sig;
 
 		// AtomStorage interface
 		Handle getNode(Type, const char *);
@@ -73,11 +73,10 @@ LLPGConnection::~LLPGConnection()
 LLPGRecordSet * LLPGConnection::get_record_set(void)
 {
 	LLPGRecordSet *rs;
-	if (!free_pool.empty())
+	LLRecordSet* llrs = get_free_record_set();
+	if (llrs)
 	{
-		LLRecordSet* llrs = free_pool.top();
 		rs = dynamic_cast<LLPGRecordSet*>(llrs);
-		free_pool.pop();
 		rs->ncols = -1;
 	}
 	else
@@ -67,6 +67,18 @@ LLConnection::~LLConnection()
     }
 }
 
+/* =========================================================== */
+
+LLRecordSet *
+LLConnection::get_free_record_set(void)
+{
+    std::lock_guard<std::mutex> lck(free_pool_mtx);
+    if (free_pool.empty()) return nullptr;
+    LLRecordSet *rs = free_pool.top();
+    free_pool.pop();
+    return rs;
+}
+
 /* =========================================================== */
 /* pseudo-private routine */
 
@@ -86,6 +98,7 @@ LLRecordSet::LLRecordSet(LLConnection *_conn)
 void
 LLRecordSet::release(void)
 {
+    std::lock_guard<std::mutex> lck(conn->free_pool_mtx);
     conn->free_pool.push(this);
 }
 
@@ -28,6 +28,7 @@
 #ifndef _OPENCOG_PERSISTENT_LL_DRIVER_H
 #define _OPENCOG_PERSISTENT_LL_DRIVER_H
 
+#include <mutex>
 #include <stack>
 #include <string>
 
@@ -42,7 +43,13 @@ class LLConnection
     friend class LLRecordSet;
     protected:
         bool is_connected;
+
+        // Record sets may be released by a thread other than the one
+        // that ran the query (the bulk loader does this), so the pool
+        // of spare record sets is guarded.
+        std::mutex free_pool_mtx;
         std::stack<LLRecordSet *> free_pool;
+        LLRecordSet * get_free_record_set(void);
 
     public:
         LLConnection(void);
@@ -231,11 +231,10 @@ ODBCConnection::~ODBCConnection()
 ODBCRecordSet * ODBCConnection::get_record_set(void)
 {
     ODBCRecordSet *rs;
-    if (!free_pool.empty())
+    LLRecordSet* llrs = get_free_record_set();
+    if (llrs)
     {
-        LLRecordSet* llrs = free_pool.top();
         rs = dynamic_cast<ODBCRecordSet*>(llrs);
-        free_pool.pop();
         rs->ncols = -1;
     }
     else
@@ -22,6 +22,8 @@
  * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
  */
 
+#include <unordered_map>
+
 #include "ProtocolBufferSerializer.h"
 #include "opencog/atoms/base/Handle.h"
 #include "opencog/atoms/base/Atom.h"
@@ -172,7 +174,7 @@ CountTruthValuePtr ProtocolBufferSerializer::deserializeCountTruthValue(
 }
 
 void ProtocolBufferSerializer::serializeCountTruthValue(
-        CountTruthValue& tv, ZMQTruthValueMessage* truthValueMessage)
+        const CountTruthValue& tv, ZMQTruthValueMessage* truthValueMessage)
 {
     ZMQSingleTruthValueMessage *singleTruthValue=truthValueMessage->add_singletruthvalue();
     singleTruthValue->set_truthvaluetype(ZMQTruthValueTypeCount);
@@ -207,7 +209,7 @@ IndefiniteTruthValuePtr ProtocolBufferSerializer::deserializeIndefiniteTruthValu
 }
 
 void ProtocolBufferSerializer::serializeIndefiniteTruthValue(
-        IndefiniteTruthValue& tv, ZMQTruthValueMessage* truthValueMessage)
+        const IndefiniteTruthValue& tv, ZMQTruthValueMessage* truthValueMessage)
 {
     ZMQSingleTruthValueMessage *singleTruthValue=truthValueMessage->add_singletruthvalue();
     singleTruthValue->set_truthvaluetype(ZMQTruthValueTypeIndefinite);
@@ -295,7 +297,7 @@ SimpleTruthValuePtr ProtocolBufferSerializer::deserializeSimpleTruthValue(
 }
 
 void ProtocolBufferSerializer::serializeSimpleTruthValue(
-        SimpleTruthValue& tv, ZMQTruthValueMessage* truthValueMessage)
+        const SimpleTruthValue& tv, ZMQTruthValueMessage* truthValueMessage)
 {
     ZMQSingleTruthValueMessage *singleTruthValue=truthValueMessage->add_singletruthvalue();
     singleTruthValue->set_truthvaluetype(ZMQTruthValueTypeSimple);
@@ -303,23 +305,23 @@ void ProtocolBufferSerializer::serializeSimpleTruthValue(
     singleTruthValue->set_count(tv.getCount());
 }
 
-void ProtocolBufferSerializer::serialize(TruthValue &tv, ZMQTruthValueMessage* truthValueMessage)
+void ProtocolBufferSerializer::serialize(const TruthValue &tv, ZMQTruthValueMessage* truthValueMessage)
 {
-    CountTruthValue* count = dynamic_cast<CountTruthValue*>(&tv);
+    const CountTruthValue* count = dynamic_cast<const CountTruthValue*>(&tv);
     if(count)
     {
         serializeCountTruthValue(*count, truthValueMessage);
         return;
     }
 
-    IndefiniteTruthValue* indefinite = dynamic_cast<IndefiniteTruthValue*>(&tv);
+    const IndefiniteTruthValue* indefinite = dynamic_cast<const IndefiniteTruthValue*>(&tv);
     if(indefinite)
     {
         serializeIndefiniteTruthValue(*indefinite, truthValueMessage);
         return;
     }
 
-    SimpleTruthValue* simple = dynamic_cast<SimpleTruthValue*>(&tv);
+    const SimpleTruthValue* simple = dynamic_cast<const SimpleTruthValue*>(&tv);
     if(simple)
     {
         serializeSimpleTruthValue(*simple, truthValueMessage);
@@ -356,3 +358,93 @@ TruthValuePtr ProtocolBufferSerializer::deserialize(
                  singleTruthValueMessage.truthvaluetype());
     }
 }
+
+std::vector<uint32_t> ProtocolBufferSerializer::serialize(
+        const HandleSeq& atoms,
+        google::protobuf::RepeatedPtrField<ZMQAtomMessage>* atomMessages)
+{
+    std::unordered_map<Handle, uint32_t> position;
+
+    // Depth-first, so that the outgoing set is written before the link.
+    std::function<uint32_t(const Handle&)> write = [&](const Handle& h)
+    {
+        auto it = position.find(h);
+        if (position.end() != it) return it->second;
+
+        std::vector<uint32_t> oset;
+        if (h->isLink())
+            for (const Handle& ho : h->getOutgoingSet())
+                oset.push_back(write(ho));
+
+        uint32_t pos = atomMessages->size();
+        ZMQAtomMessage* atomMsg = atomMessages->Add();
+        atomMsg->set_handle(h.value());
+        atomMsg->set_type(h->getType());
+        if (h->isNode())
+        {
+            atomMsg->set_atomtype(ZMQAtomTypeNode);
+            atomMsg->set_name(h->getName());
+        }
+        else
+        {
+            atomMsg->set_atomtype(ZMQAtomTypeLink);
+            for (const Handle& ho : h->getOutgoingSet())
+                atomMsg->add_outgoing(ho.value());
+            for (uint32_t i : oset)
+                atomMsg->add_outgoing_index(i);
+        }
+
+        TruthValuePtr tv(h->getTruthValue());
+        if (not tv->isDefaultTV())
+            serialize(*tv, atomMsg->mutable_truthvalue());
+
+        position.emplace(h, pos);
+        return pos;
+    };
+
+    std::vector<uint32_t> result;
+    result.reserve(atoms.size());
+    for (const Handle& h : atoms)
+        result.push_back(write(h));
+    return result;
+}
+
+HandleSeq ProtocolBufferSerializer::deserialize(
+        const google::protobuf::RepeatedPtrField<ZMQAtomMessage>& atomMessages)
+{
+    HandleSeq atoms;
+    atoms.reserve(atomMessages.size());
+    for (const ZMQAtomMessage& atomMsg : atomMessages)
+    {
+        Handle h;
+        switch (atomMsg.atomtype())
+        {
+        case ZMQAtomTypeNode:
+            h = createNode(atomMsg.type(), atomMsg.name());
+            break;
+        case ZMQAtomTypeLink:
+        {
+            HandleSeq oset;
+            oset.reserve(atomMsg.outgoing_index_size());
+            for (uint32_t i : atomMsg.outgoing_index())
+            {
+                if (atoms.size() <= i or nullptr == atoms[i])
+                    throw RuntimeException(TRACE_INFO,
+                        "ZMQ link refers to a missing atom at %u", i);
+                oset.push_back(atoms[i]);
+            }
+            h = createLink(oset, atomMsg.type());
+            break;
+        }
+        case ZMQAtomTypeNotFound:
+            break;
+        default:
+            throw RuntimeException(TRACE_INFO, "Invalid ZMQ atomtype");
+        }
+
+        if (nullptr != h and atomMsg.has_truthvalue())
+            h->setTruthValue(deserialize(atomMsg.truthvalue()));
+        atoms.push_back(h);
+    }
+    return atoms;
+}
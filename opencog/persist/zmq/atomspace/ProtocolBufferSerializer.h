@@ -29,6 +29,7 @@
 
 #include <memory>
 #include <string>
+#include <vector>
 
 #include <opencog/atoms/base/Atom.h>
 #include <opencog/truthvalue/AttentionValue.h>
@@ -74,15 +75,15 @@ class ProtocolBufferSerializer {
     static CountTruthValuePtr deserializeCountTruthValue(
             const ZMQSingleTruthValueMessage& singleTruthValue);
     static void serializeCountTruthValue(
-            CountTruthValue& tv, ZMQTruthValueMessage* truthValueMessage);
+            const CountTruthValue& tv, ZMQTruthValueMessage* truthValueMessage);
     static IndefiniteTruthValuePtr deserializeIndefiniteTruthValue(
             const ZMQSingleTruthValueMessage& singleTruthValue);
     static void serializeIndefiniteTruthValue(
-            IndefiniteTruthValue& tv, ZMQTruthValueMessage* truthValueMessage);
+            const IndefiniteTruthValue& tv, ZMQTruthValueMessage* truthValueMessage);
     static SimpleTruthValuePtr deserializeSimpleTruthValue(
             const ZMQSingleTruthValueMessage& singleTruthValue);
     static void serializeSimpleTruthValue(
-            SimpleTruthValue& tv, ZMQTruthValueMessage* truthValueMessage);
+            const SimpleTruthValue& tv, ZMQTruthValueMessage* truthValueMessage);
 
     static TruthValuePtr deserialize(
             const ZMQSingleTruthValueMessage& singleTruthValueMessage);
@@ -95,7 +96,26 @@ public:
 //    static void serialize(Atom &atom, ZMQAtomMessage* atomMessage);
 
     static TruthValuePtr deserialize(const ZMQTruthValueMessage& truthValueMessage);
-    static void serialize(TruthValue &tv, ZMQTruthValueMessage* truthValueMessage);
+    static void serialize(const TruthValue &tv, ZMQTruthValueMessage* truthValueMessage);
+
+    /**
+     * Append the atoms, and everything in their outgoing sets, to the
+     * list of atom messages, with their truth values. Each atom is
+     * written only once, and each link after its outgoing set, which
+     * it refers to by position (outgoing_index), so that a whole batch
+     * of atoms can be rebuilt from one message. Returns the position
+     * of each of the given atoms in the list.
+     */
+    static std::vector<uint32_t> serialize(const HandleSeq& atoms,
+            google::protobuf::RepeatedPtrField<ZMQAtomMessage>* atomMessages);
+
+    /**
+     * Rebuild the atoms of a list written by serialize(HandleSeq),
+     * one per entry, in the same order. The atoms are not in any
+     * atomtable; entries for atoms that were not found are undefined.
+     */
+    static HandleSeq deserialize(
+            const google::protobuf::RepeatedPtrField<ZMQAtomMessage>& atomMessages);
 };
 
 /** @}*/
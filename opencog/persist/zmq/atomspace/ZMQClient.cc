@@ -31,52 +31,279 @@
 #include <memory>
 #include <thread>
 
+#include <opencog/util/Logger.h>
 #include <opencog/util/oc_assert.h>
 #include <opencog/atoms/base/ClassServer.h>
 #include <opencog/atoms/base/Link.h>
 #include <opencog/atoms/base/Node.h>
-#include <opencog/truthvalue/CountTruthValue.h>
-#include <opencog/truthvalue/IndefiniteTruthValue.h>
-#include <opencog/truthvalue/ProbabilisticTruthValue.h>
-#include <opencog/truthvalue/SimpleTruthValue.h>
 #include <opencog/truthvalue/TruthValue.h>
 
 #include <opencog/persist/zmq/atomspace/ZMQClient.h>
 
 using namespace opencog;
 
-ZMQClient::ZMQClient(string networkAddress) {
-	zmqContext = new zmq::context_t(1);
-    zmqClientSocket = new zmq::socket_t(*zmqContext, ZMQ_REQ);
-    fprintf(stderr, "ZeroMQ connecting to %s\n", networkAddress.c_str());
-    zmqClientSocket->connect(networkAddress.c_str());
+/// Default number of atoms in one store message.
+#define DEFAULT_BATCH_SIZE 1000
+
+/// Default number of requests sent before the first reply comes back.
+#define DEFAULT_MAX_IN_FLIGHT 64
+
+/// How long a partial batch may sit, before it is sent anyway.
+#define BATCH_LINGER_MSEC 20
+
+/// Default time to wait without any reply, before giving up on the server.
+#define DEFAULT_TIMEOUT_MSEC 30000
+
+ZMQClient::ZMQClient(string networkAddress, zmq::context_t* context)
+	: _next_id(0), _replies(0), _pending_stores(0), _failed_stores(0),
+	  _max_in_flight(DEFAULT_MAX_IN_FLIGHT), _stop(false),
+	  _timeout(DEFAULT_TIMEOUT_MSEC),
+	  _batch_size(DEFAULT_BATCH_SIZE)
+{
+	ownContext = (nullptr == context);
+	zmqContext = ownContext ? new zmq::context_t(1) : context;
+
+	logger().info("ZeroMQ connecting to %s", networkAddress.c_str());
+	zmqClientSocket = new zmq::socket_t(*zmqContext, ZMQ_DEALER);
+	int linger = 0;
+	zmqClientSocket->setsockopt(ZMQ_LINGER, &linger, sizeof(linger));
+	zmqClientSocket->connect(networkAddress.c_str());
+
+	// The doorbell is bound before anyone connects to it.
+	char bell[64];
+	snprintf(bell, sizeof(bell), "inproc://zmq-client-bell-%p", this);
+	zmqDoorbell = new zmq::socket_t(*zmqContext, ZMQ_PULL);
+	zmqDoorbell->bind(bell);
+	zmqBellPush = new zmq::socket_t(*zmqContext, ZMQ_PUSH);
+	zmqBellPush->setsockopt(ZMQ_LINGER, &linger, sizeof(linger));
+	zmqBellPush->connect(bell);
+
+	_io_thread = std::thread(&ZMQClient::io_loop, this);
 }
 
-ZMQClient::~ZMQClient() {
+ZMQClient::~ZMQClient()
+{
+	try {
+		flushStoreQueue();
+	}
+	catch (const RuntimeException& ex) {
+		logger().warn("%s", ex.get_message());
+	}
+	{
+		std::lock_guard<std::mutex> lck(_queue_mutex);
+		_stop = true;
+	}
+	ring();
+	_io_thread.join();
+
+	delete zmqBellPush;
+	delete zmqDoorbell;
 	delete zmqClientSocket;
-	delete zmqContext;
+	if (ownContext) delete zmqContext;
 }
 
 bool ZMQClient::connected(void) {
 	return zmqClientSocket->connected();
 }
 
+void ZMQClient::set_max_in_flight(size_t n)
+{
+	std::lock_guard<std::mutex> lck(_queue_mutex);
+	_max_in_flight = std::max<size_t>(n, 1);
+}
+
+void ZMQClient::set_batch_size(size_t n)
+{
+	std::lock_guard<std::mutex> lck(_batch_mutex);
+	_batch_size = std::max<size_t>(n, 1);
+}
+
+void ZMQClient::set_timeout(std::chrono::milliseconds t)
+{
+	std::lock_guard<std::mutex> lck(_queue_mutex);
+	_timeout = std::max(t, std::chrono::milliseconds(1));
+}
+
+/* ================================================================ */
+// The I/O thread.
+
+/// zmq calls this when it is done with a message body.
+static void free_body(void*, void* hint)
+{
+	delete static_cast<std::string*>(hint);
+}
+
+/// Wake up the I/O thread.
+void ZMQClient::ring(void)
+{
+	std::lock_guard<std::mutex> lck(_doorbell_mutex);
+	zmq::message_t bell(0);
+	zmqBellPush->send(bell);
+}
+
+/**
+ * Wait until 'ready' holds; the lock must be held. If no reply at all
+ * comes back from the server for the whole timeout, while waiting,
+ * every request queued or in flight is failed, and the wait goes on
+ * until 'ready' holds again. Must not be called from the I/O thread.
+ */
+void ZMQClient::wait_replies(std::unique_lock<std::mutex>& lck,
+                             const std::function<bool(void)>& ready)
+{
+	uint64_t seen = _replies;
+	while (not _queue_cv.wait_for(lck, _timeout, ready))
+	{
+		if (seen != _replies) { seen = _replies; continue; }
+		lck.unlock();
+		fail_requests("no reply from the server");
+		lck.lock();
+	}
+}
+
+/**
+ * Call every request queued or in flight with an error reply, and
+ * forget about it; a reply that comes back for it later is dropped.
+ */
+void ZMQClient::fail_requests(const char* why)
+{
+	std::vector<Done> failed;
+	{
+		std::lock_guard<std::mutex> lck(_queue_mutex);
+		for (Request& r : _send_queue)
+		{
+			delete r.body;
+			failed.push_back(std::move(r.done));
+		}
+		_send_queue.clear();
+		for (auto& pr : _in_flight)
+			failed.push_back(std::move(pr.second));
+		_in_flight.clear();
+	}
+
+	logger().warn("ZMQClient: %s; failing %zu requests", why, failed.size());
+	ZMQReplyMessage rep;
+	rep.set_error(why);
+	for (Done& done : failed)
+	{
+		ZMQReplyMessage copy(rep);
+		if (done) done(copy);
+	}
+	_queue_cv.notify_all();
+}
+
+/**
+ * Queue the request for the I/O thread, with the function to call
+ * with the reply (which may be empty, if nobody wants the reply).
+ * This blocks while the queue is full, unless called from the I/O
+ * thread itself.
+ */
+void ZMQClient::submit(ZMQRequestMessage& req, Done done, bool from_io_thread)
+{
+	std::unique_lock<std::mutex> lck(_queue_mutex);
+	if (not from_io_thread)
+		wait_replies(lck, [&] {
+			return _send_queue.size() < _max_in_flight; });
+
+	req.set_id(++_next_id);
+	_send_queue.push_back({req.id(),
+		new std::string(req.SerializeAsString()), std::move(done)});
+	lck.unlock();
+
+	if (not from_io_thread) ring();
+}
+
+void ZMQClient::io_loop(void)
+{
+	while (true)
+	{
+		// Send as much of the queue as the pipeline allows.
+		std::vector<std::string*> bodies;
+		{
+			std::lock_guard<std::mutex> lck(_queue_mutex);
+			if (_stop) break;
+			while (not _send_queue.empty() and
+			       _in_flight.size() < _max_in_flight)
+			{
+				Request& r = _send_queue.front();
+				_in_flight.emplace(r.id, std::move(r.done));
+				bodies.push_back(r.body);
+				_send_queue.pop_front();
+			}
+		}
+		if (not bodies.empty()) _queue_cv.notify_all();
+
+		// No copy: zmq frees the body, once it is sent.
+		for (std::string* body : bodies)
+		{
+			zmq::message_t request((void *) body->data(), body->size(),
+			                       free_body, body);
+			zmqClientSocket->send(request);
+		}
+
+		// Wait for replies, or for more to send.
+		zmq::pollitem_t items[] = {
+			{ (void *) *zmqClientSocket, 0, ZMQ_POLLIN, 0 },
+			{ (void *) *zmqDoorbell, 0, ZMQ_POLLIN, 0 },
+		};
+		zmq::poll(items, 2, BATCH_LINGER_MSEC);
+
+		if (items[1].revents & ZMQ_POLLIN)
+		{
+			zmq::message_t bell;
+			while (zmqDoorbell->recv(&bell, ZMQ_DONTWAIT)) {}
+		}
+
+		zmq::message_t reply;
+		while (zmqClientSocket->recv(&reply, ZMQ_DONTWAIT))
+		{
+			ZMQReplyMessage rep;
+			rep.ParseFromArray(reply.data(), reply.size());
+
+			Done done;
+			{
+				std::lock_guard<std::mutex> lck(_queue_mutex);
+				_replies++;
+				auto it = _in_flight.find(rep.id());
+				if (_in_flight.end() == it)
+				{
+					logger().warn("ZMQClient: reply to unknown request %lu",
+					              (unsigned long) rep.id());
+					continue;
+				}
+				done = std::move(it->second);
+				_in_flight.erase(it);
+			}
+			if (done) done(rep);
+			_queue_cv.notify_all();
+		}
+
+		flush_lingering_batch();
+	}
+}
+
+/* ================================================================ */
+
+/**
+ * Send the request, and wait for the reply. Other requests, from this
+ * thread or others, may be in flight at the same time.
+ */
 void ZMQClient::sendMessage(ZMQRequestMessage& requestMessage,
         ZMQReplyMessage& replyMessage)
 {
-    // Send request to server
-    fprintf(stderr, "%s. Request... %s\n", connected() ? "Connected" : "NOT connected", requestMessage.DebugString().c_str());
-    string strRequest = requestMessage.SerializeAsString();
-    zmq::message_t request(strRequest.size());
-    memcpy((void *) request.data (), strRequest.c_str(),
-            strRequest.size()); //TODO use copyless init from data
-    zmqClientSocket->send(request);
-
-    // Wait for reply
-    zmq::message_t reply;
-    zmqClientSocket->recv(&reply);
-    replyMessage.ParseFromArray(reply.data(), reply.size());
-    fprintf(stderr, "Reply received... %s\n", replyMessage.DebugString().c_str());
+	bool replied = false;
+	submit(requestMessage, [&](ZMQReplyMessage& rep) {
+		replyMessage.Swap(&rep);
+		std::lock_guard<std::mutex> lck(_queue_mutex);
+		replied = true;
+	});
+	{
+		std::unique_lock<std::mutex> lck(_queue_mutex);
+		wait_replies(lck, [&] { return replied; });
+	}
+
+	if (replyMessage.has_error())
+		throw RuntimeException(TRACE_INFO, "ZMQ server: %s",
+		                       replyMessage.error().c_str());
 }
 
 void ZMQClient::reserve() {
@@ -84,41 +311,102 @@ void ZMQClient::reserve() {
 }
 
 /**
+ * Add the atom to the batch of atoms to be stored. The batch is sent
+ * once it is full, or once it has lingered for BATCH_LINGER_MSEC; if
+ * synchronous, it is sent now, and this waits until it is stored.
+ *
  * In Java: org.opencog.atomspace.zmq.ZmqBackingStore#storeAtomsAsync
  */
-void ZMQClient::storeAtom(const AtomPtr& atomPtr, bool synchronous) {
-
-	fprintf(stderr, "Storing atom %lu ...", atomPtr->getHandle().value());
-
-    ZMQRequestMessage req;
-    ZMQReplyMessage rep;
-
-    req.set_function(ZMQstoreAtoms);
-    ZMQAtomMessage *atomMsg = req.add_atom();
-    atomMsg->set_handle(atomPtr->getHandle().value());
-    atomMsg->set_type(atomPtr->getType());
-
-//    ZMQTruthValueMessage *tvMsg = atomMsg->mutable_truthvalue();
-//    ZMQSingleTruthValueMessage *stvMsg = tvMsg->add_singletruthvalue();
-//    stvMsg->set_truthvaluetype(ZMQTruthValueTypeSimple);
-//    stvMsg->set_mean(atomPtr->getTruthValue()->getMean());
-//    stvMsg->set_confidence(atomPtr->getTruthValue()->getConfidence());
-//    stvMsg->set_count(atomPtr->getTruthValue()->getCount());
-//    atomMsg->set_allocated_truthvalue(tvMsg);
-
-    LinkPtr linkPtr = dynamic_pointer_cast<Link>(atomPtr);
-    if (linkPtr != NULL) {
-    	atomMsg->set_atomtype(ZMQAtomTypeLink);
-    	for (unsigned int i = 0; i < linkPtr->getOutgoingSet().size(); i++) {
-    		atomMsg->add_outgoing(linkPtr->getOutgoingSet()[i].value());
-    	}
-    } else {
-    	NodePtr nodePtr = dynamic_pointer_cast<Node>(atomPtr);
-    	atomMsg->set_atomtype(ZMQAtomTypeNode);
-    	atomMsg->set_name(nodePtr->getName());
-    }
-
-    sendMessage(req, rep);
+void ZMQClient::storeAtom(const AtomPtr& atomPtr, bool synchronous)
+{
+	HandleSeq batch;
+	{
+		std::lock_guard<std::mutex> lck(_batch_mutex);
+		if (_write_batch.empty())
+			_batch_start = std::chrono::steady_clock::now();
+		_write_batch.emplace_back(atomPtr->getHandle());
+		if (not synchronous and _write_batch.size() < _batch_size)
+			return;
+		batch.swap(_write_batch);
+	}
+
+	if (not synchronous)
+	{
+		send_store(batch);
+		return;
+	}
+
+	ZMQRequestMessage req;
+	ZMQReplyMessage rep;
+	req.set_function(ZMQstoreAtoms);
+	ProtocolBufferSerializer::serialize(batch, req.mutable_atom());
+	sendMessage(req, rep);
+}
+
+/**
+ * Send a batch of atoms to be stored, without waiting for the reply.
+ */
+void ZMQClient::send_store(HandleSeq& batch, bool from_io_thread)
+{
+	ZMQRequestMessage req;
+	req.set_function(ZMQstoreAtoms);
+	ProtocolBufferSerializer::serialize(batch, req.mutable_atom());
+	batch.clear();
+
+	{
+		std::lock_guard<std::mutex> lck(_queue_mutex);
+		_pending_stores++;
+	}
+	submit(req, [this](ZMQReplyMessage& rep) {
+		if (rep.has_error())
+			logger().warn("ZMQClient: failed to store atoms: %s",
+			              rep.error().c_str());
+		std::lock_guard<std::mutex> lck(_queue_mutex);
+		if (rep.has_error()) _failed_stores++;
+		_pending_stores--;
+	}, from_io_thread);
+}
+
+/// Called by the I/O thread, to send the batch if it has waited long
+/// enough for more atoms to show up.
+void ZMQClient::flush_lingering_batch(void)
+{
+	HandleSeq batch;
+	{
+		std::lock_guard<std::mutex> lck(_batch_mutex);
+		if (_write_batch.empty()) return;
+		if (std::chrono::steady_clock::now() - _batch_start <
+		    std::chrono::milliseconds(BATCH_LINGER_MSEC)) return;
+		batch.swap(_write_batch);
+	}
+	send_store(batch, true);
+}
+
+/**
+ * Send the partial batch, and wait until all of the stores sent so
+ * far have been acknowledged by the server. Throws if any of the
+ * stores since the last flush failed, or were given up on, because
+ * the server stopped replying.
+ */
+void ZMQClient::flushStoreQueue()
+{
+	HandleSeq batch;
+	{
+		std::lock_guard<std::mutex> lck(_batch_mutex);
+		batch.swap(_write_batch);
+	}
+	if (not batch.empty()) send_store(batch);
+
+	size_t failed;
+	{
+		std::unique_lock<std::mutex> lck(_queue_mutex);
+		wait_replies(lck, [&] { return 0 == _pending_stores; });
+		failed = _failed_stores;
+		_failed_stores = 0;
+	}
+	if (0 < failed)
+		throw RuntimeException(TRACE_INFO,
+			"ZMQClient: %zu store batches failed", failed);
 }
 
 /* ================================================================ */
@@ -134,11 +422,11 @@ void ZMQClient::storeSingleAtom(AtomPtr atom)
 
 bool ZMQClient::store_cb(AtomPtr atom)
 {
-	storeSingleAtom(atom);
+	storeAtom(atom);
 	store_count ++;
-	if (store_count%1 == 0)
+	if (store_count%100000 == 0)
 	{
-		fprintf(stderr, "\tStored %lu atoms.\n", (unsigned long) store_count);
+		logger().info("\tStored %lu atoms.", (unsigned long) store_count);
 	}
 	return false;
 }
@@ -148,14 +436,50 @@ void ZMQClient::store(const AtomTable &table)
 	store_count = 0;
 	table.foreachHandleByType(
 	    [&](Handle h)->void { store_cb(h); }, ATOM, true);
+	flushStoreQueue();
 }
 
-void ZMQClient::loadType(AtomTable &, Type)
+/* ================================================================ */
+// Bulk fetches
+
+/// Put all of the atoms of the reply into the table.
+void ZMQClient::add_to_table(AtomTable& table, const ZMQReplyMessage& rep)
 {
+	HandleSeq atoms(ProtocolBufferSerializer::deserialize(rep.atom()));
+	HandleSeq found;
+	found.reserve(atoms.size());
+	for (const Handle& h : atoms)
+		if (nullptr != h) found.push_back(h);
+	table.add_atoms(found);
 }
 
-void ZMQClient::load(AtomTable &table) {
+void ZMQClient::loadType(AtomTable &table, Type t)
+{
+	ZMQRequestMessage req;
+	ZMQReplyMessage rep;
 
+	req.set_function(ZMQfetchAtoms);
+	ZMQAtomFetch *fetch = req.add_fetch();
+	fetch->set_kind(ZMQAtomFetchKind::TYPE);
+	fetch->set_type(t);
+	sendMessage(req, rep);
+
+	add_to_table(table, rep);
+}
+
+void ZMQClient::load(AtomTable &table)
+{
+	ZMQRequestMessage req;
+	ZMQReplyMessage rep;
+
+	req.set_function(ZMQfetchAtoms);
+	ZMQAtomFetch *fetch = req.add_fetch();
+	fetch->set_kind(ZMQAtomFetchKind::TYPE);
+	fetch->set_type(ATOM);
+	fetch->set_subclass(true);
+	sendMessage(req, rep);
+
+	add_to_table(table, rep);
 }
 
 /**
@@ -163,12 +487,36 @@ void ZMQClient::load(AtomTable &table) {
  */
 void ZMQClient::getIncomingSet(AtomTable& table, const Handle& h)
 {
-	// TODO: implement
+	getIncomingSets(table, HandleSeq({h}));
 }
 
 void ZMQClient::getIncomingByType(AtomTable& table, const Handle& h, Type t)
 {
-	// TODO: implement
+	getIncomingSets(table, HandleSeq({h}), t);
+}
+
+/**
+ * Retrieve the incoming sets of all of the indicated atoms, with
+ * one request.
+ */
+void ZMQClient::getIncomingSets(AtomTable& table, const HandleSeq& hs, Type t)
+{
+	ZMQRequestMessage req;
+	ZMQReplyMessage rep;
+
+	req.set_function(ZMQfetchAtoms);
+	std::vector<uint32_t> pos(
+		ProtocolBufferSerializer::serialize(hs, req.mutable_atom()));
+	for (uint32_t p : pos)
+	{
+		ZMQAtomFetch *fetch = req.add_fetch();
+		fetch->set_kind(ZMQAtomFetchKind::INCOMING);
+		fetch->set_handle(p);
+		if (NOTYPE != t) fetch->set_type(t);
+	}
+	sendMessage(req, rep);
+
+	add_to_table(table, rep);
 }
 
 /**
@@ -178,28 +526,21 @@ void ZMQClient::getIncomingByType(AtomTable& table, const Handle& h, Type t)
  * to fetch the associated TruthValue for this node.
  *
  * This method does *not* register the atom with any atomtable/atomspace
- * However, it does register with the TLB, as the SQL uuids and the
- * TLB Handles must be kept in sync, or all hell breaks loose.
  */
 Handle ZMQClient::getNode(Type t, const char * str)
 {
-    ZMQRequestMessage req;
-    ZMQReplyMessage rep;
-
-    req.set_function(ZMQgetAtoms);
-    ZMQAtomFetch *fetch1 = req.add_fetch();
-    fetch1->set_kind(ZMQAtomFetchKind::NODE);
-    fetch1->set_type(t);
-    fetch1->set_name(str);
-    sendMessage(req, rep);
-
-    ZMQAtomMessage atomMsg = rep.atom(0);
-    if (atomMsg.atomtype() == ZMQAtomTypeNode) {
-        NodePtr nodePtr = dynamic_pointer_cast<Node>(ProtocolBufferSerializer::deserialize(atomMsg));
-        return Handle(nodePtr);
-    } else {
-        return Handle();
-    }
+	ZMQRequestMessage req;
+	ZMQReplyMessage rep;
+
+	req.set_function(ZMQgetAtoms);
+	ZMQAtomFetch *fetch1 = req.add_fetch();
+	fetch1->set_kind(ZMQAtomFetchKind::NODE);
+	fetch1->set_type(t);
+	fetch1->set_name(str);
+	sendMessage(req, rep);
+
+	HandleSeq atoms(ProtocolBufferSerializer::deserialize(rep.atom()));
+	return atoms.at(rep.result(0));
 }
 
 /**
@@ -209,62 +550,37 @@ Handle ZMQClient::getNode(Type t, const char * str)
  * to fetch the associated TruthValue for this link.
  *
  * This method does *not* register the atom with any atomtable/atomspace
- * However, it does register with the TLB, as the SQL uuids and the
- * TLB Handles must be kept in sync, or all hell breaks loose.
  */
 Handle ZMQClient::getLink(Type t, const HandleSeq& oset)
 {
-    ZMQRequestMessage req;
-    ZMQReplyMessage rep;
-
-    req.set_function(ZMQgetAtoms);
-    ZMQAtomFetch *fetch1 = req.add_fetch();
-    fetch1->set_kind(ZMQAtomFetchKind::LINK);
-    fetch1->set_type(t);
-    for (unsigned int i = 0; i < oset.size(); i++) {
-    	fetch1->add_outgoing(oset[i].value());
-    }
-    sendMessage(req, rep);
-
-    ZMQAtomMessage atomMsg = rep.atom(0);
-    if (atomMsg.atomtype() == ZMQAtomTypeLink) {
-        LinkPtr linkPtr = dynamic_pointer_cast<Link>(ProtocolBufferSerializer::deserialize(atomMsg));
-        return Handle(linkPtr);
-    } else {
-        return Handle();
-    }
+	ZMQRequestMessage req;
+	ZMQReplyMessage rep;
+
+	req.set_function(ZMQgetAtoms);
+	Handle link(createLink(oset, t));
+	std::vector<uint32_t> pos(
+		ProtocolBufferSerializer::serialize({link}, req.mutable_atom()));
+	ZMQAtomFetch *fetch1 = req.add_fetch();
+	fetch1->set_kind(ZMQAtomFetchKind::LINK);
+	fetch1->set_type(t);
+	fetch1->set_handle(pos[0]);
+	for (const Handle& h : oset)
+		fetch1->add_outgoing(h.value());
+	sendMessage(req, rep);
+
+	HandleSeq atoms(ProtocolBufferSerializer::deserialize(rep.atom()));
+	return atoms.at(rep.result(0));
 }
 
 /**
- * Create a new atom, retrieved from storage
- *
- * This method does *not* register the atom with any atomtable/atomspace
- * However, it does register with the TLB, as the SQL uuids and the
- * TLB Handles must be kept in sync, or all hell breaks loose.
+ * Not supported: the server keeps atoms by their contents, and has no
+ * UUIDs to look them up by. Use getNode() or getLink() instead.
  */
 AtomPtr ZMQClient::getAtom(UUID uuid)
 {
-    ZMQRequestMessage req;
-    ZMQReplyMessage rep;
-
-    req.set_function(ZMQgetAtoms);
-    ZMQAtomFetch *fetch1 = req.add_fetch();
-    fetch1->set_kind(ZMQAtomFetchKind::UUID);
-    fetch1->set_handle(uuid);
-    sendMessage(req, rep);
-
-    ZMQAtomMessage atomMsg = rep.atom(0);
-    if (atomMsg.atomtype() != ZMQAtomTypeNotFound) {
-        AtomPtr atomPtr = ProtocolBufferSerializer::deserialize(atomMsg);
-        return atomPtr;
-    } else {
-    	return NULL;
-    }
-}
-
-void ZMQClient::flushStoreQueue()
-{
-
+	throw RuntimeException(TRACE_INFO,
+		"ZMQClient: getAtom(UUID) is not supported; "
+		"the server has no UUIDs");
 }
 
 /* ============================= END OF FILE ================= */
@@ -29,10 +29,15 @@
 #define _OPENCOG_PERSISTENT_ZMQ_STORAGE_H
 
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
 #include <mutex>
 #include <set>
 #include <string>
 #include <thread>
+#include <unordered_map>
 #include <vector>
 
 #include <zmq.hpp>
@@ -53,13 +58,80 @@ namespace opencog
  *  @{
  */
 
+/**
+ * Client side of the ZeroMQ backing store.
+ *
+ * Requests go out on a DEALER socket, so that many of them can be in
+ * flight at once; each carries an id, and the server's ROUTER copies
+ * it into the reply. The socket belongs to an I/O thread. Other
+ * threads queue their requests for it, and ring a doorbell (an inproc
+ * PUSH/PULL pair) to wake it up; the I/O thread sends them, as the
+ * pipeline depth allows, and hands the replies back by id.
+ *
+ * Stores are asynchronous. storeAtom() only adds the atom to a batch;
+ * full batches are sent as one message, and a partial batch is sent
+ * after it has lingered for a little while. flushStoreQueue() sends
+ * the partial batch, and waits until the server has acknowledged all
+ * of the stores in flight.
+ *
+ * If the server sends no reply at all for the whole timeout, while
+ * someone is waiting on one, every request queued or in flight is
+ * failed: the waiting calls throw, and so does the next
+ * flushStoreQueue(). The destructor only logs it.
+ */
 class ZMQClient
 {
 	private:
 		zmq::context_t *zmqContext;
-		zmq::socket_t *zmqClientSocket;
+		bool ownContext;
 		int store_count = 0;
 
+		// Used only by the I/O thread.
+		zmq::socket_t *zmqClientSocket;
+		zmq::socket_t *zmqDoorbell;
+
+		// Rung by the other threads; guarded by _doorbell_mutex.
+		zmq::socket_t *zmqBellPush;
+		std::mutex _doorbell_mutex;
+
+		typedef std::function<void(ZMQReplyMessage&)> Done;
+		struct Request
+		{
+			uint64_t id;
+			std::string* body;
+			Done done;
+		};
+
+		// Everything below is guarded by _queue_mutex.
+		std::mutex _queue_mutex;
+		std::condition_variable _queue_cv;
+		std::deque<Request> _send_queue;
+		std::unordered_map<uint64_t, Done> _in_flight;
+		uint64_t _next_id;
+		uint64_t _replies;
+		size_t _pending_stores;
+		size_t _failed_stores;
+		size_t _max_in_flight;
+		bool _stop;
+		std::chrono::milliseconds _timeout;
+
+		// The batch of atoms to be stored.
+		std::mutex _batch_mutex;
+		HandleSeq _write_batch;
+		std::chrono::steady_clock::time_point _batch_start;
+		size_t _batch_size;
+
+		std::thread _io_thread;
+		void io_loop(void);
+		void ring(void);
+		void submit(ZMQRequestMessage&, Done, bool from_io_thread = false);
+		void wait_replies(std::unique_lock<std::mutex>&,
+		                  const std::function<bool(void)>&);
+		void fail_requests(const char*);
+		void send_store(HandleSeq&, bool from_io_thread = false);
+		void flush_lingering_batch(void);
+		void add_to_table(AtomTable&, const ZMQReplyMessage&);
+
 	protected:
 		void sendMessage(ZMQRequestMessage& requestMessage,
 		        ZMQReplyMessage& replyMessage);
@@ -67,17 +139,34 @@ class ZMQClient
 		bool store_cb(AtomPtr atom);
 
 	public:
-		ZMQClient(string networkAddress = "tcp://127.0.0.1:5555"); //"ipc:///tmp/AtomSpaceZMQ.ipc"
+		/**
+		 * Connect to the server at the network address. An inproc://
+		 * address works only if the server uses the same context;
+		 * pass the server's context() in that case.
+		 */
+		ZMQClient(string networkAddress = "tcp://127.0.0.1:5555", //"ipc:///tmp/AtomSpaceZMQ.ipc"
+		          zmq::context_t* context = nullptr);
 		~ZMQClient();
 
 		bool connected(void); // connection to DB is alive
 
+		// Pipelining and batching.  At most max_in_flight requests are
+		// sent before the first reply comes back, and stores are sent
+		// batch_size atoms at a time.
+		void set_max_in_flight(size_t);
+		void set_batch_size(size_t);
+
+		// How long to wait without any reply from the server, before
+		// failing the requests; 30 seconds by default.
+		void set_timeout(std::chrono::milliseconds);
+
 		// Store atoms to DB
 //		void storeSingleAtom(AtomPtr);
 		void storeAtom(const AtomPtr& atomPtr, bool synchronous = false);
 		void flushStoreQueue();
 
-		// Fetch atoms from DB
+		// Fetch atoms from DB.  getAtom(UUID) throws; the server
+		// has no UUIDs.
 		AtomPtr getAtom(UUID);
 		Handle getNode(Type, const char *);
 		Handle getLink(Type, const HandleSeq&);
@@ -87,6 +176,9 @@ class ZMQClient
 		void load(AtomTable &); // Load entire contents of DB
 		void getIncomingSet(AtomTable&, const Handle&);
 		void getIncomingByType(AtomTable&, const Handle&, Type);
+		// The incoming sets of many atoms, in one round-trip; only the
+		// links of the given type, unless that is NOTYPE.
+		void getIncomingSets(AtomTable&, const HandleSeq&, Type = NOTYPE);
 		void store(const AtomTable &); // Store entire contents of AtomTable
 		void reserve(void);     // reserve range of UUID's
 
@@ -0,0 +1,212 @@
+/*
+ * opencog/persist/zmq/atomspace/ZMQServer.cc
+ *
+ * Copyright (C) 2008-2015 OpenCog Foundation
+ * All Rights Reserved
+ *
+ * Written by Erwin Joosten
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License v3 as
+ * published by the Free Software Foundation and including the exceptions
+ * at http://opencog.org/wiki/Licenses
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, write to:
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <opencog/util/Logger.h>
+#include <opencog/atoms/base/Link.h>
+#include <opencog/atoms/base/Node.h>
+
+#include "ProtocolBufferSerializer.h"
+#include "ZMQServer.h"
+
+using namespace opencog;
+
+/// How often the server thread checks whether it should stop.
+#define STOP_POLL_MSEC 100
+
+ZMQServer::ZMQServer(AtomSpace* atomSpace1, std::string networkAddress,
+                     zmq::context_t* context)
+    : stopServer(false), atomSpace(atomSpace1)
+{
+    ownContext = (nullptr == context);
+    zmqContext = ownContext ? new zmq::context_t(1) : context;
+
+    // Bind before returning, so that clients can connect right away.
+    zmqServerSocket = new zmq::socket_t(*zmqContext, ZMQ_ROUTER);
+    int linger = 0;
+    zmqServerSocket->setsockopt(ZMQ_LINGER, &linger, sizeof(linger));
+    zmqServerSocket->bind(networkAddress.c_str());
+
+    zmqServerThread = std::thread(&ZMQServer::zmqLoop, this);
+}
+
+ZMQServer::~ZMQServer()
+{
+    stopServer = true;
+    zmqServerThread.join();
+    delete zmqServerSocket;
+    if (ownContext) delete zmqContext;
+}
+
+/// zmq calls this when it is done with a reply body.
+static void free_body(void*, void* hint)
+{
+    delete static_cast<std::string*>(hint);
+}
+
+void ZMQServer::zmqLoop(void)
+{
+    zmq::pollitem_t items[] = {
+        { (void *) *zmqServerSocket, 0, ZMQ_POLLIN, 0 },
+    };
+
+    while (not stopServer)
+    {
+        zmq::poll(items, 1, STOP_POLL_MSEC);
+        if (0 == (items[0].revents & ZMQ_POLLIN)) continue;
+
+        // Each request is the identity of the client, then the body.
+        zmq::message_t identity, request;
+        while (zmqServerSocket->recv(&identity, ZMQ_DONTWAIT))
+        {
+            if (not identity.more()) continue;
+            zmqServerSocket->recv(&request);
+
+            ZMQRequestMessage requestMessage;
+            ZMQReplyMessage replyMessage;
+            if (requestMessage.ParseFromArray(request.data(), request.size()))
+                serve(requestMessage, replyMessage);
+            else
+                replyMessage.set_error("Malformed request");
+
+            std::string* strReply = new std::string(
+                replyMessage.SerializeAsString());
+            zmq::message_t reply((void *) strReply->data(), strReply->size(),
+                                 free_body, strReply);
+            zmqServerSocket->send(identity, ZMQ_SNDMORE);
+            zmqServerSocket->send(reply);
+        }
+    }
+}
+
+void ZMQServer::serve(const ZMQRequestMessage& req, ZMQReplyMessage& rep)
+{
+    rep.set_id(req.id());
+    try
+    {
+        switch (req.function())
+        {
+            case ZMQstoreAtoms:
+                storeAtoms(req, rep);
+                break;
+            case ZMQgetAtoms:
+                getAtoms(req, rep);
+                break;
+            case ZMQfetchAtoms:
+                fetchAtoms(req, rep);
+                break;
+            default:
+                rep.set_error("Unsupported ZMQ function");
+        }
+    }
+    catch (const std::exception& ex)
+    {
+        rep.clear_atom();
+        rep.clear_result();
+        rep.set_error(ex.what());
+    }
+}
+
+/// Add the atoms to the atomspace, replacing the truth values of those
+/// that are already there.
+void ZMQServer::storeAtoms(const ZMQRequestMessage& req, ZMQReplyMessage&)
+{
+    HandleSeq atoms(ProtocolBufferSerializer::deserialize(req.atom()));
+    for (const Handle& h : atoms)
+        if (nullptr == h)
+            throw RuntimeException(TRACE_INFO, "Cannot store a missing atom");
+
+    HandleSeq added(atomSpace->add_atoms(atoms));
+    for (size_t i = 0; i < added.size(); i++)
+        if (req.atom(i).has_truthvalue())
+            added[i]->setTruthValue(atoms[i]->getTruthValue());
+}
+
+/// Look up single atoms; the result of each fetch is its position
+/// in the reply.
+void ZMQServer::getAtoms(const ZMQRequestMessage& req, ZMQReplyMessage& rep)
+{
+    HandleSeq reqAtoms(ProtocolBufferSerializer::deserialize(req.atom()));
+    for (const ZMQAtomFetch& fetch : req.fetch())
+    {
+        Handle found;
+        switch (fetch.kind())
+        {
+            case ZMQAtomFetchKind::UUID:
+                // There are no UUIDs here.
+                break;
+            case ZMQAtomFetchKind::NODE:
+                found = atomSpace->get_atom(
+                    Handle(createNode(fetch.type(), fetch.name())));
+                break;
+            case ZMQAtomFetchKind::LINK:
+                found = atomSpace->get_atom(reqAtoms.at(fetch.handle()));
+                break;
+            default:
+                throw RuntimeException(TRACE_INFO,
+                    "Unsupported fetch kind %d for ZMQgetAtoms", fetch.kind());
+        }
+
+        if (nullptr == found)
+        {
+            rep.add_result(rep.atom_size());
+            rep.add_atom()->set_atomtype(ZMQAtomTypeNotFound);
+            continue;
+        }
+        rep.add_result(ProtocolBufferSerializer::serialize(
+            HandleSeq({found}), rep.mutable_atom())[0]);
+    }
+}
+
+/// Gather the results of all of the fetches, and send them back in
+/// one list.
+void ZMQServer::fetchAtoms(const ZMQRequestMessage& req, ZMQReplyMessage& rep)
+{
+    HandleSeq reqAtoms(ProtocolBufferSerializer::deserialize(req.atom()));
+    HandleSeq results;
+    for (const ZMQAtomFetch& fetch : req.fetch())
+    {
+        switch (fetch.kind())
+        {
+            case ZMQAtomFetchKind::INCOMING:
+            {
+                Handle target(atomSpace->get_atom(reqAtoms.at(fetch.handle())));
+                if (nullptr == target) break;
+                IncomingSet iset(fetch.has_type() ?
+                    target->getIncomingSetByType(fetch.type()) :
+                    target->getIncomingSet(atomSpace));
+                for (const LinkPtr& l : iset)
+                    results.emplace_back(Handle(l));
+                break;
+            }
+            case ZMQAtomFetchKind::TYPE:
+                atomSpace->get_handles_by_type(results, fetch.type(),
+                                               fetch.subclass());
+                break;
+            default:
+                throw RuntimeException(TRACE_INFO,
+                    "Unsupported fetch kind %d for ZMQfetchAtoms", fetch.kind());
+        }
+    }
+    ProtocolBufferSerializer::serialize(results, rep.mutable_atom());
+}
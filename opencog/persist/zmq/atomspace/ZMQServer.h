@@ -0,0 +1,81 @@
+/*
+ * opencog/persist/zmq/atomspace/ZMQServer.h
+ *
+ * Copyright (C) 2008-2015 OpenCog Foundation
+ * All Rights Reserved
+ *
+ * Written by Erwin Joosten
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License v3 as
+ * published by the Free Software Foundation and including the exceptions
+ * at http://opencog.org/wiki/Licenses
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, write to:
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _OPENCOG_ZMQ_SERVER_H
+#define _OPENCOG_ZMQ_SERVER_H
+
+#include <atomic>
+#include <string>
+#include <thread>
+
+#include <zmq.hpp>
+#include <opencog/atomspace/AtomSpace.h>
+#include "opencog/persist/zmq/atomspace/ZMQMessages.pb.h"
+
+namespace opencog {
+/** \addtogroup grp_persist
+ *  @{
+ */
+
+/**
+ * Serves an AtomSpace to ZMQClients, over a ROUTER socket, so that
+ * each client may have many requests in flight.  Requests are served
+ * in the order they arrive, by one thread.
+ *
+ * With an inproc:// address, this is a local, in-process backing
+ * store, for benchmarking and testing the client without a network;
+ * the client must then be given this server's context().
+ *
+ * Errors are sent back in ZMQReplyMessage#error, and thrown by the
+ * client.  If the server crashes or is restarted, the clients have to
+ * be restarted as well.
+ */
+class ZMQServer
+{
+    zmq::context_t* zmqContext;
+    bool ownContext;
+    zmq::socket_t* zmqServerSocket;
+    std::thread zmqServerThread;
+    std::atomic<bool> stopServer;
+    AtomSpace* atomSpace;
+
+    void zmqLoop(void);
+    void serve(const ZMQRequestMessage&, ZMQReplyMessage&);
+    void storeAtoms(const ZMQRequestMessage&, ZMQReplyMessage&);
+    void getAtoms(const ZMQRequestMessage&, ZMQReplyMessage&);
+    void fetchAtoms(const ZMQRequestMessage&, ZMQReplyMessage&);
+
+public:
+    ZMQServer(AtomSpace* atomSpace1,
+              std::string networkAddress = "tcp://*:5555", //"ipc:///tmp/AtomSpaceZMQ.ipc"
+              zmq::context_t* context = nullptr);
+    ~ZMQServer();
+
+    zmq::context_t* context() { return zmqContext; }
+};
+
+/** @}*/
+} // namespace opencog
+
+#endif // _OPENCOG_ZMQ_SERVER_H
@@ -35,6 +35,13 @@ TruthValuePtr satisfaction_link(AtomSpace*, const Handle&);
 Handle satisfying_set(AtomSpace*, const Handle&, size_t max_results=SIZE_MAX);
 Handle recognize(AtomSpace*, const Handle&);
 
+// As above, but with the search split across `nthreads` threads;
+// zero means one thread per core.
+Handle parallel_bindlink(AtomSpace*, const Handle&, unsigned nthreads=0,
+                         size_t max_results=SIZE_MAX);
+Handle parallel_satisfying_set(AtomSpace*, const Handle&, unsigned nthreads=0,
+                               size_t max_results=SIZE_MAX);
+
 } // namespace opencog
 
 #endif // _OPENCOG_BINDLINK_API_H
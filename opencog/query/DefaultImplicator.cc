@@ -21,10 +21,28 @@
  * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
  */
 
+#include <typeinfo>
+
 #include "DefaultImplicator.h"
 
 using namespace opencog;
 
+/**
+ * The workers instantiate their groundings in their own threads, and
+ * put the results into our result set.
+ */
+PatternMatchCallback* DefaultImplicator::make_worker(void)
+{
+	// A derived class would need workers of its own kind.
+	if (typeid(*this) != typeid(DefaultImplicator)) return nullptr;
+
+	DefaultImplicator* w = new DefaultImplicator(InitiateSearchCB::_as);
+	w->implicand = implicand;
+	w->max_results = max_results;
+	w->_sink = this;
+	return w;
+}
+
 #ifdef CACHED_IMPLICATOR
 
 DefaultImplicator* CachedDefaultImplicator::_cached_implicator = NULL;
@@ -66,6 +66,8 @@ class DefaultImplicator:
 		InitiateSearchCB::set_pattern(vars, pat);
 		DefaultPatternMatchCB::set_pattern(vars, pat);
 	}
+
+	virtual PatternMatchCallback* make_worker(void);
 };
 
 
@@ -187,6 +187,15 @@ void DefaultPatternMatchCB::set_pattern(const Variables& vars,
 	_globs = &pat.globby_terms;
 }
 
+/// A worker that grounded an optional clause counts as if we had.
+void DefaultPatternMatchCB::release_worker(PatternMatchCallback* w)
+{
+	DefaultPatternMatchCB* dw = dynamic_cast<DefaultPatternMatchCB*>(w);
+	if (dw and dw->_optionals_present)
+		_optionals_present = true;
+	delete w;
+}
+
 /* ======================================================== */
 
 /**
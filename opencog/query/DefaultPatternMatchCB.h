@@ -91,6 +91,8 @@ class DefaultPatternMatchCB : public virtual PatternMatchCallback
 		}
 
 		bool optionals_present(void) { return _optionals_present; }
+
+		virtual void release_worker(PatternMatchCallback*);
 	protected:
 
 		ClassServer& _classserver;
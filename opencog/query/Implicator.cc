@@ -46,7 +46,8 @@ bool Implicator::grounding(const HandleMap &var_soln,
 	// PatternMatchEngine::print_solution(term_soln,var_soln);
 
 	// Do not accept new solution if maximum number has been already reached
-	if (_result_set.size() >= max_results)
+	Implicator* sink = _sink ? _sink : this;
+	if (sink->num_results() >= max_results)
 		return true;
 
 	// Ignore the case where the URE creates ill-formed links (due to
@@ -57,15 +58,20 @@ bool Implicator::grounding(const HandleMap &var_soln,
 	// issue #950 and pull req #962. XXX FIXME later.
 	try {
 		Handle h = inst.instantiate(implicand, var_soln, true);
-		insert_result(h);
+		sink->insert_result(h);
 	} catch(...) {}
 
 	// If we found as many as we want, then stop looking for more.
-	return (_result_set.size() >= max_results);
+	return (sink->num_results() >= max_results);
 }
 
 void Implicator::insert_result(const Handle& h)
 {
+	std::lock_guard<std::mutex> lck(_result_mtx);
+
+	// Worker threads may race past the limit; keep only the first ones.
+	if (_result_set.size() >= max_results) return;
+
 	if (h and _result_set.end() == _result_set.find(h))
 	{
 		_result_set.insert(h);
@@ -73,6 +79,12 @@ void Implicator::insert_result(const Handle& h)
 	}
 }
 
+size_t Implicator::num_results()
+{
+	std::lock_guard<std::mutex> lck(_result_mtx);
+	return _result_set.size();
+}
+
 namespace opencog
 {
 
@@ -159,6 +171,21 @@ Handle bindlink(AtomSpace* as, const Handle& hbindlink, size_t max_results)
 	return do_imply(as, hbindlink, impl);
 }
 
+/**
+ * Same as bindlink(), but with the search split across several
+ * threads.  The order of the results is not defined; if there are
+ * more than `max_results` of them, it is not defined which ones are
+ * returned, either.
+ */
+Handle parallel_bindlink(AtomSpace* as, const Handle& hbindlink,
+                         unsigned nthreads, size_t max_results)
+{
+	DefaultImplicator impl(as);
+	impl.max_results = max_results;
+	impl.set_threads(nthreads);
+	return do_imply(as, hbindlink, impl);
+}
+
 /**
  * Attentional Focus specific PatternMatchCallback implementation
  */
@@ -24,6 +24,7 @@
 #ifndef _OPENCOG_IMPLICATOR_H
 #define _OPENCOG_IMPLICATOR_H
 
+#include <mutex>
 #include <vector>
 
 #include <opencog/atomspace/AtomSpace.h>
@@ -58,8 +59,16 @@ class Implicator :
 		UnorderedHandleSet _result_set;
 		HandleSeq _result_list;
 
+		// When the search is split across threads, the workers put
+		// their results into the result set of the callback that
+		// created them; the lock guards that set.
+		Implicator* _sink;
+		std::mutex _result_mtx;
+		size_t num_results();
+
 	public:
-		Implicator(AtomSpace* as) : inst(as), max_results(SIZE_MAX) {}
+		Implicator(AtomSpace* as) :
+			_sink(nullptr), inst(as), max_results(SIZE_MAX) {}
 		Instantiator inst;
 		Handle implicand;
 		size_t max_results;
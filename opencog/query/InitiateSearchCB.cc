@@ -30,7 +30,13 @@
 #include <opencog/atomutils/FindUtils.h>
 #include <opencog/atomutils/Substitutor.h>
 
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+
 #include "InitiateSearchCB.h"
+#include "JoinOrder.h"
 #include "PatternMatchEngine.h"
 
 using namespace opencog;
@@ -62,6 +68,9 @@ InitiateSearchCB::InitiateSearchCB(AtomSpace* as) :
 	_curr_clause = 0;
 	_choices.clear();
  	_search_fail = false;
+	_nthreads = 1;
+	_use_plans = true;
+	_use_costs = true;
 	_as = as;
 #endif
 }
@@ -85,6 +94,9 @@ void InitiateSearchCB::clear()
 	_curr_clause = 0;
 	_choices.clear();
  	_search_fail = false;
+	_nthreads = 1;
+	_use_plans = true;
+	_use_costs = true;
 	_as = NULL;
 }
 #endif
@@ -99,6 +111,23 @@ void InitiateSearchCB::set_pattern(const Variables& vars,
 	_dynamic = &pat.evaluatable_terms;
 }
 
+void InitiateSearchCB::set_threads(unsigned nthreads)
+{
+	if (0 == nthreads)
+		nthreads = std::thread::hardware_concurrency();
+	_nthreads = (0 == nthreads) ? 1 : nthreads;
+}
+
+void InitiateSearchCB::set_plan_cache(bool use)
+{
+	_use_plans = use;
+}
+
+void InitiateSearchCB::set_cost_model(bool use)
+{
+	_use_costs = use;
+}
+
 
 /* ======================================================== */
 
@@ -256,6 +285,7 @@ Handle InitiateSearchCB::find_thinnest(const HandleSeq& clauses,
 	Handle best_start(Handle::UNDEFINED);
 	starter_term = Handle::UNDEFINED;
 	_choices.clear();
+	_starts.clear();
 
 	size_t nc = clauses.size();
 	for (size_t i=0; i < nc; i++)
@@ -269,6 +299,16 @@ Handle InitiateSearchCB::find_thinnest(const HandleSeq& clauses,
 		size_t width = SIZE_MAX;
 		Handle term(Handle::UNDEFINED);
 		Handle start(find_starter(h, depth, term, width));
+		if (start)
+		{
+			_start_widths.emplace_back(start, width);
+
+			Choice ch;
+			ch.clause = i;
+			ch.best_start = start;
+			ch.start_term = term;
+			_starts.push_back(ch);
+		}
 		if (start
 		    and (width < thinnest
 		         or (width == thinnest and depth > deepest)))
@@ -284,6 +324,123 @@ Handle InitiateSearchCB::find_thinnest(const HandleSeq& clauses,
 	return best_start;
 }
 
+/* ======================================================== */
+
+// Don't bother with threads unless each one gets at least this
+// many starting points to explore.
+#define MIN_CANDIDATES_PER_THREAD 16
+
+// Each thread grabs this many chunks' worth of starting points, on
+// average, so that a thread that lands on a few expensive ones does
+// not hold up the rest.
+#define CHUNKS_PER_THREAD 8
+
+/**
+ * Return true if the search over `ncands` starting points should be
+ * split across threads.  Multi-component patterns are grounded
+ * through a wrapper callback that collects the groundings of each
+ * component; that one is not thread-safe, so those are always
+ * searched in the calling thread.
+ */
+bool InitiateSearchCB::use_workers(PatternMatchEngine *pme, size_t ncands)
+{
+	if (_nthreads < 2) return false;
+	if (ncands < 2 * MIN_CANDIDATES_PER_THREAD) return false;
+
+	PatternMatchCallback* self = this;
+	return &pme->get_callback() == self;
+}
+
+/**
+ * Explore the neighborhood of each of the candidate starting points,
+ * using several threads. Every thread gets its own worker callback,
+ * and its own engine, and thus its own grounding stacks; the workers
+ * report their groundings back to this callback.  The starting points
+ * are handed out in chunks, from a shared cursor, so that the threads
+ * that finish early pick up the remaining work. The search stops as
+ * soon as any of the threads is satisfied, just as the single-threaded
+ * search would.
+ *
+ * If this callback does not provide workers, then the search is done
+ * in the calling thread.
+ */
+bool InitiateSearchCB::explore_candidates(PatternMatchEngine *pme,
+                                          const HandleSeq& cands)
+{
+	size_t ncands = cands.size();
+	size_t nworkers = std::min((size_t) _nthreads,
+	                           ncands / MIN_CANDIDATES_PER_THREAD);
+
+	std::vector<PatternMatchCallback*> workers;
+	for (size_t i = 0; i < nworkers; i++)
+	{
+		PatternMatchCallback* w = make_worker();
+		if (nullptr == w) break;
+		w->set_pattern(*_variables, *_pattern);
+		workers.push_back(w);
+	}
+
+	if (workers.empty())
+	{
+		for (const Handle& h : cands)
+			if (pme->explore_neighborhood(_root, _starter_term, h))
+				return true;
+		return false;
+	}
+
+	size_t chunk = std::max((size_t) 1,
+	                        ncands / (workers.size() * CHUNKS_PER_THREAD));
+	std::atomic<size_t> cursor(0);
+	std::atomic<bool> stop(false);
+	std::atomic<bool> found(false);
+	std::mutex err_mtx;
+	std::exception_ptr err;
+
+	auto work = [&](PatternMatchCallback* w)
+	{
+		try
+		{
+			PatternMatchEngine wpme(*w);
+			wpme.set_pattern(*_variables, *_pattern);
+			wpme.set_join_order(_join_order);
+			while (not stop.load())
+			{
+				size_t start = cursor.fetch_add(chunk);
+				if (ncands <= start) break;
+				size_t end = std::min(start + chunk, ncands);
+				for (size_t i = start; i < end and not stop.load(); i++)
+				{
+					if (wpme.explore_neighborhood(_root, _starter_term,
+					                              cands[i]))
+					{
+						found = true;
+						stop = true;
+					}
+				}
+			}
+		}
+		catch (...)
+		{
+			std::lock_guard<std::mutex> lck(err_mtx);
+			if (not err) err = std::current_exception();
+			stop = true;
+		}
+	};
+
+	// The calling thread does its share of the work, too.
+	std::vector<std::thread> pool;
+	for (size_t i = 1; i < workers.size(); i++)
+		pool.push_back(std::thread(work, workers[i]));
+	work(workers[0]);
+	for (std::thread& t : pool) t.join();
+
+	for (PatternMatchCallback* w : workers)
+		release_worker(w);
+
+	if (err) std::rethrow_exception(err);
+	return found;
+}
+
 /* ======================================================== */
 /**
  * Given a set of clauses, find a neighborhood to search, and perform
@@ -313,23 +470,7 @@ bool InitiateSearchCB::neighbor_search(PatternMatchEngine *pme)
 		return false;
 	}
 
-	// Sometimes, the number of mandatory clauses can be zero...
-	// or they might all be evaluatable.  In this case, its OK to
-	// start searching with an optional clause. But if there ARE
-	// mandatories, we must NOT start search on an optional, since,
-	// after all, it might be absent!
-	bool try_all = true;
-	for (const Handle& m : _pattern->mandatory)
-	{
-		if (0 == _pattern->evaluatable_holders.count(m))
-		{
-			try_all = false;
-			break;
-		}
-	}
-
-	const HandleSeq& clauses =
-		try_all ?  _pattern->cnf_clauses :  _pattern->mandatory;
+	const HandleSeq& clauses = neighbor_clauses();
 
 	// In principle, we could start our search at some node, any node,
 	// that is not a variable. In practice, the search begins by
@@ -359,7 +500,8 @@ bool InitiateSearchCB::neighbor_search(PatternMatchEngine *pme)
 	}
 
 	// If only a single choice, fake it for the loop below.
-	if (0 == _choices.size())
+	bool single = (0 == _choices.size());
+	if (single)
 	{
 		Choice ch;
 		ch.clause = bestclause;
@@ -372,13 +514,110 @@ bool InitiateSearchCB::neighbor_search(PatternMatchEngine *pme)
 		// TODO -- weed out duplicates!
 	}
 
+	// The thinnest start is not always the cheapest one; it might
+	// lead to clauses with a huge fan-out. So look at all of them.
+	order_choices(single);
+
+	save_plan(QueryPlan::NEIGHBOR);
+	return explore_choices(pme);
+}
+
+/**
+ * Use the cost model to pick the order in which to ground the clauses,
+ * for each of the chosen start points. If `pick_start` is set, then
+ * the start point is picked, too, from among all of those found by
+ * find_thinnest(). With ChoiceLinks in the pattern, each of the
+ * choices must be explored, and so none of them can be passed over.
+ */
+void InitiateSearchCB::order_choices(bool pick_start)
+{
+	if (not _use_costs) return;
+
+	JoinOrder jo(_as, *_variables, *_pattern);
+	if (jo.size() < 2) return;
+
+	const HandleSeq& clauses = neighbor_clauses();
+	if (pick_start)
+	{
+		Choice& best = _choices[0];
+		double least = jo.order(clauses[best.clause], best.order);
+		for (const Choice& ch : _starts)
+		{
+			HandleSeq order;
+			double cost = jo.order(clauses[ch.clause], order);
+			if (cost < least)
+			{
+				least = cost;
+				best = ch;
+				best.order = order;
+			}
+		}
+	}
+	else
+	{
+		for (Choice& ch : _choices)
+			jo.order(clauses[ch.clause], ch.order);
+	}
+
+	const auto& tcs = jo.type_counts();
+	_type_counts.insert(_type_counts.end(), tcs.begin(), tcs.end());
+}
+
+/**
+ * Use the cost model to pick the order in which to ground the clauses,
+ * when the search starts with the root clause.
+ */
+void InitiateSearchCB::order_from_root(void)
+{
+	_join_order.clear();
+	if (not _use_costs) return;
+
+	JoinOrder jo(_as, *_variables, *_pattern);
+	if (jo.size() < 2) return;
+
+	jo.order(_root, _join_order);
+
+	const auto& tcs = jo.type_counts();
+	_type_counts.insert(_type_counts.end(), tcs.begin(), tcs.end());
+}
+
+/**
+ * The clauses that the neighbor search may start with.
+ */
+const HandleSeq& InitiateSearchCB::neighbor_clauses(void)
+{
+	// Sometimes, the number of mandatory clauses can be zero...
+	// or they might all be evaluatable.  In this case, its OK to
+	// start searching with an optional clause. But if there ARE
+	// mandatories, we must NOT start search on an optional, since,
+	// after all, it might be absent!
+	bool try_all = true;
+	for (const Handle& m : _pattern->mandatory)
+	{
+		if (0 == _pattern->evaluatable_holders.count(m))
+		{
+			try_all = false;
+			break;
+		}
+	}
+
+	return try_all ?  _pattern->cnf_clauses :  _pattern->mandatory;
+}
+
+/**
+ * Explore the neighborhoods of each of the chosen start points.
+ */
+bool InitiateSearchCB::explore_choices(PatternMatchEngine *pme)
+{
+	const HandleSeq& clauses = neighbor_clauses();
 	for (const Choice& ch : _choices)
 	{
-		bestclause = ch.clause;
-		best_start = ch.best_start;
+		const Handle& best_start = ch.best_start;
 		_starter_term = ch.start_term;
+		_join_order = ch.order;
+		pme->set_join_order(_join_order);
 
-		_root = clauses[bestclause];
+		_root = clauses[ch.clause];
 		DO_LOG({LAZY_LOG_FINE << "Search start node: " << best_start->toShortString();})
 		DO_LOG({LAZY_LOG_FINE << "Start term is: "
 		              << (_starter_term == (Atom*) nullptr ?
@@ -390,6 +629,15 @@ bool InitiateSearchCB::neighbor_search(PatternMatchEngine *pme)
 		// focus in the AttentionalFocusCB class...
 		IncomingSet iset = get_incoming_set(best_start);
 		size_t sz = iset.size();
+		if (use_workers(pme, sz))
+		{
+			HandleSeq cands;
+			cands.reserve(sz);
+			for (const LinkPtr& lp : iset)
+				cands.emplace_back(lp);
+			if (explore_candidates(pme, cands)) return true;
+			continue;
+		}
 		for (size_t i = 0; i < sz; i++)
 		{
 			Handle h(iset[i]);
@@ -501,6 +749,26 @@ bool InitiateSearchCB::initiate_search(PatternMatchEngine *pme)
 {
 	jit_analyze(pme);
 
+	// If this pattern was run before, the search can start the way
+	// it did last time; unless the atomspace has changed too much.
+	if (_use_plans)
+	{
+		QueryPlanPtr plan(std::atomic_load(&_pattern->plan));
+		if (nullptr == plan or QueryPlan::NONE == plan->strategy or
+		    plan->made_by != typeid(*this) or plan->space != _as->get_uuid())
+			QueryPlan::count_miss();
+		else if (plan->drifted(_as))
+			QueryPlan::count_replan();
+		else
+		{
+			QueryPlan::count_hit();
+			return run_plan(pme, *plan);
+		}
+	}
+	_start_widths.clear();
+	_type_counts.clear();
+	_join_order.clear();
+
 	DO_LOG({logger().fine("Attempt to use node-neighbor search");})
 	_search_fail = false;
 	bool found = neighbor_search(pme);
@@ -561,6 +829,7 @@ void InitiateSearchCB::find_rarest(const Handle& clause,
 	if (not quotation.consumable(t))
 	{
 		size_t num = (size_t) _as->get_num_atoms_of_type(t);
+		_type_counts.emplace_back(t, num);
 		if (num < count)
 		{
 			count = num;
@@ -617,29 +886,11 @@ bool InitiateSearchCB::link_type_search(PatternMatchEngine *pme)
 		return false;
 	}
 
-	DO_LOG({LAZY_LOG_FINE << "Start clause is: " << std::endl
-	              << _root->toShortString();})
-	DO_LOG({LAZY_LOG_FINE << "Start term is: " << std::endl
-	              << _starter_term->toShortString();})
-
 	// Get type of the rarest link
-	Type ptype = _starter_term->getType();
-
-	HandleSeq handle_set;
-	_as->get_handles_by_type(handle_set, ptype);
-
-#ifdef DEBUG
-	size_t i = 0, hsz = handle_set.size();
-#endif
-	for (const Handle& h : handle_set)
-	{
-		DO_LOG({LAZY_LOG_FINE << "yyyyyyyyyy link_type_search yyyyyyyyyy\n"
-		              << "Loop candidate (" << ++i << "/" << hsz << "):\n"
-		              << h->toShortString();})
-		bool found = pme->explore_neighborhood(_root, _starter_term, h);
-		if (found) return true;
-	}
-	return false;
+	std::set<Type> ptypes({_starter_term->getType()});
+	order_from_root();
+	save_plan(QueryPlan::LINK_TYPE, ptypes);
+	return explore_types(pme, ptypes);
 }
 
 /* ======================================================== */
@@ -700,7 +951,11 @@ bool InitiateSearchCB::variable_search(PatternMatchEngine *pme)
 		// Calculate the total number of atoms of typeset
 		size_t num = 0;
 		for (Type t : typeset)
-			num += (size_t) _as->get_num_atoms_of_type(t);
+		{
+			size_t tnum = (size_t) _as->get_num_atoms_of_type(t);
+			_type_counts.emplace_back(t, tnum);
+			num += tnum;
+		}
 
 		DO_LOG({LAZY_LOG_FINE << var->toString() << "has "
 		              << num << " atoms in the atomspace";})
@@ -790,6 +1045,29 @@ bool InitiateSearchCB::variable_search(PatternMatchEngine *pme)
 		_root = _starter_term = clauses[0];
 	}
 
+	order_from_root();
+
+	// Don't keep a plan for the untyped case; it should keep on
+	// tripping the loop detector above.
+	if (not ptypes.empty())
+		save_plan(QueryPlan::VARIABLE, ptypes);
+	return explore_types(pme, ptypes);
+}
+
+/**
+ * Explore the neighborhood of every atom of the given types, or of
+ * every atom, if no types are given.
+ */
+bool InitiateSearchCB::explore_types(PatternMatchEngine *pme,
+                                     const std::set<Type>& ptypes)
+{
+	DO_LOG({LAZY_LOG_FINE << "Start clause is: " << std::endl
+	              << _root->toShortString();})
+	DO_LOG({LAZY_LOG_FINE << "Start term is: " << std::endl
+	              << _starter_term->toShortString();})
+
+	pme->set_join_order(_join_order);
+
 	HandleSeq handle_set;
 	if (ptypes.empty())
 		_as->get_handles_by_type(handle_set, ATOM, true);
@@ -799,12 +1077,15 @@ bool InitiateSearchCB::variable_search(PatternMatchEngine *pme)
 
 	DO_LOG({LAZY_LOG_FINE << "Atomspace reported " << handle_set.size() << " atoms";})
 
+	if (use_workers(pme, handle_set.size()))
+		return explore_candidates(pme, handle_set);
+
 #ifdef DEBUG
 	size_t i = 0, hsz = handle_set.size();
 #endif
 	for (const Handle& h : handle_set)
 	{
-		DO_LOG({LAZY_LOG_FINE << "zzzzzzzzzzz variable_search zzzzzzzzzzz\n"
+		DO_LOG({LAZY_LOG_FINE << "zzzzzzzzzzz explore_types zzzzzzzzzzz\n"
 		              << "Loop candidate (" << ++i << "/" << hsz << "):\n"
 		              << h->toShortString();})
 		bool found = pme->explore_neighborhood(_root, _starter_term, h);
@@ -835,9 +1116,59 @@ bool InitiateSearchCB::no_search(PatternMatchEngine *pme)
 	}
 
 	// Evaluate all evaluatable clauses
+	save_plan(QueryPlan::NO_SEARCH);
 	return pme->explore_constant_evaluatables(_pattern->mandatory);
 }
 
+/* ======================================================== */
+/**
+ * Keep the decisions made so far with the pattern, so that the next
+ * search on it can skip straight to run_plan().
+ */
+void InitiateSearchCB::save_plan(QueryPlan::Strategy strategy,
+                                 const std::set<Type>& types)
+{
+	if (not _use_plans) return;
+
+	std::shared_ptr<QueryPlan> plan(std::make_shared<QueryPlan>());
+	plan->strategy = strategy;
+	plan->made_by = typeid(*this);
+	plan->space = _as->get_uuid();
+	plan->choices = _choices;
+	plan->root = _root;
+	plan->starter_term = _starter_term;
+	plan->types = types;
+	plan->order = _join_order;
+	plan->widths = _start_widths;
+	plan->type_counts = _type_counts;
+	std::atomic_store(&_pattern->plan, QueryPlanPtr(plan));
+}
+
+/**
+ * Run the search the way the plan says to.
+ */
+bool InitiateSearchCB::run_plan(PatternMatchEngine *pme,
+                                const QueryPlan& plan)
+{
+	switch (plan.strategy)
+	{
+		case QueryPlan::NEIGHBOR:
+			_choices = plan.choices;
+			return explore_choices(pme);
+		case QueryPlan::NO_SEARCH:
+			return pme->explore_constant_evaluatables(_pattern->mandatory);
+		case QueryPlan::LINK_TYPE:
+		case QueryPlan::VARIABLE:
+			_root = plan.root;
+			_starter_term = plan.starter_term;
+			_join_order = plan.order;
+			return explore_types(pme, plan.types);
+		default:
+			break;
+	}
+	return false;
+}
+
 /* ======================================================== */
 /**
  * Just-In-Time analysis of patterns. Patterns we could not unpack
@@ -850,6 +1181,24 @@ void InitiateSearchCB::jit_analyze(PatternMatchEngine* pme)
 	if (0 == _pattern->defined_terms.size())
 		return;
 
+	// If it was expanded before, and none of the definitions have
+	// changed since, then the old expansion is still good.
+	const Pattern* orig = _pattern;
+	QueryPlanPtr plan;
+	if (_use_plans)
+		plan = std::atomic_load(&orig->plan);
+	if (plan and plan->expanded and plan->expansion_current())
+	{
+		_pl = plan->expanded;
+		_variables = &_pl->get_variables();
+		_pattern = &_pl->get_pattern();
+		_dynamic = &_pattern->evaluatable_terms;
+
+		pme->set_pattern(*_variables, *_pattern);
+		set_pattern(*_variables, *_pattern);
+		return;
+	}
+
 	// Now is the time to look up the definitions!
 	// We loop here, so that all recursive definitions are expanded
 	// as well.  XXX Except that this is wrong, if any of the
@@ -859,6 +1208,7 @@ void InitiateSearchCB::jit_analyze(PatternMatchEngine* pme)
 	// evaluation, and only expand if really, really needed. (Which
 	// then brings up ideas like tail recursion, etc.)  Anyway, most
 	// of this code should probably be moved to PatterLink::jit_expand()
+	HandleMap used;
 	while (0 < _pattern->defined_terms.size())
 	{
 		Variables vset;
@@ -866,6 +1216,7 @@ void InitiateSearchCB::jit_analyze(PatternMatchEngine* pme)
 		for (const Handle& name : _pattern->defined_terms)
 		{
 			Handle defn = DefineLink::get_definition(name);
+			used.insert({name, defn});
 			if (not defn) continue;
 
 			// Extract the variables in the definition.
@@ -905,6 +1256,14 @@ void InitiateSearchCB::jit_analyze(PatternMatchEngine* pme)
 
 	_dynamic = &_pattern->evaluatable_terms;
 
+	if (_use_plans)
+	{
+		std::shared_ptr<QueryPlan> xplan(std::make_shared<QueryPlan>());
+		xplan->expanded = _pl;
+		xplan->definitions = used;
+		std::atomic_store(&orig->plan, QueryPlanPtr(xplan));
+	}
+
 	pme->set_pattern(*_variables, *_pattern);
 	set_pattern(*_variables, *_pattern);
 	DO_LOG({logger().fine("JIT expanded!");
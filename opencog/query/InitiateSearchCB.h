@@ -30,6 +30,7 @@
 #include <opencog/atoms/pattern/PatternLink.h>
 #include <opencog/query/PatternMatchCallback.h>
 #include <opencog/query/PatternMatchEngine.h>
+#include <opencog/query/QueryPlan.h>
 
 namespace opencog {
 
@@ -55,6 +56,36 @@ public:
 	virtual void set_pattern(const Variables&, const Pattern&);
 	virtual bool initiate_search(PatternMatchEngine *);
 
+	/**
+	 * Number of threads to split the search across. The candidate
+	 * starting points are handed out to the threads, each with its
+	 * own engine and worker callback (see make_worker()). Zero means
+	 * one thread per core; one (the default) means no threads at all.
+	 * Any grounded predicates in the pattern will be evaluated in
+	 * the worker threads.
+	 */
+	void set_threads(unsigned);
+
+	/**
+	 * Keep the search plan (the choice of search strategy and of
+	 * where to start) with the pattern, and re-use it the next time
+	 * the same pattern is run, by the same callback class, in the
+	 * same atomspace; on by default. A plan that is re-used skips
+	 * find_starter() and the *_search() methods, so derived classes
+	 * that override those to decide afresh each time should turn it
+	 * off.
+	 */
+	void set_plan_cache(bool);
+
+	/**
+	 * Use the clause statistics kept by the AtomTable to pick the
+	 * clause to start with, and the order in which to ground the
+	 * rest of them (see JoinOrder); on by default.  If off, the
+	 * search starts at the constant with the thinnest incoming set,
+	 * and the engine picks the next clause as it goes.
+	 */
+	void set_cost_model(bool);
+
 protected:
 
 	ClassServer& _classserver;
@@ -69,15 +100,28 @@ protected:
 	Handle _root;
 	Handle _starter_term;
 
-	struct Choice
-	{
-		size_t clause;
-		Handle best_start;
-		Handle start_term;
-	};
+	typedef QueryPlan::Choice Choice;
 	size_t _curr_clause;
 	std::vector<Choice> _choices;
 
+	// Every clause that the neighbor search could start with, and
+	// the clause order for the search under way.
+	bool _use_costs;
+	std::vector<Choice> _starts;
+	HandleSeq _join_order;
+	void order_choices(bool);
+	void order_from_root(void);
+
+	// The plan, and the sizes it is based on, as they are worked out.
+	bool _use_plans;
+	std::vector<std::pair<Handle, size_t>> _start_widths;
+	std::vector<std::pair<Type, size_t>> _type_counts;
+	void save_plan(QueryPlan::Strategy, const std::set<Type>& = {});
+	bool run_plan(PatternMatchEngine *, const QueryPlan&);
+	const HandleSeq& neighbor_clauses(void);
+	bool explore_choices(PatternMatchEngine *);
+	bool explore_types(PatternMatchEngine *, const std::set<Type>&);
+
 	virtual Handle find_starter(const Handle&, size_t&, Handle&, size_t&);
 	virtual Handle find_starter_recursive(const Handle&, size_t&, Handle&,
 	                                      size_t&);
@@ -87,6 +131,10 @@ protected:
 	virtual void find_rarest(const Handle&, Handle&, size_t&,
 	                         Quotation quotation=Quotation());
 
+	unsigned _nthreads;
+	bool use_workers(PatternMatchEngine *, size_t);
+	bool explore_candidates(PatternMatchEngine *, const HandleSeq&);
+
 	bool _search_fail;
 	virtual bool neighbor_search(PatternMatchEngine *);
 	virtual bool link_type_search(PatternMatchEngine *);
@@ -0,0 +1,348 @@
+/*
+ * JoinOrder.cc
+ *
+ * Copyright (C) 2017 OpenCog Foundation
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License v3 as
+ * published by the Free Software Foundation and including the exceptions
+ * at http://opencog.org/wiki/Licenses
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, write to:
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <algorithm>
+#include <limits>
+
+#include <opencog/atoms/base/ClassServer.h>
+#include <opencog/atoms/base/Link.h>
+#include <opencog/atomspace/AtomSpace.h>
+
+#include "JoinOrder.h"
+
+using namespace opencog;
+
+// Patterns with up to this many clauses get the cheapest order;
+// those with more get a greedy one. The search is over all subsets
+// of the clauses, so this can't be large.
+#define MAX_DP_CLAUSES 12
+
+// The links holding a constant are counted one by one, unless there
+// are more than this many of them.
+#define MAX_SCAN 4096
+
+static const double INFINITE_COST = std::numeric_limits<double>::infinity();
+
+JoinOrder::JoinOrder(AtomSpace* as, const Variables& vars,
+                     const Pattern& pat) :
+	_as(as), _vars(vars), _pat(pat)
+{
+	for (const Handle& cl : pat.mandatory)
+	{
+		if (0 < pat.evaluatable_holders.count(cl)) continue;
+		if (not cl->isLink()) continue;
+
+		Clause c;
+		c.root = cl;
+		c.population = population(cl->getType());
+		std::vector<Step> path;
+		find_anchors(c, cl, path);
+
+		// A clause without variables is a plain test; the engine gets
+		// to it whenever it likes.
+		if (c.vars.empty()) continue;
+
+		_clauses.push_back(c);
+	}
+
+	// There is nothing to order, unless there are two clauses.
+	if (_clauses.size() < 2) return;
+
+	for (Clause& c : _clauses)
+		for (Anchor& a : c.anchors)
+			if (a.constant) a.width = walk(a);
+}
+
+/**
+ * Find every constant and variable in the clause, and how to get from
+ * each one up to the top of the clause.  Anything inside of an
+ * evaluatable term, or a ChoiceLink, is skipped: the former need not
+ * exist in the atomspace, and the latter need not be there at all.
+ */
+void JoinOrder::find_anchors(Clause& cl, const Handle& h,
+                             std::vector<Step>& path, Quotation quotation)
+{
+	Type t = h->getType();
+	if (h->isNode())
+	{
+		if (GLOB_NODE == t) return;
+		bool var = quotation.is_unquoted() and _vars.is_in_varset(h);
+		if (var) cl.vars.insert(h);
+
+		Anchor a;
+		a.atom = h;
+		a.constant = not var;
+		a.path.assign(path.rbegin(), path.rend());
+		a.width = 0.0;
+		cl.anchors.push_back(a);
+		return;
+	}
+
+	if (quotation.is_unquoted())
+	{
+		if (CHOICE_LINK == t) return;
+		if (0 < _pat.evaluatable_terms.count(h)) return;
+	}
+
+	// Quotes are not in the atomspace; step right through them.
+	bool consumed = quotation.consumable(t);
+	quotation.update(t);
+
+	const HandleSeq& oset = h->getOutgoingSet();
+	for (size_t i = 0; i < oset.size(); i++)
+	{
+		if (consumed)
+		{
+			find_anchors(cl, oset[i], path, quotation);
+			continue;
+		}
+		path.push_back({t, i});
+		find_anchors(cl, oset[i], path, quotation);
+		path.pop_back();
+	}
+}
+
+double JoinOrder::population(Type t)
+{
+	size_t num = _as->get_num_atoms_of_type(t);
+	auto seen = [t](const std::pair<Type, size_t>& tc)
+		{ return tc.first == t; };
+	if (std::none_of(_type_counts.begin(), _type_counts.end(), seen))
+		_type_counts.emplace_back(t, num);
+	return std::max((double) num, 1.0);
+}
+
+double JoinOrder::fanout(Type t, size_t pos)
+{
+	std::pair<Type, size_t> key(t, pos);
+	auto it = _fanout.find(key);
+	if (_fanout.end() != it) return it->second;
+
+	population(t);
+	double mean = _as->get_fanout(t, pos).mean;
+	_fanout.emplace(key, mean);
+	return mean;
+}
+
+/**
+ * The number of candidates for the top of the clause, found by walking
+ * up from the anchor.  The first step up from a constant is counted
+ * exactly, if that is cheap to do.
+ */
+double JoinOrder::walk(const Anchor& a)
+{
+	if (a.path.empty()) return 1.0;
+
+	double w = 1.0;
+	size_t k = 0;
+	if (a.constant)
+	{
+		const Step& s = a.path[0];
+		size_t isz = a.atom->getIncomingSetSize();
+		if (MAX_SCAN < isz)
+			w = isz;
+		else
+		{
+			bool unordered = classserver().isA(s.type, UNORDERED_LINK);
+			w = 0.0;
+			for (const LinkPtr& lp : a.atom->getIncomingSetByType(s.type))
+				if (unordered or lp->getOutgoingAtom(s.pos) == a.atom) w++;
+		}
+		k = 1;
+	}
+
+	for (; k < a.path.size(); k++)
+		w *= fanout(a.path[k].type, a.path[k].pos);
+	return w;
+}
+
+/**
+ * Estimate the work needed to ground the clause, once the given
+ * variables have been grounded: that is, the number of candidates
+ * looked at, and the number of them that will be groundings.
+ */
+void JoinOrder::estimate(const Clause& cl, const OrderedHandleSet& bound,
+                         double& work, double& rows)
+{
+	std::vector<double> widths;
+	for (const Anchor& a : cl.anchors)
+	{
+		if (a.constant)
+			widths.push_back(a.width);
+		else if (0 < bound.count(a.atom))
+			widths.push_back(walk(a));
+	}
+
+	// Nothing to walk up from; every atom of the type is a candidate.
+	if (widths.empty())
+	{
+		work = rows = cl.population;
+		return;
+	}
+
+	auto least = std::min_element(widths.begin(), widths.end());
+	work = *least;
+	rows = work;
+	for (auto it = widths.begin(); it != widths.end(); it++)
+		if (it != least)
+			rows *= std::min(1.0, *it / cl.population);
+}
+
+bool JoinOrder::connected(const Clause& cl,
+                          const OrderedHandleSet& bound) const
+{
+	for (const Handle& v : cl.vars)
+		if (0 < bound.count(v)) return true;
+	return false;
+}
+
+double JoinOrder::order(const Handle& start, HandleSeq& order)
+{
+	order.clear();
+
+	size_t s = 0;
+	while (s < _clauses.size() and _clauses[s].root != start) s++;
+	if (_clauses.size() == s) return INFINITE_COST;
+
+	std::vector<size_t> seq;
+	double cost = (_clauses.size() <= MAX_DP_CLAUSES) ?
+		best_order(s, seq) : INFINITE_COST;
+	if (INFINITE_COST == cost)
+		cost = greedy_order(s, seq);
+
+	for (size_t i : seq)
+		order.push_back(_clauses[i].root);
+	return cost;
+}
+
+/**
+ * Dynamic programming over the subsets of the clauses: the cheapest
+ * way of grounding each subset that includes the start clause, built
+ * up one clause at a time.  Each step must share a variable with the
+ * clauses already grounded, since that is how the engine gets from
+ * one clause to the next.
+ */
+double JoinOrder::best_order(size_t start, std::vector<size_t>& seq)
+{
+	size_t n = _clauses.size();
+	size_t nsets = ((size_t) 1) << n;
+	std::vector<double> cost(nsets, INFINITE_COST);
+	std::vector<double> rows(nsets, 0.0);
+	std::vector<size_t> last(nsets, n);
+
+	double work;
+	size_t first = ((size_t) 1) << start;
+	estimate(_clauses[start], OrderedHandleSet(), work, rows[first]);
+	cost[first] = std::max(work, 1.0);
+	last[first] = start;
+
+	// Every set is bigger than all of its subsets, so it is done
+	// after them.
+	for (size_t set = first; set < nsets; set++)
+	{
+		if (INFINITE_COST == cost[set]) continue;
+
+		OrderedHandleSet bound;
+		for (size_t i = 0; i < n; i++)
+			if (set & (((size_t) 1) << i))
+				bound.insert(_clauses[i].vars.begin(),
+				             _clauses[i].vars.end());
+
+		for (size_t j = 0; j < n; j++)
+		{
+			size_t bit = ((size_t) 1) << j;
+			if (set & bit) continue;
+			if (not connected(_clauses[j], bound)) continue;
+
+			double out;
+			estimate(_clauses[j], bound, work, out);
+			double c = cost[set] + rows[set] * std::max(work, 1.0);
+			if (c < cost[set | bit])
+			{
+				cost[set | bit] = c;
+				rows[set | bit] = rows[set] * out;
+				last[set | bit] = j;
+			}
+		}
+	}
+
+	size_t set = nsets - 1;
+	if (INFINITE_COST == cost[set]) return INFINITE_COST;
+
+	double total = cost[set];
+	seq.clear();
+	while (set)
+	{
+		size_t j = last[set];
+		seq.push_back(j);
+		set &= ~(((size_t) 1) << j);
+	}
+	std::reverse(seq.begin(), seq.end());
+	return total;
+}
+
+/**
+ * Ground the clause that yields the fewest groundings next, and then
+ * the one after that, and so on.  Clauses that cannot be reached from
+ * the start are left for the engine to deal with.
+ */
+double JoinOrder::greedy_order(size_t start, std::vector<size_t>& seq)
+{
+	size_t n = _clauses.size();
+	std::vector<bool> done(n, false);
+	OrderedHandleSet bound;
+
+	double work, rows;
+	estimate(_clauses[start], bound, work, rows);
+	double cost = std::max(work, 1.0);
+	seq.assign(1, start);
+	done[start] = true;
+	bound.insert(_clauses[start].vars.begin(), _clauses[start].vars.end());
+
+	while (seq.size() < n)
+	{
+		size_t best = n;
+		double best_work = 0.0, best_out = INFINITE_COST;
+		for (size_t j = 0; j < n; j++)
+		{
+			if (done[j] or not connected(_clauses[j], bound)) continue;
+			double out;
+			estimate(_clauses[j], bound, work, out);
+			if (out < best_out or (out == best_out and work < best_work))
+			{
+				best = j;
+				best_work = work;
+				best_out = out;
+			}
+		}
+		if (n == best) break;
+
+		cost += rows * std::max(best_work, 1.0);
+		rows *= best_out;
+		seq.push_back(best);
+		done[best] = true;
+		bound.insert(_clauses[best].vars.begin(), _clauses[best].vars.end());
+	}
+	return cost;
+}
+
+/* ===================== END OF FILE ===================== */
@@ -0,0 +1,135 @@
+/*
+ * JoinOrder.h
+ *
+ * Copyright (C) 2017 OpenCog Foundation
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License v3 as
+ * published by the Free Software Foundation and including the exceptions
+ * at http://opencog.org/wiki/Licenses
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, write to:
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _OPENCOG_JOIN_ORDER_H
+#define _OPENCOG_JOIN_ORDER_H
+
+#include <map>
+#include <utility>
+#include <vector>
+
+#include <opencog/atoms/base/Handle.h>
+#include <opencog/atoms/base/Quotation.h>
+#include <opencog/atoms/core/Variables.h>
+#include <opencog/atoms/pattern/Pattern.h>
+
+namespace opencog {
+
+class AtomSpace;
+
+/**
+ * A cost model for the order in which the clauses of a pattern get
+ * grounded.
+ *
+ * Grounding a clause, once some of its atoms are known (either because
+ * they are constants, or because they are variables that earlier
+ * clauses have grounded), means walking upwards from one of those
+ * atoms, through the incoming sets, to the top of the clause.  The
+ * number of candidates found that way is estimated from the fan-out
+ * statistics that the AtomTable keeps (see FanoutStats): for each link
+ * on the way up, the average number of links of that type that hold
+ * the same atom at that position.  Each of the other known atoms in
+ * the clause then rules out some of the candidates; it is assumed that
+ * they do so independently of one another.
+ *
+ * The cost of an ordering is the total number of candidates looked at;
+ * the cheapest one is found by dynamic programming over the subsets of
+ * the clauses, or greedily, if there are too many clauses for that.
+ *
+ * Only the mandatory clauses that exist in the atomspace are ordered;
+ * the evaluatable and the optional clauses are grounded after those,
+ * as they always were.
+ */
+class JoinOrder
+{
+	struct Step
+	{
+		Type type;
+		size_t pos;
+	};
+
+	struct Anchor
+	{
+		Handle atom;
+		bool constant;
+
+		// The links from the atom up to the top of the clause.
+		std::vector<Step> path;
+
+		// The number of candidates, when starting from a constant.
+		double width;
+	};
+
+	struct Clause
+	{
+		Handle root;
+		double population;
+		std::vector<Anchor> anchors;
+		OrderedHandleSet vars;
+	};
+
+	AtomSpace* _as;
+	const Variables& _vars;
+	const Pattern& _pat;
+	std::vector<Clause> _clauses;
+
+	std::map<std::pair<Type, size_t>, double> _fanout;
+	std::vector<std::pair<Type, size_t>> _type_counts;
+
+	void find_anchors(Clause&, const Handle&, std::vector<Step>&,
+	                  Quotation quotation=Quotation());
+	double fanout(Type, size_t);
+	double population(Type);
+	double walk(const Anchor&);
+	void estimate(const Clause&, const OrderedHandleSet&,
+	              double& work, double& rows);
+	bool connected(const Clause&, const OrderedHandleSet&) const;
+
+	double best_order(size_t, std::vector<size_t>&);
+	double greedy_order(size_t, std::vector<size_t>&);
+
+public:
+	JoinOrder(AtomSpace*, const Variables&, const Pattern&);
+
+	/// The number of clauses that can be ordered.
+	size_t size(void) const { return _clauses.size(); }
+
+	/**
+	 * Find the cheapest order in which to ground the clauses, if the
+	 * search starts with the given clause.  The order (starting with
+	 * the given clause) is placed in the HandleSeq; the estimated cost
+	 * is returned.  If the clause is not one that can be ordered, the
+	 * order is left empty, and the cost is infinite.
+	 */
+	double order(const Handle&, HandleSeq&);
+
+	/// The number of atoms of each type that the estimates made so far
+	/// were based on.
+	const std::vector<std::pair<Type, size_t>>& type_counts(void) const
+	{
+		return _type_counts;
+	}
+};
+
+} // namespace opencog
+
+#endif // _OPENCOG_JOIN_ORDER_H
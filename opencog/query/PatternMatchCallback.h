@@ -335,6 +335,25 @@ class PatternMatchCallback
 		 */
 		virtual void set_pattern(const Variables& vars,
 		                         const Pattern& pat) = 0;
+
+		/**
+		 * Called to create a callback for a worker thread, when the
+		 * search is split across several threads. Each worker gets
+		 * its own engine, and reports its groundings to its own
+		 * callback; the worker callback is expected to pass them on
+		 * to this one, which must then be able to accept them from
+		 * several threads at once. Returning null (the default)
+		 * means that the search cannot be split, and is done in
+		 * the calling thread.
+		 */
+		virtual PatternMatchCallback* make_worker(void) { return nullptr; }
+
+		/**
+		 * Called when a worker created by make_worker() is done. The
+		 * callee may gather up any state that the worker kept, and
+		 * must dispose of the worker.
+		 */
+		virtual void release_worker(PatternMatchCallback* w) { delete w; }
 };
 
 } // namespace opencog
@@ -1549,6 +1549,37 @@ bool PatternMatchEngine::get_next_thinnest_clause(bool search_virtual,
 		else ungrounded_vars.insert(v);
 	}
 
+	auto untried = [&](const Handle& root)
+	{
+		return (issued.end() == issued.find(root))
+		        and (search_virtual or not is_evaluatable(root))
+		        and (search_black or not is_black(root))
+		        and (search_optionals or not is_optional(root));
+	};
+
+	// If there is a join order, the next clause is the earliest one
+	// in it that shares a grounded variable with the clauses grounded
+	// so far; it is joined through the thinnest such variable.
+	size_t best_rank = SIZE_MAX;
+	for (auto tckvar : thick_vars)
+	{
+		if (_join_rank.empty()) break;
+		const Handle& pursue = tckvar.second;
+		auto root_list = _pat->connectivity_map.equal_range(pursue);
+		for (auto it = root_list.first; it != root_list.second; it++)
+		{
+			const Handle& root = it->second;
+			auto rank = _join_rank.find(root);
+			if (_join_rank.end() == rank or best_rank <= rank->second)
+				continue;
+			if (not untried(root)) continue;
+			best_rank = rank->second;
+			unsolved_clause = root;
+			joint = pursue;
+			unsolved = true;
+		}
+	}
+
 	// We are looking for a joining atom, one that is shared in common
 	// with the a fully grounded clause, and an as-yet ungrounded clause.
 	// The joint is called "pursue", and the unsolved clause that it
@@ -1558,6 +1589,7 @@ bool PatternMatchEngine::get_next_thinnest_clause(bool search_virtual,
 	// yet variables.
 	for (auto tckvar : thick_vars)
 	{
+		if (SIZE_MAX != best_rank) break;
 		std::size_t pursue_thickness = tckvar.first;
 		const Handle& pursue = tckvar.second;
 
@@ -1568,10 +1600,7 @@ bool PatternMatchEngine::get_next_thinnest_clause(bool search_virtual,
 		for (auto it = root_list.first; it != root_list.second; it++)
 		{
 			const Handle& root = it->second;
-			if ((issued.end() == issued.find(root))
-			        and (search_virtual or not is_evaluatable(root))
-			        and (search_black or not is_black(root))
-			        and (search_optionals or not is_optional(root)))
+			if (untried(root))
 			{
 				unsigned int root_thickness = thickness(root, ungrounded_vars);
 				if (root_thickness < thinnest_clause)
@@ -1862,6 +1891,14 @@ void PatternMatchEngine::set_pattern(const Variables& v,
 {
 	_varlist = &v;
 	_pat = &p;
+	_join_rank.clear();
+}
+
+void PatternMatchEngine::set_join_order(const HandleSeq& order)
+{
+	_join_rank.clear();
+	for (size_t i = 0; i < order.size(); i++)
+		_join_rank.emplace(order[i], i);
 }
 
 /* ======================================================== */
@@ -136,6 +136,8 @@ private:
 	bool get_next_thinnest_clause(bool, bool, bool);
 	unsigned int thickness(const Handle&, const OrderedHandleSet&);
 	Handle next_clause;
+	// Position of each clause in the join order, if one was given.
+	std::unordered_map<Handle, size_t> _join_rank;
 	Handle next_joint;
 	// Set of clauses for which a grounding is currently being attempted.
 	typedef OrderedHandleSet IssuedSet;
@@ -214,6 +216,12 @@ private:
 public:
 	PatternMatchEngine(PatternMatchCallback&);
 	void set_pattern(const Variables&, const Pattern&);
+	PatternMatchCallback& get_callback(void) { return _pmc; }
+
+	// Ground the clauses in this order, as far as the connections
+	// between them allow. An empty order means that the engine picks
+	// the thinnest clause, as it goes. Cleared by set_pattern().
+	void set_join_order(const HandleSeq&);
 
 	// Examine the locally connected neighborhood for possible
 	// matches.
@@ -40,7 +40,22 @@ class PatternSCM : public ModuleWrap
 using namespace opencog;
 
 // ========================================================
-// Convenience wrapper
+// Convenience wrappers
+
+// The guile wrappers have no slot for both a thread count and a
+// result limit; the parallel variants always look for everything.
+static Handle bindlink_parallel(AtomSpace* as, const Handle& h,
+                                size_t nthreads)
+{
+	return parallel_bindlink(as, h, nthreads);
+}
+
+static Handle satisfying_set_parallel(AtomSpace* as, const Handle& h,
+                                      size_t nthreads)
+{
+	return parallel_satisfying_set(as, h, nthreads);
+}
+
 Handle PatternSCM::find_approximate_match(Handle hp)
 {
 	FuzzyMatchBasic fpm;
@@ -105,6 +120,13 @@ void PatternSCM::init(void)
 	_binders.push_back(new FunctionWrap(satisfying_set,
 	                   "cog-satisfying-set-first-n", "query"));
 
+	// Same as above, but split across N threads, assuming that N is
+	// the second argument; zero means one thread per core.
+	_binders.push_back(new FunctionWrap(bindlink_parallel,
+	                   "cog-bind-parallel", "query"));
+	_binders.push_back(new FunctionWrap(satisfying_set_parallel,
+	                   "cog-satisfying-set-parallel", "query"));
+
 	// Rule recognition.
 	_binders.push_back(new FunctionWrap(recognize,
 	                   "cog-recognize", "query"));
@@ -0,0 +1,101 @@
+/*
+ * QueryPlan.cc
+ *
+ * Copyright (C) 2017 OpenCog Foundation
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License v3 as
+ * published by the Free Software Foundation and including the exceptions
+ * at http://opencog.org/wiki/Licenses
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, write to:
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <atomic>
+
+#include <opencog/atoms/core/DefineLink.h>
+#include <opencog/atomspace/AtomSpace.h>
+
+#include "QueryPlan.h"
+
+using namespace opencog;
+
+// A size has drifted when it has grown or shrunk by more than this
+// factor, and by more than this many atoms. Small sizes jitter a lot,
+// and don't matter much.
+#define DRIFT_FACTOR 2
+#define DRIFT_SLACK 64
+
+static std::atomic<size_t> plan_hits(0);
+static std::atomic<size_t> plan_misses(0);
+static std::atomic<size_t> plan_replans(0);
+
+static bool size_drifted(size_t then, size_t now)
+{
+	size_t lo = std::min(then, now);
+	size_t hi = std::max(then, now);
+	if (hi - lo <= DRIFT_SLACK) return false;
+	return hi > DRIFT_FACTOR * lo;
+}
+
+bool QueryPlan::drifted(AtomSpace* as) const
+{
+	for (const auto& w : widths)
+		if (size_drifted(w.second, w.first->getIncomingSetSize()))
+			return true;
+
+	for (const auto& tc : type_counts)
+		if (size_drifted(tc.second, as->get_num_atoms_of_type(tc.first)))
+			return true;
+
+	return false;
+}
+
+bool QueryPlan::expansion_current() const
+{
+	for (const auto& def : definitions)
+	{
+		try
+		{
+			if (DefineLink::get_definition(def.first) != def.second)
+				return false;
+		}
+		catch (...)
+		{
+			// The definition was deleted.
+			return false;
+		}
+	}
+	return true;
+}
+
+void QueryPlan::count_hit(void) { plan_hits++; }
+void QueryPlan::count_miss(void) { plan_misses++; }
+void QueryPlan::count_replan(void) { plan_replans++; }
+
+QueryPlanStats QueryPlan::get_stats(void)
+{
+	QueryPlanStats stats;
+	stats.hits = plan_hits.load();
+	stats.misses = plan_misses.load();
+	stats.replans = plan_replans.load();
+	return stats;
+}
+
+void QueryPlan::reset_stats(void)
+{
+	plan_hits = 0;
+	plan_misses = 0;
+	plan_replans = 0;
+}
+
+/* ===================== END OF FILE ===================== */
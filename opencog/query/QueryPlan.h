@@ -0,0 +1,131 @@
+/*
+ * QueryPlan.h
+ *
+ * Copyright (C) 2017 OpenCog Foundation
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License v3 as
+ * published by the Free Software Foundation and including the exceptions
+ * at http://opencog.org/wiki/Licenses
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, write to:
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _OPENCOG_QUERY_PLAN_H
+#define _OPENCOG_QUERY_PLAN_H
+
+#include <memory>
+#include <set>
+#include <typeindex>
+#include <utility>
+#include <vector>
+
+#include <opencog/atoms/base/Handle.h>
+#include <opencog/atoms/pattern/PatternLink.h>
+
+namespace opencog {
+
+class AtomSpace;
+
+struct QueryPlanStats
+{
+	size_t hits;      // Plans that were used as-is.
+	size_t misses;    // Patterns that had no plan yet.
+	size_t replans;   // Plans thrown away, because the atomspace changed.
+};
+
+/**
+ * The decisions that InitiateSearchCB makes before it starts a
+ * search: which of the search strategies applies, where the search
+ * starts, and in which order the clauses get grounded (see JoinOrder).
+ * These depend on nothing but the pattern, and on the sizes of some
+ * incoming sets and type populations; so they are made once, and kept
+ * with the pattern (in Pattern::plan) for the next time. When those
+ * sizes have changed a lot, the plan is made over again.
+ *
+ * A plan only affects how fast the groundings are found, never which
+ * ones are found.
+ *
+ * Patterns with defined terms in them are expanded just before the
+ * search; the expanded pattern is kept in the plan of the original
+ * pattern, and is re-used for as long as the definitions stay the
+ * same. The expanded pattern has its own plan.
+ */
+struct QueryPlan
+{
+	enum Strategy
+	{
+		NONE,           // Only holds an expansion.
+		NEIGHBOR,       // Start from the incoming set of a constant.
+		NO_SEARCH,      // No variables; evaluate the clauses.
+		LINK_TYPE,      // Start from all links of the rarest type.
+		VARIABLE        // Start from all atoms a variable may take.
+	};
+
+	struct Choice
+	{
+		size_t clause;
+		Handle best_start;
+		Handle start_term;
+
+		// The order in which to ground the clauses, starting with
+		// this one; empty, if the engine is to pick as it goes.
+		HandleSeq order;
+	};
+
+	Strategy strategy = NONE;
+
+	// The callback class that made the plan, and the atomspace it was
+	// made in. The plan is good only for the same two: another class
+	// may start its searches some other way, and the start points
+	// belong to the atomspace. The atomspace is known by its UUID, not
+	// its address, which a later atomspace may be given.
+	std::type_index made_by = typeid(void);
+	UUID space = 0;
+
+	// Start points, for the neighbor search.
+	std::vector<Choice> choices;
+
+	// Start clause, term, candidate types and clause order, for the
+	// link-type and variable searches. No types means all atoms.
+	Handle root;
+	Handle starter_term;
+	std::set<Type> types;
+	HandleSeq order;
+
+	// The sizes that the choices above were based on.
+	std::vector<std::pair<Handle, size_t>> widths;
+	std::vector<std::pair<Type, size_t>> type_counts;
+
+	// The expanded pattern, and the definitions it was expanded with.
+	PatternLinkPtr expanded;
+	HandleMap definitions;
+
+	/// True if the sizes have moved far enough from the ones the
+	/// plan was based on, that it should be made over again.
+	bool drifted(AtomSpace*) const;
+
+	/// True if the definitions have not changed since the expansion.
+	bool expansion_current() const;
+
+	static void count_hit(void);
+	static void count_miss(void);
+	static void count_replan(void);
+	static QueryPlanStats get_stats(void);
+	static void reset_stats(void);
+};
+
+typedef std::shared_ptr<const QueryPlan> QueryPlanPtr;
+
+} // namespace opencog
+
+#endif // _OPENCOG_QUERY_PLAN_H
@@ -21,6 +21,8 @@
  * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
  */
 
+#include <typeinfo>
+
 #include <opencog/atomspace/AtomSpace.h>
 #include <opencog/atoms/pattern/PatternLink.h>
 
@@ -87,6 +89,23 @@ bool Satisfier::search_finished(bool done)
 	return rc;
 }
 
+/// Workers keep their own result; it is merged when they are done.
+PatternMatchCallback* Satisfier::make_worker(void)
+{
+	// A derived class would need workers of its own kind.
+	if (typeid(*this) != typeid(Satisfier)) return nullptr;
+
+	return new Satisfier(InitiateSearchCB::_as);
+}
+
+void Satisfier::release_worker(PatternMatchCallback* w)
+{
+	Satisfier* sw = dynamic_cast<Satisfier*>(w);
+	if (sw and TruthValue::TRUE_TV() == sw->_result)
+		_result = TruthValue::TRUE_TV();
+	DefaultPatternMatchCB::release_worker(w);
+}
+
 // ===========================================================
 
 bool SatisfyingSet::grounding(const HandleMap &var_soln,
@@ -94,16 +113,19 @@ bool SatisfyingSet::grounding(const HandleMap &var_soln,
 {
 	// PatternMatchEngine::log_solution(var_soln, term_soln);
 
+	SatisfyingSet* sink = _sink ? _sink : this;
+	std::lock_guard<std::mutex> lck(sink->_set_mtx);
+
 	// Do not accept new solution if maximum number has been already reached
-	if (_satisfying_set.size() >= max_results)
+	if (sink->_satisfying_set.size() >= max_results)
 		return true;
 
 	if (1 == _varseq.size())
 	{
-		_satisfying_set.emplace(var_soln.at(_varseq[0]));
+		sink->_satisfying_set.emplace(var_soln.at(_varseq[0]));
 
 		// If we found as many as we want, then stop looking for more.
-		return (_satisfying_set.size() >= max_results);
+		return (sink->_satisfying_set.size() >= max_results);
 	}
 
 	// If more than one variable, encapsulate in sequential order,
@@ -113,10 +135,21 @@ bool SatisfyingSet::grounding(const HandleMap &var_soln,
 	{
 		vargnds.push_back(var_soln.at(hv));
 	}
-	_satisfying_set.emplace(Handle(createLink(vargnds, LIST_LINK)));
+	sink->_satisfying_set.emplace(Handle(createLink(vargnds, LIST_LINK)));
 
 	// If we found as many as we want, then stop looking for more.
-	return (_satisfying_set.size() >= max_results);
+	return (sink->_satisfying_set.size() >= max_results);
+}
+
+PatternMatchCallback* SatisfyingSet::make_worker(void)
+{
+	// A derived class would need workers of its own kind.
+	if (typeid(*this) != typeid(SatisfyingSet)) return nullptr;
+
+	SatisfyingSet* w = new SatisfyingSet(InitiateSearchCB::_as);
+	w->max_results = max_results;
+	w->_sink = this;
+	return w;
 }
 
 TruthValuePtr opencog::satisfaction_link(AtomSpace* as, const Handle& hlink)
@@ -138,7 +171,8 @@ TruthValuePtr opencog::satisfaction_link(AtomSpace* as, const Handle& hlink)
 	return sater._result;
 }
 
-Handle opencog::satisfying_set(AtomSpace* as, const Handle& hlink, size_t max_results)
+static Handle do_satisfying_set(AtomSpace* as, const Handle& hlink,
+                                unsigned nthreads, size_t max_results)
 {
 	// Special case the BindLink. We probably shouldn't have to, and
 	// the C++ code for handling this case could maybe be refactored
@@ -147,7 +181,9 @@ Handle opencog::satisfying_set(AtomSpace* as, const Handle& hlink, size_t max_re
 	Type blt = hlink->getType();
 	if (BIND_LINK == blt)
 	{
-		return bindlink(as, hlink, max_results);
+		if (1 == nthreads)
+			return bindlink(as, hlink, max_results);
+		return parallel_bindlink(as, hlink, nthreads, max_results);
 	}
 	if (DUAL_LINK == blt)
 	{
@@ -162,6 +198,7 @@ Handle opencog::satisfying_set(AtomSpace* as, const Handle& hlink, size_t max_re
 
 	SatisfyingSet sater(as);
 	sater.max_results = max_results;
+	sater.set_threads(nthreads);
 	bl->satisfy(sater);
 
 	// Ugh. We used an std::set to avoid duplicates. But now, we need a
@@ -173,4 +210,15 @@ Handle opencog::satisfying_set(AtomSpace* as, const Handle& hlink, size_t max_re
 	return as->add_link(SET_LINK, satvec);
 }
 
+Handle opencog::satisfying_set(AtomSpace* as, const Handle& hlink, size_t max_results)
+{
+	return do_satisfying_set(as, hlink, 1, max_results);
+}
+
+Handle opencog::parallel_satisfying_set(AtomSpace* as, const Handle& hlink,
+                                        unsigned nthreads, size_t max_results)
+{
+	return do_satisfying_set(as, hlink, nthreads, max_results);
+}
+
 /* ===================== END OF FILE ===================== */
@@ -24,6 +24,7 @@
 #ifndef _OPENCOG_SATISFIER_H
 #define _OPENCOG_SATISFIER_H
 
+#include <mutex>
 #include <vector>
 
 #include <opencog/truthvalue/TruthValue.h>
@@ -73,6 +74,9 @@ class Satisfier :
 
 		// Final pass, if no grounding was found.
 		virtual bool search_finished(bool);
+
+		virtual PatternMatchCallback* make_worker(void);
+		virtual void release_worker(PatternMatchCallback*);
 };
 
 /**
@@ -93,7 +97,8 @@ class SatisfyingSet :
 {
 	public:
 		SatisfyingSet(AtomSpace* as) :
-			InitiateSearchCB(as), DefaultPatternMatchCB(as), max_results(SIZE_MAX) {}
+			InitiateSearchCB(as), DefaultPatternMatchCB(as),
+			max_results(SIZE_MAX), _sink(nullptr) {}
 		HandleSeq _varseq;
 		OrderedHandleSet _satisfying_set;
 		size_t max_results;
@@ -113,6 +118,14 @@ class SatisfyingSet :
 		// groundings.
 		virtual bool grounding(const HandleMap &var_soln,
 		                       const HandleMap &term_soln);
+
+		virtual PatternMatchCallback* make_worker(void);
+
+	protected:
+		// Workers put their groundings into the satisfying set of
+		// the callback that created them; the lock guards that set.
+		SatisfyingSet* _sink;
+		std::mutex _set_mtx;
 };
 
 }; // namespace opencog
@@ -95,6 +95,65 @@
         )
 ")
 
+(set-procedure-property! cog-new-atoms 'documentation
+"
+ cog-new-atoms ATOM-1 ... ATOM-N
+    Add all of the given atoms to the atomspace, in one batch, and
+    return the list of atoms that are in the atomspace, in the same
+    order.  Lists of atoms may be given as well; these are flattened.
+    Optionally, an atomspace can be included in the arguments; the
+    atoms are added to it, instead of the current atomspace.
+
+    Instead of atoms, atom descriptions may be given: quoted lists,
+    such as '(ConceptNode \"abc\" (stv 0.5 0.5)), of the type name,
+    followed by the node name or the outgoing atoms (or descriptions),
+    with an optional truth value.  These are turned into atoms without
+    creating any scheme objects for them, except for the result.
+
+    This is much faster than adding the atoms one at a time, when
+    there are many of them; for example, when copying the contents of
+    one atomspace into another.
+
+    Example:
+        ; Copy some atoms into another atomspace:
+        guile> (define x (cog-new-node 'ConceptNode \"abc\"))
+        guile> (define y (cog-new-node 'ConceptNode \"def\"))
+        guile> (define as2 (cog-new-atomspace))
+        guile> (cog-new-atoms (list x y (ListLink x y)) as2)
+        ((ConceptNode \"abc\")
+         (ConceptNode \"def\")
+         (ListLink
+           (ConceptNode \"abc\")
+           (ConceptNode \"def\")
+         )
+        )
+
+        ; Add atoms from descriptions:
+        guile> (cog-new-atoms
+                  '(InheritanceLink (ConceptNode \"cat\") (ConceptNode \"animal\"))
+                  '(ConceptNode \"dog\" (stv 0.9 0.8)))
+")
+
+(set-procedure-property! cog-load-atomese 'documentation
+"
+ cog-load-atomese FILENAME [ATOMSPACE]
+    Load the atoms in the file FILENAME into the atomspace, returning
+    the number of top-level atoms in it.  The file is parsed directly,
+    without the scheme evaluator, and the atoms are added in large
+    batches, so this is many times faster than (load FILENAME) for
+    large files.  Optionally, an atomspace can be given; the atoms are
+    added to it, instead of the current atomspace.
+
+    Only plain atomese is understood: atoms, with truth values written
+    as (stv M C) or (ctv M C N), and comments.  Anything else, such as
+    (define ...), throws an error giving the line it is on; such files
+    have to be loaded with (load FILENAME).
+
+    Example:
+        guile> (cog-load-atomese \"/tmp/kb.scm\")
+        150000
+")
+
 (set-procedure-property! cog-link 'documentation
 "
  cog-link LINK-TYPE ATOM-1 ... ATOM-N
@@ -974,6 +1033,35 @@
      Remove all atoms from ATOMSPACE.
 ")
 
+(set-procedure-property! cog-save-snapshot 'documentation
+"
+ cog-save-snapshot FILENAME [ATOMSPACE]
+     Write all of the atoms in the atomspace, with their truth values
+     and values, to the snapshot file FILENAME.  Optionally, an
+     atomspace can be given; it is written instead of the current
+     atomspace.  The file is written under a temporary name and then
+     renamed, so an older snapshot of the same name is replaced only
+     once the new one is complete.
+
+     Example:
+        guile> (cog-save-snapshot \"/var/lib/opencog/kb.snap\")
+")
+
+(set-procedure-property! cog-load-snapshot 'documentation
+"
+ cog-load-snapshot FILENAME [ATOMSPACE]
+     Add the atoms in the snapshot file FILENAME, as written by
+     cog-save-snapshot, to the atomspace, returning the number of
+     atoms in the snapshot.  This is much faster than loading the
+     same atoms from scheme files, or from SQL.  Optionally, an
+     atomspace can be given; the atoms are added to it, instead of
+     the current atomspace.
+
+     Example:
+        guile> (cog-load-snapshot \"/var/lib/opencog/kb.snap\")
+        3000000
+")
+
 ;set-procedure-property! cog-yield 'documentation
 ;"
 ; cog-yield
@@ -41,6 +41,22 @@
     The search is terminated after the first N matches are found.
 ")
 
+(set-procedure-property! cog-bind-parallel 'documentation
+"
+ cog-bind-parallel handle N
+    Run pattern matcher on handle.  handle must be a BindLink.
+    The search is split across N threads; if N is zero, one thread
+    per core is used. Any GroundedPredicateNodes in the pattern will
+    be evaluated in those threads.
+")
+
+(set-procedure-property! cog-satisfying-set-parallel 'documentation
+"
+ cog-satisfying-set-parallel handle N
+    Find the set of all groundings of the pattern in handle, using
+    N threads; if N is zero, one thread per core is used.
+")
+
 (set-procedure-property! cog-bind-single 'documentation
 "
  cog-bind-single handle
@@ -1,6 +1,7 @@
 from unittest import TestCase
+from array import array
 
-from opencog.atomspace import AtomSpace, TruthValue, Atom
+from opencog.atomspace import AtomSpace, AtomArray, TruthValue, Atom
 from opencog.atomspace import types, is_a, get_type, get_type_name
 
 from opencog.type_constructors import *
@@ -72,6 +73,64 @@ class AtomSpaceTest(TestCase):
             caught = True
         self.assertEquals(caught, True)
 
+    def test_add_atoms(self):
+        n1 = Node("test1")
+        n2 = Node("test2")
+        l1 = Link(n1, n2)
+
+        # Copy the atoms into another atomspace, in one batch.
+        other = AtomSpace()
+        added = other.add_atoms([l1, n1, n2, l1])
+        self.assertEquals(len(added), 4)
+        self.assertEquals(other.size(), 3)
+        self.assertEquals(added[0], added[3])
+        self.assertEquals(added[0].out, [added[1], added[2]])
+
+        # Atoms already there are found, not added again.
+        self.assertEquals(self.space.add_atoms([n1, l1]), [n1, l1])
+        self.assertEquals(self.space.size(), 3)
+
+        # Anything that is not an Atom is an error, and nothing is added.
+        self.assertRaises(TypeError, other.add_atoms,
+                          [Node("test3"), "test4"])
+        self.assertEquals(other.size(), 3)
+
+    def test_atom_array(self):
+        nodes = [Node("bulk %d" % i) for i in range(5)]
+        nodes[1].tv = TruthValue(0.25, 0.5)
+        key = PredicateNode("bulk key")
+
+        atoms = self.space.get_atom_array(types.Node, False)
+        self.assertEquals(len(atoms), 5)
+        self.assertEquals(sorted(atoms.atoms()), sorted(nodes))
+        self.assertEquals(list(atoms.types()), [types.Node] * 5)
+        self.assertEquals(len(set(atoms.ids())), 5)
+
+        # Truth values come as (strength, confidence) pairs.
+        atoms = AtomArray(nodes)
+        tvs = atoms.tvs()
+        self.assertEquals(len(tvs), 10)
+        self.assertEquals(list(tvs[2:4]), [0.25, 0.5])
+
+        tvs[0] = 0.75
+        tvs[1] = 0.875
+        atoms.set_tvs(tvs)
+        self.assertEquals(nodes[0].tv, TruthValue(0.75, 0.875))
+        self.assertRaises(ValueError, atoms.set_tvs, array('f', [0.5]))
+
+        # FloatValues, two to each atom, and then one each for the
+        # first two.
+        atoms.set_float_values(key, array('d', range(10)), 2)
+        values, offsets = atoms.float_values(key)
+        self.assertEquals(list(values), list(range(10)))
+        self.assertEquals(list(offsets), [0, 2, 4, 6, 8, 10])
+
+        atoms.set_float_values(key, array('d', [1, 2]),
+                               array('l', [0, 1, 2, 2, 2, 2]))
+        values, offsets = atoms.float_values(key)
+        self.assertEquals(list(values), [1, 2])
+        self.assertEquals(list(offsets), [0, 1, 2, 2, 2, 2])
+
     def test_is_valid(self):
         a1 = Node("test1")
         # check with Atom object
@@ -235,6 +294,24 @@ class AtomSpaceTest(TestCase):
         self.assertEquals(self.space.size(), 0) 
         self.assertEquals(len(self.space), 0) 
 
+    def test_snapshot(self):
+        import os, tempfile
+        a = ConceptNode("a").truth_value(0.5, 0.25)
+        l = ListLink(a, PredicateNode("b"))
+        fd, path = tempfile.mkstemp()
+        os.close(fd)
+        try:
+            self.space.save_snapshot(path)
+            space2 = AtomSpace()
+            self.assertEquals(space2.load_snapshot(path), 3)
+            self.assertEquals(space2.size(), 3)
+            a2 = space2.add_node(types.ConceptNode, "a")
+            self.assertAlmostEqual(a2.tv.mean, 0.5)
+            self.assertAlmostEqual(a2.tv.confidence, 0.25)
+            self.assertRaises(RuntimeError, space2.load_snapshot, path + ".none")
+        finally:
+            os.remove(path)
+
     def test_container_methods(self):
         self.assertEquals(len(self.space), 0) 
         a1 = Node("test1")
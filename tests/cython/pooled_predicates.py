@@ -0,0 +1,12 @@
+"""
+Predicates for PythonEvalUTest to evaluate in the worker processes,
+which can only see predicates that are in a module.
+"""
+
+from opencog.atomspace import TruthValue
+
+
+def name_length(atom):
+    """ The strength is the length of the name; the confidence is the
+    argument's own, copied to the worker along with it. """
+    return TruthValue(len(atom.name) / 100.0, atom.tv.confidence)